@@ -0,0 +1,167 @@
+#pragma once
+
+// 백그라운드 에셋 로더
+// 이미지 디코딩과 OBJ 파싱처럼 오래 걸리는 CPU 작업을 작업 스레드 풀에서 실행하여, 에셋 크기와 관계없이 첫 프레임을 바로 그릴 수 있게 합니다.
+// 작업(Job)은 작업 스레드에서 실행되며 Vulkan 을 호출하지 않아야 합니다. 대신 메인 스레드에서 실행할 완료 함수(Publish)를 돌려주고, 메인 스레드는 프레임 사이에 dispatchCompleted 로 끝난 작업들의 완료 함수를 실행합니다.
+// 그래서 버퍼 / 이미지 생성, 업로드 기록, 디스크립터 갱신 같은 Vulkan 호출은 모두 메인 스레드 한 곳에서만 일어나고 큐나 명령 풀에 대한 별도의 동기화가 필요 없습니다.
+// 작업 스레드에서 던진 예외는 잡아 두었다가 dispatchCompleted 에서 메인 스레드로 다시 던집니다.
+// 파이프라인 레지스트리(PipelineRegistry.h)도 이 스레드 풀로 파이프라인을 컴파일합니다. 그 작업은 외부 동기화가 필요 없는 vkCreateGraphicsPipelines 만 부릅니다.
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cstdint>
+
+
+class AssetLoader
+{
+public:
+    using Publish = std::function<void()>;
+    using Job = std::function<Publish()>;
+
+    void init(uint32_t threadCount)
+    {
+        stopping = false;
+        threadCount = std::max(1u, threadCount);
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            workers.emplace_back(&AssetLoader::workerMain, this);
+        }
+    }
+
+    // 초기화 도중 예외로 destroy 를 부르지 못해도 합류하지 않은 std::thread 가 std::terminate 를 부르지 않도록 합니다.
+    ~AssetLoader()
+    {
+        if (workers.empty() == false)
+        {
+            destroy();
+        }
+    }
+
+    // 작업 스레드를 멈추고 합류시킵니다. 아직 시작하지 않은 작업과 실행하지 않은 완료 함수는 버립니다. (실행 중인 작업은 끝날 때까지 기다립니다.)
+    void destroy()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            jobs.clear();
+        }
+        wakeCondition.notify_all();
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+        workers.clear();
+        completed.clear();
+        pendingCount = 0;
+    }
+
+    void enqueue(Job job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        pendingCount++;
+        wakeCondition.notify_one();
+    }
+
+    // 끝난 작업들의 완료 함수를 끝난 순서대로 메인 스레드에서 실행하고, 실행한 수를 반환합니다. 멈추지 않으므로 매 프레임 호출합니다.
+    size_t dispatchCompleted()
+    {
+        std::vector<Completed> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.swap(completed);
+        }
+
+        for (Completed& result : ready)
+        {
+            pendingCount--;
+            if (result.error)
+            {
+                std::rethrow_exception(result.error);
+            }
+            if (result.publish)
+            {
+                result.publish();
+            }
+        }
+        return ready.size();
+    }
+
+    // 끝난 작업이 생길 때까지 기다린 뒤 dispatchCompleted 를 실행하고, 실행한 수를 반환합니다. 기다릴 작업이 없으면 바로 0 을 반환합니다.
+    size_t waitCompleted()
+    {
+        if (pendingCount == 0)
+        {
+            return 0;
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            completedCondition.wait(lock, [this]() { return completed.empty() == false; });
+        }
+        return dispatchCompleted();
+    }
+
+    // 넣었지만 아직 완료 함수까지 실행되지 않은 작업 수 (메인 스레드에서만 호출)
+    size_t getPendingCount() const
+    {
+        return pendingCount;
+    }
+
+private:
+    struct Completed
+    {
+        Publish publish;
+        std::exception_ptr error;
+    };
+
+    void workerMain()
+    {
+        for (;;)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeCondition.wait(lock, [this]() { return stopping || jobs.empty() == false; });
+                if (stopping)
+                {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            Completed result;
+            try
+            {
+                result.publish = job();
+            }
+            catch (...)
+            {
+                result.error = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                completed.push_back(std::move(result));
+            }
+            completedCondition.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;                           // jobs, completed, stopping 을 보호합니다.
+    std::condition_variable wakeCondition;
+    std::condition_variable completedCondition; // waitCompleted 를 깨웁니다.
+    std::deque<Job> jobs;                       // 아직 시작하지 않은 작업
+    std::vector<Completed> completed;           // 끝났지만 완료 함수를 실행하지 않은 작업
+    bool stopping = false;
+    size_t pendingCount = 0;                    // 메인 스레드에서만 읽고 씁니다.
+};
@@ -0,0 +1,253 @@
+#pragma once
+
+// 압축 버텍스 형식
+// 임포트할 때 메쉬마다 버텍스 형식(VertexLayout)을 정하고, float 버텍스를 그 형식의 바이트 배열로 압축합니다.
+// - 위치 : 메쉬 경계 상자 기준으로 정규화한 16 비트 UNORM (R16G16B16A16_UNORM, 네 번째 성분은 사용하지 않음). 셰이더에는 [0, 1] 값이 들어가므로 경계 상자로 되돌리는 변환(getDequantizeMatrix)을 모델 행렬에 곱합니다.
+// - UV : 모든 좌표가 [0, 1] 안이면 R16G16_UNORM, 반복(REPEAT) 주소 지정을 위해 범위를 벗어나는 좌표가 있으면 R16G16_SFLOAT (half float)
+// - 색상 : 모든 버텍스가 같은 색이면 버텍스에서 빼고, 인스턴스 단위로 읽는 4 바이트 버퍼 하나(바인딩 1)로 전달합니다. 다르면 버텍스마다 R8G8B8A8_UNORM 으로 저장합니다.
+// 셰이더 입력은 float 형식(vec3 / vec2)을 그대로 사용합니다. UNORM / SFLOAT 형식은 버텍스 입력 단계에서 float 로 변환되므로 셰이더를 바꿀 필요가 없습니다.
+// 32 바이트이던 버텍스가 12 바이트(색상이 일정할 때) 또는 16 바이트가 됩니다.
+// 인덱스도 버텍스가 65536 개보다 적은 메쉬는 16 비트(VK_INDEX_TYPE_UINT16)로 줄여 인덱스 메모리와 대역폭을 절반으로 만듭니다. (packIndices)
+
+#include "VertexDedup.h"
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+
+// 메쉬 하나의 버텍스 형식. 메쉬 캐시에 그대로 저장되므로 포인터 없는 고정 크기 구조체로 유지해야 합니다.
+struct VertexLayout
+{
+    uint32_t stride = 0;
+    uint32_t positionOffset = 0;
+    VkFormat positionFormat = VK_FORMAT_UNDEFINED;
+    uint32_t texCoordOffset = 0;
+    VkFormat texCoordFormat = VK_FORMAT_UNDEFINED;
+    uint32_t colorOffset = 0;
+    VkFormat colorFormat = VK_FORMAT_UNDEFINED;     // VK_FORMAT_UNDEFINED 이면 constantColor 를 바인딩 1 로 전달합니다.
+    uint32_t constantColor = 0;                     // RGBA8
+    float positionMin[3] = { 0.0f, 0.0f, 0.0f };    // 저장된 위치 p 의 실제 위치 = positionMin + p * positionScale
+    float positionScale[3] = { 1.0f, 1.0f, 1.0f };
+
+    bool hasConstantColor() const
+    {
+        return colorFormat == VK_FORMAT_UNDEFINED;
+    }
+
+    // 두 형식의 버텍스 입력(바인딩 / 속성 설명)이 같은지. 같으면 같은 그래픽 파이프라인으로 그릴 수 있습니다. (위치 복원 변환과 일정한 색상 값은 파이프라인에 들어가지 않습니다.)
+    bool hasSameVertexInput(const VertexLayout& other) const
+    {
+        return stride == other.stride
+            && positionOffset == other.positionOffset && positionFormat == other.positionFormat
+            && texCoordOffset == other.texCoordOffset && texCoordFormat == other.texCoordFormat
+            && colorFormat == other.colorFormat && (hasConstantColor() || colorOffset == other.colorOffset);
+    }
+
+    // 정규화된 위치를 원래 좌표로 되돌리는 행렬. 모델 행렬 뒤에 곱합니다. (model * getDequantizeMatrix())
+    glm::mat4 getDequantizeMatrix() const
+    {
+        glm::mat4 translation = glm::translate(glm::mat4(1.0f), glm::vec3(positionMin[0], positionMin[1], positionMin[2]));
+        return glm::scale(translation, glm::vec3(positionScale[0], positionScale[1], positionScale[2]));
+    }
+
+    // 바인딩 0 : 버텍스 버퍼 (버텍스마다), 바인딩 1 : 일정한 색상 버퍼 (인스턴스마다, 색상이 일정할 때만)
+    std::vector<VkVertexInputBindingDescription> getBindingDescriptions() const
+    {
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions(hasConstantColor() ? 2 : 1);
+        bindingDescriptions[0].binding = 0;
+        bindingDescriptions[0].stride = stride;
+        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        if (hasConstantColor())
+        {
+            // 인스턴스 하나만 그리므로 항상 첫 번째 원소(constantColor)를 읽습니다.
+            bindingDescriptions[1].binding = 1;
+            bindingDescriptions[1].stride = sizeof(uint32_t);
+            bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        }
+        return bindingDescriptions;
+    }
+
+    // 셰이더의 location 0 : 위치, 1 : 색상, 2 : UV
+    std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() const
+    {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions(3);
+        attributeDescriptions[0] = { 0, 0, positionFormat, positionOffset };
+        if (hasConstantColor())
+        {
+            attributeDescriptions[1] = { 1, 1, VK_FORMAT_R8G8B8A8_UNORM, 0 };
+        }
+        else
+        {
+            attributeDescriptions[1] = { 1, 0, colorFormat, colorOffset };
+        }
+        attributeDescriptions[2] = { 2, 0, texCoordFormat, texCoordOffset };
+        return attributeDescriptions;
+    }
+};
+
+namespace CompactVertex
+{
+    // 압축된 버텍스 하나. 색상이 일정한 형식에서는 color 를 쓰지 않고 stride 12 바이트까지만 저장합니다.
+    struct PackedVertex
+    {
+        uint16_t position[4];
+        uint16_t texCoord[2];
+        uint8_t color[4];
+
+        bool operator==(const PackedVertex& other) const
+        {
+            return std::memcmp(this, &other, sizeof(PackedVertex)) == 0;
+        }
+    };
+    static_assert(sizeof(PackedVertex) == 16, "PackedVertex must not have padding");
+
+    inline uint16_t quantizeUnorm16(float value)
+    {
+        return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+    }
+
+    inline uint8_t quantizeUnorm8(float value)
+    {
+        return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+    }
+
+    // 메쉬에 맞는 압축 형식을 고르고 버텍스를 압축합니다. VertexT 는 glm::vec3 position, glm::vec3 color, glm::vec2 texCoord 멤버가 있어야 합니다.
+    // 압축하면서 서로 같아진 버텍스는 다시 합치고 indices 를 고칩니다. 합칠 때 처음 참조되는 순서를 유지하므로 앞 단계의 버텍스 읽기 순서 최적화가 그대로 남습니다.
+    template<typename VertexT>
+    VertexLayout pack(const std::vector<VertexT>& vertices, std::vector<uint32_t>& indices, std::vector<uint8_t>& packedData)
+    {
+        VertexLayout layout;
+        packedData.clear();
+        if (vertices.empty())
+        {
+            return layout;
+        }
+
+        // 1. 메쉬 특성 조사 : 위치 경계 상자, UV 범위, 색상이 모두 같은지
+        glm::vec3 positionMin = vertices[0].position;
+        glm::vec3 positionMax = vertices[0].position;
+        bool texCoordInUnitRange = true;
+        bool colorConstant = true;
+        for (const VertexT& vertex : vertices)
+        {
+            positionMin = glm::min(positionMin, vertex.position);
+            positionMax = glm::max(positionMax, vertex.position);
+            texCoordInUnitRange = texCoordInUnitRange && vertex.texCoord.x >= 0.0f && vertex.texCoord.x <= 1.0f && vertex.texCoord.y >= 0.0f && vertex.texCoord.y <= 1.0f;
+            colorConstant = colorConstant && vertex.color == vertices[0].color;
+        }
+
+        // 2. 형식 결정
+        layout.positionOffset = offsetof(PackedVertex, position);
+        layout.positionFormat = VK_FORMAT_R16G16B16A16_UNORM;
+        layout.texCoordOffset = offsetof(PackedVertex, texCoord);
+        layout.texCoordFormat = texCoordInUnitRange ? VK_FORMAT_R16G16_UNORM : VK_FORMAT_R16G16_SFLOAT;
+        if (colorConstant)
+        {
+            layout.stride = offsetof(PackedVertex, color);
+            layout.colorFormat = VK_FORMAT_UNDEFINED;
+            const glm::vec3& color = vertices[0].color;
+            layout.constantColor = uint32_t(quantizeUnorm8(color.r)) | (uint32_t(quantizeUnorm8(color.g)) << 8) | (uint32_t(quantizeUnorm8(color.b)) << 16) | (255u << 24);
+        }
+        else
+        {
+            layout.stride = sizeof(PackedVertex);
+            layout.colorOffset = offsetof(PackedVertex, color);
+            layout.colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+        }
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float extent = positionMax[axis] - positionMin[axis];
+            layout.positionMin[axis] = positionMin[axis];
+            layout.positionScale[axis] = extent > 0.0f ? extent : 1.0f;
+        }
+
+        // 3. 압축. 압축 결과가 같아진 버텍스는 다시 합칩니다. (인덱스 순서대로 읽으므로 처음 참조되는 순서가 유지됩니다.)
+        auto packVertex = [&](const VertexT& vertex)
+        {
+            PackedVertex packed{};
+            for (int axis = 0; axis < 3; axis++)
+            {
+                packed.position[axis] = quantizeUnorm16((vertex.position[axis] - layout.positionMin[axis]) / layout.positionScale[axis]);
+            }
+            for (int axis = 0; axis < 2; axis++)
+            {
+                packed.texCoord[axis] = texCoordInUnitRange ? quantizeUnorm16(vertex.texCoord[axis]) : static_cast<uint16_t>(glm::packHalf1x16(vertex.texCoord[axis]));
+            }
+            if (colorConstant == false)
+            {
+                packed.color[0] = quantizeUnorm8(vertex.color.r);
+                packed.color[1] = quantizeUnorm8(vertex.color.g);
+                packed.color[2] = quantizeUnorm8(vertex.color.b);
+                packed.color[3] = 255;
+            }
+            return packed;
+        };
+
+        std::vector<PackedVertex> packedVertices;
+        std::vector<uint32_t> packedIndices;
+        VertexDedup::deduplicate<PackedVertex>(indices.size(), 1, [&](size_t corner) { return packVertex(vertices[indices[corner]]); }, packedVertices, packedIndices, vertices.size());
+        indices.swap(packedIndices);
+
+        packedData.resize(packedVertices.size() * layout.stride);
+        for (size_t i = 0; i < packedVertices.size(); i++)
+        {
+            std::memcpy(packedData.data() + i * layout.stride, &packedVertices[i], layout.stride);
+        }
+        return layout;
+    }
+
+    // 메쉬에 맞는 인덱스 크기를 고르고 indices 를 그 크기로 packedData 에 옮깁니다. 고른 크기(sizeof(uint16_t) 또는 sizeof(uint32_t))를 반환합니다.
+    // 프리미티브 재시작은 사용하지 않지만 0xFFFF 는 재시작 값과 겹치므로 가장 큰 인덱스가 0xFFFE 이하일 때만 16 비트를 사용합니다.
+    inline uint32_t packIndices(const std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint8_t>& packedData)
+    {
+        if (vertexCount <= UINT16_MAX)
+        {
+            packedData.resize(indices.size() * sizeof(uint16_t));
+            uint16_t* destination = reinterpret_cast<uint16_t*>(packedData.data());
+            for (size_t i = 0; i < indices.size(); i++)
+            {
+                destination[i] = static_cast<uint16_t>(indices[i]);
+            }
+            return sizeof(uint16_t);
+        }
+
+        packedData.resize(indices.size() * sizeof(uint32_t));
+        std::memcpy(packedData.data(), indices.data(), packedData.size());
+        return sizeof(uint32_t);
+    }
+
+    inline VkIndexType getIndexType(uint32_t indexSize)
+    {
+        return indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    }
+
+    // layout 형식으로 저장된 버텍스들의 원래 좌표 경계 상자. 압축된 위치는 경계 상자가 layout 에 있으므로 버텍스를 읽지 않고, float 위치(R32G32B32_SFLOAT)는 모두 훑습니다.
+    inline void getPositionBounds(const VertexLayout& layout, const uint8_t* vertexData, uint32_t vertexCount, glm::vec3& boundsMin, glm::vec3& boundsMax)
+    {
+        if (layout.positionFormat == VK_FORMAT_R16G16B16A16_UNORM)
+        {
+            boundsMin = glm::vec3(layout.positionMin[0], layout.positionMin[1], layout.positionMin[2]);
+            boundsMax = boundsMin + glm::vec3(layout.positionScale[0], layout.positionScale[1], layout.positionScale[2]);
+            return;
+        }
+
+        boundsMin = glm::vec3(0.0f);
+        boundsMax = glm::vec3(0.0f);
+        for (uint32_t i = 0; i < vertexCount; i++)
+        {
+            glm::vec3 position;
+            std::memcpy(&position, vertexData + size_t(i) * layout.stride + layout.positionOffset, sizeof(position));
+            boundsMin = i == 0 ? position : glm::min(boundsMin, position);
+            boundsMax = i == 0 ? position : glm::max(boundsMax, position);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+// 프레임 단위 지연 해제 큐
+// 그리기에 쓰던 리소스(메쉬 버퍼, 텍스쳐, 파이프라인)를 새 리소스로 바꾸어도, 이미 제출한 프레임들이 아직 GPU 에서 예전 리소스를 읽고 있을 수 있습니다.
+// 그래서 바꾼 시점까지 제출한 프레임 수와 함께 해제 함수를 맡겨두고, 그 프레임들이 모두 끝난 뒤(프레임 펜스를 기다린 뒤)에 해제합니다. vkDeviceWaitIdle 로 렌더링을 멈출 필요가 없습니다.
+
+#include <deque>
+#include <functional>
+#include <cstdint>
+
+
+class DeletionQueue
+{
+public:
+    // submittedFrames : 지금까지 제출한 프레임 수. 이 프레임들이 모두 끝나면 release 를 실행합니다. 호출마다 같거나 커야 합니다.
+    void push(uint64_t submittedFrames, std::function<void()> release)
+    {
+        entries.push_back(Entry{ submittedFrames, std::move(release) });
+    }
+
+    // completedFrames : GPU 에서 끝난 것으로 확인된 프레임 수. 프레임은 제출 순서대로 끝나므로 앞에서부터 해제합니다.
+    void flush(uint64_t completedFrames)
+    {
+        while (entries.empty() == false && entries.front().submittedFrames <= completedFrames)
+        {
+            entries.front().release();
+            entries.pop_front();
+        }
+    }
+
+    // 남은 해제 함수를 모두 실행합니다. vkDeviceWaitIdle 이후 프로그램을 끝낼 때 호출합니다.
+    void flushAll()
+    {
+        flush(UINT64_MAX);
+    }
+
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t submittedFrames;
+        std::function<void()> release;
+    };
+
+    std::deque<Entry> entries;
+};
@@ -0,0 +1,329 @@
+#pragma once
+
+// GPU 타임스탬프 쿼리를 이용한 구간별 GPU 시간 측정기
+// 커맨드 버퍼에 이름 붙은 구간(scope)을 열고 닫으면 그 사이에 GPU 가 소비한 시간을 측정하고, 구간별로 최근 샘플들의 min / avg / p99 를 제공합니다.
+// 쿼리 풀은 슬롯 단위로 나뉘어 있습니다. 프레임마다 MAX_FRAMES_IN_FLIGHT 개의 슬롯을 돌려 쓰고, 마지막 한 슬롯은 일회성 명령 버퍼(업로드, 밉맵 생성 등) 용으로 사용합니다.
+// 결과는 해당 슬롯의 펜스(또는 큐 대기)가 끝난 뒤에만 읽으므로 vkGetQueryPoolResults 가 GPU 를 기다리며 멈추는 일이 없습니다.
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <ostream>
+#include <iomanip>
+#include <stdexcept>
+#include <cstdint>
+
+
+class GpuProfiler
+{
+public:
+    // 구간 하나의 측정 결과
+    struct ScopeResult
+    {
+        const char* name;       // 구간 이름 (beginScope 에 전달한 문자열 리터럴)
+        uint64_t frameId;       // beginSlot 에 전달한 프레임 번호
+        double milliseconds;    // GPU 에서 걸린 시간
+    };
+
+    // 구간별 최근 샘플들의 통계
+    struct ScopeStats
+    {
+        size_t count = 0;       // 통계에 사용된 샘플 수 (최대 historySize)
+        double last = 0.0;
+        double min = 0.0;
+        double avg = 0.0;
+        double p99 = 0.0;
+    };
+
+    static constexpr uint32_t INVALID_SCOPE = UINT32_MAX;
+
+    // 쿼리 풀을 만듭니다. 큐 패밀리가 타임스탬프를 지원하지 않으면 프로파일러는 비활성화되며 모든 호출이 아무 일도 하지 않습니다.
+    // frameSlots : 동시에 비행 중일 수 있는 프레임 수, maxScopesPerSlot : 한 슬롯(명령 버퍼)에서 열 수 있는 최대 구간 수, historySize : 통계를 낼 최근 샘플 수
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t frameSlots, uint32_t maxScopesPerSlot = 16, size_t historySize = 256)
+    {
+        this->device = device;
+        this->maxQueriesPerSlot = maxScopesPerSlot * 2;
+        this->historySize = historySize;
+
+        // timestampValidBits 가 0 이면 해당 큐에서 타임스탬프를 쓸 수 없습니다.
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+        uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+
+        // timestampPeriod 는 타임스탬프 값이 1 증가할 때 흐른 나노초입니다. 소프트웨어 드라이버(lavapipe, SwiftShader 등)는 보통 1.0 을 보고하며 하드웨어와 똑같이 취급하면 됩니다.
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        timestampPeriod = static_cast<double>(properties.limits.timestampPeriod);
+
+        if (validBits == 0 || timestampPeriod <= 0.0)
+        {
+            return;
+        }
+        timestampMask = (validBits >= 64) ? ~0ull : ((1ull << validBits) - 1);
+
+        // 프레임 슬롯들 + 일회성 명령 버퍼용 슬롯 1개
+        slots.resize(frameSlots + 1);
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            slots[i].firstQuery = static_cast<uint32_t>(i) * maxQueriesPerSlot;
+        }
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = static_cast<uint32_t>(slots.size()) * maxQueriesPerSlot;
+
+        if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create timestamp query pool!");
+        }
+
+        queryResults.resize(maxQueriesPerSlot * 2);
+    }
+
+    void destroy()
+    {
+        if (queryPool != VK_NULL_HANDLE)
+        {
+            vkDestroyQueryPool(device, queryPool, nullptr);
+            queryPool = VK_NULL_HANDLE;
+        }
+        slots.clear();
+    }
+
+    bool isEnabled() const
+    {
+        return queryPool != VK_NULL_HANDLE;
+    }
+
+    // 일회성 명령 버퍼가 사용할 슬롯 번호
+    uint32_t immediateSlot() const
+    {
+        return static_cast<uint32_t>(slots.size()) - 1;
+    }
+
+    // 명령 버퍼 기록을 시작한 직후에 호출합니다. 슬롯의 쿼리들을 초기화하므로 렌더 패스 밖이어야 하며, 이 슬롯의 이전 결과는 collectSlot 으로 먼저 읽어두어야 합니다.
+    void beginSlot(VkCommandBuffer commandBuffer, uint32_t slot, uint64_t frameId)
+    {
+        if (isEnabled() == false)
+        {
+            return;
+        }
+
+        Slot& s = slots[slot];
+        s.frameId = frameId;
+        s.nextQuery = 0;
+        s.scopes.clear();
+        vkCmdResetQueryPool(commandBuffer, queryPool, s.firstQuery, maxQueriesPerSlot);
+        recordingSlot = slot;
+    }
+
+    // 구간 시작 타임스탬프를 기록하고 endScope 에 넘길 구간 번호를 돌려줍니다. name 은 슬롯 결과를 읽을 때까지 살아있어야 하므로 문자열 리터럴을 사용하십시오.
+    // 렌더 패스 안에서도 호출할 수 있습니다. 구간은 중첩될 수 있습니다.
+    uint32_t beginScope(VkCommandBuffer commandBuffer, const char* name, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT)
+    {
+        if (isEnabled() == false || recordingSlot == INVALID_SCOPE)
+        {
+            return INVALID_SCOPE;
+        }
+
+        Slot& s = slots[recordingSlot];
+        if (s.nextQuery + 2 > maxQueriesPerSlot)
+        {
+            return INVALID_SCOPE;
+        }
+
+        Scope scope{};
+        scope.name = name;
+        scope.beginQuery = s.nextQuery++;
+        scope.endQuery = INVALID_SCOPE;
+        vkCmdWriteTimestamp(commandBuffer, stage, queryPool, s.firstQuery + scope.beginQuery);
+
+        // 구간을 닫을 쿼리 자리도 미리 예약해 두어 열린 구간이 항상 닫힐 수 있게 합니다.
+        s.nextQuery++;
+        s.scopes.push_back(scope);
+        return static_cast<uint32_t>(s.scopes.size()) - 1;
+    }
+
+    // beginScope 로 연 구간을 닫습니다.
+    void endScope(VkCommandBuffer commandBuffer, uint32_t scope, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT)
+    {
+        if (scope == INVALID_SCOPE || recordingSlot == INVALID_SCOPE)
+        {
+            return;
+        }
+
+        Slot& s = slots[recordingSlot];
+        Scope& target = s.scopes[scope];
+        target.endQuery = target.beginQuery + 1;
+        vkCmdWriteTimestamp(commandBuffer, stage, queryPool, s.firstQuery + target.endQuery);
+    }
+
+    // 명령 버퍼 기록을 마칠 때 호출합니다. 이후의 beginScope 는 다음 beginSlot 전까지 무시됩니다.
+    void endSlot()
+    {
+        recordingSlot = INVALID_SCOPE;
+    }
+
+    // 슬롯에 기록된 구간들의 결과를 읽어 통계에 추가하고 이번에 읽은 결과를 돌려줍니다.
+    // 반드시 이 슬롯의 명령 버퍼가 끝난 뒤(펜스 대기 / 큐 대기 이후)에 호출해야 합니다. 대기 플래그 없이 읽으므로 아직 준비되지 않은 쿼리는 결과에서 빠집니다.
+    const std::vector<ScopeResult>& collectSlot(uint32_t slot)
+    {
+        resolved.clear();
+        if (isEnabled() == false)
+        {
+            return resolved;
+        }
+
+        Slot& s = slots[slot];
+        if (s.scopes.empty())
+        {
+            return resolved;
+        }
+
+        // 쿼리마다 (값, 사용 가능 여부) 두 개의 64비트 값을 받습니다. 일부 쿼리만 준비되었더라도 준비된 쿼리의 값은 채워집니다.
+        VkResult result = vkGetQueryPoolResults(device, queryPool, s.firstQuery, s.nextQuery, sizeof(uint64_t) * 2 * s.nextQuery, queryResults.data(), sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if (result == VK_SUCCESS || result == VK_NOT_READY)
+        {
+            for (const Scope& scope : s.scopes)
+            {
+                if (scope.endQuery == INVALID_SCOPE || queryResults[scope.beginQuery * 2 + 1] == 0 || queryResults[scope.endQuery * 2 + 1] == 0)
+                {
+                    continue;
+                }
+
+                // 타임스탬프는 timestampValidBits 비트에서 한 바퀴 돌 수 있으므로 마스크 안에서 차이를 구합니다.
+                uint64_t begin = queryResults[scope.beginQuery * 2] & timestampMask;
+                uint64_t end = queryResults[scope.endQuery * 2] & timestampMask;
+                uint64_t elapsed = (end - begin) & timestampMask;
+                double milliseconds = static_cast<double>(elapsed) * timestampPeriod / 1000000.0;
+
+                addSample(scope.name, milliseconds);
+                resolved.push_back({ scope.name, s.frameId, milliseconds });
+            }
+        }
+
+        s.scopes.clear();
+        s.nextQuery = 0;
+        return resolved;
+    }
+
+    // 구간 이름별 최근 historySize 개 샘플의 통계를 계산합니다.
+    ScopeStats getStats(const std::string& name) const
+    {
+        ScopeStats stats;
+        auto it = histories.find(name);
+        if (it == histories.end() || it->second.samples.empty())
+        {
+            return stats;
+        }
+
+        const History& history = it->second;
+        std::vector<double> sorted = history.samples;
+        std::sort(sorted.begin(), sorted.end());
+
+        double sum = 0.0;
+        for (double v : sorted)
+        {
+            sum += v;
+        }
+
+        stats.count = sorted.size();
+        stats.last = history.samples[(history.next + history.samples.size() - 1) % history.samples.size()];
+        stats.min = sorted.front();
+        stats.avg = sum / sorted.size();
+        stats.p99 = sorted[std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * 0.99))];
+        return stats;
+    }
+
+    // 측정된 적 있는 구간 이름들 (처음 측정된 순서)
+    const std::vector<std::string>& getScopeNames() const
+    {
+        return scopeNames;
+    }
+
+    // 모든 구간의 통계를 한 줄씩 출력합니다.
+    void printStats(std::ostream& out, const char* prefix) const
+    {
+        if (isEnabled() == false)
+        {
+            out << prefix << "GPU timestamps are not supported on this queue.\n";
+            return;
+        }
+
+        for (const std::string& name : scopeNames)
+        {
+            ScopeStats stats = getStats(name);
+            out << prefix << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(3)
+                << " min " << stats.min << " ms, avg " << stats.avg << " ms, p99 " << stats.p99 << " ms (" << stats.count << " samples)\n";
+            out.unsetf(std::ios::fixed);
+        }
+    }
+
+private:
+    // 한 명령 버퍼 안에서 열린 구간
+    struct Scope
+    {
+        const char* name;
+        uint32_t beginQuery;    // 슬롯 내 쿼리 번호
+        uint32_t endQuery;      // 닫히지 않았으면 INVALID_SCOPE
+    };
+
+    // 쿼리 풀에서 명령 버퍼 하나가 사용하는 구역
+    struct Slot
+    {
+        uint32_t firstQuery = 0;
+        uint32_t nextQuery = 0;
+        uint64_t frameId = 0;
+        std::vector<Scope> scopes;
+    };
+
+    // 구간 하나의 최근 샘플을 담는 원형 버퍼
+    struct History
+    {
+        std::vector<double> samples;
+        size_t next = 0;
+    };
+
+    void addSample(const char* name, double milliseconds)
+    {
+        auto it = histories.find(name);
+        if (it == histories.end())
+        {
+            it = histories.emplace(name, History{}).first;
+            it->second.samples.reserve(historySize);
+            scopeNames.push_back(name);
+        }
+
+        History& history = it->second;
+        if (history.samples.size() < historySize)
+        {
+            history.samples.push_back(milliseconds);
+        }
+        else
+        {
+            history.samples[history.next] = milliseconds;
+        }
+        history.next = (history.next + 1) % historySize;
+    }
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    double timestampPeriod = 0.0;
+    uint64_t timestampMask = 0;
+    uint32_t maxQueriesPerSlot = 0;
+    size_t historySize = 0;
+
+    std::vector<Slot> slots;
+    uint32_t recordingSlot = INVALID_SCOPE;
+    std::vector<uint64_t> queryResults;
+    std::vector<ScopeResult> resolved;
+
+    std::unordered_map<std::string, History> histories;
+    std::vector<std::string> scopeNames;
+};
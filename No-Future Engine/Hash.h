@@ -0,0 +1,50 @@
+#pragma once
+
+// 해시 함수 모음
+// hashBytes 는 MurmurHash64A (Austin Appleby, public domain) 입니다. 8 바이트씩 처리하므로 수 MB 크기의 소스 파일 전체를 해시해도 파싱에 비해 무시할 만한 시간이 듭니다.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+
+inline uint64_t hashBytes(const void* data, size_t length, uint64_t seed = 0)
+{
+    const uint64_t m = 0xc6a4a7935bd1e995ull;
+    const int r = 47;
+
+    uint64_t h = seed ^ (length * m);
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    const uint8_t* end = bytes + (length / 8) * 8;
+    for (; bytes != end; bytes += 8)
+    {
+        // 정렬되지 않은 주소일 수 있으므로 memcpy 로 읽습니다. (컴파일러가 단일 로드로 바꿉니다.)
+        uint64_t k;
+        std::memcpy(&k, bytes, sizeof(k));
+
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        h ^= k;
+        h *= m;
+    }
+
+    switch (length & 7)
+    {
+    case 7: h ^= uint64_t(bytes[6]) << 48; [[fallthrough]];
+    case 6: h ^= uint64_t(bytes[5]) << 40; [[fallthrough]];
+    case 5: h ^= uint64_t(bytes[4]) << 32; [[fallthrough]];
+    case 4: h ^= uint64_t(bytes[3]) << 24; [[fallthrough]];
+    case 3: h ^= uint64_t(bytes[2]) << 16; [[fallthrough]];
+    case 2: h ^= uint64_t(bytes[1]) << 8; [[fallthrough]];
+    case 1: h ^= uint64_t(bytes[0]);
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
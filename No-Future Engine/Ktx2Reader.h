@@ -0,0 +1,158 @@
+#pragma once
+
+// KTX2 텍스쳐 읽기
+// 미리 만들어 둔 밉 체인(toktx, KTX-Software 등으로 만든 .ktx2)을 디코딩이나 밉맵 생성 없이 그대로 올리기 위해 사용합니다.
+// 파일은 메모리 매핑하고, 초압축이 없는 레벨은 매핑된 파일 안을 그대로 가리키므로 업로드할 때 파일에서 스테이징 링으로 한 번만 복사됩니다.
+// zstd 초압축(supercompressionScheme = 2) 레벨은 ZstdDecoder 로 풀어 inflated 에 담습니다. BasisLZ / zlib 초압축과 배열, 큐브맵, 3D 텍스쳐는 지원하지 않습니다.
+// 텍셀 형식은 엔진이 올릴 수 있는 R8G8B8A8_SRGB, BC1_RGB_SRGB, BC3_SRGB, BC7_SRGB 만 받습니다.
+//
+// 파일 구조 (리틀 엔디안, https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html)
+// [식별자 12 바이트][Ktx2Header][레벨 색인 : levelCount x Ktx2LevelIndex][DFD][키 / 값 데이터][초압축 전역 데이터][밉 레벨 데이터 (보통 작은 레벨부터)]
+
+#include "MappedFile.h"
+#include "MipBuilder.h"
+#include "ZstdDecoder.h"
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+
+constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+constexpr uint32_t KTX2_SUPERCOMPRESSION_NONE = 0;
+constexpr uint32_t KTX2_SUPERCOMPRESSION_ZSTD = 2;
+
+// 파일의 헤더는 68 바이트라 64 비트 필드 앞에 여백이 생기지 않도록 4 바이트로 묶습니다.
+#pragma pack(push, 4)
+struct Ktx2Header
+{
+    uint32_t vkFormat;                  // VkFormat. 초압축을 풀었을 때의 텍셀 형식입니다.
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;                // 2D 텍스쳐는 0
+    uint32_t layerCount;                // 배열이 아니면 0
+    uint32_t faceCount;                 // 큐브맵이 아니면 1
+    uint32_t levelCount;                // 0 이면 레벨 0 만 있고 나머지는 불러오는 쪽에서 만들어야 합니다.
+    uint32_t supercompressionScheme;    // KTX2_SUPERCOMPRESSION_*
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+#pragma pack(pop)
+static_assert(sizeof(Ktx2Header) == 68, "Ktx2Header must match the file layout");
+
+struct Ktx2LevelIndex
+{
+    uint64_t byteOffset;                // 파일 시작부터 레벨 데이터까지의 바이트
+    uint64_t byteLength;                // 파일에 저장된(초압축된) 바이트 수
+    uint64_t uncompressedByteLength;    // 초압축을 푼 바이트 수
+};
+
+namespace Ktx2
+{
+    inline bool toTextureFormat(uint32_t vkFormat, TextureFormat& format)
+    {
+        switch (vkFormat)
+        {
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            format = TextureFormat::Rgba8;
+            return true;
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            format = TextureFormat::Bc1;
+            return true;
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            format = TextureFormat::Bc3;
+            return true;
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            format = TextureFormat::Bc7;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // KTX2 파일을 매핑하고 레벨들을 view 에 담습니다. 파일이 없으면 false 를 반환하고, 파일이 잘못되었거나 지원하지 않는 형식이면 예외를 던집니다.
+    // 초압축이 없으면 view 는 file 안을, zstd 초압축이면 inflated 안을 가리키므로 둘 다 업로드가 끝날 때까지 살아 있어야 합니다.
+    inline bool open(MappedFile& file, const std::string& path, std::vector<uint8_t>& inflated, MipBuilder::MipChainView& view)
+    {
+        if (file.open(path) == false)
+        {
+            return false;
+        }
+
+        Ktx2Header header{};
+        if (file.getSize() < sizeof(KTX2_IDENTIFIER) + sizeof(header) || std::memcmp(file.getData(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+        {
+            throw std::runtime_error("Not a KTX2 file : " + path);
+        }
+        std::memcpy(&header, file.getData() + sizeof(KTX2_IDENTIFIER), sizeof(header));
+
+        if (toTextureFormat(header.vkFormat, view.format) == false)
+        {
+            throw std::runtime_error("Unsupported KTX2 texture format (VkFormat " + std::to_string(header.vkFormat) + ") : " + path);
+        }
+        if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth != 0 || header.layerCount > 1 || header.faceCount != 1)
+        {
+            throw std::runtime_error("Only 2D KTX2 textures are supported : " + path);
+        }
+        if (header.supercompressionScheme != KTX2_SUPERCOMPRESSION_NONE && header.supercompressionScheme != KTX2_SUPERCOMPRESSION_ZSTD)
+        {
+            throw std::runtime_error("Unsupported KTX2 supercompression scheme " + std::to_string(header.supercompressionScheme) + " : " + path);
+        }
+
+        const uint32_t levelCount = std::max(1u, header.levelCount);
+        const size_t levelIndexOffset = sizeof(KTX2_IDENTIFIER) + sizeof(header);
+        if (levelCount > MipBuilder::getFullLevelCount(header.pixelWidth, header.pixelHeight) || file.getSize() < levelIndexOffset + sizeof(Ktx2LevelIndex) * levelCount)
+        {
+            throw std::runtime_error("Corrupt KTX2 level index : " + path);
+        }
+        std::vector<Ktx2LevelIndex> levelIndex(levelCount);
+        std::memcpy(levelIndex.data(), file.getData() + levelIndexOffset, sizeof(Ktx2LevelIndex) * levelCount);
+
+        // 레벨 크기는 형식과 크기로 정해지므로, 파일에 적힌 크기가 다르면 이 엔진이 올릴 수 없는 배치(여러 레이어 등)입니다.
+        view.levels.resize(levelCount);
+        size_t inflatedSize = 0;
+        for (uint32_t level = 0; level < levelCount; level++)
+        {
+            MipBuilder::MipChainView::LevelData& data = view.levels[level];
+            data.width = std::max(1u, header.pixelWidth >> level);
+            data.height = std::max(1u, header.pixelHeight >> level);
+            data.size = getLevelByteSize(view.format, data.width, data.height);
+
+            const Ktx2LevelIndex& entry = levelIndex[level];
+            const uint64_t storedSize = header.supercompressionScheme == KTX2_SUPERCOMPRESSION_NONE ? data.size : entry.byteLength;
+            if (entry.byteLength != storedSize || entry.byteOffset > file.getSize() || file.getSize() - entry.byteOffset < entry.byteLength
+                || (header.supercompressionScheme == KTX2_SUPERCOMPRESSION_ZSTD && entry.uncompressedByteLength != data.size))
+            {
+                throw std::runtime_error("Corrupt KTX2 level " + std::to_string(level) + " : " + path);
+            }
+            data.data = file.getData() + entry.byteOffset;
+            inflatedSize += (data.size + MIP_BUILDER_LEVEL_ALIGNMENT - 1) & ~(MIP_BUILDER_LEVEL_ALIGNMENT - 1);
+        }
+
+        // zstd 는 레벨마다 따로 압축되어 있으므로 레벨마다 풀어서 inflated 의 16 바이트 경계에 이어 붙입니다.
+        if (header.supercompressionScheme == KTX2_SUPERCOMPRESSION_ZSTD)
+        {
+            inflated.resize(inflatedSize);
+            size_t offset = 0;
+            for (uint32_t level = 0; level < levelCount; level++)
+            {
+                MipBuilder::MipChainView::LevelData& data = view.levels[level];
+                Zstd::decompress(data.data, static_cast<size_t>(levelIndex[level].byteLength), inflated.data() + offset, data.size);
+                data.data = inflated.data() + offset;
+                offset += (data.size + MIP_BUILDER_LEVEL_ALIGNMENT - 1) & ~(MIP_BUILDER_LEVEL_ALIGNMENT - 1);
+            }
+        }
+        return true;
+    }
+}
@@ -10,10 +10,31 @@
 
 #define STB_IMAGE_IMPLEMENTATION // stb_image.h 헤더는 기본적으로 함수의 프로토타입만 정의합니다. 하나의 코드 파일에서 함수 본문을 한번만 포함하기 위해 STB_IMAGE_IMPLEMENTATION 정의가 있는 헤더를 포함해야 합니다. 그렇지 않으면 링킹 오류가 발생합니다.
 #include <stb_image.h> // 이미지를 로드하는 데 사용할 수 있는 라이브러리가 많이 있으며 BMP 및 PPM 과 같은 간단한 형식을 로드하는 고유한 코드를 작성할 수도 있습니다. 이 튜토리얼에서는 stb 컬렉션의 stb_image 라이브러리를 사용할 것입니다. 장점은 모든 코드가 단일 파일에 있으므로 까다로운 빌드 구성이 필요하지 않다는 것입니다. stb_image.h를 다운로드하여 포함 경로에 위치를 추가합니다.
+#undef STB_IMAGE_IMPLEMENTATION // stb_image.h 도 구현 부분에 포함 가드가 없으므로, TextureAtlas.h 가 다시 포함할 때 함수 본문이 두 번 만들어지지 않도록 합니다.
+
+#define STB_DXT_IMPLEMENTATION // stb_image 와 같은 방식으로 이 파일에서 stb_dxt 의 함수 본문을 만듭니다.
+#include <stb_dxt.h> // BC1 / BC3 블록 압축. 텍스쳐 압축기(TextureCompressor.h)가 사용합니다.
+#undef STB_DXT_IMPLEMENTATION // stb_dxt.h 는 구현 부분에 포함 가드가 없으므로, TextureCompressor.h 가 다시 포함할 때 함수 본문이 두 번 만들어지지 않도록 합니다.
+
+#define STB_RECT_PACK_IMPLEMENTATION // 같은 방식으로 stb_rect_pack 의 함수 본문을 만듭니다.
+#include <stb_rect_pack.h> // 텍스쳐 아틀라스(TextureAtlas.h)에 머티리얼 텍스쳐들을 배치하는 사각형 패커
+#undef STB_RECT_PACK_IMPLEMENTATION // stb_dxt.h 와 마찬가지로 TextureAtlas.h 가 다시 포함할 때를 위해 지웁니다.
 
 #define TINYOBJLOADER_IMPLEMENTATION // tinyobjloader 라이브러리는 STB 라이브러리와 동일한 방식으로 포함됩니다. tiny_obj_loader.h 파일을 포함하고 하나의 소스 파일에 TINYOBJLOADER_IMPLEMENTATION을 정의하여 함수 본문을 포함하고 링커 오류를 방지해야 합니다.
 #include <tiny_obj_loader.h> // OBJ 파일에서 꼭짓점과 면을 로드하기 위해 tinyobjloader 라이브러리를 사용합니다. stb_image와 비슷한 단일 헤더파일 라이브러리이기 때문에 빠르고 쉽게 통합할 수 있습니다. https://github.com/syoyo/tinyobjloader
 
+// tinyobjloader 에 함께 들어있는 멀티스레드 파서입니다. 파일 버퍼를 스레드 수만큼 나누어 줄 단위로 동시에 해석하므로 수백 MB 크기의 OBJ 파일에서 LoadObj 보다 훨씬 빠릅니다. Windows 에서는 windows.h 를 포함하므로 min / max 매크로가 std::min / std::max 를 가리지 않도록 먼저 NOMINMAX 를 정의합니다.
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#endif
+#define TINYOBJ_LOADER_OPT_IMPLEMENTATION
+#include <tinyobj_loader_opt.h> // lfpAlloc 을 <lfpAlloc/...> 로 포함하므로 EXTERNALS/tinyobjloader/experimental 도 포함 경로에 있어야 합니다.
+
 
 #include <iostream>         // 
 #include <fstream>          // 셰이더 소스를 읽기 위함
@@ -29,6 +50,32 @@
 #include <optional>         // 그래픽카드가 해당 큐 패밀리를 지원하는지 여부 검사
 #include <set>              // 사용할 모든 큐 패밀리 셋을 모아서 관리
 #include <unordered_map>    // OBJ 파일 로드시 버텍스가 고유한지 판단하여 중복된 버텍스를 인덱싱하기 위해 사용
+#include <atomic>           // 병렬 OBJ 로드 중 작업 스레드에서 발견한 오류 표시
+#include <memory>           // 작업 스레드에서 만든 에셋을 std::shared_ptr 로 완료 함수에 넘김
+
+#include "GpuProfiler.h"    // 타임스탬프 쿼리로 렌더 패스, 업로드 등 구간별 GPU 시간 측정
+#include "MemoryAllocator.h" // 큰 메모리 블록을 나누어 리소스에 할당하는 디바이스 메모리 할당기
+#include "UniformRingBuffer.h" // 영구 매핑된 프레임별 유니폼 링 버퍼 (동적 유니폼 오프셋)
+#include "MeshCache.h"      // 중복 제거까지 끝난 메쉬를 바이너리로 저장하고 메모리 매핑으로 불러오는 캐시
+#include "VertexDedup.h"    // 스레드별 해시 테이블로 나누어 처리한 뒤 합치는 병렬 버텍스 중복 제거
+#include "MeshOptimizer.h"  // 버텍스 캐시 / 오버드로우 / 버텍스 읽기 순서 최적화
+#include "CompactVertex.h"  // 메쉬마다 고르는 압축 버텍스 형식 (16 비트 위치 / UV, 일정한 색상 제거)
+#include "UploadBatch.h"    // 업로드 명령을 하나의 명령 버퍼에 모아 펜스와 함께 한 번에 제출하는 업로드 컨텍스트
+#include "StagingRing.h"    // 모든 업로드가 나누어 쓰는 영구 매핑된 스테이징 링 버퍼
+#include "AssetLoader.h"    // 텍스쳐 디코딩과 메쉬 파싱을 작업 스레드에서 실행하고 결과를 메인 스레드로 넘기는 에셋 로더
+#include "DeletionQueue.h"  // 교체한 리소스를 그 리소스를 쓰던 프레임들이 끝난 뒤에 해제하는 지연 해제 큐
+#include "MipBuilder.h"     // 작업 스레드에서 sRGB 를 고려해 밉 체인 전체를 만드는 SIMD 밉맵 생성기
+#include "TextureCompressor.h" // 밉 체인을 BC1 / BC3 / BC7 블록으로 압축하는 멀티스레드 텍스쳐 압축기
+#include "TextureCache.h"   // 압축까지 끝난 밉 체인을 저장해 두고 다음 실행부터 디코딩 없이 불러오는 캐시
+#include "Ktx2Reader.h"     // 미리 만든 밉 체인을 담은 KTX2 파일(초압축 없음 / zstd)을 매핑해서 읽는 리더
+#include "TextureStreamer.h" // 화면 크기와 메모리 예산에 맞춰 텍스쳐의 상주 밉 레벨을 정하는 텍스쳐 스트리머
+#include "ObjMaterials.h"   // OBJ 의 MTL 머티리얼과 삼각형별 머티리얼 읽기
+#include "TextureAtlas.h"   // 머티리얼 텍스쳐들을 여백을 둔 아틀라스 한 장으로 배치하고 합치는 텍스쳐 아틀라스
+#include "ResourceCache.h"  // 같은 텍스쳐 / 샘플러를 참조 수를 세어 나누어 쓰고, 쓰지 않는 항목은 LRU 로 내보내는 리소스 캐시
+#include "PipelineCache.h"  // 장치와 드라이버를 확인해서 불러오고 종료할 때 저장하는 디스크 파이프라인 캐시
+#include "PipelineRegistry.h" // 파이프라인 상태를 키로 파이프라인 변형을 작업 스레드에서 컴파일하고 다시 쓰는 파이프라인 레지스트리
+#include "ShaderLibrary.h"  // shaderc 로 GLSL 을 실행 중에 컴파일하고 SPIR-V 를 캐시하는 셰이더 라이브러리와 소스 변경 감시
+#include "ShaderReflection.h" // SPIRV-Reflect 로 셰이더에서 디스크립터 셋 / 파이프라인 레이아웃과 버텍스 입력을 만들고, 같은 레이아웃은 한 번만 만드는 레이아웃 캐시
 
 // 디버그 관련
 #ifdef NDEBUG
@@ -47,12 +94,68 @@ constexpr uint32_t HEIGHT = 600;
 // 이 장에서는 아직 조명을 활성화하지 않을 것이므로 조명이 텍스처에 구워진 샘플 모델을 사용하는 것이 도움이 됩니다. 이러한 모델을 찾는 쉬운 방법은 Sketchfab에서 3D 스캔을 찾는 것입니다. 해당 사이트의 많은 모델은 허용 라이선스가 있는 OBJ 형식으로 사용할 수 있습니다. 이 튜토리얼에서는 nigelgoh(CC BY 4.0)의 바이킹 룸 모델을 사용하기로 결정했습니다. 원본 obj 파일에서 모델의 크기와 방향을 적절히 조정한 버전입니다. 자신의 모델을 자유롭게 사용할 수 있지만 약 1.5 x 1.5 x 1.5 단위의 치수이며 하나의 텍스쳐로만 구성되어 있어야 합니다. 그보다 크면 뷰 매트릭스를 변경해야 합니다. Shaders 폴더처럼 Models 폴더와 Textures 폴더를 각각 생성해서 파일을 정리해 넣었습니다.
 const std::string MODEL_PATH = "Models/viking_room.obj";
 const std::string TEXTURE_PATH = "Textures/viking_room.png";
+const std::string MESH_CACHE_EXTENSION = ".meshcache";  // 모델 파일 옆에 "viking_room.obj.meshcache" 처럼 캐시 파일을 만듭니다.
+const std::string TEXTURE_CACHE_EXTENSION = ".texcache"; // 텍스쳐 파일 옆에 "viking_room.png.texcache" 처럼 캐시 파일을 만듭니다.
+const std::string TEXTURE_KTX2_EXTENSION = ".ktx2";     // 텍스쳐 파일 옆에 "viking_room.ktx2" 가 있으면 이미지 대신 그 안의 밉 체인을 올립니다.
+const std::string TEXTURE_KTX2_PATH = TEXTURE_PATH.substr(0, TEXTURE_PATH.find_last_of('.')) + TEXTURE_KTX2_EXTENSION;
+const std::string PIPELINE_CACHE_PATH = "Shaders/pipelines.pipelinecache"; // 종료할 때 파이프라인 캐시를 저장하고 다음 실행에서 불러오는 파일
+const std::string VERTEX_SHADER_PATH = "Shaders/hello_triangle_shader.vert";     // GLSL 소스. 실행 중에 shaderc 로 컴파일하고, 컴파일할 수 없으면 옆의 ".spv" 를 읽습니다.
+const std::string FRAGMENT_SHADER_PATH = "Shaders/hello_triangle_shader.frag";
+const std::string TEXTURE_ATLAS_EXTENSION = ".atlas";   // 머티리얼 아틀라스의 텍스쳐 캐시는 모델 파일 옆에 "viking_room.obj.atlas.texcache" 로 만듭니다.
 
 
 // 대기 없이 미리 CPU 에서 처리 가능한 프레임 수 설정
 // CPU가 GPU보다 너무 앞서는 것을 원하지 않기 때문에 숫자 2를 선택합니다. 2개의 프레임이 비행 중이면 CPU와 GPU가 동시에 자체 작업을 수행할 수 있습니다. CPU가 일찍 끝나면 GPU가 렌더링을 마칠 때까지 기다렸다가 추가 작업을 제출합니다. 3개 이상의 프레임이 비행 중이면 CPU가 GPU보다 앞서서 지연 프레임이 추가될 수 있습니다. 일반적으로 추가 대기 시간은 바람직하지 않습니다. 그러나 비행 중인 프레임 수에 대한 애플리케이션 제어 권한을 부여하는 것은 Vulkan이 명시적임을 보여주는 또 다른 예입니다. 그런 다음 여러 커맨드 버퍼를 만들어야 합니다. createCommandBuffer의 이름을 createCommandBuffers로 바꿉니다. 다음으로 커맨드 버퍼 벡터의 크기를 MAX_FRAMES_IN_FLIGHT 크기로 조정하고 VkCommandBufferAllocateInfo를 변경하여 많은 커맨드 버퍼를 포함한 다음 대상을 커맨드 버퍼의 벡터로 변경해야 합니다.
 constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
+// 프레임 슬롯마다 유니폼 링 버퍼에 기록할 수 있는 최대 바이트. 정렬 256 바이트 기준으로 UniformBufferObject 1024 개 분량입니다.
+constexpr VkDeviceSize UNIFORM_RING_BYTES_PER_FRAME = 256 * 1024;
+
+// 헤드리스 벤치마크 모드에서 별도로 지정하지 않았을 때 렌더링할 프레임 수
+constexpr uint32_t DEFAULT_BENCHMARK_FRAMES = 500;
+
+// OBJ 로드 벤치마크(--bench-obj)에서 각 경로를 반복 측정할 횟수
+constexpr uint32_t OBJ_BENCHMARK_RUNS = 3;
+
+// 스테이징 링 버퍼의 기본 크기 (MiB)
+constexpr uint32_t DEFAULT_STAGING_RING_MIB = 32;
+
+// 쓰지 않게 된 텍스쳐를 텍스쳐 캐시에 남겨 둘 기본 크기 (MiB)
+constexpr uint32_t DEFAULT_TEXTURE_CACHE_MIB = 64;
+
+// 쓰지 않게 된 샘플러를 샘플러 캐시에 남겨 둘 최대 개수. 텍스쳐 스트리밍이 minLod 만 바꾼 샘플러를 되풀이해 만들기 때문에 그 단계 수보다 넉넉하게 둡니다.
+constexpr size_t SAMPLER_CACHE_MAX_UNUSED = 16;
+
+// 에셋 로더의 작업 스레드 수. 텍스쳐와 모델을 동시에 불러올 수 있도록 2 개를 둡니다. (OBJ 파싱 자체는 작업 안에서 다시 importThreads 개의 스레드로 나누어집니다.)
+constexpr uint32_t ASSET_LOADER_THREADS = 2;
+
+// 파이프라인 레지스트리의 컴파일 스레드 수. 메쉬가 불러와지며 늘어나는 파이프라인 변형을 에셋 로드와 겹쳐서 컴파일합니다.
+constexpr uint32_t PIPELINE_COMPILER_THREADS = 2;
+
+
+// 커맨드 라인으로 전달받는 실행 옵션을 모아둔 구조체
+struct AppOptions
+{
+    bool headless = false;                              // true 이면 GLFW 윈도우, 서피스, 스왑 체인 없이 오프스크린 이미지에 렌더링합니다. (디스플레이가 없는 빌드/성능 측정 머신용)
+    uint32_t benchmarkFrames = DEFAULT_BENCHMARK_FRAMES;// 헤드리스 모드에서 렌더링할 프레임 수
+    uint32_t width = WIDTH;                             // 헤드리스 모드의 오프스크린 렌더 타겟 해상도
+    uint32_t height = HEIGHT;
+    AllocationStrategy allocatorStrategy = AllocationStrategy::Tlsf; // 디바이스 메모리 블록 안의 구간을 나누는 방식
+    uint32_t importThreads = 0;                         // OBJ 파싱과 버텍스 중복 제거에 사용할 스레드 수 (0 이면 하드웨어 스레드 수)
+    bool quantizeVertices = true;                       // 버텍스를 메쉬에 맞는 압축 형식(CompactVertex)으로 업로드합니다. (--no-quantize 로 끄면 32 바이트 float 버텍스를 그대로 사용합니다.)
+    bool optimizeMesh = true;                           // 버퍼를 만들기 전에 삼각형과 버텍스 순서를 최적화합니다. (--no-mesh-optimize 로 끄고 헤드리스 벤치마크로 비교할 수 있습니다.)
+    bool textureAtlas = true;                           // 모델의 머티리얼 텍스쳐가 둘 이상이면 아틀라스 한 장으로 합치고 UV 를 옮깁니다. (--no-texture-atlas 로 끄면 TEXTURE_PATH 하나만 씁니다.)
+    bool cpuMipmaps = true;                             // 작업 스레드에서 밉 체인 전체를 만들어 한 번에 올립니다. (--gpu-mipmaps 로 끄면 레벨 0 만 올리고 그래픽 큐에서 vkCmdBlitImage 로 채웁니다.)
+    TextureCompression textureCompression = TextureCompression::Auto; // 텍스쳐를 올릴 형식. 장치가 BC 형식을 지원하지 않으면 압축하지 않습니다.
+    bool textureStreaming = true;                       // 작은 밉 레벨부터 올리고 화면 크기와 메모리 예산에 맞춰 레벨을 올리고 내립니다. (--no-texture-streaming 으로 끄면 모든 레벨을 한 번에 올립니다.)
+    uint32_t textureBudgetMiB = 0;                      // 텍스쳐 스트리밍의 메모리 예산 (MiB). 0 이면 VK_EXT_memory_budget 의 힙 예산 (확장이 없으면 힙 크기) 을 씁니다.
+    uint32_t textureCacheMiB = DEFAULT_TEXTURE_CACHE_MIB; // 쓰지 않게 된 텍스쳐를 텍스쳐 캐시에 남겨 둘 최대 크기 (MiB). 0 이면 쓰지 않게 되는 즉시 지웁니다.
+    bool pipelineCache = true;                          // 파이프라인 캐시를 디스크에서 불러오고 종료할 때 저장합니다. (--no-pipeline-cache 로 끄고 시작 / 크기 조정 시간을 비교할 수 있습니다.)
+    bool shaderReload = true;                           // 창 모드에서 셰이더 소스가 바뀌면 다시 컴파일해서 파이프라인을 바꿉니다. (--no-shader-reload 로 끕니다. 헤드리스 모드에서는 감시하지 않습니다.)
+    uint32_t stagingRingMiB = DEFAULT_STAGING_RING_MIB; // 모든 업로드가 나누어 쓰는 스테이징 링 버퍼의 크기 (MiB). 이보다 큰 업로드는 조각으로 나누어 복사합니다.
+    std::string benchObjPath;                           // 비어있지 않으면 렌더링 대신 이 OBJ 파일로 단일 스레드 / 멀티 스레드 로드 경로를 비교합니다.
+};
+
 
 
 // 필요한 검증 레이어 목록
@@ -102,6 +205,8 @@ struct QueueFamilyIndices
     std::optional<uint32_t> graphicsFamily;
     // presentFamily 에는 그래픽카드가 해당 프레젠테이션 큐 페밀리를 지원하는지 여부와 지원한다면 해당 큐 페밀리의 인덱스 번호를 담고 있습니다.
     std::optional<uint32_t> presentFamily;
+    // transferFamily 에는 그래픽 기능이 없는 전용 전송 큐 패밀리의 인덱스를 담습니다. 없으면 비어 있으며 업로드는 그래픽 큐를 사용합니다. (필수 패밀리가 아니므로 isComplete 에서 검사하지 않습니다.)
+    std::optional<uint32_t> transferFamily;
 
     // 이 함수를 호출해서 우리가 원하는 모든 패밀리를 얻었는지 확인할 수 있습니다.
     bool isComplete()
@@ -184,6 +289,22 @@ struct Vertex
         return attributeDescriptions;
     }
 
+    // 압축하지 않을 때(--no-quantize) 사용할 VertexLayout. 그래픽 파이프라인은 메쉬마다 고른 VertexLayout 으로 만들어지므로 위의 두 설명을 그대로 옮겨 담습니다.
+    static VertexLayout getFloatLayout()
+    {
+        auto attributeDescriptions = getAttributeDescriptions();
+
+        VertexLayout layout;
+        layout.stride = getBindingDescription().stride;
+        layout.positionOffset = attributeDescriptions[0].offset;
+        layout.positionFormat = attributeDescriptions[0].format;
+        layout.colorOffset = attributeDescriptions[1].offset;
+        layout.colorFormat = attributeDescriptions[1].format;
+        layout.texCoordOffset = attributeDescriptions[2].offset;
+        layout.texCoordFormat = attributeDescriptions[2].format;
+        return layout;
+    }
+
     // 버텍스 두개가 동일한 위치, 색상, UV좌표를 가지고 있는지 검사하기 위한 연산자 오버로딩 함수 (OBJ 파일 로드시 버텍스가 고유한지 판단하여 중복된 버텍스를 인덱싱하기 위해 사용)
     bool operator==(const Vertex& other) const
     {
@@ -198,7 +319,8 @@ namespace std
     {
         size_t operator()(Vertex const& vertex) const
         {
-            return ((hash<glm::vec3>()(vertex.position) ^ (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^ (hash<glm::vec2>()(vertex.texCoord) << 1);
+            // 처음에는 세 glm 해시를 시프트와 XOR 로 결합했지만, 격자처럼 규칙적인 메쉬에서 충돌이 많아 버텍스 전체 바이트에 대한 64 비트 해시(VertexDedup::hashVertex)로 바꾸었습니다.
+            return static_cast<size_t>(VertexDedup::hashVertex(vertex));
         }
     };
 }
@@ -253,6 +375,260 @@ const std::vector<uint16_t> indices_sample = {
 };
 
 
+// 작업 스레드에서 읽고 가공을 마친, 업로드 전의 메쉬
+struct MeshAsset
+{
+    VertexLayout layout;                                // 임포트할 때 메쉬에 맞게 고른 버텍스 형식
+    MappedFile cacheFile;                               // 메쉬 캐시를 불러왔으면 vertexData / indexData 가 이 매핑 안을 가리킵니다.
+    std::vector<uint8_t> packedVertices;                // OBJ 를 파싱했으면 layout 형식으로 옮긴 버텍스 배열
+    std::vector<uint8_t> packedIndices;                 // indexSize 크기로 옮긴 인덱스 배열
+    const uint8_t* vertexData = nullptr;
+    const void* indexData = nullptr;
+    uint32_t indexSize = sizeof(uint32_t);              // 메쉬마다 고른 인덱스 크기. 버텍스가 65536 개보다 적으면 2 (uint16_t) 입니다.
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    MeshOptimizer::VertexCacheStats cacheStats;         // 업로드할 인덱스 순서의 ACMR / ATVR (벤치마크 출력용)
+    glm::vec3 boundsMin{ 0.0f };                        // 원래 좌표의 경계 상자 (CompactVertex::getPositionBounds)
+    glm::vec3 boundsMax{ 0.0f };
+};
+
+// 작업 스레드에서 불러와 메인 스레드의 업로드(createTextureImage)로 넘기는 텍스쳐
+struct TextureAsset
+{
+    MipBuilder::MipChain chain;                         // 이미지를 디코딩해 만들었거나 텍스쳐 캐시에서 읽은 밉 체인
+    MappedFile ktx2File;                                // KTX2 파일을 불러왔으면 초압축이 없는 레벨은 이 매핑 안을 그대로 가리킵니다.
+    std::vector<uint8_t> inflated;                      // zstd 초압축을 푼 KTX2 레벨들
+    MipBuilder::MipChainView view;                      // 업로드할 레벨들. chain, ktx2File, inflated 중 하나를 가리킵니다.
+    TextureKey key;                                     // 텍스쳐 캐시 키 (identifyTexture). 디코딩하기 전에 구해서, 캐시에 있으면 loadTexture 를 건너뜁니다.
+    uint64_t sourceHash = 0;                            // 원본 파일 내용의 해시와 크기. 디스크 텍스쳐 캐시(TextureCache)가 유효한지 확인할 때 씁니다.
+    uint64_t sourceSize = 0;
+};
+
+// 모델의 머티리얼 텍스쳐들을 합친 아틀라스 배치. 에셋 로드를 시작하기 전에 메인 스레드에서 정해 두고, 메쉬 / 텍스쳐 작업 스레드는 읽기만 합니다.
+struct MaterialAtlas
+{
+    std::vector<ObjMaterial> materials;                 // 모델의 MTL 머티리얼
+    std::vector<int32_t> materialEntries;               // 머티리얼마다 layout.entries 의 인덱스
+    int32_t defaultEntry = -1;                          // 머티리얼이 없거나 텍스쳐가 없는 면이 쓰는 흰색 이미지의 인덱스
+    TextureAtlasLayout layout;                          // 비어 있으면 아틀라스 없이 TEXTURE_PATH 하나를 씁니다.
+
+    bool empty() const { return layout.empty(); }
+
+    // 삼각형의 머티리얼 번호(ObjMaterials::assignTriangles, 없으면 -1)로 아틀라스 이미지를 고릅니다.
+    size_t getEntry(int32_t material) const
+    {
+        return static_cast<size_t>(material >= 0 && static_cast<size_t>(material) < materialEntries.size() ? materialEntries[material] : defaultEntry);
+    }
+
+    // 머티리얼과 이미지의 대응도 UV 에 영향을 주므로 배치와 함께 메쉬 / 텍스쳐 캐시 키에 섞습니다.
+    uint64_t getHash() const
+    {
+        uint64_t hash = layout.getHash();
+        for (const ObjMaterial& material : materials)
+        {
+            hash = hashBytes(material.name.data(), material.name.size(), hash);
+        }
+        return hashBytes(materialEntries.data(), materialEntries.size() * sizeof(int32_t), hash);
+    }
+};
+
+// GPU 에 올린 텍스쳐. 그리기에 쓰는 텍스쳐와 업로드가 끝나기를 기다리는 텍스쳐를 같은 구조로 다룹니다.
+struct TextureResource
+{
+    VkImage image = VK_NULL_HANDLE;                     // 텍스쳐 이미지 핸들
+    MemoryAllocation memory;                            // 텍스쳐 이미지 메모리 핸들
+    VkImageView view = VK_NULL_HANDLE;                  // 텍스쳐 이미지 뷰 핸들
+    TextureFormat format = TextureFormat::Rgba8;        // 텍셀 형식 (압축하지 않은 RGBA8 또는 BC 블록)
+    VkDeviceSize byteSize = 0;                          // 모든 밉 레벨의 바이트 수
+    uint32_t mipLevels = 1;                             // 밉맵 단계 수. Vulkan에서 각 밉 이미지는 VkImage의 서로 다른 밉 레벨에 저장됩니다. 밉 레벨 0은 원본 이미지이고 레벨 0 이후의 밉 레벨은 일반적으로 밉 체인이라고 합니다.
+    TextureKey key;                                     // 텍스쳐 캐시 키. 다 쓴 텍스쳐는 지우지 않고 이 키로 textureCache 에 돌려줍니다.
+};
+
+// GPU 에 올린 메쉬와 그리기에 필요한 정보
+struct MeshResource
+{
+    VertexLayout layout;                                // 메쉬의 버텍스 형식. 그래픽 파이프라인의 버텍스 입력도 이 형식을 따릅니다.
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;             // 버텍스 버퍼 핸들
+    MemoryAllocation vertexBufferMemory;                // 버텍스 버퍼가 들어있는 실제 메모리의 핸들
+    VkBuffer constantColorBuffer = VK_NULL_HANDLE;      // 모든 버텍스의 색상이 같은 메쉬에서 그 색상(RGBA8) 하나를 담아 바인딩 1 로 넘기는 버퍼
+    MemoryAllocation constantColorBufferMemory;
+    // 버텍스 데이터와 마찬가지로 GPU가 인덱스에 액세스할 수 있도록 인덱스를 VkBuffer에 업로드해야 합니다.
+    VkBuffer indexBuffer = VK_NULL_HANDLE;              // 인덱스 버퍼
+    MemoryAllocation indexBufferMemory;                 // 인덱스 버퍼가 들어있는 실제 메모리의 핸들
+    uint32_t indexSize = sizeof(uint32_t);
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;       // indexSize 에 맞는 그리기용 인덱스 타입
+    uint32_t indexCount = 0;
+    MeshOptimizer::VertexCacheStats cacheStats;
+    glm::vec3 boundsCenter{ 0.0f };                     // 모델 좌표의 경계 구. 화면에서 차지하는 크기로 텍스쳐 스트리밍 레벨을 정합니다.
+    float boundsRadius = 0.0f;
+};
+
+
+// 단일 스레드 OBJ 로드 경로 (tinyobj::LoadObj + std::unordered_map 중복 제거)
+// 지금은 loadModel 에서 사용하지 않지만, 병렬 경로의 결과가 같은지와 얼마나 빨라졌는지 비교하는 기준으로 --bench-obj 에서 사용합니다.
+HELPER_FUNCTION void loadObjSerial(const std::string& path, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    vertices.clear();
+    indices.clear();
+
+    // 이제 이 라이브러리를 사용하여 정점 및 인덱스 컨테이너를 메쉬의 정점 데이터로 채우는 loadModel 함수를 작성할 것입니다. 버텍스 및 인덱스 버퍼가 생성되기 전에 이 함수가 호출되어야 합니다.
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    // 모델은 tinyobj::LoadObj 함수를 호출하여 라이브러리의 데이터 구조로 로드됩니다. OBJ 파일은 위치, 법선, 텍스처 좌표 및 면으로 구성됩니다. 면은 임의의 양의 정점으로 구성되며 각 정점은 인덱스로 위치, 법선 및/또는 텍스처 좌표를 나타냅니다. 이를 통해 전체 정점뿐만 아니라 개별 속성도 재사용할 수 있습니다. attrib 컨테이너는 attrib.vertices, attrib.normals 및 attrib.texcoords 벡터의 모든 위치, 법선 및 텍스처 좌표를 보유합니다.모양 컨테이너에는 모든 개별 개체와 해당 면이 포함됩니다. 각 면은 정점 배열로 구성되며 각 정점에는 위치, 법선 및 텍스처 좌표 속성의 인덱스가 포함됩니다. OBJ 모델은 면별로 재질과 질감을 정의할 수도 있지만 무시하겠습니다. err 문자열은 오류를 포함하고 warn 문자열은 누락된 재료 정의와 같이 파일을 로드하는 동안 발생한 경고를 포함합니다. LoadObj 함수가 false를 반환하는 경우 로드에 실패했다는 의미입니다. 위에서 언급했듯이 OBJ 파일의 면은 실제로 임의의 수의 정점을 포함할 수 있지만 우리 애플리케이션은 삼각형만 렌더링할 수 있습니다. 운 좋게도 LoadObj에는 기본적으로 활성화되어 있는 이러한 면을 자동으로 모두 삼각형으로 만들어주는 선택적 매개변수 triangulation 가 있습니다.
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str()))
+    {
+        throw std::runtime_error("\033[1;31m@ [ERROR] : Failed to load OBJ File : " + warn + err);
+    }
+
+    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+
+    // 파일의 모든 면을 단일 모델로 결합할 것이므로 모든 모양을 순회합니다.
+    for (const auto& shape : shapes)
+    {
+        for (const auto& index : shape.mesh.indices)
+        {
+            Vertex vertex{};
+
+            // triangulation 기능으로 이미 면당 3개의 정점만 존재한다는 것이 보장되므로 이제 정점을 직접 순회하며 정점 벡터에 직접 덤프할 수 있습니다. 단순화를 위해 모든 정점이 고유하다고 가정하므로 간단히 인덱스를 증가시켰습니다. 인덱스 변수는 vertex_index, normal_index 및 texcoord_index 멤버를 포함하는 tinyobj::index_t 유형입니다. attrib 배열에서 실제 꼭짓점 속성을 조회하려면 다음 인덱스를 사용해야 합니다. 불행히도 attrib.vertices 배열은 glm::vec3과 같이 버텍스로 묶인 배열이 아니라 그냥 모든 요소가 쭉 나열된 float 값의 배열이므로 인덱스에 3(x,y,z)을 곱해야 실제 버텍스별로 접근이 가능합니다.
+            vertex.position = {
+                attrib.vertices[3 * index.vertex_index + 0],
+                attrib.vertices[3 * index.vertex_index + 1],
+                attrib.vertices[3 * index.vertex_index + 2]
+            };
+
+            // 마찬가지로 attrib.texcoords 배열에는 두 개의 텍스처 좌표 구성 요소(U,V)씩 나열되어 있으므로 2를 곱해 접근하였습니다.
+            vertex.texCoord = {
+                attrib.texcoords[2 * index.texcoord_index + 0],
+                // OBJ 형식은 수직 좌표가 0 이면 이미지의 하단을 의미하는 좌표계를 가지지만 Vulkan 에서 0 은 이미지의 상단을 의미하므로 이미지를 위에서 아래 방향으로 업로드했습니다. 텍스처 좌표의 수직 구성요소를 뒤집어서 이 문제를 해결하였습니다.
+                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+            };
+
+            vertex.color = { 1.0f, 1.0f, 1.0f };
+
+            // 불행히도 아직 인덱스 버퍼를 제대로 활용하지 못하고 있습니다. 정점 벡터에는 많은 정점이 여러 삼각형에 포함되어 있기 때문에 중복된 정점 데이터가 많이 포함되어 있습니다. 고유한 정점만 유지하고 인덱스 버퍼를 사용하여 정점이 나타날 때마다 재사용해야 합니다. 이것을 구현하는 간단한 방법은 map 또는 unordered_map을 사용하여 고유한 정점과 각 인덱스를 추적하는 것입니다. OBJ 파일에서 정점을 읽을 때마다 이전에 정확히 동일한 위치와 텍스처 좌표를 가진 정점을 이미 본 적이 있는지 확인합니다. 그렇지 않은 경우 정점에 추가하고 해당 인덱스를 uniqueVertices 컨테이너에 저장합니다. 그 후 새로운 정점의 인덱스를 인덱스에 추가합니다. 이전에 똑같은 꼭짓점을 본 적이 있다면 uniqueVertices에서 해당 인덱스를 조회하고 해당 인덱스를 인덱스에 저장합니다. 꼭짓점의 크기를 확인하면 1,500,000 에서 265,645 개로 축소된 것을 알 수 있습니다! 이는 각 정점이 평균 ~6개 의 삼각형에서 재사용됨을 의미합니다. 이것은 확실히 GPU 메모리를 많이 절약합니다.
+            if (uniqueVertices.count(vertex) == 0)
+            {
+                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+                vertices.push_back(vertex);
+            }
+
+            indices.push_back(uniqueVertices[vertex]);
+        }
+    }
+
+    // 최적화가 활성화된 상태에서 지금 프로그램을 실행하십시오(예: Visual Studio의 릴리스 모드 및 GCC용 -O3 컴파일러 플래그). 그렇지 않으면 모델을 로드하는 속도가 매우 느려지기 때문에 이것이 필요합니다.
+}
+
+// 멀티스레드 OBJ 로드 경로 (tinyobj_opt::parseObj + VertexDedup::deduplicate)
+// 파일을 메모리 매핑하여 복사 없이 파서에 넘기고, 면의 모서리 배열을 스레드별로 나누어 중복을 제거합니다. 삼각형으로만 이루어진 모델이면 결과는 loadObjSerial 과 같습니다. (사각형 이상의 면은 두 파서의 삼각형 분할 방식이 달라 인덱스 순서가 다를 수 있습니다.)
+// atlas 가 있으면 삼각형마다 머티리얼을 찾아 UV 를 그 머티리얼 텍스쳐가 놓인 아틀라스 자리로 옮깁니다.
+HELPER_FUNCTION void loadObjParallel(const std::string& path, uint32_t threadCount, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, double* parseMs = nullptr, double* dedupMs = nullptr, const MaterialAtlas* atlas = nullptr)
+{
+    auto parseStart = std::chrono::high_resolution_clock::now();
+
+    MappedFile source;
+    if (source.open(path) == false)
+    {
+        throw std::runtime_error("\033[1;31m@ [ERROR] : Failed to open OBJ File : " + path);
+    }
+
+    // 파서는 마지막 줄이 줄바꿈으로 끝나지 않으면 그 줄을 버리므로, 이 경우에만 줄바꿈을 붙인 복사본을 넘깁니다.
+    const char* buffer = reinterpret_cast<const char*>(source.getData());
+    size_t length = source.getSize();
+    std::vector<char> terminatedCopy;
+    if (buffer[length - 1] != '\n')
+    {
+        terminatedCopy.assign(buffer, buffer + length);
+        terminatedCopy.push_back('\n');
+        buffer = terminatedCopy.data();
+        length = terminatedCopy.size();
+    }
+
+    tinyobj_opt::attrib_t attrib;
+    std::vector<tinyobj_opt::shape_t> shapes;
+    std::vector<tinyobj_opt::material_t> materials;
+    tinyobj_opt::LoadOption loadOption;
+    loadOption.req_num_threads = static_cast<int>(threadCount);
+    loadOption.triangulate = true;
+    if (!tinyobj_opt::parseObj(&attrib, &shapes, &materials, buffer, length, loadOption))
+    {
+        throw std::runtime_error("\033[1;31m@ [ERROR] : Failed to load OBJ File : " + path);
+    }
+
+    // 파서는 머티리얼을 작업 디렉터리에서 찾으므로 삼각형별 머티리얼은 버퍼를 한 번 더 훑어 직접 읽습니다. (ObjMaterials.h)
+    std::vector<int32_t> triangleMaterials;
+    if (atlas != nullptr)
+    {
+        ObjMaterials::assignTriangles(buffer, length, atlas->materials, triangleMaterials);
+    }
+    source.close();
+
+    auto dedupStart = std::chrono::high_resolution_clock::now();
+
+    // 모든 면이 삼각형으로 분할되었으므로 attrib.indices 는 그대로 삼각형 모서리의 나열입니다. 모든 모양(shape)을 하나의 모델로 합치는 것도 loadObjSerial 과 같습니다.
+    const size_t positionCount = attrib.vertices.size() / 3;
+    const size_t texcoordCount = attrib.texcoords.size() / 2;
+    std::atomic<bool> invalidIndex{ false }; // 작업 스레드에서 던진 예외는 잡을 수 없으므로 표시만 해두고 끝난 뒤에 예외를 던집니다.
+    VertexDedup::deduplicate<Vertex>(attrib.indices.size(), threadCount, [&](size_t corner)
+    {
+        const tinyobj_opt::index_t& index = attrib.indices[corner];
+        Vertex vertex{};
+        if (index.vertex_index < 0 || static_cast<size_t>(index.vertex_index) >= positionCount)
+        {
+            invalidIndex = true;
+            return vertex;
+        }
+
+        vertex.position = {
+            attrib.vertices[3 * index.vertex_index + 0],
+            attrib.vertices[3 * index.vertex_index + 1],
+            attrib.vertices[3 * index.vertex_index + 2]
+        };
+
+        // 텍스처 좌표가 없는 모서리는 (0, 1) 로 둡니다. 수직 좌표를 뒤집는 것은 loadObjSerial 과 같습니다.
+        if (index.texcoord_index >= 0 && static_cast<size_t>(index.texcoord_index) < texcoordCount)
+        {
+            vertex.texCoord = {
+                attrib.texcoords[2 * index.texcoord_index + 0],
+                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+            };
+        }
+        else
+        {
+            vertex.texCoord = { 0.0f, 1.0f };
+        }
+
+        // 면은 모두 삼각형으로 나뉘었으므로 세 모서리마다 삼각형 하나입니다.
+        if (atlas != nullptr)
+        {
+            const size_t triangle = corner / 3;
+            vertex.texCoord = atlas->layout.remap(atlas->getEntry(triangle < triangleMaterials.size() ? triangleMaterials[triangle] : -1), vertex.texCoord);
+        }
+
+        vertex.color = { 1.0f, 1.0f, 1.0f };
+        return vertex;
+    }, vertices, indices);
+
+    if (invalidIndex)
+    {
+        throw std::runtime_error("\033[1;31m@ [ERROR] : Invalid vertex index in OBJ File : " + path);
+    }
+
+    auto dedupEnd = std::chrono::high_resolution_clock::now();
+    if (parseMs != nullptr)
+    {
+        *parseMs = std::chrono::duration<double, std::milli>(dedupStart - parseStart).count();
+    }
+    if (dedupMs != nullptr)
+    {
+        *dedupMs = std::chrono::duration<double, std::milli>(dedupEnd - dedupStart).count();
+    }
+}
+
+
 // 실제 어플리케이션 클래스
 class HelloTriangleApplication
 {
@@ -264,10 +640,14 @@ private:
 
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;   // 선택된 그래픽카드 디바이스 핸들. vkInstance 와 함께 자동으로 소멸됩니다.
     VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;  // 그래픽카드가 사용할 수 있는 샘플 수를 결정하는 것으로 시작하겠습니다. 대부분의 최신 GPU는 최소 8개의 샘플을 지원하지만 이 숫자가 항상 동일하다고 보장할 수는 없습니다. 우리는 새로운 클래스 멤버를 추가하여 그래픽카드의 최대 샘플 수를 검사할 것입니다.
+    bool textureCompressionBC = false;                  // 장치가 BC 압축 텍스쳐 형식을 지원하는지 여부. 지원하면 논리 장치를 만들 때 기능을 켭니다.
+    bool physicalDeviceProperties2Supported = false;    // 인스턴스가 VK_KHR_get_physical_device_properties2 를 켰는지 여부. Vulkan 1.0 에서 VK_EXT_memory_budget 을 쓰려면 필요합니다.
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR getPhysicalDeviceMemoryProperties2 = nullptr; // VK_EXT_memory_budget 을 켰으면 힙별 예산 / 사용량을 읽는 함수, 아니면 nullptr
     VkDevice device;                                    // 추상적 디바이스 핸들. 그래픽카드와 통신하기 위한 인터페이스 입니다. 하나의 그래픽카드에 여러개의 추상적 디바이스를 만들 수도 있습니다.
 
     VkQueue graphicsQueue;                              // 그래픽 큐 핸들. 사실 큐는 추상적 디바이스를 만들때 같이 만들어집니다. 하지만 만들어질 그래픽 큐를 다룰 수 있는 핸들을 따로 만들어 관리해야 합니다. VkDevice 와 함께 자동으로 소멸됩니다.
     VkQueue presentQueue;                               // 프레젠테이션 큐 핸들. 화면에 결과물을 보여주기 위해 사용됩니다.
+    VkQueue transferQueue;                              // 업로드 복사를 실행할 전송 큐 핸들. 전용 전송 큐 패밀리가 없으면 graphicsQueue 와 같습니다.
 
     VkSwapchainKHR swapChain;                           // 불칸은 기본 프레임버퍼라는 개념이 없으므로 화면에 렌더링 하기 전에 이 버퍼를 소유할 인프라가 필요하며 이 인프라를 스왑 체인이라고 합니다. 스왑 체인은 기본적으로 화면에 표기되기를 기다리는 이미지 큐입니다. 응용 프로그램은 랜더링할 이미지를 다 그리면 이 큐에 넣습니다. 스왑 체인의 일반적인 목적은 이미지 표시를 화면의 새로 고침 빈도와 동기화하는 것입니다. 사실 프레젠테이션 큐가 지원되는 그래픽 카드에서는 스왑 체인 확장 기능도 반드시 지원할 것입니다.
     std::vector<VkImage> swapChainImages;               // 이제 스왑 체인이 생성되었으므로 남은 것은 그 안에 있는 스왑 체인용 이미지들(VkImages) 의 핸들을 받는 것입니다. 렌더링 작업 중에 이를 참조할 것입니다. 이미지는 스왑 체인 구현과 함께 생성하며 스왑 체인이 파괴되면 자동으로 소멸됩니다.
@@ -277,39 +657,50 @@ private:
     std::vector<VkFramebuffer> swapChainFramebuffers;   // 스왑 체인용 프레임 버퍼들의 핸들 모음
 
     VkRenderPass renderPass;                            // 렌더 패스 핸들
-    VkDescriptorSetLayout descriptorSetLayout;          // 디스크립터 셋 레이아웃 핸들 (유니폼 버퍼를 바인딩하는데 사용). 모든 디스크립터 바인딩은 하나의 VkDescriptorSetLayout 개체와 결합됩니다.
-    VkPipelineLayout pipelineLayout;                    // 파이프라인 레이아웃 핸들
-    VkPipeline graphicsPipeline;                        // 그래픽스 파이프라인 핸들
+    VkDescriptorSetLayout descriptorSetLayout;          // 디스크립터 셋 레이아웃 핸들 (유니폼 버퍼를 바인딩하는데 사용). 모든 디스크립터 바인딩은 하나의 VkDescriptorSetLayout 개체와 결합됩니다. 레이아웃 캐시가 소유합니다.
+    VkPipelineLayout pipelineLayout;                    // 파이프라인 레이아웃 핸들. 레이아웃 캐시가 소유합니다.
+    PipelineLayoutDesc pipelineLayoutDesc;              // 셰이더 리플렉션으로 만든 디스크립터 바인딩과 푸시 상수 범위. 디스크립터 셋 레이아웃, 디스크립터 풀, 디스크립터 쓰기가 모두 이것을 따릅니다.
+    std::vector<uint32_t> vertexInputLocations;         // 버텍스 셰이더가 읽는 입력의 location. 메쉬의 버텍스 형식에서 이 밖의 속성은 파이프라인에 넣지 않습니다.
+    LayoutCache layoutCache;                            // 내용이 같은 디스크립터 셋 레이아웃과 파이프라인 레이아웃을 한 번만 만듭니다.
+    VkPipeline graphicsPipeline;                        // 지금 그리는 메쉬(mesh)의 그래픽스 파이프라인 핸들. 파이프라인 레지스트리가 소유합니다.
+    VkShaderModule vertShaderModule;                    // 모든 파이프라인 변형이 쓰는 셰이더 모듈. 파이프라인 레지스트리가 소유합니다.
+    VkShaderModule fragShaderModule;
+    PipelineCache pipelineCache;                        // 파이프라인 생성에 넘기는 디스크 파이프라인 캐시
+    PipelineRegistry pipelineRegistry;                  // 파이프라인 상태별로 파이프라인을 작업 스레드에서 컴파일하고 다시 쓰는 레지스트리
+    std::chrono::high_resolution_clock::time_point pipelineRequestTime; // 자리표시 메쉬의 파이프라인을 요청한 시각
+    ShaderLibrary shaderLibrary;                        // GLSL 소스를 SPIR-V 로 컴파일하고 캐시합니다. 작업 스레드에서도 씁니다.
+    ShaderSource vertShaderSource;                      // 지금 쓰는 셰이더의 소스와 define. 시작할 때 정하고 바꾸지 않습니다.
+    ShaderSource fragShaderSource;
+    ShaderWatcher shaderWatcher;                        // 셰이더 소스와 #include 한 파일의 변경 감시
+    bool shaderCompilePending = false;                  // 바뀐 셰이더를 작업 스레드에서 컴파일하는 중인지
+    bool shaderPipelinePending = false;                 // 새 셰이더로 지금 메쉬의 파이프라인을 컴파일하는 중인지
+    VkShaderModule previousVertShaderModule = VK_NULL_HANDLE; // 핫 리로드 전의 셰이더 모듈. 새 파이프라인으로 바꾸면 레지스트리에서 빼고, 컴파일에 실패하면 되돌립니다.
+    VkShaderModule previousFragShaderModule = VK_NULL_HANDLE;
+    std::vector<uint32_t> previousVertexInputLocations;
+    std::chrono::high_resolution_clock::time_point shaderChangeTime; // 셰이더 소스 변경을 발견한 시각
+    uint32_t pipelineWaitFrames = 0;                    // 업로드가 끝난 메쉬가 파이프라인 컴파일을 기다리며 이전 메쉬로 그린 프레임 수
 
     VkCommandPool commandPool;                          // 커맨드 풀 버퍼. 커맨드 풀은 버퍼를 저장하는 데 사용되는 메모리를 관리합니다.
 
     // MSAA에서 각 픽셀은 오프스크린 버퍼에서 샘플링된 다음 화면에 렌더링됩니다. 이 새로운 버퍼는 우리가 렌더링해온 일반 이미지와 약간 다릅니다. 픽셀당 하나 이상의 샘플을 저장할 수 있어야 합니다. 멀티샘플링된 버퍼가 생성되면 디폴트 프레임 버퍼(픽셀당 단일 샘플만 저장)로 확인해야 합니다. 이것이 추가 렌더 타겟을 생성하고 현재 드로잉 프로세스를 수정해야 하는 이유입니다. 깊이 버퍼와 마찬가지로 한 번에 하나의 그리기 작업만 활성화되므로 하나의 렌더 타겟만 필요합니다. 다음 클래스 멤버들을 추가합니다.
     VkImage colorImage;                                 // 컬러 이미지 핸들
-    VkDeviceMemory colorImageMemory;                    // 컬러 이미지 메모리 핸들
+    MemoryAllocation colorImageMemory;                  // 컬러 이미지 메모리 핸들
     VkImageView colorImageView;                         // 컬러 이미지 뷰 핸들
 
     VkImage depthImage;                                 // 깊이 이미지 핸들. 깊이 어태치먼트는 색상 어태치먼트와 마찬가지로 이미지를 기반으로 합니다. 차이점은 스왑 체인이 자동으로 깊이 이미지를 생성하지 않는다는 것입니다. 한 번에 하나의 그리기 작업만 실행되기 때문에 하나의 깊이 이미지만 필요합니다. 깊이 이미지에는 이미지, 메모리 및 이미지 보기의 세 가지 리소스가 필요합니다.
-    VkDeviceMemory depthImageMemory;                    // 깊이 이미지 메모리 핸들
+    MemoryAllocation depthImageMemory;                  // 깊이 이미지 메모리 핸들
     VkImageView depthImageView;                         // 깊이 이미지 뷰 핸들
 
-    uint32_t mipLevels;                                 // 밉맵 단계 수. Vulkan에서 각 밉 이미지는 VkImage의 서로 다른 밉 레벨에 저장됩니다. 밉 레벨 0은 원본 이미지이고 레벨 0 이후의 밉 레벨은 일반적으로 밉 체인이라고 합니다. 밉 레벨의 수는 VkImage가 생성될 때 지정됩니다. 지금까지 우리는 항상 이 값을 1로 설정했습니다. 이미지의 차원에서 밉 레벨의 수를 계산해야 합니다.
-    VkImage textureImage;                               // 텍스쳐 이미지 핸들
-    VkDeviceMemory textureImageMemory;                  // 텍스쳐 이미지 메모리 핸들
-    VkImageView textureImageView;                       // 텍스쳐 이미지 뷰 핸들
+    TextureResource texture;                            // 그리기에 쓰는 텍스쳐. 백그라운드 로드가 끝나기 전에는 1x1 흰색 자리표시 텍스쳐입니다.
     VkSampler textureSampler;                           // 텍스쳐 샘플러 핸들
-    
-    std::vector<Vertex> vertices;                       // 버텍스 배열. 이제 샘플 모델 파일에서 버텍스와 인덱스를 로드할 것입니다.
-    std::vector<uint32_t> indices;                      // 인덱스 배열. 65535보다 더 많은 정점이 있을 것이기 때문에 인덱스 유형을 uint16_t에서 uint32_t로 변경해야 합니다.
-
-    VkBuffer vertexBuffer;                              // 버텍스 버퍼 핸들
-    VkDeviceMemory vertexBufferMemory;                  // 버텍스 버퍼가 들어있는 실제 메모리의 핸들
-    // 버텍스 데이터와 마찬가지로 GPU가 인덱스에 액세스할 수 있도록 인덱스를 VkBuffer에 업로드해야 합니다.인덱스 버퍼에 대한 리소스를 보유할 두 개의 새 클래스 멤버를 정의합니다.
-    VkBuffer indexBuffer;                               // 인덱스 버퍼
-    VkDeviceMemory indexBufferMemory;                   // 인덱스 버퍼가 들어있는 실제 메모리의 핸들
+    SamplerKey textureSamplerKey;                       // textureSampler 를 만든 설정. minLod 는 텍스쳐 스트리밍이 새로 올라온 레벨을 서서히 보여 줄 때 바뀝니다.
+    MeshResource mesh;                                  // 그리기에 쓰는 메쉬. 백그라운드 로드가 끝나기 전에는 자리표시 메쉬(vertices_sample)입니다.
 
     // 셰이더를 위해 UBO 데이터가 포함된 버퍼를 자세히 정의할 것입니다. 매 프레임마다 새로운 데이터를 유니폼 버퍼에 복사할 것이므로 스테이징 버퍼를 갖는 것은 의미가 없습니다. 이 경우 불필요한 오버헤드를 추가하고 성능을 개선하는 대신 오히려 성능을 저하시킬 수 있습니다. 여러 프레임이 동시에 비행 중일 수 있고 이전 프레임이 여전히 읽고 있는 동안 다음 프레임을 준비하기 위해 버퍼를 업데이트하고 싶지 않기 때문에 여러 버퍼가 있어야 합니다! 따라서 비행 중인 프레임 수만큼 유니폼 버퍼가 필요하고 현재 GPU 에서 읽고 있지 않는 유니폼 버퍼에 기록해야 합니다.
-    std::vector<VkBuffer> uniformBuffers;               // 유니폼 버퍼 
-    std::vector<VkDeviceMemory> uniformBuffersMemory;   // 실제 그래픽카드 메모리에 담긴 유니폼 버퍼 핸들
+    std::vector<VkBuffer> uniformBuffers;               // 유니폼 버퍼. 프레임 슬롯마다 하나씩 있는 링 버퍼로 사용합니다.
+    std::vector<MemoryAllocation> uniformBuffersMemory; // 실제 그래픽카드 메모리에 담긴 유니폼 버퍼 핸들
+    UniformRingBuffer uniformRing;                      // 유니폼 버퍼들에 그리기별 데이터를 차례로 기록하고 동적 오프셋을 나누어 줍니다.
+    uint32_t objectUniformOffset = 0;                   // 이번 프레임에 그릴 오브젝트의 UBO 가 링 버퍼에 기록된 동적 오프셋
 
     VkDescriptorPool descriptorPool;                    // 디스크립터 풀 핸들. 디스크립터 세트들을 할당하고 관리합니다. 주의할 점은 Descriptor pools은 외부적으로 동기화 되어지므로 멀티 쓰레드에서 동시에 같은 pool에 접근하여 할당/해제를 시도하면 안됩니다.
     std::vector<VkDescriptorSet> descriptorSets;        // 디스크립터 셋 핸들 모음. 셰이더가 지정된 위치의 리소스를 읽을 수 있게 하는 인터페이스를 제공합니다.
@@ -324,14 +715,64 @@ private:
 
     bool framebufferResized = false;                                // 많은 드라이버와 플랫폼이 창 크기 조정 후 VK_ERROR_OUT_OF_DATE_KHR을 자동으로 트리거하지만 항상 발생한다고 보장할 수 없습니다. 때문에 프레임 버퍼 크기 조정을 직접 감지하도록 framebufferResized 를 만들어 사용하였습니다.
 
+    AppOptions options;                                             // 커맨드 라인으로 전달받은 실행 옵션
+    std::vector<MemoryAllocation> offscreenImagesMemory;            // 헤드리스 모드에서는 스왑 체인 대신 직접 만든 오프스크린 이미지를 swapChainImages 에 담아 사용합니다. 그 이미지들의 메모리 핸들입니다.
+
+    MemoryAllocator memoryAllocator;                                // 모든 버퍼와 이미지의 디바이스 메모리를 메모리 유형별 블록에서 나누어 할당합니다.
+    GpuProfiler gpuProfiler;                                        // 구간별 GPU 시간 측정기. 프레임 슬롯마다, 그리고 일회성 명령 버퍼용으로 따로 타임스탬프 쿼리 구역을 가집니다.
+    uint64_t frameNumber = 0;                                       // 지금까지 제출한 프레임 수
+    UploadContext uploadContext;                                    // 버퍼 / 이미지 업로드 명령을 배치로 모아 제출합니다.
+    VkBuffer stagingRingBuffer = VK_NULL_HANDLE;                    // 시작할 때 한 번 만들어 영구 매핑해 두는 스테이징 버퍼
+    MemoryAllocation stagingRingMemory;
+    StagingRing stagingRing;                                        // stagingRingBuffer 를 업로드마다 나누어 주고, 업로드 배치가 끝나면 돌려받습니다.
+    VkExtent3D transferGranularity{ 1, 1, 1 };                      // 복사를 실행하는 큐 패밀리의 minImageTransferGranularity. 이미지를 행 단위 조각으로 나눌 때 지켜야 합니다.
+    UploadToken resourceUploadToken;                                // 초기화 때 제출한 자리표시 텍스쳐 / 메쉬 업로드 배치
+    UploadToken uploadProfileToken;                                 // 일회성 명령용 타임스탬프 슬롯을 사용한, 아직 결과를 읽지 않은 업로드 배치
+    bool uploadProfiling = false;                                   // 기록 중인 업로드 배치가 타임스탬프 슬롯을 사용하는지 여부
+    std::vector<double> gpuFrameTimes;                              // 벤치마크 중 프레임 번호별 GPU 시간 (ms). 음수는 측정값 없음
+    uint64_t benchmarkFirstFrame = 0;                               // gpuFrameTimes[0] 에 해당하는 frameNumber (에셋 로드를 기다린 준비 프레임 다음)
+
+    AssetLoader assetLoader;                                        // 텍스쳐 디코딩과 모델 파싱을 실행하는 작업 스레드 풀
+    MaterialAtlas materialAtlas;                                    // 모델의 머티리얼 텍스쳐들을 합친 아틀라스 배치 (planMaterialAtlas). 비어 있으면 TEXTURE_PATH 하나를 씁니다.
+    DeletionQueue deletionQueue;                                    // 교체한 메쉬 / 텍스쳐 / 파이프라인을 그것을 쓰던 프레임들이 끝난 뒤에 해제합니다.
+    ResourceCache<TextureKey, TextureResource, TextureKeyHash> textureCache; // 올린 텍스쳐를 경로와 내용 해시로 찾아 나누어 씁니다. 다 쓴 텍스쳐는 deletionQueue 를 거쳐 여기로 돌려줍니다.
+    ResourceCache<SamplerKey, VkSampler, SamplerKeyHash> samplerCache;        // 만든 샘플러를 VkSamplerCreateInfo 전체로 찾아 나누어 씁니다.
+    TextureResource pendingTexture;                                 // 업로드는 제출했지만 아직 끝나지 않아 그리기에 쓰지 않는 텍스쳐 (없으면 image 가 VK_NULL_HANDLE)
+    UploadToken pendingTextureToken;
+    uint32_t pendingTextureBase = 0;                                // pendingTexture 의 레벨 0 이 스트리밍하는 밉 체인의 몇 번째 레벨인지
+    std::shared_ptr<TextureAsset> streamedTexture;                  // 스트리밍 중인 텍스쳐의 전체 밉 체인. 레벨을 다시 올릴 수 있도록 계속 들고 있습니다. (스트리밍하지 않으면 nullptr)
+    TextureStreamer textureStreamer;                                // streamedTexture 의 어느 레벨부터 상주시킬지 정합니다.
+    float meshScreenDiameter = 0.0f;                                // 지난 프레임에 메쉬 경계 구가 화면에서 차지한 지름 (픽셀). 텍스쳐 스트리밍이 필요한 레벨을 고를 때 씁니다.
+    MeshResource pendingMesh;                                       // 업로드는 제출했지만 아직 끝나지 않아 그리기에 쓰지 않는 메쉬 (없으면 vertexBuffer 가 VK_NULL_HANDLE)
+    UploadToken pendingMeshToken;
+    uint64_t textureGeneration = 0;                                 // 그리기용 텍스쳐를 바꿀 때마다 올립니다.
+    std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> descriptorTextureGenerations{}; // 프레임 슬롯의 디스크립터 셋이 가리키는 텍스쳐의 textureGeneration
+    std::chrono::high_resolution_clock::time_point initStartTime;   // 첫 프레임까지 / 에셋이 준비될 때까지의 시간 측정 기준
+    bool firstFrameReported = false;
+    bool assetsReady = false;                                       // 백그라운드 로드한 텍스쳐와 메쉬를 모두 그리기에 쓰고 있는지
+
 public:
+    HelloTriangleApplication(const AppOptions& options) : options(options)
+    {
+    }
+
     void run()
     {
-        initWindow();       // 1. GLFW 윈도우 초기화
+        if (options.headless == false)
+        {
+            initWindow();   // 1. GLFW 윈도우 초기화 (헤드리스 모드에서는 윈도우가 필요 없습니다.)
+        }
 
         initVulkan();       // 2. 불칸 개체 초기화 및 렌더링 준비
 
-        mainLoop();         // 3. 계속해서 매 프레임 렌더
+        if (options.headless)
+        {
+            benchmarkLoop();// 3. 정해진 프레임 수만큼 오프스크린 렌더링하며 프레임별 CPU / GPU 시간 측정
+        }
+        else
+        {
+            mainLoop();     // 3. 계속해서 매 프레임 렌더
+        }
 
         cleanup();          // 4. 프로그램 종료
     }
@@ -383,43 +824,69 @@ private:
     // 2. 불칸 개체 초기화 및 렌더링 준비
     inline void initVulkan()
     {
+        initStartTime = std::chrono::high_resolution_clock::now();
+
+        startAssetLoading();            // 2-17. 작업 스레드에서 OBJ 파일 로드를 시작합니다. Vulkan 이 필요 없는 작업이므로 가장 먼저 시작해 아래의 초기화와 겹치게 합니다.
+
         createInstance();               // 2-1. Vulkan 개체 만들기
 
-        createSurface();                // 2-2. 화면 표시를 위한 서피스 생성 및 GLFW 윈도우에 연결
+        if (options.headless == false)
+        {
+            createSurface();            // 2-2. 화면 표시를 위한 서피스 생성 및 GLFW 윈도우에 연결
+        }
 
         pickPhysicalDevice();           // 2-3. 그래픽 카드 선택
 
         createLogicalDevice();          // 2-4. 그래픽 카드와 통신하기 위한 인터페이스 생성
 
-        createSwapChain();              // 2-5. 이미지 버퍼를 어떤 방식으로 동기화하면서 화면에 표시할지 스왑 체인 규약과 스왑 체인용 이미지 생성
-       
+        startTextureLoading();          // 2-17. 장치가 지원하는 텍스쳐 압축 형식을 알았으므로 작업 스레드에서 텍스쳐 로드를 시작합니다.
+
+        createMemoryAllocator();        // 2-26. 버퍼와 이미지의 메모리를 나누어 줄 디바이스 메모리 할당기 생성. 모든 리소스 생성보다 먼저 준비되어야 합니다.
+
+        createResourceCaches();         // 2-29. 텍스쳐와 샘플러를 나누어 쓰는 리소스 캐시 준비. 샘플러와 자리표시 텍스쳐보다 먼저 준비되어야 합니다.
+
+        createPipelineCache();          // 2-30. 디스크에서 파이프라인 캐시를 불러옵니다. 그래픽스 파이프라인보다 먼저 준비되어야 합니다.
+
+        createPipelineRegistry();       // 2-31. 파이프라인을 컴파일할 작업 스레드를 시작합니다. 파이프라인 캐시를 함께 씁니다.
+
+        if (options.headless)
+        {
+            createOffscreenTargets();   // 2-5. 헤드리스 모드에서는 스왑 체인 대신 오프스크린 렌더 타겟 이미지를 만듭니다.
+        }
+        else
+        {
+            createSwapChain();          // 2-5. 이미지 버퍼를 어떤 방식으로 동기화하면서 화면에 표시할지 스왑 체인 규약과 스왑 체인용 이미지 생성
+        }
+
         createImageViews();             // 2-6. 스왑 체인용 이미지 사용 방식을 정의하기 위한 이미지 뷰 생성
 
         createRenderPass();             // 2-7. 렌더 패스 생성
 
+        loadShaders();                  // 2-9. 셰이더 로드와 리플렉션. 디스크립터 셋 레이아웃과 파이프라인 레이아웃이 셰이더에서 읽은 바인딩을 따르므로 먼저 불러옵니다.
+
         createDescriptorSetLayout();    // 2-8. 디스크립터 셋 레이아웃 생성 (여기선 유니폼 버퍼를 처리하기 위함)
 
-        createGraphicsPipeline();       // 2-9. 셰이더 로드 및 그래픽스 파이프라인 생성
+        createGraphicsPipeline();       // 2-9. 파이프라인 레이아웃 생성. 자리표시 메쉬의 그래픽스 파이프라인은 작업 스레드에서 컴파일하며 아래의 초기화와 겹칩니다.
 
         createCommandPool();            // 2-10. 그래픽 카드로 보낼 명령 풀(커맨드 버퍼 모음) 생성 : 추후 command buffer allocation 에 사용할 예정
 
+        createGpuProfiler();            // 2-25. 구간별 GPU 시간 측정기 생성. 텍스쳐 밉맵 생성과 버퍼 복사도 측정하도록 리소스 업로드 전에 만듭니다.
+
+        createUploadContext();          // 2-27. 업로드 명령을 모아 한 번에 제출할 업로드 컨텍스트 생성. 텍스쳐와 버퍼 업로드보다 먼저 준비되어야 합니다.
+
         createColorResources();         // 2-11. 멀티샘플링된 컬러 버퍼 생성 : MSAA 를 위함
 
         createDepthResources();         // 2-12. 깊이 이미지 생성 (깊이 테스트를 위함)
 
         createFramebuffers();           // 2-13. 프레임 버퍼들을 생성. 깊이 이미지 뷰가 생성된 후에 호출되어야 합니다.
 
-        createTextureImage();           // 2-14. 이미지(텍스쳐) 파일 로드
-
-        createTextureImageView();       // 2-15. 셰이더가 텍스쳐에서 텍셀을 읽어들이는 방식인 이미지 뷰 생성
-
         createTextureSampler();         // 2-16. 텍스쳐를 샘플링 하기 위해 샘플러 객체를 생성합니다. (이 샘플러를 사용하여 셰이더의 텍스처에서 색상을 읽을 것입니다.)
 
-        loadModel();                    // 2-17. 테스트용 OBJ 파일의 버텍스를 로드합니다. (중복된 버텍스는 해시 함수를 이용해 버리고 인덱싱 하였습니다.)
+        createPlaceholderAssets();      // 2-28. 백그라운드 로드가 끝날 때까지 그릴 자리표시 텍스쳐와 메쉬 생성 (2-14 ~ 2-19 를 작은 데이터로 바로 실행합니다.)
 
-        createVertexBuffer();           // 2-18. 버텍스 버퍼 생성
+        waitGraphicsPipeline();         // 2-9. 자리표시 메쉬를 그릴 그래픽스 파이프라인의 컴파일이 끝나기를 기다립니다.
 
-        createIndexBuffer();            // 2-19. 인덱스 버퍼 생성
+        resourceUploadToken = submitUploads(); // 자리표시 텍스쳐 / 버텍스 / 인덱스 업로드를 한 번에 제출합니다. 배치 끝의 배리어가 이후 그리기와의 순서를 보장하므로 여기서 기다리지 않습니다.
 
         createUniformBuffers();         // 2-20. 유니폼 버퍼 생성
 
@@ -430,6 +897,9 @@ private:
         createCommandBuffers();         // 2-23. 그래픽 카드로 보낼 커맨드 버퍼 생성
 
         createSyncObjects();            // 2-24. CPU 와 GPU 흐름을 동기화 시키기 위한 개체 생성
+
+        // 리소스를 모두 만든 뒤의 메모리 블록 사용량과 단편화 정도를 출력합니다.
+        memoryAllocator.printStats(std::cout, "@ [INFO] : ");
     }
 
 
@@ -487,9 +957,13 @@ private:
         createInfo.pApplicationInfo = &appInfo;
 
         // Vulkan은 플랫폼에 구애받지 않는 API이므로 윈도우 시스템과 상호작용 하려면 확장이 필요합니다. GLFW에는 필요한 확장을 반환하는 편리한 내장 함수가 있습니다.
+        // 헤드리스 모드에서는 GLFW 를 초기화하지 않으며 윈도우 시스템 확장도 필요 없습니다.
         uint32_t glfwExtensionCount = 0;
-        const char** glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        const char** glfwExtensions = nullptr;
+        if (options.headless == false)
+        {
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        }
         std::cout << "Used extensions from GLFW:\n";
         for (int i = 0; i < glfwExtensionCount; i++)
         {
@@ -510,6 +984,20 @@ private:
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
         }
 
+        // 텍스쳐 스트리밍의 메모리 예산(VK_EXT_memory_budget)은 vkGetPhysicalDeviceMemoryProperties2 로 읽으므로 Vulkan 1.0 에서는 이 인스턴스 확장이 필요합니다. 없으면 예산 없이 힙 크기만 봅니다.
+        uint32_t availableExtensionCount = 0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &availableExtensionCount, nullptr);
+        std::vector<VkExtensionProperties> availableExtensions(availableExtensionCount);
+        vkEnumerateInstanceExtensionProperties(nullptr, &availableExtensionCount, availableExtensions.data());
+        for (const auto& extension : availableExtensions)
+        {
+            if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0)
+            {
+                extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+                physicalDeviceProperties2Supported = true;
+            }
+        }
+
         // 활성화할 전역 검증 레이어를 설정합니다. 검증 레이어는 Vulkan API를 가로채서 로깅, 프로파일링, 디버깅, 혹은 다른 추가적인 기능에 사용될 수 있습니다.
         createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
         createInfo.ppEnabledExtensionNames = extensions.data();
@@ -667,6 +1155,7 @@ private:
                 vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
                 // requiredExtensions 는 확인이 필요한 필요한 확장 기능 체크리스트 입니다. 그래픽카드가 지원하는 모든 확장 기능 리스트를 순회하면서 우리가 필요로 하는 확장 기능들을 전부 지원하는지 하나씩 지워나가며 확인할 것입니다.
+                const std::vector<const char*> deviceExtensions = getRequiredDeviceExtensions();
                 std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
                 for (const auto& extension : availableExtensions)
                 {
@@ -678,8 +1167,9 @@ private:
 
 
                 // 2-3-4. 해당 그래픽카드가 필요한 스왑 체인 기능들을 모두 지원하는지 확인해야 합니다.
-                bool swapChainAdequate = false;
-                if (extensionsSupported)
+                // 헤드리스 모드에서는 화면에 표시하지 않으므로 스왑 체인 지원 여부를 따지지 않습니다.
+                bool swapChainAdequate = options.headless;
+                if (extensionsSupported && options.headless == false)
                 {
                     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
                     // 현재로썬 윈도우 서피스에 하나 이상의 이미지 포멧과 하나 이상의 프레젠테이션 모드를 지원한다면 충분합니다.
@@ -770,7 +1260,15 @@ private:
             // 서피스에 이미지를 표시할 수 있는 큐 패밀리가 있는지 검사합니다. 보통은 그리기와 화면 표시가 동시에 지원되는 큐 페밀리가 있지만 (그런경우 i 값이 동일하게 저장될 것입니다), 각각 따로 존재할 수도 있습니다 (이런 경우 성능이 떨어집니다).
             VkBool32 presentSupport = false;
             // 특이하게 생성된 추상적 서피스 개체를 사용하고 프레젠테이션을 지원할 수 있는 그래픽스 큐를 검색 하려면 queueFamily.queueFlags 가 아닌vkGetPhysicalDeviceSurfaceSupportKHR 라고 따로 존재하는 함수를 사용해야 한다.
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            // 헤드리스 모드에는 서피스가 없으므로 그래픽 큐 패밀리를 프레젠테이션 큐 패밀리로도 사용합니다. (실제로 화면에 표시하지는 않습니다.)
+            if (options.headless)
+            {
+                presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) ? VK_TRUE : VK_FALSE;
+            }
+            else
+            {
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            }
             if (presentSupport)
             {
                 indices.presentFamily = i;
@@ -787,6 +1285,26 @@ private:
             i++;
         }
 
+        // 전송 전용 큐 패밀리를 찾습니다. 그래픽과 컴퓨트 기능이 모두 없는 패밀리(대개 DMA 엔진)를 가장 선호하고, 없으면 그래픽 기능만 없는 패밀리를 사용합니다.
+        // 텍스쳐는 항상 밉 레벨 전체를 복사하므로 이런 패밀리의 minImageTransferGranularity 가 (0, 0, 0) 이어도 문제가 없습니다.
+        for (uint32_t family = 0; family < queueFamilyCount; family++)
+        {
+            VkQueueFlags flags = queueFamilies[family].queueFlags;
+            if ((flags & VK_QUEUE_TRANSFER_BIT) == 0 || (flags & VK_QUEUE_GRAPHICS_BIT) != 0)
+            {
+                continue;
+            }
+            if ((flags & VK_QUEUE_COMPUTE_BIT) == 0)
+            {
+                indices.transferFamily = family;
+                break;
+            }
+            if (indices.transferFamily.has_value() == false)
+            {
+                indices.transferFamily = family;
+            }
+        }
+
         // 지원하는 큐 페밀리의 인덱스 번호들을 담고 있습니다.
         return indices;
     }
@@ -811,6 +1329,16 @@ private:
         return VK_SAMPLE_COUNT_1_BIT;
     }
 
+    // 그래픽카드가 반드시 지원해야 하는 장치 확장 목록을 반환하는 헬퍼함수. 헤드리스 모드에서는 스왑 체인 확장이 필요 없으므로 화면이 없는 서버용 장치나 소프트웨어 드라이버(lavapipe, SwiftShader)도 선택할 수 있습니다.
+    HELPER_FUNCTION std::vector<const char*> getRequiredDeviceExtensions() const
+    {
+        if (options.headless)
+        {
+            return {};
+        }
+        return deviceExtensions;
+    }
+
 
 
     // 2-4. 그래픽 카드와 통신하기 위한 인터페이스 생성
@@ -825,6 +1353,11 @@ private:
             indices.graphicsFamily.value(), 
             indices.presentFamily.value(), 
         };
+        // 전용 전송 큐 패밀리가 있으면 그 패밀리의 큐도 하나 요청합니다.
+        if (indices.transferFamily.has_value())
+        {
+            uniqueQueueFamilies.insert(indices.transferFamily.value());
+        }
 
         // 각각의 큐 패밀리를 위해 만든 queueCreateInfo 정보들을 벡터 리스트로 저장합니다.
         for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -849,6 +1382,12 @@ private:
         deviceFeatures.samplerAnisotropy = VK_TRUE;
         // 보다 상세한 장면에서 출력 이미지의 품질에 영향을 미칠 수 있는 MSAA 구현의 특정 제한 사항이 있습니다. 예를 들어, 우리는 현재 셰이더 앨리어싱으로 인해 발생할 수 있는 잠재적인 문제를 해결하고 있지 않습니다. 즉, MSAA는 내부 채우기는 제외하고 지오메트리의 가장자리만 부드럽게 합니다. 이로 인해 화면에 부드러운 다각형이 렌더링되지만 높은 대비 색상이 다각형 안쪽에 포함된 경우 적용된 텍스처가 여전히 앨리어스되어 보이는 상황이 발생할 수 있습니다. 이 문제에 접근하는 한 가지 방법은 샘플 셰이딩을 활성화하여 추가 성능 비용이 발생하더라도 이미지 품질을 더욱 향상시킬 수 있습니다.
         deviceFeatures.sampleRateShading = VK_TRUE; // enable sample shading feature for the device
+        // BC 압축 텍스쳐 형식도 선택적인 기능입니다. 지원하면 켜고, 지원하지 않으면 텍스쳐를 압축하지 않은 RGBA8 로 올립니다. (loadTexture)
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+        textureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
+        deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+        std::cout << "@ [INFO] : BC texture compression " << (textureCompressionBC ? "supported" : "not supported, textures are uploaded as RGBA8") << "\n";
 
         // 2-4-3. 이제 논리 장치를 만듭니다. 논리 장치를 만들때 위에서 미리 만들어둔 VkDeviceQueueCreateInfo, VkPhysicalDeviceFeatures 두개의 설정값들을 사용합니다.
         VkDeviceCreateInfo createInfo{};
@@ -862,6 +1401,26 @@ private:
         createInfo.pEnabledFeatures = &deviceFeatures;
 
         // 우리가 사용할 추가 확장 기능 리스트도 불칸에게 전달합니다.
+        std::vector<const char*> deviceExtensions = getRequiredDeviceExtensions();
+
+        // VK_EXT_memory_budget 은 선택적인 확장입니다. 지원하면 켜서 텍스쳐 스트리밍이 힙별 예산과 사용량을 보고 레벨을 내리게 합니다. (getTextureBudget)
+        bool memoryBudgetSupported = false;
+        if (physicalDeviceProperties2Supported)
+        {
+            uint32_t extensionCount = 0;
+            vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+            std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+            vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+            for (const auto& extension : availableExtensions)
+            {
+                memoryBudgetSupported = memoryBudgetSupported || strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+            }
+        }
+        if (memoryBudgetSupported)
+        {
+            deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+        std::cout << "@ [INFO] : Memory budget " << (memoryBudgetSupported ? "supported" : "not supported, texture streaming uses the heap size") << "\n";
         createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
         createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
@@ -883,10 +1442,18 @@ private:
             throw std::runtime_error("Failed to create logical device!");
         }
 
+        // 확장 함수는 로더가 직접 내보내지 않으므로 인스턴스에서 주소를 받아옵니다.
+        if (memoryBudgetSupported)
+        {
+            getPhysicalDeviceMemoryProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR"));
+        }
+
 
         // 2-4-5. 각각의 큐 페밀리에 해당하는 큐 핸들을 받아옵니다. 큐 패밀리가 동일한 경우 graphicsQueue 와 presentQueue 핸들은 동일한 값을 가질 가능성이 높습니다. 큐 패밀리가 동일한게 확실한 경우 해당 인덱스를 한 번만 전달해도 됩니다. vkGetDeviceQueue(추상적 디바이스, 큐 페밀리 인덱스, 큐 인덱스, 큐 핸들을 저장할 변수에 대한 포인터)
         vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
         vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+        // 전용 전송 큐가 없으면 전송도 그래픽 큐에서 합니다.
+        vkGetDeviceQueue(device, indices.transferFamily.value_or(indices.graphicsFamily.value()), 0, &transferQueue);
 
         // 이제 추상적 디바이스와 큐 핸들을 사용하여 실제로 그래픽 카드에 명령을 때려넣어 작업을 시작할 수 있습니다.
     }
@@ -1081,6 +1648,29 @@ private:
         }
     }
 
+    // 2-5. (헤드리스 모드) 스왑 체인 대신 오프스크린 렌더 타겟 이미지를 만듭니다.
+    inline void createOffscreenTargets()
+    {
+        // 스왑 체인이 없으므로 이미지 형식과 해상도를 직접 정합니다. 스왑 체인에서 선호하던 B8G8R8A8_SRGB 를 우선 시도하고, 소프트웨어 드라이버 등에서 지원하지 않으면 R8G8B8A8_SRGB 를 사용합니다.
+        swapChainImageFormat = findSupportedFormat(
+            { VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_SRGB },
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT
+        );
+        swapChainExtent = { options.width, options.height };
+
+        // 스왑 체인 이미지 대신 프레임 슬롯 수만큼 이미지를 만들어 swapChainImages 에 담아두면 이미지 뷰, 프레임 버퍼 생성 코드를 그대로 재사용할 수 있습니다. 헤드리스 모드에서는 currentFrame 이 곧 이미지 인덱스가 됩니다.
+        // 나중에 결과물을 읽어갈 수 있도록 VK_IMAGE_USAGE_TRANSFER_SRC_BIT 도 추가하였습니다.
+        swapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+        offscreenImagesMemory.resize(MAX_FRAMES_IN_FLIGHT);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            createImage(swapChainExtent.width, swapChainExtent.height, 1, VK_SAMPLE_COUNT_1_BIT, swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i], offscreenImagesMemory[i]);
+        }
+
+        std::cout << "@ [INFO] : Headless mode - offscreen targets " << swapChainExtent.width << "x" << swapChainExtent.height << " (format " << swapChainImageFormat << ")\n";
+    }
+
 
 
     // 2-6. 스왑 체인용 이미지 사용 방식을 정의하기 위한 이미지 뷰 생성
@@ -1197,6 +1787,11 @@ private:
         colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        // 헤드리스 모드에서는 화면에 표시하지 않으므로 결과를 복사해 갈 수 있는 레이아웃으로 끝냅니다. (VK_IMAGE_LAYOUT_PRESENT_SRC_KHR 은 스왑 체인 확장이 있어야만 사용할 수 있습니다.)
+        if (options.headless)
+        {
+            colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        }
         
 
         // 서브패스 및 어태치먼트 속성 설정
@@ -1276,54 +1871,87 @@ private:
     {
         // 버텍스 셰이더를 사용할때 각각의 버텍스 속성에 대해 해당하는 location 인덱스 ID 를 정의해야 했던 것처럼 파이프라인 생성을 위해서도 셰이더에 사용된 모든 디스크립터 바인딩에 대한 세부 정보를 제공해야 합니다. createDescriptorSetLayout이라는 이 모든 정보를 정의하는 새 함수를 설정합니다. 파이프라인 생성 직전에 이러한 것들이 준비되어야 합니다. 모든 바인딩은 VkDescriptorSetLayoutBinding 구조체를 통해 설명되어야 합니다.
         // 처음 두 필드는 binding 을 정의하는 것으로써, 셰이더에 사용될 유니폼 버퍼 객체와 디스크립터 유형을 지정합니다. 셰이더 변수는 유니폼 버퍼 객체의 배열을 나타낼 수 있으며 descriptorCount는 배열의 값 갯수를 지정합니다. 예를 들면, 이것은 스켈레톤 애니메이션을 위한 스켈레톤의 각 본에 대한 변환을 지정하는 데 사용할 수 있습니다. MVP 변환은 하나의 유니폼 버퍼 개체로 표현 가능하므로 descriptorCount 1개만 사용하고 있습니다.
-        VkDescriptorSetLayoutBinding uboLayoutBinding{};
-        uboLayoutBinding.binding = 0;
-        uboLayoutBinding.descriptorCount = 1;
-        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        // pImmutableSamplers 필드는 이미지 샘플링 관련 디스크립터에만 관련이 있으며 나중에 살펴보겠습니다. 기본값으로 그대로 둘 수 있습니다.
-        uboLayoutBinding.pImmutableSamplers = nullptr;
-        // 또한 디스크립터가 참조할 셰이더 스테이지를 지정해야 합니다. stageFlags 필드는 VkShaderStageFlagBits 값들의 조합 또는 VK_SHADER_STAGE_ALL_GRAPHICS 값이 될 수 있습니다. 우리는 현재 버텍스 셰이더의 디스크립터만 참조합니다.
-        uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        // 예전에는 유니폼 버퍼(바인딩 0, 버텍스 셰이더)와 결합된 이미지 샘플러(바인딩 1, 프래그먼트 셰이더)를 여기에 직접 적었습니다. 이제는 loadShaders 가 두 셰이더의 SPIR-V 에서 읽어 합쳐 둔 pipelineLayoutDesc 의 바인딩을 그대로 씁니다.
+        // 바인딩 번호, 디스크립터 유형, 개수, 스테이지가 셰이더와 항상 같고, 셰이더가 선언만 하고 쓰지 않는 바인딩은 빠집니다. 그리기마다 다른 UBO 를 링 버퍼의 다른 위치에서 읽도록 유니폼 버퍼는 동적 유니폼 버퍼 유형으로 만듭니다.
+        // vkCreateDescriptorSetLayout 은 레이아웃 캐시가 호출하며, 파이프라인 레이아웃(2-9)도 같은 셋 레이아웃 핸들을 다시 씁니다.
+        descriptorSetLayout = layoutCache.getSetLayout(pipelineLayoutDesc.sets[0]);
+    }
 
-        // 유니폼 버퍼 강의 부분에서 이미 디스크립터를 살펴본 적이 있습니다. 이 장에서는 새로운 유형의 디스크립터인 combined image sampler를 살펴보겠습니다. 이 디스크립터를 사용하면 셰이더가 이전 장에서 만든 샘플러 개체를 통해 이미지 리소스에 액세스할 수 있습니다. 이렇게 결합된 이미지 샘플러 디스크립터를 포함하도록 디스크립터 레이아웃, 디스크립터 풀 및 디스크립터 세트를 수정하는 것으로 시작하겠습니다. 그런 다음 정점에 텍스처 좌표를 추가하고 정점 색상을 보간하는 대신 텍스처에서 색상을 읽도록 프래그먼트 셰이더를 수정하겠습니다.
-        VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-        samplerLayoutBinding.binding = 1;
-        samplerLayoutBinding.descriptorCount = 1;
-        samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        samplerLayoutBinding.pImmutableSamplers = nullptr;
-        // 프래그먼트 셰이더에서 결합된 이미지 샘플러 디스크립터를 사용할 것임을 나타내도록 stageFlags를 설정해야 합니다. 그것이 프레그먼트(조각)의 색상이 결정되는 곳입니다. 정점 셰이더에서 텍스처 샘플링을 사용하는 것도 가능합니다. 예를 들어 하이트맵에 의해 버텍스 격자를 동적으로 변형하는 것입니다.
-        samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-        std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
-        VkDescriptorSetLayoutCreateInfo layoutInfo{};
-        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-        layoutInfo.pBindings = bindings.data();
 
-        // 그런 다음 vkCreateDescriptorSetLayout을 사용하여 생성할 수 있습니다. 이 함수는 바인딩 배열과 함께 간단한 VkDescriptorSetLayoutCreateInfo를 허용합니다.
-        if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+    // 2-9. 셰이더 로드와 리플렉션
+    // 셰이더 모듈을 만들고, SPIR-V 리플렉션으로 디스크립터 셋 레이아웃(2-8), 디스크립터 풀(2-21), 파이프라인 레이아웃과 버텍스 입력(getPipelineDesc)에 쓸 정보를 모읍니다.
+    inline void loadShaders()
+    {
+        // ------------- 이 아래로는 프로그래밍 가능한 셰이더 스테이지 (Shader stages) 에 대한 설정입니다. -------------
+        
+        // 2-9-1. GLSL 소스를 shaderc 로 컴파일해서 SPIR-V 바이트 배열을 얻습니다. 소스가 그대로면 디스크의 SPIR-V 캐시를 읽으므로 컴파일하지 않습니다. (ShaderLibrary.h)
+        // shaderc DLL 이 없으면 미리 컴파일한 ".spv" 를 읽고 핫 리로드도 하지 않습니다.
+        if (shaderLibrary.init() == false)
         {
-            throw std::runtime_error("Failed to create descriptor set layout!");
+            std::cout << "@ [WARNING] : " << SHADERC_DLL_NAME << " is not available, using the prebuilt .spv shaders without hot reload\n";
         }
-    }
+        vertShaderSource = ShaderSource{ VERTEX_SHADER_PATH, shaderc_vertex_shader, {} };
+        fragShaderSource = ShaderSource{ FRAGMENT_SHADER_PATH, shaderc_fragment_shader, {} };
+        CompiledShader vertShader = loadShader(vertShaderSource);
+        CompiledShader fragShader = loadShader(fragShaderSource);
 
+        // 2-9-2. 바이트 배열로 저장된 버퍼를 받아서 셰이더 모듈 (VkShaderModule) 를 만듭니다. 셰이더 모듈은 단순히 셰이더 바이트코드의 얇은 래퍼입니다.
+        // GPU에서 실행하기 위해 SPIR-V 바이트코드를 기계어 코드로 컴파일하고 링킹하는 작업은 그래픽 파이프라인이 생성될 때까진 발생하지 않습니다.
+        // 버텍스 형식이 다른 메쉬를 불러오면 같은 셰이더로 파이프라인 변형을 더 컴파일하므로, 셰이더 모듈은 파이프라인 레지스트리가 들고 있다가 종료할 때 지웁니다.
+        vertShaderModule = getShaderModule(vertShader.code);
+        fragShaderModule = getShaderModule(fragShader.code);
+
+        // 창 모드에서는 소스와 #include 한 파일이 바뀌면 다시 컴파일합니다. (updateShaderReload)
+        if (options.shaderReload && options.headless == false && shaderLibrary.isAvailable())
+        {
+            std::vector<std::string> dependencies = vertShader.dependencies;
+            dependencies.insert(dependencies.end(), fragShader.dependencies.begin(), fragShader.dependencies.end());
+            shaderWatcher.watch(dependencies);
+        }
 
+        // 셰이더가 쓰는 디스크립터 바인딩, 푸시 상수, 버텍스 입력을 읽습니다. (ShaderReflection.h)
+        layoutCache.init(device);
+        std::string error;
+        if (reflectShaders(vertShader.code, fragShader.code, pipelineLayoutDesc, vertexInputLocations, error) == false)
+        {
+            throw std::runtime_error("Failed to reflect shaders : " + error);
+        }
+        std::vector<VkVertexInputBindingDescription> bindings = Vertex::getFloatLayout().getBindingDescriptions();
+        std::vector<VkVertexInputAttributeDescription> attributes = Vertex::getFloatLayout().getAttributeDescriptions();
+        if (ShaderReflection::filterVertexInput(vertexInputLocations, bindings, attributes, error) == false)
+        {
+            throw std::runtime_error(error);
+        }
+        std::cout << "@ [INFO] : Shader reflection : " << pipelineLayoutDesc.sets[0].bindings.size() << " descriptor bindings, " << pipelineLayoutDesc.pushConstants.size() << " push constant ranges, "
+            << vertexInputLocations.size() << " vertex inputs\n";
+    }
 
-    // 2-9. 셰이더 로드 및 그래픽스 파이프라인 생성
+    // 2-9. 파이프라인 레이아웃 생성
+    // 파이프라인 레이아웃을 만들고, 자리표시 메쉬를 그릴 파이프라인의 컴파일을 파이프라인 레지스트리의 작업 스레드에 맡깁니다.
+    // 컴파일은 나머지 초기화와 겹쳐서 진행되고 첫 프레임 전에 waitGraphicsPipeline 에서 기다립니다. 파이프라인의 상태 설정은 compileGraphicsPipeline 에 있습니다.
     inline void createGraphicsPipeline()
     {
-        // ------------- 이 아래로는 프로그래밍 가능한 셰이더 스테이지 (Shader stages) 에 대한 설정입니다. -------------
-        
-        // 2-9-1. 바이너리 파일을 읽어서 바이트 배열로 반환합니다.
-        auto vertShaderCode = readFile("Shaders/hello_triangle_shader.vert.spv");
-        auto fragShaderCode = readFile("Shaders/hello_triangle_shader.frag.spv");
+        // ------------- 이 아래로는 런타임에 셰이더에서 참조하는 uniform 과 push values 값들에 대한 설정 (Pipeline layout) 입니다. -------------
+
+        // 2-9-14. 파이프라인 레이아웃을 설정합니다. (파이프라인 레이아웃은 스왑 체인이나 버텍스 형식에 묶여 있지 않으므로 한 번만 만들고 모든 파이프라인 변형이 함께 씁니다.)
+        // 셰이더에서 uniform 값을 사용할 수 있습니다. 이는 동적 상태 변수와 유사한 전역 변수로, 드로잉 시 변경할 수 있어 셰이더를 다시 생성하지 않고도 셰이더의 동작을 변경할 수 있습니다. 변환 행렬을 버텍스 셰이더에 전달하거나 프래그먼트 셰이더에서 텍스처 샘플러를 만드는 데 일반적으로 사용됩니다. 이러한 uniform 값은 VkPipelineLayout 객체를 생성하여 파이프라인 생성 중에 지정해야 합니다.다음 장까지 사용하지 않겠지만 여전히 빈 파이프라인 레이아웃을 만들어야 합니다. 이 구조는 또한 푸시 상수를 지정하는데, 이는 동적 값을 셰이더에 전달하는 또 다른 방법이며, 이는 향후 장에서 다룰 것입니다.
+        // 셰이더가 사용할 디스크립터를 Vulkan에 알리기 위해 파이프라인 생성 중에 디스크립터 세트 레이아웃을 지정해야 합니다. 디스크립터 세트 레이아웃은 파이프라인 레이아웃 개체에 함께 지정됩니다. 우리가 만든 디스크립터 세트 레이아웃 개체를 참조하도록 setLayoutCount 갯수와 pSetLayouts 를 수정합니다. 하나의 디스크립터 세트에 이미 모든 바인딩이 포함되어 있기 때문에 여기에서 여러개의 디스크립터 세트 레이아웃을 지정할 수 있는 이유에 대해 궁금할 것입니다. 다음 장에서 디스크립터 풀과 디스크립터 집합에 대해 다시 살펴보겠습니다.
+        // 셋 레이아웃과 푸시 상수 범위는 리플렉션한 pipelineLayoutDesc 를 따릅니다. 지금 셰이더는 셋 0 하나만 쓰고 푸시 상수는 없습니다.
 
-        // 2-9-2. 바이트 배열로 저장된 버퍼를 받아서 셰이더 모듈 (VkShaderModule) 를 만듭니다. 셰이더 모듈은 단순히 셰이더 바이트코드의 얇은 래퍼입니다.
-        // GPU에서 실행하기 위해 SPIR-V 바이트코드를 기계어 코드로 컴파일하고 링킹하는 작업은 그래픽 파이프라인이 생성될 때까진 발생하지 않습니다. 즉, 파이프라인 생성이 완료되는 즉시 셰이더 모듈을 파괴해도 상관없습니다. 따라서 클래스 멤버 대신 createGraphicsPipeline 함수 내 로컬 변수로 만들었습니다.
-        VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-        VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
 
+        // 2-9-15. 파이프라인 레이아웃을 생성합니다. 셋 0 의 레이아웃은 2-8 에서 만든 것을 레이아웃 캐시가 다시 씁니다.
+        pipelineLayout = layoutCache.getPipelineLayout(pipelineLayoutDesc);
 
+        // 자리표시 메쉬의 버텍스 형식으로 파이프라인 컴파일을 시작합니다.
+        const VertexLayout placeholderLayout = Vertex::getFloatLayout();
+        pipelineRequestTime = std::chrono::high_resolution_clock::now();
+        pipelineRegistry.request(getPipelineDesc(placeholderLayout), getPipelineLabel(placeholderLayout));
+    }
+
+    // 2-9. 그래픽스 파이프라인 하나를 컴파일합니다. 파이프라인 레지스트리의 작업 스레드에서 실행되므로 desc 와 한 번 만들고 바뀌지 않는 핸들(device, pipelineCache)만 읽습니다.
+    HELPER_FUNCTION VkPipeline compileGraphicsPipeline(const GraphicsPipelineDesc& desc)
+    {
         // 2-9-3. 셰이더 스테이지를 설정합니다. 셰이더를 사용하기 위해서는 특정한 파이프라인 스테이지에 배치하여야 합니다.
         // 버텍스 셰이더 스테이지를 정의합니다.
         VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
@@ -1331,7 +1959,7 @@ private:
         // 이 셰이더를 어떤 파이프라인 스테이지에서 사용할지 enum 값으로 알려줍니다.
         vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
         // 해당하는 셰이더 모듈의 핸들을 할당합니다.
-        vertShaderStageInfo.module = vertShaderModule;
+        vertShaderStageInfo.module = desc.vertexShader;
         // 진입점 (엔트리포인트 함수) 를 설정합니다. 여러 프레그먼트 셰이더들을 단일 셰이더 모듈로 결합하고 서로 다른 진입점을 사용하여 동작을 구분할 수도 있습니다.
         vertShaderStageInfo.pName = "main";
         // vertShaderStageInfo.pSpecializationInfo 는 사용되지 않았지만 중요합니다. 셰이더에 쓰일 상수 (constants) 에 대한 값을 지정할 수 있습니다. 셰이더를 런타임에 교환하는 것보다 상수값을 이용해 코드의 흐름을 변경시키는 것이 효과적일 때가 많습니다. 컴파일러는 이러한 상수값에 따라 if 문을 제거하는 것과 같은 최적화를 수행할 수 있기 때문입니다. 이와 같은 상수가 없으면 구조체 초기화가 자동으로 수행하는 nullptr로 멤버를 설정할 수 있습니다.
@@ -1341,7 +1969,7 @@ private:
         VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
         fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        fragShaderStageInfo.module = fragShaderModule;
+        fragShaderStageInfo.module = desc.fragmentShader;
         fragShaderStageInfo.pName = "main";
         fragShaderStageInfo.pSpecializationInfo = nullptr;
 
@@ -1360,12 +1988,11 @@ private:
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
         // 우리가 직접 구성한 버텍스 데이터를 허용하도록 그래픽 파이프라인을 설정해야 합니다. 위에서 미리 만들어둔 Vertex::getBindingDescription() 와 Vertex::getAttributeDescriptions() 를 사용해서 설정값을 채웁니다.
-        auto bindingDescription = Vertex::getBindingDescription();
-        auto attributeDescriptions = Vertex::getAttributeDescriptions();
-        vertexInputInfo.vertexBindingDescriptionCount = 1;
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+        // 이제 버텍스 형식은 그리는 메쉬의 형식(VertexLayout)을 따르고 파이프라인 키(desc)에 들어 있습니다. 압축하지 않은 메쉬와 자리표시 메쉬는 Vertex::getFloatLayout() 으로 위의 설명과 같은 값을 갖습니다. 백그라운드 로드한 메쉬의 형식이 다르면 그 형식의 파이프라인 변형을 따로 컴파일합니다. (updateAssets)
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(desc.bindings.size());
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(desc.attributes.size());
+        vertexInputInfo.pVertexBindingDescriptions = desc.bindings.data();
+        vertexInputInfo.pVertexAttributeDescriptions = desc.attributes.data();
         // 파이프라인은 이제 설정한 버텍스 컨테이너 형식의 버텍스 데이터를 받아 버텍스 셰이더에 전달할 준비가 되었습니다. 유효성 검사 레이어가 활성화된 상태에서 프로그램을 실행하면 바인딩된 버텍스 버퍼가 없다고 불평하는 것을 볼 수 있습니다. @@ 다음 단계는 버텍스 버퍼를 만들고 버텍스 데이터를 GPU가 액세스할 수 있도록 버텍스 버퍼로 이동하는 것입니다.
 
 
@@ -1379,39 +2006,31 @@ private:
         // @@ 일단 현재는 듀토리얼을 위해 버텍스로 삼각형 (TRIANGLE_LIST) 을 그립니다.
         VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
         inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        inputAssembly.topology = desc.topology;
         inputAssembly.primitiveRestartEnable = VK_FALSE;
 
 
         // 2-9-6. 뷰포트 영역을 설정합니다.
         // 뷰포트는 기본적으로 출력이 렌더링될 프레임 버퍼의 영역을 설명합니다. 이것은 거의 항상 (0, 0) ~ (너비, 높이) 입니다.
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        // 스왑 체인 이미지들이 나중에 프레임 버퍼로 사용될 것입니다.
-        viewport.width = (float)swapChainExtent.width;
-        viewport.height = (float)swapChainExtent.height;
-        // 프레임 버퍼에서 사용할 깊이 값 범위를 설정합니다. 반드시 0 ~ 1 범위 내에서만 설정해야 합니다.
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
+        // 뷰포트는 스왑 체인 크기를 따르므로 파이프라인에 굽지 않고 동적 스테이트(2-9-13)로 두어, 명령 버퍼를 기록할 때(recordCommandBuffer) 정합니다.
+        // 그래서 창 크기가 바뀌어도 그래픽스 파이프라인을 다시 만들 필요가 없습니다.
 
 
         // 2-9-7. 시저 영역을 설정합니다.
         // 뷰포트는 이미지에서 프레임 버퍼로의 변환을 정의하는 반면 시저 직사각형은 픽셀이 실제로 저장될 영역을 정의합니다. 시저 직사각형 외부의 모든 픽셀은 래스터라이저에 의해 연산되지 않고 무시됩니다. 변환이 아니라 필터처럼 작동하므로 성능 향상을 볼 수 있습니다. 차이점은 이 이미지를 참고해주세요 - https://vulkan-tutorial.com/images/viewports_scissors.png
         // @@ 일단 지금은 화면 전부를 보여주기 위해 프레임 버퍼 크기만큼 덮는 시저로 설정합니다.
-        VkRect2D scissor{};
-        scissor.offset = { 0, 0 };
-        scissor.extent = swapChainExtent;
+        // 시저도 뷰포트와 같이 동적 스테이트로 두고 명령 버퍼를 기록할 때 스왑 체인 크기로 정합니다.
 
 
         // 2-9-8. 뷰포트와 시저 영역 설정들을 결합합니다.
         // 뷰포트와 시저 영역 설정은 VkPipelineViewportStateCreateInfo 구조체를 사용하여 뷰포트 스테이트로 결합되어야 합니다. 일부 그래픽 카드에서는 여러 뷰포트와 가위형 직사각형을 사용할 수 있으므로 해당 멤버는 해당 그래픽 카드의 배열을 참조합니다. 여러 개를 사용하려면 GPU 기능을 활성화해야 합니다 (추상적 장치 생성 참조).
         VkPipelineViewportStateCreateInfo viewportState{};
         viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        // 동적 스테이트로 둔 뷰포트와 시저는 개수만 정하고 값(pViewports, pScissors)은 넘기지 않습니다.
         viewportState.viewportCount = 1;
-        viewportState.pViewports = &viewport;
+        viewportState.pViewports = nullptr;
         viewportState.scissorCount = 1;
-        viewportState.pScissors = &scissor;
+        viewportState.pScissors = nullptr;
 
 
         // 2-9-9. 레스터라이저를 설정합니다.
@@ -1427,13 +2046,13 @@ private:
         // VK_POLYGON_MODE_LINE : 와이어프레임 모드
         // VK_POLYGON_MODE_POINT : 점들만 표히사는 모드
         // 채우기 이외의 모드를 사용하려면 GPU 기능을 활성화해야 합니다.
-        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+        rasterizer.polygonMode = desc.polygonMode;
         // 레스터화에 사용할 선분의 굵기를 설정합니다. 지원되는 최대 라인 너비는 그래픽 카드에 따라 다르며 1.0f 보다 두꺼운 라인은 wideLines GPU 기능을 활성화해야 합니다.
         rasterizer.lineWidth = 1.0f;
         // 표면 컬링 유형을 결정합니다. 컬링을 비활성화하거나, 앞면을 컬링하거나, 뒷면을 컬링하거나, 둘 모두를 컬링할 수 있습니다. frontFace 변수는 정면으로 간주되는 면의 버텍스 순서를 지정하며 시계 방향 (왼손 중심) 또는 시계 반대 방향 (오른손 중심) 일 수 있습니다.
-        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+        rasterizer.cullMode = desc.cullMode;
         // 지금 프로그램을 실행하면 불행히도 아무 것도 보이지 않는다는 것을 알게 될 것입니다. 문제는 투영 행렬에서 Y 플립을 수행했기 때문에 (GLM 사용을 위해) 정점이 이제 시계 방향 대신 시계 반대 방향으로 그려지고 있다는 것입니다.이로 인해 후면 컬링이 시작되고 형상이 그려지지 않습니다. createGraphicsPipeline 함수로 이동하고 VkPipelineRasterizationStateCreateInfo 에서 frontFace를 수정하여 다음을 수정합니다.
-        rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE; 
+        rasterizer.frontFace = desc.frontFace;
         // 바이어스 값을 사용하여 (상수를 더해) 깊이 값을 계산합니다. 이것은 때때로 그림자 매핑에 사용되지만 우리는 사용하지 않을 것입니다. depthBiasEnable을 VK_FALSE로 설정하기만 하면 됩니다.
         rasterizer.depthBiasEnable = VK_FALSE;
         rasterizer.depthBiasConstantFactor = 0.0f; // Optional
@@ -1445,9 +2064,9 @@ private:
         // VkPipelineMultisampleStateCreateInfo 구조체는 안티앨리어싱을 수행하는 방법 중 하나인 멀티샘플링을 구성합니다. 동일한 픽셀에서 여러 다각형의 프레그먼트 셰이더 결과를 결합하여 작동합니다. 이것은 주로 가장 눈에 띄는 앨리어싱 아티팩트가 발생하는 가장자리 계단 현상을 해결합니다. 하나의 폴리곤만 픽셀에 매핑되는 경우 프래그먼트 셰이더를 여러 번 실행할 필요가 없기 때문에 단순히 더 높은 해상도로 렌더링한 다음 축소하는 것보다 훨씬 저렴합니다. 활성화하려면 GPU 기능을 활성화해야 합니다. 지금은 비활성화 상태로 둡니다.
         VkPipelineMultisampleStateCreateInfo multisampling{};
         multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisampling.sampleShadingEnable = VK_TRUE; // 샘플 셰이딩을 활성화합니다 - https://vulkan-tutorial.com/Multisampling | enable sample shading in the pipeline
-        multisampling.rasterizationSamples = msaaSamples; // 마지막으로 createGraphicsPipeline을 수정하여 새로 생성된 파이프라인에 두 개 이상의 샘플을 사용하도록 지시합니다. 밉매핑과 마찬가지로 차이점이 바로 나타나지 않을 수 있습니다. 자세히 보면 가장자리가 더 이상 들쭉날쭉하지 않고 전체 이미지가 원본에 비해 약간 더 매끄럽게 보입니다.
-        multisampling.minSampleShading = 1.0f; // Optional
+        multisampling.sampleShadingEnable = desc.sampleShadingEnable; // 샘플 셰이딩을 활성화합니다 - https://vulkan-tutorial.com/Multisampling | enable sample shading in the pipeline
+        multisampling.rasterizationSamples = desc.rasterizationSamples; // 마지막으로 createGraphicsPipeline을 수정하여 새로 생성된 파이프라인에 두 개 이상의 샘플을 사용하도록 지시합니다. 밉매핑과 마찬가지로 차이점이 바로 나타나지 않을 수 있습니다. 자세히 보면 가장자리가 더 이상 들쭉날쭉하지 않고 전체 이미지가 원본에 비해 약간 더 매끄럽게 보입니다.
+        multisampling.minSampleShading = desc.minSampleShading; // Optional
         multisampling.pSampleMask = nullptr; // Optional
         multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
         multisampling.alphaToOneEnable = VK_FALSE; // Optional
@@ -1459,11 +2078,11 @@ private:
         VkPipelineDepthStencilStateCreateInfo depthStencil{};
         depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
         // depthTestEnable 필드는 새 조각의 깊이를 깊이 버퍼와 비교하여 폐기해야 하는지 여부를 지정합니다.
-        depthStencil.depthTestEnable = VK_TRUE;
+        depthStencil.depthTestEnable = desc.depthTestEnable;
         // depthWriteEnable 필드는 깊이 테스트를 통과한 조각의 새 깊이값이 실제로 깊이 버퍼에 기록되어야 하는지 여부를 지정합니다.
-        depthStencil.depthWriteEnable = VK_TRUE;
+        depthStencil.depthWriteEnable = desc.depthWriteEnable;
         // depthCompareOp 필드는 조각을 유지하거나 폐기하기 위해 수행되는 비교를 지정합니다. 우리는 더 낮은 깊이 = 더 가깝다는 규칙을 고수하고 있으므로 새 조각의 깊이는 더 작아야 통과시키는 조건을 사용합니다.
-        depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+        depthStencil.depthCompareOp = desc.depthCompareOp;
         // depthBoundsTestEnable, minDepthBounds 및 maxDepthBounds 필드는 선택적 깊이 경계 테스트에 사용됩니다. 기본적으로 이렇게 하면 지정된 깊이 범위에 속하는 조각만 유지할 수 있습니다. 우리는 이 기능을 사용하지 않을 것입니다.
         depthStencil.depthBoundsTestEnable = VK_FALSE;
         depthStencil.minDepthBounds = 0.0f; // Optional
@@ -1480,16 +2099,8 @@ private:
         // 2) 비트 연산을 사용하여 이전 값과 새 값 결합 (logicOpEnable을 VK_TRUE로 설정해야 합니다.)
         // 색상 혼합을 설정하는 두 가지 유형의 구조체가 있습니다. VkPipelineColorBlendAttachmentState 는 프레임버퍼당 설정이고 두 번째 VkPipelineColorBlendStateCreateInfo 는 전역적인 색상 혼합 설정이 들어있습니다. 우리의 경우에는 하나의 프레임 버퍼만 있습니다.
         // 색상 혼합을 사용하는 가장 일반적인 방법은 불투명도에 따라 새 색상을 이전 색상과 혼합하려는 알파 블랜딩을 구현하는 것입니다. 컬러 블랜딩에 아래 설정들이 어떻게 활용되는지는 다음 사이트의 의사 코드를 참고해 주세요. - https://vulkan-tutorial.com/Drawing_a_triangle/Graphics_pipeline_basics/Fixed_functions 
-        VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        // 색상 블랜딩을 하지 않고 최신 색상만 표시합니다.
-        colorBlendAttachment.blendEnable = VK_FALSE;
-        colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
-        colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-        colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD; // Optional
-        colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
-        colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-        colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD; // Optional
+        // 블렌딩 설정은 파이프라인 키(desc.blend)에 있습니다. 기본값은 색상 블랜딩을 하지 않고 최신 색상만 표시합니다.
+        const VkPipelineColorBlendAttachmentState colorBlendAttachment = desc.blend;
 
         // 두 번째 구조는 모든 프레임 버퍼에 대한 구조 배열을 참조하며 앞서 언급한 계산에서 혼합 계수로 사용할 수 있는 혼합 상수를 설정할 수 있습니다.
         // 두 번째 혼합 방법(비트 조합)을 사용하려면 logicOpEnable을 VK_TRUE로 설정해야 합니다. 그런 다음 비트 연산을 logicOp 필드에 지정할 수 있습니다. 첫 번째 혼합 방법을 위해 blendEnable을 VK_FALSE로 설정한 것처럼 이렇게 하면 연결된 모든 프레임 버퍼에 대해 자동으로 비활성화됩니다. colorWriteMask는 또한 이 모드에서 실제로 영향을 받을 프레임 버퍼의 채널을 결정하는 데 사용됩니다. 여기에서 했던 것처럼 두 모드를 모두 비활성화할 수도 있습니다. 이 경우 프레그먼트 색상이 블랜딩 되지 않은 상태로 프레임 버퍼에 바로 기록됩니다.
@@ -1507,34 +2118,15 @@ private:
 
         // 2-9-13. 동적 스테이트를 설정합니다.
         // 위에서 우리가 만들었던 설정값들은 사실 파이프라인을 완전히 새로 만들지 않고도 변경할 수 있습니다. 뷰포트의 크기, 선 너비 및 블렌드 상수가 그 예입니다. 그렇게 하려면 다음과 같이 VkPipelineDynamicStateCreateInfo 구조를 채워야 합니다. 이렇게 하면 이러한 값의 구성이 무시되고 드로잉 시(런타임) 에 데이터를 지정해야 합니다. 이에 대해서는 다음 장에서 다시 다루겠습니다. 이 구조체는 나중에 동적 상태가 없는 경우 nullptr로 대체될 수 있습니다.
-        //std::vector<VkDynamicState> dynamicStates = {
-        //    VK_DYNAMIC_STATE_VIEWPORT,
-        //    VK_DYNAMIC_STATE_LINE_WIDTH
-        //};
-        //VkPipelineDynamicStateCreateInfo dynamicState{};
-        //dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-        //dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-        //dynamicState.pDynamicStates = dynamicStates.data();
-
-
-        // ------------- 이 아래로는 런타임에 셰이더에서 참조하는 uniform 과 push values 값들에 대한 설정 (Pipeline layout) 입니다. -------------
-
-        // 2-9-14. 파이프라인 레이아웃을 설정합니다. (파이프라인 레이아웃은 사실 스왑 체인에 묶여서 생성되고 파괴되지 않아도 되는 별개의 존재라고 합니다.. 유연한 셰이더 스위칭을 위해 셰이더 모듈과 함께 나중에 별도의 파일로 분리하는게 좋을 것 같습니다.)
-        // 셰이더에서 uniform 값을 사용할 수 있습니다. 이는 동적 상태 변수와 유사한 전역 변수로, 드로잉 시 변경할 수 있어 셰이더를 다시 생성하지 않고도 셰이더의 동작을 변경할 수 있습니다. 변환 행렬을 버텍스 셰이더에 전달하거나 프래그먼트 셰이더에서 텍스처 샘플러를 만드는 데 일반적으로 사용됩니다. 이러한 uniform 값은 VkPipelineLayout 객체를 생성하여 파이프라인 생성 중에 지정해야 합니다.다음 장까지 사용하지 않겠지만 여전히 빈 파이프라인 레이아웃을 만들어야 합니다. 이 구조는 또한 푸시 상수를 지정하는데, 이는 동적 값을 셰이더에 전달하는 또 다른 방법이며, 이는 향후 장에서 다룰 것입니다.
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        // 셰이더가 사용할 디스크립터를 Vulkan에 알리기 위해 파이프라인 생성 중에 디스크립터 세트 레이아웃을 지정해야 합니다. 디스크립터 세트 레이아웃은 파이프라인 레이아웃 개체에 함께 지정됩니다. 우리가 만든 디스크립터 세트 레이아웃 개체를 참조하도록 setLayoutCount 갯수와 pSetLayouts 를 수정합니다. 하나의 디스크립터 세트에 이미 모든 바인딩이 포함되어 있기 때문에 여기에서 여러개의 디스크립터 세트 레이아웃을 지정할 수 있는 이유에 대해 궁금할 것입니다. 다음 장에서 디스크립터 풀과 디스크립터 집합에 대해 다시 살펴보겠습니다.
-        pipelineLayoutInfo.setLayoutCount = 1; // 디스크립터 세트 레이아웃 1개 들어가므로
-        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout; // 디스크립터 세트 레이아웃
-        pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-        pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
-
-
-        // 2-9-15. 파이프라인 레이아웃을 생성합니다.
-        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to create pipeline layout!");
-        }
+        // 뷰포트와 시저를 동적 스테이트로 두어 창 크기가 바뀌어도 이 파이프라인을 그대로 씁니다. 값은 recordCommandBuffer 에서 vkCmdSetViewport / vkCmdSetScissor 로 정합니다.
+        std::array<VkDynamicState, 2> dynamicStates = {
+            VK_DYNAMIC_STATE_VIEWPORT,
+            VK_DYNAMIC_STATE_SCISSOR
+        };
+        VkPipelineDynamicStateCreateInfo dynamicState{};
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+        dynamicState.pDynamicStates = dynamicStates.data();
 
 
         // ------------- 이 아래로는 파이프라인 스테이지에서 참조하는 어태치먼트 및 어태치먼트 사용방식 설정 (Render pass) 입니다. -------------
@@ -1554,12 +2146,12 @@ private:
         // 방금 채운 깊이 스텐실 상태를 참조하도록 VkGraphicsPipelineCreateInfo 구조체를 업데이트합니다. 렌더 패스에 깊이 스텐실 어태치먼트가 포함된 경우 깊이 스텐실 상태를 항상 설정해야 합니다.
         pipelineInfo.pDepthStencilState = &depthStencil; // Optional
         pipelineInfo.pColorBlendState = &colorBlending;
-        pipelineInfo.pDynamicState = nullptr; // Optional
+        pipelineInfo.pDynamicState = &dynamicState;
         // 파이프라인 레이아웃과 렌더패스는 특이하게 구조체 포인터가 아닌 핸들을 집어넣습니다.
-        pipelineInfo.layout = pipelineLayout;
-        pipelineInfo.renderPass = renderPass;
+        pipelineInfo.layout = desc.layout;
+        pipelineInfo.renderPass = desc.renderPass;
         // 이 그래픽 파이프라인이 사용할 서브 패스의 인덱스
-        pipelineInfo.subpass = 0;
+        pipelineInfo.subpass = desc.subpass;
         // Vulkan을 사용하면 기존 파이프라인에서 파생하여 새 그래픽 파이프라인을 만들 수 있습니다. 기존 파이프라인과 많은 기능을 공유하는 경우나 동일한 상위 파이프라인을 가지고 있는 경우 파이프라인 간의 전환을 통해 설정하는 과정에 들어가는 비용을 줄일 수 있습니다. basePipelineHandle을 사용하여 기존 파이프라인의 핸들을 지정하거나 basePipelineIndex를 사용하여 인덱스에 의해 생성될 다른 파이프라인을 참조할 수 있습니다.
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
         pipelineInfo.basePipelineIndex = -1; // Optional
@@ -1567,37 +2159,138 @@ private:
 
         // 마침내 그래픽스 파이프라인을 생성합니다.
         // 두 번째 매개변수로 전달한 VK_NULL_HANDLE 인수는 사실 VkPipelineCache 개체를 참조할 수 있습니다. 파이프라인 캐시는 vkCreateGraphicsPipelines에 대한 여러 호출과 캐시가 파일에 저장된 경우 프로그램 실행 전반에 걸쳐 파이프라인 생성과 관련된 데이터를 저장하고 재사용하는 데 사용할 수 있습니다. 이를 통해 나중에 파이프라인 생성 속도를 크게 높일 수 있습니다. 파이프라인 캐시 장에서 이에 대해 알아보겠습니다.
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+        // 디스크에서 불러온 파이프라인 캐시(pipelineCache)에 같은 파이프라인이 있으면 컴파일을 건너뜁니다. 캐시를 끄면 VK_NULL_HANDLE 입니다. 여러 작업 스레드가 같은 캐시를 넘겨도 드라이버가 동기화합니다.
+        VkPipeline pipeline;
+        if (vkCreateGraphicsPipelines(device, pipelineCache.get(), 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
         {
             throw std::runtime_error("Failed to create graphics pipeline!");
         }
 
-        
-        // vkCreateGraphicsPipelines 을 부르고 그래픽스 파이프라인이 최종적으로 생성되면, 다 쓴 셰이더 모듈은 소멸시킬 수 있습니다.
-        vkDestroyShaderModule(device, fragShaderModule, nullptr);
-        vkDestroyShaderModule(device, vertShaderModule, nullptr);
+        // 셰이더 모듈은 다른 파이프라인 변형도 쓰므로 여기서 지우지 않습니다. (파이프라인 레지스트리가 종료할 때 지웁니다.)
+        return pipeline;
     }
 
-    // 바이너리 파일을 읽어서 바이트 배열로 반환합니다.
-    // @@ 나중에 C 스타일로 바꿔서 성능 향상 가능할 듯..
-    HELPER_FUNCTION static std::vector<char> readFile(const std::string& filename)
+    // 2-9. 메쉬의 버텍스 형식으로 그릴 파이프라인의 키. 버텍스 입력 말고는 모든 메쉬가 같은 상태를 씁니다.
+    HELPER_FUNCTION GraphicsPipelineDesc getPipelineDesc(const VertexLayout& layout) const
     {
-        // 지정된 파일에서 모든 바이트를 읽고 바이트 배열 (std::vector) 로 저장하여 반환합니다.
-        // 두 개의 플래그 설정이 필요합니다.
-        // ate: 파일의 끝에서부터 읽기 시작 (끝에서부터 읽는 이유는 파일의 사이즈를 바로 알 수 있기 때문입니다.)
-        // binary: 파일을 바이너리 형식으로 읽기 (텍스트 변형 방지, 이진 코드이기 때문에 %%EOF 로 끝나지 않음)
-        std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-        // 파일 열기를 시도합니다.
-        if (!file.is_open())
+        GraphicsPipelineDesc desc;
+        desc.vertexShader = vertShaderModule;
+        desc.fragmentShader = fragShaderModule;
+        desc.bindings = layout.getBindingDescriptions();
+        desc.attributes = layout.getAttributeDescriptions();
+        // 버텍스 셰이더가 읽지 않는 속성과 바인딩은 빼서, 셰이더가 쓰지 않는 데이터를 버텍스 입력 단계가 읽지 않게 합니다.
+        std::string error;
+        if (ShaderReflection::filterVertexInput(vertexInputLocations, desc.bindings, desc.attributes, error) == false)
         {
-            throw std::runtime_error("Failed to open file!");
+            throw std::runtime_error(error);
         }
+        desc.rasterizationSamples = msaaSamples;
+        desc.sampleShadingEnable = VK_TRUE;
+        desc.minSampleShading = 1.0f;
+        desc.layout = pipelineLayout;
+        desc.renderPass = renderPass;
+        return desc;
+    }
 
-        // ate 속성으로 파일을 열었기 때문에 파일의 끝 위치가 즉 파일 사이즈가 됩니다.
-        size_t fileSize = (size_t)file.tellg();
-        // 파일 사이즈만큼 버퍼를 준비합니다.
-        std::vector<char> buffer(fileSize);
+    HELPER_FUNCTION static std::string getPipelineLabel(const VertexLayout& layout)
+    {
+        return "Vertex stride " + std::to_string(layout.stride) + (layout.hasConstantColor() ? " (constant color)" : "");
+    }
+
+    // 두 셰이더의 리플렉션 결과를 파이프라인 레이아웃 하나로 합칩니다. 엔진이 바인딩할 수 있는 디스크립터만 쓰는지도 확인합니다.
+    // 엔진은 셋 0 하나만 바인딩하며, 동적 유니폼 버퍼에는 오브젝트 UBO 를, 결합된 이미지 샘플러에는 메쉬 텍스쳐를 연결합니다. (createDescriptorSets)
+    // 셋 0 이 비어 있으면 디스크립터 풀을 만들 수 없으므로(poolSizeCount 는 0 일 수 없습니다) 받지 않습니다.
+    HELPER_FUNCTION static bool reflectShaders(const std::vector<char>& vertCode, const std::vector<char>& fragCode, PipelineLayoutDesc& layoutDesc, std::vector<uint32_t>& inputLocations, std::string& error)
+    {
+        std::vector<ShaderStageLayout> stages(2);
+        if (ShaderReflection::reflect(vertCode, stages[0], error) == false || ShaderReflection::reflect(fragCode, stages[1], error) == false
+            || ShaderReflection::merge(stages, true, layoutDesc, error) == false)
+        {
+            return false;
+        }
+        layoutDesc.sets.resize(std::max<size_t>(1, layoutDesc.sets.size()));
+        if (layoutDesc.sets.size() > 1)
+        {
+            error = "Shaders use descriptor sets other than set 0";
+            return false;
+        }
+        if (layoutDesc.sets[0].bindings.empty())
+        {
+            error = "Shaders use no descriptors in set 0";
+            return false;
+        }
+        for (const VkDescriptorSetLayoutBinding& binding : layoutDesc.sets[0].bindings)
+        {
+            // 같은 유형의 바인딩이 둘이면 findBinding 이 앞의 것을 찾으므로 뒤의 것은 연결할 리소스가 없습니다.
+            if ((binding.descriptorType != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC && binding.descriptorType != VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                || binding.descriptorCount != 1 || layoutDesc.findBinding(0, binding.descriptorType) != &binding)
+            {
+                error = "No resource to bind to descriptor binding " + std::to_string(binding.binding);
+                return false;
+            }
+        }
+        inputLocations = stages[0].inputLocations;
+        return true;
+    }
+
+    // 2-9. 자리표시 메쉬의 파이프라인이 작업 스레드에서 컴파일을 마칠 때까지 기다립니다. 나머지 초기화와 겹쳐서 컴파일되었으므로 보통은 거의 기다리지 않습니다.
+    inline void waitGraphicsPipeline()
+    {
+        auto waitStart = std::chrono::high_resolution_clock::now();
+        graphicsPipeline = pipelineRegistry.wait(getPipelineDesc(mesh.layout), getPipelineLabel(mesh.layout));
+        auto readyTime = std::chrono::high_resolution_clock::now();
+        std::cout << "@ [INFO] : Graphics pipeline ready " << std::chrono::duration<double, std::milli>(readyTime - pipelineRequestTime).count() << " ms after request, waited "
+            << std::chrono::duration<double, std::milli>(readyTime - waitStart).count() << " ms at startup (pipeline cache " << toString(pipelineCache.getStatus()) << ")\n";
+    }
+
+    // 시작할 때 셰이더를 컴파일합니다. GLSL 소스를 컴파일할 수 없으면 미리 컴파일해 둔 ".spv" 파일(Compile Shaders.bat)을 대신 읽습니다.
+    HELPER_FUNCTION CompiledShader loadShader(const ShaderSource& source)
+    {
+        auto compileStart = std::chrono::high_resolution_clock::now();
+        CompiledShader shader;
+        if (shaderLibrary.compile(source, shader))
+        {
+            double compileMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - compileStart).count();
+            std::cout << "@ [INFO] : Shader " << source.path << (shader.cacheHit ? " loaded from the SPIR-V cache in " : " compiled in ") << compileMs << " ms\n";
+            return shader;
+        }
+        std::cout << "@ [WARNING] : Failed to compile " << source.path << ", using the prebuilt " << source.path << ".spv\n" << shader.error << "\n";
+        shader.code = readFile(source.path + ".spv");
+        return shader;
+    }
+
+    // 내용이 같은 셰이더는 파이프라인 레지스트리에 있는 모듈을 다시 씁니다. 모듈 핸들이 파이프라인 키에 들어가므로 같은 셰이더로 만든 파이프라인은 같은 키가 됩니다.
+    HELPER_FUNCTION VkShaderModule getShaderModule(const std::vector<char>& code)
+    {
+        const uint64_t hash = hashBytes(code.data(), code.size());
+        VkShaderModule module = pipelineRegistry.findShader(hash);
+        if (module == VK_NULL_HANDLE)
+        {
+            module = pipelineRegistry.addShader(hash, createShaderModule(code));
+        }
+        return module;
+    }
+
+    // 바이너리 파일을 읽어서 바이트 배열로 반환합니다.
+    // @@ 나중에 C 스타일로 바꿔서 성능 향상 가능할 듯..
+    HELPER_FUNCTION static std::vector<char> readFile(const std::string& filename)
+    {
+        // 지정된 파일에서 모든 바이트를 읽고 바이트 배열 (std::vector) 로 저장하여 반환합니다.
+        // 두 개의 플래그 설정이 필요합니다.
+        // ate: 파일의 끝에서부터 읽기 시작 (끝에서부터 읽는 이유는 파일의 사이즈를 바로 알 수 있기 때문입니다.)
+        // binary: 파일을 바이너리 형식으로 읽기 (텍스트 변형 방지, 이진 코드이기 때문에 %%EOF 로 끝나지 않음)
+        std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+        // 파일 열기를 시도합니다.
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open file!");
+        }
+
+        // ate 속성으로 파일을 열었기 때문에 파일의 끝 위치가 즉 파일 사이즈가 됩니다.
+        size_t fileSize = (size_t)file.tellg();
+        // 파일 사이즈만큼 버퍼를 준비합니다.
+        std::vector<char> buffer(fileSize);
 
         // 커서가 파일의 맨 끝에 있으므로 맨 앞으로 가져와서 읽기 시작해야 합니다.
         file.seekg(0);
@@ -1782,8 +2475,26 @@ private:
 
 
 
-    // 2-14. 이미지(텍스쳐) 파일 로드
-    void createTextureImage()
+    // 밉 체인의 텍셀 형식에 맞는 Vulkan 이미지 형식. 모두 sRGB 형식이라 샘플링할 때 선형으로 풀립니다.
+    HELPER_FUNCTION static VkFormat getTextureVkFormat(TextureFormat format)
+    {
+        switch (format)
+        {
+        case TextureFormat::Bc1:
+            return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+        case TextureFormat::Bc3:
+            return VK_FORMAT_BC3_SRGB_BLOCK;
+        case TextureFormat::Bc7:
+            return VK_FORMAT_BC7_SRGB_BLOCK;
+        default:
+            return VK_FORMAT_R8G8B8A8_SRGB;
+        }
+    }
+
+    // 2-14. 이미지(텍스쳐) 업로드
+    // 작업 스레드에서 불러온 밉 체인(loadTexture)으로 이미지를 만들고 업로드 명령을 기록합니다. 업로드는 호출하는 쪽에서 submitUploads 로 제출합니다.
+    // 레벨들은 밉 체인 배열이나 매핑된 KTX2 파일에서 스테이징 링으로 바로 복사되므로, 업로드 명령을 기록하는 동안만 살아 있으면 됩니다.
+    void createTextureImage(const MipBuilder::MipChainView& mips, TextureResource& texture)
     {
         // 애플리케이션에 텍스처를 추가하려면 다음 단계가 필요합니다.
         // 1. 장치 메모리가 지원하는 이미지 개체 만들기
@@ -1801,59 +2512,215 @@ private:
         // 5. VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : 셰이더 샘플링에 최적
         // 이미지 레이아웃을 전환하는 가장 일반적인 방법 중 하나는 파이프라인 장벽입니다. 파이프라인 장벽은 주로 이미지를 읽기 전에 기록했는지 확인하는 것처럼 리소스에 대한 액세스를 동기화하는 데 사용되지만 레이아웃을 전환하는 데 사용할 수도 있습니다. 이 장에서는 파이프라인 장벽이 이러한 목적으로 사용되는 방법을 볼 것입니다. VK_SHARING_MODE_EXCLUSIVE를 사용할 때 큐 패밀리 소유권을 이전하는 데 장벽을 추가로 사용할 수 있습니다.
 
-        // 이 라이브러리로 이미지를 로드하는 것은 정말 쉽습니다. stbi_load 함수는 파일 경로와 로드할 채널 수를 인자로 받습니다. STBI_rgb_alpha 값은 알파 채널이 없는 경우에도 이미지를 강제로 로드하므로 향후 여러 텍스처를 일관성있게 로드하기 좋습니다. 가운데 세 개의 매개변수는 이미지의 너비, 높이 및 실제 채널 수에 대한 출력입니다. 반환되는 포인터는 픽셀 값 배열의 첫 번째 요소입니다. STBI_rgb_alpha의 경우 픽셀당 4바이트로 픽셀 갯수는 총 texWidth * texHeight * 4(rgba) 입니다.
-        int texWidth, texHeight, texChannels;
-        // 새로운 테스트 이미지를 사용하도록 파일 경로를 TEXTURE_PATH.c_str() 로 지정하였습니다.
-        stbi_uc* pixels = stbi_load(TEXTURE_PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-        VkDeviceSize imageSize = texWidth * texHeight * 4;
+        const uint32_t texWidth = mips.getWidth();
+        const uint32_t texHeight = mips.getHeight();
+
         // 밉 체인의 레벨 수를 계산합니다. max 함수는 가장 큰 차원을 선택합니다. log2 함수는 해당 차원을 2로 나눌 수 있는 횟수를 계산합니다. floor 함수는 가장 큰 차원이 2의 거듭제곱이 아닌 경우를 처리합니다. 원본 이미지가 밉 수준을 갖도록 1이 추가됩니다.
-        mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
-        //mipLevels = 1; // @@@@@@ 밉맵 끔
+        texture.mipLevels = MipBuilder::getFullLevelCount(texWidth, texHeight);
+        //texture.mipLevels = 1; // @@@@@@ 밉맵 끔
 
-        if (!pixels)
+        // 작업 스레드에서 레벨 0 만 만들었으면(--gpu-mipmaps) 나머지 레벨은 그래픽 큐에서 blit 으로 채웁니다. blit 의 소스가 되려면 VK_IMAGE_USAGE_TRANSFER_SRC_BIT 가 필요합니다.
+        const bool blitMipmaps = mips.levels.size() < texture.mipLevels;
+        if (blitMipmaps && mips.format != TextureFormat::Rgba8)
+        {
+            throw std::runtime_error("Compressed textures need a complete mip chain!");
+        }
+        texture.format = mips.format;
+        texture.byteSize = mips.getByteSize();
+        const VkFormat imageFormat = getTextureVkFormat(texture.format);
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        if (blitMipmaps)
         {
-            throw std::runtime_error("Failed to load texture image!");
+            usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
         }
 
-        // 이제 vkMapMemory를 사용하고 픽셀을 복사할 수 있도록 호스트(CPU)가 볼 수 있는 메모리에 버퍼를 만들 것입니다. 임시 버퍼이므로 함수 내 지역 변수로 만들었습니다.
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
+        // 픽셀은 호스트(CPU)가 볼 수 있는 스테이징 버퍼를 거쳐 이미지로 복사됩니다. 예전에는 텍스쳐마다 임시 스테이징 버퍼를 만들었지만, 이제는 시작할 때 만든 스테이징 링(stagingRing)에서 영역을 나누어 받습니다. (uploadImage)
         // 버퍼는 매핑할 수 있도록 호스트에서 볼 수 있는 메모리에 있어야 하고 나중에 이미지에 복사할 수 있도록 전송 소스로 사용할 수 있어야 합니다.
-        createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-        // 그런 다음 이미지 로딩 라이브러리에서 가져온 픽셀 값을 스테이징 버퍼 메모리로 직접 복사할 수 있습니다.
-        void* data;
-        vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-        memcpy(data, pixels, static_cast<size_t>(imageSize));
-        vkUnmapMemory(device, stagingBufferMemory);
-
-        // stb 라이브러리에서 사용한 원래의 픽셀 배열을 정리하는 것을 잊지 마십시오.
-        stbi_image_free(pixels);
 
         // 이 함수는 이미 상당히 커지고 있으며 이후 장에서 더 많은 이미지를 생성해야 할 필요가 있으므로 버퍼에서 했던 것처럼 이미지 생성을 createImage 함수로 추상화해야 합니다. 함수를 만들고 이미지 개체 생성 및 메모리 할당을 해당 함수로 이동합니다. 너비, 높이, 형식, 타일링 모드, 사용량 및 메모리 속성 매개변수를 만들었습니다. 이 매개변수는 이 튜토리얼 전체에서 만들 이미지마다 다를 수 있기 때문입니다. 밉 매핑에 사용할 vkCmdBlitImage는 전송 작업으로 간주되므로 Vulkan 에 텍스처 이미지를 전송의 소스 및 대상으로 사용할 것임을 알려야 합니다. createTextureImage의 텍스처 이미지 사용 플래그에 VK_IMAGE_USAGE_TRANSFER_SRC_BIT를 추가합니다. 다른 이미지 작업과 마찬가지로 vkCmdBlitImage는 작업하는 이미지의 레이아웃에 따라 다릅니다. 전체 이미지를 VK_IMAGE_LAYOUT_GENERAL로 전환할 수 있지만 이는 느릴 가능성이 큽니다. 최적의 성능을 위해 소스 이미지는 VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL에 있어야 하고 대상 이미지는 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL에 있어야 합니다. Vulkan을 사용하면 이미지의 각 밉 레벨을 독립적으로 전환할 수 있습니다. 각 blit은 한 번에 두 개의 밉 레벨만 처리하므로 각 레벨을 blits 명령 간에 최적의 레이아웃으로 전환할 수 있습니다.
-        createImage(texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+        createImage(texWidth, texHeight, texture.mipLevels, VK_SAMPLE_COUNT_1_BIT, imageFormat, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture.image, texture.memory);
 
         // 이제 텍스쳐 이미지 설정을 완료하는 데 필요한 모든 도구가 있으므로 createTextureImage 함수로 돌아갑니다. 우리가 거기서 마지막으로 한 것은 텍스처 이미지를 만드는 것이었습니다. 다음 단계는 스테이징 버퍼를 텍스처 이미지에 복사하는 것입니다. 여기에는 두 단계가 포함됩니다.
         // 1. 텍스처 이미지를 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL로 전환
         // 2. 버퍼에서 이미지 복사 작업 실행
         // 이것은 방금 만든 transitionImageLayout 함수로 쉽게 수행할 수 있습니다.
         // 셰이더의 텍스처 이미지에서 샘플링을 시작하려면 셰이더 액세스를 준비하기 위해 마지막 트랜지션이 하나 필요합니다. 이미지는 VK_IMAGE_LAYOUT_UNDEFINED 레이아웃으로 생성되었으므로 textureImage를 전환할 때 이전 레이아웃을 지정해야 합니다. 복사 작업을 수행하기 전에 그 컨텐츠에 대해 신경 쓰지 않아도 되기 때문에 이렇게 작업을 수행할 수 있음을 기억하십시오. transitionImageLayout은 전체 이미지에 대해서만 레이아웃 전환을 수행하므로 몇 가지 파이프라인 장벽 명령을 더 작성해야 합니다. 밉맵들을 생성하기 위해 createTextureImage에서 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL로의 기존 전환 코드를 제거합니다. 이것은 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL에 텍스처 이미지의 각 레벨을 남길 것입니다. 각 레벨은 blit 명령 읽기가 완료된 후 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL로 자동 전환됩니다. 이제 밉맵을 생성하는 함수 generateMipmaps를 작성할 것입니다.
-        //transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-        transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
-        
-        copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+        //transitionImageLayout(texture.image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        transitionImageLayout(texture.image, imageFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture.mipLevels);
         
-        // 마지막에 스테이징 버퍼와 메모리를 정리하여 createTextureImage 함수를 종료합니다.
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        // 밉 체인의 모든 레벨을 스테이징 링의 한 영역으로 복사하고 레벨마다 영역(region)을 둔 복사 명령 하나로 이미지에 옮깁니다. 링 조각보다 큰 레벨은 행 단위 조각으로 나누어 복사합니다.
+        uploadMipChain(texture.image, mips);
 
-        // 이제 텍스쳐 이미지에 여러 밉 레벨이 존재하지만 스테이징 버퍼는 밉 레벨 0 만 채울 수 있습니다. 다른 레벨은 아직 정의되지 않았습니다. 이 레벨을 채우려면 우리가 가지고 있는 단일 레벨에서 데이터를 생성해야 합니다. 이때 vkCmdBlitImage 명령을 사용합니다. 이 명령은 복사, 크기 조정 및 필터링 작업을 수행합니다. 이것을 여러 번 호출하여 텍스처 이미지의 각 레벨로 데이터를 블리트해야 합니다. 
-        generateMipmaps(textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels);
+        // 복사는 전송 큐에서, 밉맵 생성이나 셰이더 읽기 레이아웃 전환은 그래픽 큐에서 하므로 TRANSFER_DST 레이아웃 그대로 이미지의 소유권을 그래픽 큐 패밀리로 넘깁니다.
+        VkImageSubresourceRange textureRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mipLevels, 0, 1 };
+        uploadContext.transferOwnership(texture.image, textureRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+
+        if (blitMipmaps)
+        {
+            // 이제 텍스쳐 이미지에 여러 밉 레벨이 존재하지만 스테이징 버퍼는 밉 레벨 0 만 채울 수 있습니다. 다른 레벨은 아직 정의되지 않았습니다. 이 레벨을 채우려면 우리가 가지고 있는 단일 레벨에서 데이터를 생성해야 합니다. 이때 vkCmdBlitImage 명령을 사용합니다. 이 명령은 복사, 크기 조정 및 필터링 작업을 수행합니다. 이것을 여러 번 호출하여 텍스처 이미지의 각 레벨로 데이터를 블리트해야 합니다. 
+            generateMipmaps(texture.image, imageFormat, static_cast<int32_t>(texWidth), static_cast<int32_t>(texHeight), texture.mipLevels);
+        }
+        else
+        {
+            // 모든 레벨이 이미 채워졌으므로 blit 없이 셰이더 읽기 레이아웃으로 한 번에 전환합니다. 선형 blit 을 지원하지 않는 포맷도 사용할 수 있습니다.
+            transitionImageLayout(texture.image, imageFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, texture.mipLevels);
+        }
         // 이제 텍스쳐 이미지의 밉맵들이 완전히 채워졌습니다.
     }
 
+    // 장치가 BC 형식을 지원하지 않거나 밉맵을 GPU 에서 만들면(압축 형식에는 blit 을 쓸 수 없습니다) 압축하지 않습니다.
+    TextureCompression getTextureCompression() const
+    {
+        if (textureCompressionBC == false || options.cpuMipmaps == false)
+        {
+            return TextureCompression::None;
+        }
+        return options.textureCompression;
+    }
+
+    // 텍스쳐 캐시 키(경로 + 내용 해시)를 구합니다. 작업 스레드에서 호출되며, 파일을 매핑해서 해시만 하므로 디코딩에 비하면 무시할 만한 시간이 듭니다.
+    // 원본은 TEXTURE_PATH, 머티리얼 아틀라스를 쓰면 아틀라스에 들어가는 이미지 파일들입니다. 아틀라스의 해시에는 배치도 섞습니다.
+    void identifyTexture(TextureAsset& texture) const
+    {
+        if (materialAtlas.empty())
+        {
+            MappedFile source;
+            if (source.open(TEXTURE_PATH) == false)
+            {
+                throw std::runtime_error("Failed to load texture image!");
+            }
+            texture.sourceHash = hashBytes(source.getData(), source.getSize());
+            texture.sourceSize = source.getSize();
+            texture.key.path = TEXTURE_PATH;
+        }
+        else
+        {
+            texture.sourceHash = materialAtlas.getHash();
+            for (const TextureAtlasEntry& entry : materialAtlas.layout.entries)
+            {
+                MappedFile image;
+                if (entry.path.empty() == false && image.open(entry.path))
+                {
+                    texture.sourceHash = hashBytes(image.getData(), image.getSize(), texture.sourceHash);
+                    texture.sourceSize += image.getSize();
+                }
+            }
+            texture.key.path = MODEL_PATH + TEXTURE_ATLAS_EXTENSION;
+        }
+
+        // 같은 원본이라도 KTX2 파일이 있으면 그 안의 밉 체인을, 없으면 압축 방식과 밉 체인을 만드는 위치에 따라 다른 이미지를 올리므로 함께 섞습니다.
+        uint64_t contentHash = texture.sourceHash;
+        MappedFile ktx2File;
+        if (materialAtlas.empty() && ktx2File.open(TEXTURE_KTX2_PATH))
+        {
+            contentHash = hashBytes(ktx2File.getData(), ktx2File.getSize(), contentHash);
+        }
+        const uint32_t buildSettings[2] = { static_cast<uint32_t>(getTextureCompression()), options.cpuMipmaps ? 1u : 0u };
+        texture.key.contentHash = hashBytes(buildSettings, sizeof(buildSettings), contentHash);
+        texture.key.firstLevel = 0;
+    }
+
+    // 이미지(텍스쳐) 파일 로드. 작업 스레드에서 호출되므로 Vulkan 을 사용하지 않고 options 와 textureCompressionBC 만 읽습니다.
+    // 이미지 옆에 KTX2 파일이 있으면 그 안의 밉 체인을 그대로 씁니다. 없으면 디코딩, 밉 체인 생성(MipBuilder), 블록 압축(TextureCompressor)까지 끝난 결과를 캐시 파일로 저장해 두고, 다음 실행부터는 캐시를 그대로 읽습니다.
+    void loadTexture(TextureAsset& texture) const
+    {
+        auto loadStart = std::chrono::high_resolution_clock::now();
+
+        // KTX2 파일은 매핑한 채로 두고, 초압축이 없으면 레벨들이 파일 안을 그대로 가리키므로 디코딩도 중간 복사도 없습니다.
+        // 파일의 형식을 그대로 올리므로 --texture-format 은 적용되지 않습니다. 장치가 올릴 수 없는 파일이면 원본 이미지로 돌아갑니다.
+        // 머티리얼 아틀라스를 쓰면 TEXTURE_PATH 가 아니라 머티리얼 텍스쳐들을 합쳐야 하므로 KTX2 파일은 보지 않습니다.
+        const std::string& ktx2Path = TEXTURE_KTX2_PATH;
+        if (materialAtlas.empty() && Ktx2::open(texture.ktx2File, ktx2Path, texture.inflated, texture.view))
+        {
+            const bool compressed = texture.view.format != TextureFormat::Rgba8;
+            if (compressed && textureCompressionBC == false)
+            {
+                std::cout << "@ [WARNING] : " << ktx2Path << " is " << toString(texture.view.format) << " but the device does not support BC textures, loading " << TEXTURE_PATH << " instead\n";
+            }
+            else if (compressed && texture.view.levels.size() < MipBuilder::getFullLevelCount(texture.view.getWidth(), texture.view.getHeight()))
+            {
+                // 압축 형식은 blit 으로 나머지 레벨을 만들 수 없습니다.
+                std::cout << "@ [WARNING] : " << ktx2Path << " has no complete mip chain, loading " << TEXTURE_PATH << " instead\n";
+            }
+            else
+            {
+                double loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+                std::cout << "@ [INFO] : Texture loaded from " << ktx2Path << " (" << toString(texture.view.format) << ", " << texture.view.levels.size() << " levels, " << texture.view.getByteSize() / 1024 << " KiB" << (texture.inflated.empty() ? ", mapped" : ", zstd") << ") in " << loadMs << " ms\n";
+                return;
+            }
+            texture.view = MipBuilder::MipChainView{};
+            texture.inflated.clear();
+            texture.ktx2File.close();
+        }
+
+        MipBuilder::MipChain& mips = texture.chain;
+
+        const TextureCompression compression = getTextureCompression();
+
+        // 원본 파일 내용의 해시(identifyTexture)와 요청한 압축 방식으로 캐시가 유효한지 확인합니다. --gpu-mipmaps 는 레벨 0 만 만드는 비교용 경로이므로 캐시를 쓰지 않습니다.
+        const uint32_t buildFlags = static_cast<uint32_t>(compression);
+        const std::string cachePath = materialAtlas.empty() ? TEXTURE_PATH + TEXTURE_CACHE_EXTENSION : MODEL_PATH + TEXTURE_ATLAS_EXTENSION + TEXTURE_CACHE_EXTENSION;
+        if (options.cpuMipmaps && TextureCache::open(cachePath, texture.sourceHash, texture.sourceSize, buildFlags, mips))
+        {
+            double loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+            std::cout << "@ [INFO] : Texture cache hit " << cachePath << " (" << toString(mips.format) << ", " << mips.levels.size() << " levels, " << mips.data.size() / 1024 << " KiB) in " << loadMs << " ms\n";
+            texture.view = mips.getView();
+            return;
+        }
+
+        if (materialAtlas.empty())
+        {
+            MappedFile source;
+            if (source.open(TEXTURE_PATH) == false)
+            {
+                throw std::runtime_error("Failed to load texture image!");
+            }
+
+            // 이 라이브러리로 이미지를 로드하는 것은 정말 쉽습니다. stbi_load 함수는 파일 경로와 로드할 채널 수를 인자로 받습니다. STBI_rgb_alpha 값은 알파 채널이 없는 경우에도 이미지를 강제로 로드하므로 향후 여러 텍스처를 일관성있게 로드하기 좋습니다. 가운데 세 개의 매개변수는 이미지의 너비, 높이 및 실제 채널 수에 대한 출력입니다. 반환되는 포인터는 픽셀 값 배열의 첫 번째 요소입니다. STBI_rgb_alpha의 경우 픽셀당 4바이트로 픽셀 갯수는 총 texWidth * texHeight * 4(rgba) 입니다.
+            int texWidth, texHeight, texChannels;
+            stbi_uc* pixels = stbi_load_from_memory(source.getData(), static_cast<int>(source.getSize()), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+            if (!pixels)
+            {
+                throw std::runtime_error("Failed to load texture image!");
+            }
+
+            // 픽셀은 밉 체인의 레벨 0 으로 복사되므로 밉 체인을 만든 뒤 바로 해제합니다. 밉 체인을 만들다 예외가 나도 해제되도록 std::unique_ptr 에 맡깁니다.
+            {
+                std::unique_ptr<stbi_uc, void (*)(void*)> pixelsOwner(pixels, stbi_image_free);
+                MipBuilder::build(pixels, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), options.cpuMipmaps ? 0 : 1, mips);
+            }
+        }
+        else
+        {
+            // 머티리얼 텍스쳐들을 디코딩해서 여백을 둔 아틀라스 한 장으로 합친 뒤 같은 방법으로 밉 체인을 만듭니다.
+            std::vector<uint8_t> atlasPixels;
+            TextureAtlas::compose(materialAtlas.layout, atlasPixels);
+            MipBuilder::build(atlasPixels.data(), materialAtlas.layout.width, materialAtlas.layout.height, options.cpuMipmaps ? 0 : 1, mips);
+        }
+        if (mips.levels.size() > 1)
+        {
+            std::cout << "@ [INFO] : Texture mip chain built on the CPU : " << mips.levels.size() << " levels in " << mips.milliseconds << " ms\n";
+        }
+
+        // 블록들을 importThreads 개의 스레드로 나누어 압축합니다.
+        if (compression != TextureCompression::None)
+        {
+            MipBuilder::MipChain compressed;
+            TextureCompressor::compress(mips, TextureCompressor::chooseFormat(compression, mips), VertexDedup::resolveThreadCount(options.importThreads), compressed);
+            std::cout << "@ [INFO] : Texture compressed to " << toString(compressed.format) << " in " << compressed.milliseconds << " ms (" << mips.data.size() / 1024 << " KiB -> " << compressed.data.size() / 1024 << " KiB)\n";
+            mips = std::move(compressed);
+        }
+
+        // 다음 실행부터 디코딩과 압축을 건너뛸 수 있도록 결과를 캐시 파일로 저장합니다. 저장에 실패해도 다음에 다시 만들면 되므로 경고만 출력합니다.
+        if (options.cpuMipmaps && TextureCache::write(cachePath, texture.sourceHash, texture.sourceSize, buildFlags, mips) == false)
+        {
+            std::cout << "@ [WARNING] : Failed to write texture cache " << cachePath << "\n";
+        }
+        texture.view = mips.getView();
+    }
+
     // 이미지 개체를 생성해주는 헬퍼함수
-    HELPER_FUNCTION void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory)
+    HELPER_FUNCTION void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, MemoryAllocation& imageMemory)
     {
         // 버퍼의 픽셀 값에 하나하나 액세스하도록 셰이더를 설정할 수도 있지만 이 목적을 위해 Vulkan 에선 이미지 개체를 사용하는 것이 좋습니다. 이미지 개체를 사용하면 2D 좌표를 사용할 수 있으므로 색상을 더 쉽고 빠르게 검색할 수 있습니다. 이미지 객체 내의 픽셀은 텍셀로 알려져 있으며 지금부터 그 이름을 사용합니다. 다음 새 클래스 구성원을 추가합니다. 이미지에 대한 매개변수는 VkImageCreateInfo 구조체에 지정됩니다.
         VkImageCreateInfo imageInfo{};
@@ -1896,24 +2763,18 @@ private:
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+        // 메모리 유형의 풀에서 구간을 할당받습니다. OPTIMAL 타일링 이미지는 버퍼와 같은 페이지를 공유하지 않도록 할당기가 bufferImageGranularity 에 맞춰 줍니다.
+        imageMemory = memoryAllocator.allocate(memRequirements, findMemoryType(memRequirements.memoryTypeBits, properties), tiling == VK_IMAGE_TILING_LINEAR);
 
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to allocate image memory!");
-        }
-
-        vkBindImageMemory(device, image, imageMemory, 0);
+        vkBindImageMemory(device, image, imageMemory.memory, imageMemory.offset);
     }
 
     // 이미지 레이아웃 전환(트랜지션)을 구성하는 헬퍼함수
     HELPER_FUNCTION void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
     {
+        // 복사 전 전환(-> TRANSFER_DST)은 복사와 같은 전송 명령 버퍼에, 셰이더 / 어태치먼트용 전환은 그래픽 명령 버퍼에 기록합니다. (전송 큐는 그래픽 파이프라인 단계를 지원하지 않습니다.)
         // 이제 우리가 작성할 함수는 명령 버퍼를 다시 기록하고 실행하는 것과 관련이 있으므로 이제 해당 로직을 헬퍼 함수 한두개에 옮기기에 좋은 시간입니다. 여전히 버퍼를 사용하고 있었다면 이제 vkCmdCopyBufferToImage를 기록하고 실행하여 작업을 완료하는 함수를 작성할 수 있지만 이 명령을 사용하려면 먼저 이미지가 올바른 레이아웃에 있어야 합니다. 레이아웃 전환을 처리하는 새 함수를 만듭니다.
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        VkCommandBuffer commandBuffer = (newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) ? beginTransferCommands() : beginUploadCommands();
 
         // 레이아웃 전환을 수행하는 가장 일반적인 방법 중 하나는 이미지 메모리 배리어를 사용하는 것입니다. 이와 같은 파이프라인 장벽은 일반적으로 버퍼에 대한 쓰기가 읽기 전에 완료되도록 하는 것과 같이 리소스에 대한 액세스를 동기화하는 데 사용되지만 VK_SHARING_MODE_EXCLUSIVE가 사용될 때 이미지 레이아웃을 전환하고 대기열 패밀리 소유권을 이전하는 데에도 사용할 수 있습니다. 버퍼에 대해 이를 수행하는 동등한 버퍼 메모리 장벽이 있습니다.
         VkImageMemoryBarrier barrier{};
@@ -1993,28 +2854,26 @@ private:
             0, nullptr,
             1, &barrier
         );
-
-        endSingleTimeCommands(commandBuffer);
     }
 
-    // 버퍼를 받아 이미지 형태로 복사하는 헬퍼함수
-    HELPER_FUNCTION void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+    // 버퍼를 받아 이미지 형태로 복사하는 헬퍼함수. bufferOffset 에서 시작하는 height 개의 행을 이미지의 rowOffset 번째 행부터 채웁니다.
+    HELPER_FUNCTION void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t mipLevel, uint32_t width, uint32_t height, VkDeviceSize bufferOffset, uint32_t rowOffset)
     {
         // createTextureImage로 돌아가기 전에 도우미 함수 copyBufferToImage를 하나 더 작성합니다. 버퍼 복사와 마찬가지로 버퍼의 어느 부분을 이미지의 어느 부분으로 복사할지 지정해야 합니다. 이것은 VkBufferImageCopy 구조체를 통해 설정합니다.
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        VkCommandBuffer commandBuffer = beginTransferCommands();
 
         VkBufferImageCopy region{};
-        // bufferOffset은 픽셀 값이 시작되는 버퍼의 바이트 오프셋을 지정합니다.
-        region.bufferOffset = 0;
+        // bufferOffset은 픽셀 값이 시작되는 버퍼의 바이트 오프셋을 지정합니다. 스테이징 링에서 나누어 받은 영역의 시작 위치입니다.
+        region.bufferOffset = bufferOffset;
         // bufferRowLength 및 bufferImageHeight 필드는 픽셀이 메모리에 배치되는 방식을 지정합니다. 예를 들어 이미지 행 사이에 패딩 바이트가 있을 수 있습니다. 둘 다에 대해 0을 지정하면 픽셀이 우리의 경우처럼 단순히 빽빽하게 채워져 있음을 나타냅니다. 
         region.bufferRowLength = 0;
         region.bufferImageHeight = 0;
         // imageSubresource, imageOffset 및 imageExtent 필드는 픽셀을 복사하려는 이미지 일부분을 나타냅니다.
         region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.mipLevel = mipLevel;
         region.imageSubresource.baseArrayLayer = 0;
         region.imageSubresource.layerCount = 1;
-        region.imageOffset = { 0, 0, 0 };
+        region.imageOffset = { 0, static_cast<int32_t>(rowOffset), 0 };
         region.imageExtent = {
             width,
             height,
@@ -2023,8 +2882,6 @@ private:
 
         // 네 번째 매개변수는 이미지가 현재 사용 중인 레이아웃을 나타냅니다. 여기에서 이미지가 이미 픽셀 복사에 최적인 레이아웃으로 전환되었다고 가정합니다. 지금은 픽셀의 한 청크만 전체 이미지에 복사하고 있지만 VkBufferImageCopy 배열을 지정하여 이 버퍼에서 이미지로 한 번의 작업으로 다양한 복사를 수행할 수 있습니다.
         vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-        endSingleTimeCommands(commandBuffer);
     }
 
     // 밉맵들을 생성하는 헬퍼 함수 (이미지 형식, 
@@ -2043,7 +2900,8 @@ private:
             throw std::runtime_error("Texture image format does not support linear blitting!");
         }
 
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        VkCommandBuffer commandBuffer = beginUploadCommands();
+        uint32_t mipmapScope = gpuProfiler.beginScope(commandBuffer, "generateMipmaps");
 
         // 몇 가지 트렌지션을 수행할 것이므로 전에 만든 VkImageMemoryBarrier를 재사용합니다. 아래 설정된 필드는 모든 장벽에 대해 동일하게 유지됩니다.
         VkImageMemoryBarrier barrier{};
@@ -2130,22 +2988,23 @@ private:
             0, nullptr,
             1, &barrier);
 
-        endSingleTimeCommands(commandBuffer);
+        gpuProfiler.endScope(commandBuffer, mipmapScope);
     }
 
 
 
     // 2-15. 셰이더가 텍스쳐에서 텍셀을 읽어들이는 방식인 이미지 뷰 생성
-    inline void createTextureImageView()
+    inline void createTextureImageView(TextureResource& texture)
     {
         // 이 장에서는 그래픽 파이프라인이 이미지를 샘플링하는 데 필요한 리소스를 두 개 더 만들 것입니다. 첫 번째 리소스는 이전에 스왑 체인 이미지에서 이미 본 것이지만 두 번째 리소스는 새로운 것입니다. 이는 셰이더가 이미지에서 텍셀을 읽는 방법과 관련이 있습니다. 이전에 스왑 체인 이미지와 프레임 버퍼를 사용하여 이미지에 직접 액세스하지 않고 이미지 뷰를 통해 액세스하는 것을 보았습니다. 또한 텍스처 이미지에 대해 이러한 이미지 뷰를 생성해야 합니다. 텍스처 이미지에 대한 VkImageView를 보유할 클래스 멤버 textureImageView를 추가하고 이를 생성할 새 함수 createTextureImageView를 만듭니다.
-        textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+        texture.view = createImageView(texture.image, getTextureVkFormat(texture.format), VK_IMAGE_ASPECT_COLOR_BIT, texture.mipLevels);
     }
 
 
 
     // 2-16. 텍스쳐를 샘플링 하기 위해 샘플러 객체를 생성합니다. (이 샘플러를 사용하여 셰이더의 텍스처에서 색상을 읽을 것입니다.)
-    inline void createTextureSampler()
+    // minLod 는 텍스쳐 스트리밍이 새로 올라온 레벨을 서서히 보여 줄 때만 0 이 아닙니다. (updateTextureStreaming)
+    inline void createTextureSampler(float minLod = 0.0f)
     {
         // 셰이더가 이미지에서 직접 텍셀을 읽는 것도 가능하지만 텍스처로 사용되는 경우에는 그리 일반적이지 않습니다. 텍스쳐는 일반적으로 최종 색상을 계산하기 위한 필터링 및 변환을 적용하는 샘플러를 통해 액세스됩니다. 이러한 필터는 오버샘플링과 같은 문제를 처리하는 데 유용합니다. 텍스쳐를 단순한 텍셀보다는 지오메트리에 매핑된 프레그먼트로 간주하는 것이 좋습니다. 각 프래그먼트의 텍스처 좌표에 대해 가장 가까운 텍셀을 사용하기만 한다면 https://vulkan-tutorial.com/images/texture_filtering.png 에서 No filtering 이미지 예시와 같은 결과를 얻을 수 있습니다. 하지만 선형 보간법을 통해 가장 가까운 4개의 텍셀을 결합하면 오른쪽과 같이 더 부드러운 결과를 얻을 수 있습니다. 물론 응용 프로그램에 따라 No filtering 스타일에 더 적합한 아트 스타일이 요구될 수 있지만(Minecraft 처럼), 기존 그래픽 응용 프로그램에서는 filtering 방식이 선호됩니다. 샘플러 개체는 텍스처에서 색상을 읽을 때 자동으로 이 필터링을 적용합니다. 반면에 언더샘플링은 반대로 프레그먼츠보다 텍셀이 더 많을 때 발생하는 문제입니다. 낮은 각도에서 바둑판 텍스처와 같은 고주파수 패턴을 샘플링할 때 아티팩트가 발생합니다. https://vulkan-tutorial.com/images/anisotropic_filtering.png 왼쪽 이미지와 같이 멀리 갈수록 텍셀 밀도에 비해 프레그먼트 밀도가 낮아 흐릿하게 보입니다. 이에 대한 솔루션은 샘플러에 의해 자동으로 적용될 수도 있는 등방성 필터링입니다. 이러한 필터 외에도 샘플러는 변환을 처리할 수도 있습니다. addressing mode를 통해 이미지 해상도를 넘는 텍셀을 읽으려고 할 때 어떤 일이 발생하는지 결정합니다. https://vulkan-tutorial.com/images/texture_addressing.png 예시에서 몇 가지 가능성을 보여줍니다. 이제 이러한 샘플러 객체를 설정하기 위해 createTextureSampler 함수를 생성하였습니다. 이 샘플러를 사용하여 셰이더의 텍스처에서 색상을 읽을 것입니다.
 
@@ -2182,146 +3041,327 @@ private:
         // VK_SAMPLER_MIPMAP_MODE_NEAREST 로 하면 디테일이 어느정도 살아납니다. 밉맵 챕터의 결과를 보려면 textureSampler에 대한 값을 선택해야 합니다. VK_FILTER_LINEAR를 사용하도록 minFilter 및 magFilter를 이미 설정했습니다. minLod, maxLod, mipLodBias 및 mipmapMode 값을 선택하기만 하면 됩니다. 샘플러 설정을 가지고 놀면서 그들이 밉매핑에 어떤 영향을 미치는지 확인할 수 있습니다. 예를 들어 minLod를 변경하여 샘플러가 가장 낮은 밉 레벨을 사용하지 않도록 할 수 있습니다. 이 방법으로 물체가 카메라에서 더 멀리 떨어져 있을 때 더 높은 밉 레벨이 사용되는 것을 시뮬레이션 할 수 있습니다.
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         // VkImage가 밉맵 데이터를 보유하는 동안 VkSampler는 렌더링하는 동안 해당 데이터를 읽는 방법을 제어합니다. Vulkan을 사용하면 minLod, maxLod, mipLodBias 및 mipmapMode를 지정할 수 있습니다("Lod"는 "세부 수준"을 의미함). 텍스처가 샘플링되면 샘플러는 https://vulkan-tutorial.com/Generating_Mipmaps 에 나와있는 의사 코드처럼 밉 레벨을 선택합니다. samplerInfo.mipmapMode가 VK_SAMPLER_MIPMAP_MODE_NEAREST이면 lod는 샘플링할 밉 레벨을 선택합니다. 밉맵 모드가 VK_SAMPLER_MIPMAP_MODE_LINEAR인 경우 lod는 샘플링할 두 밉 수준을 선택하는 데 사용됩니다. 이러한 수준은 샘플링되고 결과는 선형으로 혼합됩니다. 샘플 작업은 lod의 영향도 받습니다. 물체가 카메라에 가까이 있으면 magFilter가 필터로 사용됩니다. 객체가 카메라에서 더 멀리 있으면 minFilter가 사용됩니다. 일반적으로 lod는 음수가 아니며 카메라를 닫을 때만 0입니다. mipLodBias를 사용하면 Vulkan이 일반적으로 사용하는 것보다 낮은 lod와 레벨을 사용하도록 강제할 수 있습니다. 전체 범위의 밉 수준을 사용할 수 있도록 minLod를 0.0f로 설정하고 maxLod를 밉 수준 수로 설정했습니다. lod 값을 변경할 이유가 없으므로 mipLodBias를 0.0f로 설정합니다.
-        samplerInfo.minLod = 0.0f; // optional
-        samplerInfo.maxLod = static_cast<float>(mipLevels); // optional
+        samplerInfo.minLod = minLod; // optional
+        // 샘플러 하나를 밉 레벨 수가 다른 텍스쳐들(1 레벨 자리표시 텍스쳐, 백그라운드 로드한 텍스쳐)이 함께 쓰므로 maxLod 를 제한하지 않습니다. 실제 레벨 수는 각 이미지 뷰가 제한합니다.
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE; // optional
         samplerInfo.mipLodBias = 0.0f; // optional
 
         // 샘플러는 어디에서도 VkImage를 참조하지 않습니다. 샘플러는 텍스처에서 색상을 추출하는 인터페이스를 제공하는 별개의 개체입니다. 1D, 2D, 3D 등 원하는 모든 이미지에 적용할 수 있습니다. 이는 텍스처 이미지와 필터링을 단일 상태로 결합한 많은 이전 API와 다릅니다.
+        // 같은 설정의 샘플러가 샘플러 캐시에 있으면 새로 만들지 않고 나누어 씁니다.
+        textureSamplerKey = SamplerKey(samplerInfo);
+        if (const VkSampler* cached = samplerCache.acquire(textureSamplerKey))
+        {
+            textureSampler = *cached;
+            return;
+        }
         if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS)
         {
             throw std::runtime_error("Failed to create texture sampler!");
         }
+        samplerCache.insert(textureSamplerKey, textureSampler, 0, "minLod " + std::to_string(minLod) + ", anisotropy " + std::to_string(samplerInfo.maxAnisotropy));
     }
 
 
 
-    // 2-17. 테스트용 OBJ 파일의 버텍스를 로드합니다.
-    void loadModel()
+    // 2-17. 백그라운드 에셋 로드 시작
+    // 텍스쳐 디코딩과 OBJ 파싱은 작업 스레드에서 실행하고, 끝나면 메인 스레드가 프레임 사이에(updateAssets) 버퍼 / 이미지를 만들어 업로드를 제출합니다.
+    // 업로드 배치가 끝나면 자리표시 리소스 대신 그리기에 쓰므로, 첫 프레임까지의 시간이 에셋 크기와 관계없어집니다.
+    inline void startAssetLoading()
     {
-        // 이제 이 라이브러리를 사용하여 정점 및 인덱스 컨테이너를 메쉬의 정점 데이터로 채우는 loadModel 함수를 작성할 것입니다. 버텍스 및 인덱스 버퍼가 생성되기 전에 이 함수가 호출되어야 합니다.
-        tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warn, err;
+        planMaterialAtlas();
+
+        assetLoader.init(ASSET_LOADER_THREADS);
 
-        // 모델은 tinyobj::LoadObj 함수를 호출하여 라이브러리의 데이터 구조로 로드됩니다. OBJ 파일은 위치, 법선, 텍스처 좌표 및 면으로 구성됩니다. 면은 임의의 양의 정점으로 구성되며 각 정점은 인덱스로 위치, 법선 및/또는 텍스처 좌표를 나타냅니다. 이를 통해 전체 정점뿐만 아니라 개별 속성도 재사용할 수 있습니다. attrib 컨테이너는 attrib.vertices, attrib.normals 및 attrib.texcoords 벡터의 모든 위치, 법선 및 텍스처 좌표를 보유합니다.모양 컨테이너에는 모든 개별 개체와 해당 면이 포함됩니다. 각 면은 정점 배열로 구성되며 각 정점에는 위치, 법선 및 텍스처 좌표 속성의 인덱스가 포함됩니다. OBJ 모델은 면별로 재질과 질감을 정의할 수도 있지만 무시하겠습니다. err 문자열은 오류를 포함하고 warn 문자열은 누락된 재료 정의와 같이 파일을 로드하는 동안 발생한 경고를 포함합니다. LoadObj 함수가 false를 반환하는 경우 로드에 실패했다는 의미입니다. 위에서 언급했듯이 OBJ 파일의 면은 실제로 임의의 수의 정점을 포함할 수 있지만 우리 애플리케이션은 삼각형만 렌더링할 수 있습니다. 운 좋게도 LoadObj에는 기본적으로 활성화되어 있는 이러한 면을 자동으로 모두 삼각형으로 만들어주는 선택적 매개변수 triangulation 가 있습니다.
-        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH.c_str()))
+        // 에셋은 작업 스레드에서 만들어 완료 함수로 넘기므로 std::shared_ptr 로 들고 다닙니다. (std::function 은 복사할 수 있는 함수 개체만 담을 수 있습니다.)
+        assetLoader.enqueue([this]() -> AssetLoader::Publish
         {
-            throw std::runtime_error("\033[1;31m@ [ERROR] : Failed to load OBJ File : " + warn + err);
-        }
+            auto asset = std::make_shared<MeshAsset>();
+            loadModel(*asset);
+            CompactVertex::getPositionBounds(asset->layout, asset->vertexData, asset->vertexCount, asset->boundsMin, asset->boundsMax);
+            return [this, asset]()
+            {
+                createVertexBuffer(*asset, pendingMesh);
+                createIndexBuffer(*asset, pendingMesh);
+                pendingMeshToken = submitUploads();
+                // 버텍스 형식이 정해졌으므로 업로드와 겹쳐서 이 형식의 파이프라인 컴파일을 시작합니다. (이미 있는 형식이면 아무 일도 하지 않습니다.)
+                pipelineRegistry.request(getPipelineDesc(pendingMesh.layout), getPipelineLabel(pendingMesh.layout));
+            };
+        });
+    }
 
-        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+    // 2-17. 모델의 머티리얼 텍스쳐가 둘 이상이면 아틀라스 배치를 정합니다. 이미지 헤더에서 크기만 읽으므로 빠르고, 메쉬 작업(UV 옮기기)과 텍스쳐 작업(픽셀 합치기)이 이 배치를 함께 씁니다.
+    // 모든 머티리얼이 텍스쳐 하나를 쓰게 되므로 디스크립터 하나, 그리기 호출 하나로 모델 전체를 그립니다.
+    inline void planMaterialAtlas()
+    {
+        if (options.textureAtlas == false || ObjMaterials::readLibrary(MODEL_PATH, materialAtlas.materials) == false)
+        {
+            return;
+        }
 
-        // 파일의 모든 면을 단일 모델로 결합할 것이므로 모든 모양을 순회합니다.
-        for (const auto& shape : shapes)
+        // 같은 텍스쳐를 쓰는 머티리얼은 아틀라스의 같은 이미지를 씁니다.
+        std::vector<TextureAtlasEntry> entries;
+        materialAtlas.materialEntries.assign(materialAtlas.materials.size(), -1);
+        for (size_t i = 0; i < materialAtlas.materials.size(); i++)
         {
-            for (const auto& index : shape.mesh.indices)
+            const std::string& path = materialAtlas.materials[i].diffuseTexture;
+            if (path.empty())
+            {
+                continue;
+            }
+            auto found = std::find_if(entries.begin(), entries.end(), [&](const TextureAtlasEntry& entry) { return entry.path == path; });
+            if (found != entries.end())
+            {
+                materialAtlas.materialEntries[i] = static_cast<int32_t>(found - entries.begin());
+                continue;
+            }
+
+            int width, height, channels;
+            if (stbi_info(path.c_str(), &width, &height, &channels) == 0)
             {
-                Vertex vertex{};
+                std::cout << "@ [WARNING] : Failed to read material texture " << path << " (" << materialAtlas.materials[i].name << "), it is drawn white\n";
+                continue;
+            }
+            materialAtlas.materialEntries[i] = static_cast<int32_t>(entries.size());
+            entries.push_back(TextureAtlasEntry{ path, static_cast<uint32_t>(width), static_cast<uint32_t>(height) });
+        }
 
-                // triangulation 기능으로 이미 면당 3개의 정점만 존재한다는 것이 보장되므로 이제 정점을 직접 순회하며 정점 벡터에 직접 덤프할 수 있습니다. 단순화를 위해 모든 정점이 고유하다고 가정하므로 간단히 인덱스를 증가시켰습니다. 인덱스 변수는 vertex_index, normal_index 및 texcoord_index 멤버를 포함하는 tinyobj::index_t 유형입니다. attrib 배열에서 실제 꼭짓점 속성을 조회하려면 다음 인덱스를 사용해야 합니다. 불행히도 attrib.vertices 배열은 glm::vec3과 같이 버텍스로 묶인 배열이 아니라 그냥 모든 요소가 쭉 나열된 float 값의 배열이므로 인덱스에 3(x,y,z)을 곱해야 실제 버텍스별로 접근이 가능합니다.
-                vertex.position = {
-                    attrib.vertices[3 * index.vertex_index + 0],
-                    attrib.vertices[3 * index.vertex_index + 1],
-                    attrib.vertices[3 * index.vertex_index + 2]
-                };
+        // 텍스쳐가 하나뿐이면 합칠 것이 없으므로 예전처럼 TEXTURE_PATH 를 그대로 씁니다.
+        const size_t textureCount = entries.size();
+        if (textureCount < 2)
+        {
+            materialAtlas = MaterialAtlas{};
+            return;
+        }
 
-                // 마찬가지로 attrib.texcoords 배열에는 두 개의 텍스처 좌표 구성 요소(U,V)씩 나열되어 있으므로 2를 곱해 접근하였습니다.
-                vertex.texCoord = {
-                    attrib.texcoords[2 * index.texcoord_index + 0],
-                    // OBJ 형식은 수직 좌표가 0 이면 이미지의 하단을 의미하는 좌표계를 가지지만 Vulkan 에서 0 은 이미지의 상단을 의미하므로 이미지를 위에서 아래 방향으로 업로드했습니다. 텍스처 좌표의 수직 구성요소를 뒤집어서 이 문제를 해결하였습니다.
-                    1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-                };
+        // 텍스쳐가 없는 머티리얼과 머티리얼이 없는 면은 흰색 이미지를 씁니다.
+        materialAtlas.defaultEntry = static_cast<int32_t>(entries.size());
+        entries.push_back(TextureAtlasEntry{ std::string(), TEXTURE_ATLAS_ALIGNMENT, TEXTURE_ATLAS_ALIGNMENT });
+        for (int32_t& entry : materialAtlas.materialEntries)
+        {
+            entry = entry < 0 ? materialAtlas.defaultEntry : entry;
+        }
 
-                vertex.color = { 1.0f, 1.0f, 1.0f };
+        if (TextureAtlas::pack(entries, materialAtlas.layout) == false)
+        {
+            std::cout << "@ [WARNING] : Material textures do not fit in a " << TEXTURE_ATLAS_MAX_EXTENT << " x " << TEXTURE_ATLAS_MAX_EXTENT << " atlas, using " << TEXTURE_PATH << " only\n";
+            materialAtlas = MaterialAtlas{};
+            return;
+        }
+        std::cout << "@ [INFO] : Texture atlas : " << textureCount << " textures of " << materialAtlas.materials.size() << " materials packed into " << materialAtlas.layout.width << " x " << materialAtlas.layout.height << "\n";
+    }
 
-                // 불행히도 아직 인덱스 버퍼를 제대로 활용하지 못하고 있습니다. 정점 벡터에는 많은 정점이 여러 삼각형에 포함되어 있기 때문에 중복된 정점 데이터가 많이 포함되어 있습니다. 고유한 정점만 유지하고 인덱스 버퍼를 사용하여 정점이 나타날 때마다 재사용해야 합니다. 이것을 구현하는 간단한 방법은 map 또는 unordered_map을 사용하여 고유한 정점과 각 인덱스를 추적하는 것입니다. OBJ 파일에서 정점을 읽을 때마다 이전에 정확히 동일한 위치와 텍스처 좌표를 가진 정점을 이미 본 적이 있는지 확인합니다. 그렇지 않은 경우 정점에 추가하고 해당 인덱스를 uniqueVertices 컨테이너에 저장합니다. 그 후 새로운 정점의 인덱스를 인덱스에 추가합니다. 이전에 똑같은 꼭짓점을 본 적이 있다면 uniqueVertices에서 해당 인덱스를 조회하고 해당 인덱스를 인덱스에 저장합니다. 꼭짓점의 크기를 확인하면 1,500,000 에서 265,645 개로 축소된 것을 알 수 있습니다! 이는 각 정점이 평균 ~6개 의 삼각형에서 재사용됨을 의미합니다. 이것은 확실히 GPU 메모리를 많이 절약합니다.
-                if (uniqueVertices.count(vertex) == 0)
+    // 2-17. 텍스쳐 로드 시작
+    // 어떤 형식으로 압축할지는 장치가 BC 형식을 지원하는지에 달려 있으므로 논리 장치를 만든 뒤에 시작합니다. 그동안 OBJ 로드는 이미 진행 중입니다.
+    // 먼저 캐시 키만 구하고, 같은 키의 텍스쳐(모든 레벨)가 텍스쳐 캐시에 있으면 디코딩도 업로드도 하지 않고 그대로 씁니다.
+    inline void startTextureLoading()
+    {
+        assetLoader.enqueue([this]() -> AssetLoader::Publish
+        {
+            auto asset = std::make_shared<TextureAsset>();
+            identifyTexture(*asset);
+            return [this, asset]()
+            {
+                if (publishCachedTexture(asset->key, 0))
                 {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex);
+                    std::cout << "@ [INFO] : Texture " << asset->key.path << " shared from the texture cache\n";
+                    return;
                 }
 
-                indices.push_back(uniqueVertices[vertex]);
+                assetLoader.enqueue([this, asset]() -> AssetLoader::Publish
+                {
+                    loadTexture(*asset);
+                    return [this, asset]()
+                    {
+                        // 스트리밍하면 작은 레벨들만 먼저 올리고, 큰 레벨은 화면 크기와 메모리 예산을 보며 updateTextureStreaming 이 한 레벨씩 올립니다.
+                        // 밉 체인이 완전하지 않으면(--gpu-mipmaps) 꼬리를 만들 수 없으므로 예전처럼 한 번에 올립니다.
+                        uint32_t base = 0;
+                        streamedTexture.reset();
+                        if (options.textureStreaming && asset->view.levels.size() == MipBuilder::getFullLevelCount(asset->view.getWidth(), asset->view.getHeight()))
+                        {
+                            streamedTexture = asset;
+                            base = textureStreamer.init(asset->view);
+                        }
+                        TextureKey key = asset->key;
+                        key.firstLevel = base;
+                        createCachedTexture(key, asset->view.getTail(base), pendingTexture);
+                        pendingTextureBase = base;
+                        pendingTextureToken = submitUploads();
+                    };
+                });
+            };
+        });
+    }
+
+    // 2-17. 테스트용 OBJ 파일의 버텍스를 로드합니다.
+    // 작업 스레드에서 호출되므로 Vulkan 을 사용하지 않고 options 만 읽습니다. 결과는 mesh 에 담아 메인 스레드의 업로드(createVertexBuffer, createIndexBuffer)로 넘깁니다.
+    void loadModel(MeshAsset& mesh) const
+    {
+        auto loadStart = std::chrono::high_resolution_clock::now();
+
+        // 원본 파일 내용의 해시로 캐시가 유효한지 확인합니다. 유효한 캐시가 있으면 파싱과 중복 제거를 모두 건너뛰고 매핑된 파일을 그대로 업로드에 사용합니다.
+        const std::string cachePath = MODEL_PATH + MESH_CACHE_EXTENSION;
+        uint64_t sourceHash = 0;
+        uint64_t sourceSize = 0;
+        bool sourceHashed = MeshCache::hashSourceFile(MODEL_PATH, sourceHash, sourceSize);
+        if (materialAtlas.empty() == false)
+        {
+            // 아틀라스 배치가 바뀌면 UV 도 바뀌므로 캐시 키에 섞습니다.
+            const uint64_t atlasHash = materialAtlas.getHash();
+            sourceHash = hashBytes(&atlasHash, sizeof(atlasHash), sourceHash);
+        }
+
+        const uint32_t buildFlags = (options.optimizeMesh ? MESH_CACHE_FLAG_OPTIMIZED : 0) | (options.quantizeVertices ? MESH_CACHE_FLAG_QUANTIZED : 0);
+        MeshCacheView cacheView;
+        if (sourceHashed && MeshCache::open(mesh.cacheFile, cachePath, sourceHash, sourceSize, buildFlags, sizeof(VertexLayout), cacheView))
+        {
+            // 버텍스 형식은 캐시의 메타데이터에 저장되어 있습니다.
+            std::memcpy(&mesh.layout, cacheView.metadata, sizeof(VertexLayout));
+            if (mesh.layout.stride != cacheView.vertexStride)
+            {
+                throw std::runtime_error("Mesh cache vertex layout does not match its vertex stride : " + cachePath);
+            }
+            mesh.vertexData = static_cast<const uint8_t*>(cacheView.vertices);
+            mesh.indexData = cacheView.indices;
+            mesh.indexSize = cacheView.indexSize;
+            mesh.vertexCount = static_cast<uint32_t>(cacheView.vertexCount);
+            mesh.indexCount = static_cast<uint32_t>(cacheView.indexCount);
+            if (mesh.indexSize == sizeof(uint16_t))
+            {
+                mesh.cacheStats = MeshOptimizer::analyzeVertexCache(static_cast<const uint16_t*>(mesh.indexData), mesh.indexCount, mesh.vertexCount);
             }
+            else
+            {
+                mesh.cacheStats = MeshOptimizer::analyzeVertexCache(static_cast<const uint32_t*>(mesh.indexData), mesh.indexCount, mesh.vertexCount);
+            }
+
+            double loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+            std::cout << "@ [INFO] : Mesh cache hit " << cachePath << " (" << mesh.vertexCount << " vertices, " << mesh.indexCount << " indices, " << mesh.indexSize * 8 << "-bit) in " << loadMs << " ms\n";
+            return;
+        }
+
+        // 캐시가 없으면 멀티스레드 파서로 OBJ 파일을 해석하고 병렬로 중복 버텍스를 제거합니다.
+        uint32_t importThreads = VertexDedup::resolveThreadCount(options.importThreads);
+        double parseMs = 0.0;
+        double dedupMs = 0.0;
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        loadObjParallel(MODEL_PATH, importThreads, vertices, indices, &parseMs, &dedupMs, materialAtlas.empty() ? nullptr : &materialAtlas);
+
+        // 캐시에 최적화된 순서로 저장되도록 캐시를 쓰기 전에 최적화합니다. 최적화 비용은 캐시를 만들 때 한 번만 듭니다.
+        if (options.optimizeMesh)
+        {
+            MeshOptimizer::Report report = MeshOptimizer::optimize(vertices, indices, offsetof(Vertex, position));
+            std::cout << "@ [INFO] : Mesh optimized in " << report.milliseconds << " ms (ACMR " << report.before.acmr << " -> " << report.after.acmr << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << ", " << report.clusterCount << " overdraw clusters)\n";
+        }
+
+        // 메쉬에 맞는 버텍스 형식을 고르고 그 형식으로 옮깁니다. 압축하면서 같아진 버텍스는 다시 합쳐지므로 indices 도 바뀔 수 있습니다.
+        size_t floatVertexCount = vertices.size();
+        if (options.quantizeVertices)
+        {
+            mesh.layout = CompactVertex::pack(vertices, indices, mesh.packedVertices);
+        }
+        else
+        {
+            mesh.layout = Vertex::getFloatLayout();
+            mesh.packedVertices.resize(vertices.size() * sizeof(Vertex));
+            std::memcpy(mesh.packedVertices.data(), vertices.data(), mesh.packedVertices.size());
         }
+        std::vector<Vertex>().swap(vertices);
+
+        mesh.vertexData = mesh.packedVertices.data();
+        mesh.vertexCount = static_cast<uint32_t>(mesh.packedVertices.size() / mesh.layout.stride);
+        mesh.indexCount = static_cast<uint32_t>(indices.size());
+        mesh.cacheStats = MeshOptimizer::analyzeVertexCache(indices.data(), mesh.indexCount, mesh.vertexCount);
+
+        // 인덱스 크기도 메쉬마다 고릅니다. 버텍스가 65536 개보다 적으면 16 비트 인덱스로 충분합니다.
+        mesh.indexSize = CompactVertex::packIndices(indices, mesh.vertexCount, mesh.packedIndices);
+        mesh.indexData = mesh.packedIndices.data();
+        std::vector<uint32_t>().swap(indices);
+        std::cout << "@ [INFO] : Vertex layout " << mesh.layout.stride << " bytes" << (mesh.layout.hasConstantColor() ? " (constant color)" : "") << ", " << mesh.packedVertices.size() / 1024 << " KiB (float " << floatVertexCount * sizeof(Vertex) / 1024 << " KiB)\n";
 
-        // 최적화가 활성화된 상태에서 지금 프로그램을 실행하십시오(예: Visual Studio의 릴리스 모드 및 GCC용 -O3 컴파일러 플래그). 그렇지 않으면 모델을 로드하는 속도가 매우 느려지기 때문에 이것이 필요합니다.
+        double loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+        std::cout << "@ [INFO] : Parsed " << MODEL_PATH << " (" << mesh.vertexCount << " vertices, " << mesh.indexCount << " indices, " << mesh.indexSize * 8 << "-bit) in " << loadMs << " ms (parse " << parseMs << " ms, dedup " << dedupMs << " ms, " << importThreads << " threads)\n";
+
+        // 다음 실행부터 파싱을 건너뛸 수 있도록 결과를 캐시 파일로 저장합니다. 저장에 실패해도 다음에 다시 파싱하면 되므로 경고만 출력합니다.
+        if (sourceHashed && MeshCache::write(cachePath, sourceHash, sourceSize, &mesh.layout, sizeof(VertexLayout), mesh.packedVertices.data(), mesh.vertexCount, mesh.layout.stride, mesh.packedIndices.data(), mesh.indexCount, mesh.indexSize, buildFlags) == false)
+        {
+            std::cout << "@ [WARNING] : Failed to write mesh cache " << cachePath << "\n";
+        }
     }
 
 
 
     // 2-18. 버텍스 버퍼 생성
     // Vulkan의 버퍼는 그래픽 카드에서 읽을 수 있는 임의의 데이터를 저장하는 데 사용되는 메모리 영역입니다. 그것들은 버텍스 데이터를 저장하는 데 사용할 수 있으며, 물론 다른 많은 목적으로도 사용할 수 있습니다. 지금까지 다루었던 Vulkan 객체들과 달리 버퍼는 자동으로 메모리를 할당하지 않습니다. Vulkan API는 프로그래머가 거의 모든 것을 제어할 수 있도록 던져주며 메모리 관리는 그 중에 하나입니다.
-    inline void createVertexBuffer()
+    inline void createVertexBuffer(const MeshAsset& asset, MeshResource& mesh)
     {
         // 버퍼의 크기를 바이트 단위로 지정하는 크기입니다. 버텍스 데이터의 바이트 크기를 계산하는 것은 sizeof를 사용하면 간단합니다.
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+        // 버텍스 크기는 메쉬마다 고른 형식(asset.layout)에 따라 다릅니다.
+        mesh.layout = asset.layout;
+        mesh.boundsCenter = (asset.boundsMin + asset.boundsMax) * 0.5f;
+        mesh.boundsRadius = glm::length(asset.boundsMax - asset.boundsMin) * 0.5f;
+        VkDeviceSize bufferSize = VkDeviceSize(mesh.layout.stride) * asset.vertexCount;
 
         // 2-18-1.
         // 버텍스 버퍼만 사용해도 올바르게 작동하지만 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT 플래그가 있어 CPU 에서 액세스할 수 있는 메모리 유형은 그래픽 카드 자체에서 사용할 수 있는 최적의 메모리는 아닐 수 있습니다. 그래픽카드가 접근하기 가장 빠른 메모리에는 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT 플래그가 있으며 일반적으로 외장 그래픽카드의 경우 CPU 에서 액세스할 수 없는 메모리입니다. 이 장에서는 두 개의 버텍스 버퍼를 만들 것입니다. 하나는 CPU 에서 엑세스 가능하며 디바이스 메모리(VRAM)에 업로드를 위한 스테이징 버퍼와 두번째는 최종적으로 GPU 의 VRAM 에 할당되는 실제 버텍스 버퍼입니다. 그런 다음 버퍼 복사 명령을 사용하여 스테이징 버퍼에서 실제 버텍스 버퍼로 데이터를 이동합니다.
-        // 이제 버텍스 데이터를 매핑하고 복사하기 위해 새로운 stagingBufferMemory 와 함께 stagingBuffer 를 사용하고 있습니다.
+        // 스테이징 버퍼는 버퍼마다 만들지 않고 시작할 때 만든 스테이징 링(stagingRingBuffer)을 함께 씁니다. (2-27, uploadBuffer)
         // 여기서 우리는 두 개의 새로운 버퍼 사용방식 플래그를 설정할 것입니다.
-        // VK_BUFFER_USAGE_TRANSFER_SRC_BIT: 버퍼는 메모리 전송 작업에서 소스로 사용될 수 있습니다.
+        // VK_BUFFER_USAGE_TRANSFER_SRC_BIT: 버퍼는 메모리 전송 작업에서 소스로 사용될 수 있습니다. (스테이징 링)
         // VK_BUFFER_USAGE_TRANSFER_DST_BIT: 버퍼는 메모리 전송 작업에서 대상(목적지)으로 사용될 수 있습니다.
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
         // vertexBuffer는 이제 장치 로컬인 메모리 유형에서 할당됩니다. 이는 일반적으로 vkMapMemory를 사용할 수 없음을 의미합니다. 그러나 stagingBuffer에서는 vertexBuffer로 데이터를 복사할 수 있습니다. 버텍스 버퍼 사용 플래그와 함께 stagingBuffer에 대한 전송 소스 플래그와 vertexBuffer에 대한 전송 대상(목적지) 플래그를 지정하여 그렇게 할 것임을 나타내야 합니다.
 
 
         // 2-18-2.
         // 이제 버텍스 데이터를 버퍼에 복사할 차례입니다. 이것은 vkMapMemory를 사용하여 버퍼 메모리를 CPU 액세스 가능한 메모리에 매핑하여 수행됩니다. 이 함수를 사용하면 오프셋과 크기로 정의된 지정된 메모리 리소스 영역에 액세스할 수 있습니다. 여기서 오프셋과 크기는 각각 0과 bufferInfo.size입니다. 모든 메모리를 매핑하기 위해 특수 값 VK_WHOLE_SIZE를 지정할 수도 있습니다. 마지막에서 두 번째 매개변수는 플래그를 지정하는 데 사용할 수 있지만 현재 API에서는 아직 사용할 수 없습니다. 값을 0으로 설정해야 합니다. 마지막 매개변수는 매핑된 메모리에 대한 포인터의 출력을 지정합니다.
-        void* data;
-        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
+        // 할당기는 호스트에서 볼 수 있는 블록 전체를 한 번만 매핑해 두고 (같은 VkDeviceMemory 는 동시에 두 번 매핑할 수 없으므로) 각 할당의 시작 주소를 mappedData 로 알려줍니다. 스테이징 링은 이 주소를 계속 사용합니다.
         // 이제 버텍스 데이터를 매핑된 메모리에 memcpy하고 vkUnmapMemory를 사용하여 다시 매핑 해제할 수 있습니다. 불행히도 드라이버는 예를 들어 캐싱 때문에 버퍼 메모리에 데이터를 즉시 복사하지 않을 수 있습니다. 버퍼에 대한 쓰기가 아직 매핑된 메모리에 표시되지 않을 수도 있습니다.
         // 해당 문제를 처리하는 두 가지 방법이 있습니다.
         // 1. VK_MEMORY_PROPERTY_HOST_COHERENT_BIT로 표시된 호스트 일관성 있는 메모리 힙 사용
         // 2. 매핑된 메모리에 쓴 후 vkFlushMappedMemoryRanges를 호출하고 매핑된 메모리에서 읽기 전에 vkInvalidateMappedMemoryRanges를 호출
         // 매핑된 메모리가 항상 할당된 메모리의 내용과 일치하도록 하는 첫 번째 접근 방식을 사용했습니다. 이것은 명시적 플러시보다 성능이 약간 더 나빠질 수 있음을 명심하십시오. 그러나 이것이 중요하지 않은 이유는 다음 장에서 살펴보겠습니다.
-        memcpy(data, vertices.data(), (size_t)bufferSize);
+        // 버텍스 데이터를 링에 memcpy 하는 일은 아래의 uploadBuffer 가 조각마다 합니다.
         // 메모리 범위를 플러시하거나 일관된 메모리 힙을 사용한다는 것은 드라이버가 버퍼에 대한 쓰기를 인식한다는 것을 의미하지만 아직 GPU에서 실제로 볼 수 있다는 의미는 아닙니다. GPU로의 데이터 전송은 백그라운드에서 발생하는 작업이며 사양은 단순히 vkQueueSubmit에 대한 다음 호출 시점에서 완료가 보장된다고 알려줍니다.
-        vkUnmapMemory(device, stagingBufferMemory);
 
         // 버텍스 버퍼를 생성하기 위해 실제로 버퍼를 생성하는 헬퍼 함수를 호출합니다.
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.vertexBuffer, mesh.vertexBufferMemory);
 
 
         // 2-18-3.
-        // 이제 copyBuffer라고 하는 한 버퍼에서 다른 버퍼로 내용을 복사하는 함수를 작성할 것입니다.
-        copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+        // 이제 copyBuffer라고 하는 한 버퍼에서 다른 버퍼로 내용을 복사하는 함수를 작성할 것입니다. uploadBuffer 는 데이터를 스테이징 링의 영역에 나누어 담고 조각마다 copyBuffer 를 기록합니다.
+        uploadBuffer(mesh.vertexBuffer, asset.vertexData, bufferSize);
+        // 전송 큐에서 채운 버텍스 버퍼를 그래픽 큐가 버텍스 입력 단계에서 읽을 수 있도록 소유권을 넘깁니다.
+        uploadContext.transferOwnership(mesh.vertexBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
 
-        // 스테이징 버퍼는 장치 버퍼로 데이터를 한번만 복사하고는 더 이상 사용하지 않을 것이므로 깔끔히 지웁니다.
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        // 모든 버텍스의 색상이 같아 버텍스에서 색상을 뺀 형식이면 그 색상 하나를 바인딩 1 로 넘길 작은 버퍼를 만듭니다. 4 바이트뿐이므로 스테이징 없이 호스트 메모리에 둡니다.
+        if (mesh.layout.hasConstantColor())
+        {
+            createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, mesh.constantColorBuffer, mesh.constantColorBufferMemory);
+            memcpy(mesh.constantColorBufferMemory.mappedData, &mesh.layout.constantColor, sizeof(uint32_t));
+        }
 
-        // 프로그램을 실행하여 익숙한 삼각형이 다시 표시되는지 확인합니다. 지금은 개선 사항이 보이지 않을 수 있지만 버텍스 데이터는 이제 고성능 메모리에서 로드됩니다. 이것은 더 복잡한 지오메트리 렌더링을 시작할 때 중요합니다. 실제 응용 프로그램에서는 모든 개별 버퍼에 대해 실제로 vkAllocateMemory를 호출해서는 안 됩니다. 최대 동시 메모리 할당 수는 maxMemoryAllocationCount 물리적 장치 제한에 의해 제한되며 NVIDIA GTX 1080과 같은 고급 하드웨어에서도 4096개 만큼 낮을 수 있습니다. 동시에 많은 수의 오브젝트 렌더링을 위해 메모리를 할당하는 올바른 방법은 오프셋 매개변수를 사용하여 단일 할당을 여러 오브젝트로 분할하는 사용자 지정 할당자(allocator)를 만드는 것입니다. 이러한 할당자를 본인이 직접 구현하거나 GPUOpen initiative에서 제공하는 VulkanMemoryAllocator 라이브러리를 사용할 수도 있습니다. 그러나 이 자습서에서는 모든 리소스에 대해 별도의 버퍼 할당을 사용해도 괜찮습니다. 지금은 이러한 한계에 거의 도달하지 않을 것이기 때문입니다.
+        // 프로그램을 실행하여 익숙한 삼각형이 다시 표시되는지 확인합니다. 지금은 개선 사항이 보이지 않을 수 있지만 버텍스 데이터는 이제 고성능 메모리에서 로드됩니다. 이것은 더 복잡한 지오메트리 렌더링을 시작할 때 중요합니다. 실제 응용 프로그램에서는 모든 개별 버퍼에 대해 실제로 vkAllocateMemory를 호출해서는 안 됩니다. 최대 동시 메모리 할당 수는 maxMemoryAllocationCount 물리적 장치 제한에 의해 제한되며 NVIDIA GTX 1080과 같은 고급 하드웨어에서도 4096개 만큼 낮을 수 있습니다. 동시에 많은 수의 오브젝트 렌더링을 위해 메모리를 할당하는 올바른 방법은 오프셋 매개변수를 사용하여 단일 할당을 여러 오브젝트로 분할하는 사용자 지정 할당자(allocator)를 만드는 것입니다. 이러한 할당자를 본인이 직접 구현하거나 GPUOpen initiative에서 제공하는 VulkanMemoryAllocator 라이브러리를 사용할 수도 있습니다. 그러나 이 자습서에서는 모든 리소스에 대해 별도의 버퍼 할당을 사용해도 괜찮습니다. 지금은 이러한 한계에 거의 도달하지 않을 것이기 때문입니다. (이제는 MemoryAllocator 가 메모리 유형별 블록을 나누어 주므로 createBuffer 와 createImage 는 더 이상 리소스마다 vkAllocateMemory 를 호출하지 않습니다.)
     }
 
 
 
     // 2-19. 인덱스 버퍼 생성
     // createIndexBuffer 함수는 createVertexBuffer와 거의 동일합니다.
-    void createIndexBuffer()
+    void createIndexBuffer(const MeshAsset& asset, MeshResource& mesh)
     {
         // 눈에 띄는 차이점은 두 가지뿐입니다. bufferSize는 이제 인덱스 수에 인덱스 유형 크기를 곱한 값(uint16_t 또는 uint32_t)과 같습니다. indexBuffer의 사용법은 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT 대신 VK_BUFFER_USAGE_INDEX_BUFFER_BIT이어야 합니다. 이는 의미가 있습니다. 그 외에는 프로세스가 버텍스 버퍼 생성과 완전히 동일합니다. 인덱스 내용을 복사할 스테이징 버퍼를 만든 다음 최종 장치 로컬 인덱스 버퍼에 복사합니다.
-        VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        // 인덱스 크기는 메쉬마다 고른 indexSize (2 또는 4 바이트) 입니다.
+        mesh.indexSize = asset.indexSize;
+        mesh.indexType = CompactVertex::getIndexType(asset.indexSize);
+        mesh.indexCount = asset.indexCount;
+        mesh.cacheStats = asset.cacheStats;
+        VkDeviceSize bufferSize = VkDeviceSize(mesh.indexSize) * mesh.indexCount;
 
-        void* data;
-        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, indices.data(), (size_t)bufferSize);
-        vkUnmapMemory(device, stagingBufferMemory);
+        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.indexBuffer, mesh.indexBufferMemory);
 
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
+        uploadBuffer(mesh.indexBuffer, asset.indexData, bufferSize);
+        uploadContext.transferOwnership(mesh.indexBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
 
-        copyBuffer(stagingBuffer, indexBuffer, bufferSize);
-
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        // 데이터는 이미 스테이징 링에 복사되었으므로 업로드를 기록한 뒤에는 에셋(메쉬 캐시 매핑, 가공한 배열)을 바로 버려도 됩니다. (그리기에는 indexCount 와 indexType 만 사용합니다.)
     }
 
 
@@ -2329,13 +3369,18 @@ private:
     // 2-20. 유니폼 버퍼 생성
     inline void createUniformBuffers()
     {
-        VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+        // UBO 하나 크기가 아니라 한 프레임 동안 여러 오브젝트의 데이터를 담을 수 있는 크기로 만듭니다. 동적 오프셋은 minUniformBufferOffsetAlignment 의 배수여야 합니다.
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        uniformRing.init(MAX_FRAMES_IN_FLIGHT, UNIFORM_RING_BYTES_PER_FRAME, properties.limits.minUniformBufferOffsetAlignment);
 
         uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
         uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
 
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
+            // 호스트 일관성 메모리이므로 매 프레임 기록한 내용을 플러시할 필요가 없고, 할당기가 영구적으로 매핑해 둔 주소를 그대로 링 버퍼에 넘깁니다.
+            createBuffer(UNIFORM_RING_BYTES_PER_FRAME, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
+            uniformRing.setFrameStorage(static_cast<uint32_t>(i), uniformBuffers[i], uniformBuffersMemory[i].mappedData);
         }
     }
 
@@ -2347,12 +3392,8 @@ private:
         // 이전 장에 다룬 디스크립터 레이아웃은 바인딩할 수 있는 디스크립터의 유형을 설명합니다. 이 장에서 우리는 각각의 VkBuffer 자원에 대한 디스크립터 세트를 생성하여 이를 유니폼 버퍼 디스크립터에 바인딩할 것입니다. 디스크립터 세트는 직접 만들 수 없으며 명령 버퍼를 처리할때와 비슷하게 풀을 먼저 만들어 할당해야 합니다. 디스크립터 집합에 해당하는 것을 당연히 디스크립터 풀이라고 합니다. 우리는 그것을 설정하기 위해 새로운 함수 createDescriptorPool을 작성할 것입니다.
         
         // 먼저 VkDescriptorPoolSize 구조를 사용하여 디스크립터 세트에 포함될 디스크립터 유형과 그것이 몇 개인지 설명해야 합니다.
-        std::array<VkDescriptorPoolSize, 2> poolSizes{};
-        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-        // 또한 VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER 유형의 다른 VkPoolSize를 VkDescriptorPoolCreateInfo에 추가하여 결합된 이미지 샘플러 할당을 위한 공간을 만들기 위해 더 큰 디스크립터 풀을 만들어야 합니다. 이 디스크립터를 포함하도록 VkDescriptorPoolSize를 수정합니다.
-        poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        // 유형별 개수는 리플렉션한 셋 레이아웃의 바인딩을 프레임 수만큼 더한 값입니다. 셰이더에 바인딩이 늘거나 줄어도 여기를 고칠 필요가 없습니다.
+        std::vector<VkDescriptorPoolSize> poolSizes = pipelineLayoutDesc.getPoolSizes(static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
         // 불충분한 디스크립터 풀은 유효성 검사 계층이 포착하지 못하는 문제의 좋은 예입니다. Vulkan 1.1부터 vkAllocateDescriptorSets는 풀이 충분히 크지 않은 경우 오류 코드 VK_ERROR_POOL_OUT_OF_MEMORY와 함께 실패할 수 있지만 드라이버는 내부적으로 문제를 해결하려고 할 수도 있습니다. 이것은 때때로 (하드웨어, 풀 크기 및 할당 크기에 따라) 드라이버가 디스크립터 풀의 한계를 초과하는 할당을 허용할 수 있음을 의미합니다. 다른 경우에는 vkAllocateDescriptorSets를 실패하고 VK_ERROR_POOL_OUT_OF_MEMORY를 반환합니다. 할당이 일부 시스템에서는 성공하지만 다른 시스템에서는 실패하는 경우가 가능하므로 이 부분이 특히 혼란스러울 수 있습니다. Vulkan은 할당에 대한 책임을 드라이버에 전가하기 때문에 더 이상 특정 유형(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER 등)의 디스크립터를 디스크립터 풀 생성을 위해 해당 descriptorCount 멤버가 지정한 만큼만 할당해야 한다는 것은 엄격한 요구 사항이 아닙니다. 그러나 그렇게 하는 것이 모범적이며 Best Practice Validation 검증을 활성화 한 경우 VK_LAYER_KHRONOS_validation이 이러한 유형의 문제에 대해 경고해줄 것입니다.
 
         // 우리는 매 프레임마다 이러한 디스크립터들 중 하나를 할당하게 됩니다. 이 풀 크기 구조는 기본 VkDescriptorPoolCreateInfo에서 참조합니다.
@@ -2394,6 +3435,7 @@ private:
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
         {
             VkDescriptorBufferInfo bufferInfo{};
+            // 동적 유니폼 버퍼에서 range 는 셰이더가 한 번에 보는 크기이고, 실제 시작 위치는 바인딩할 때 넘기는 동적 오프셋이 offset 에 더해져 정해집니다.
             bufferInfo.buffer = uniformBuffers[i];
             bufferInfo.offset = 0;
             bufferInfo.range = sizeof(UniformBufferObject);
@@ -2401,36 +3443,47 @@ private:
             // 마지막 단계는 실제 이미지 및 샘플러 리소스를 디스크립터 세트 안의 디스크립터에 바인딩하는 것입니다.
             VkDescriptorImageInfo imageInfo{};
             imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            imageInfo.imageView = textureImageView;
+            imageInfo.imageView = texture.view;
             imageInfo.sampler = textureSampler;
 
-            // 이 경우처럼 전체 버퍼를 덮어쓰는 경우 범위에 대해 VK_WHOLE_SIZE 값을 사용할 수도 있습니다. 디스크립터의 구성은 VkWriteDescriptorSet 구조체의 배열을 매개변수로 사용하는 vkUpdateDescriptorSets 함수를 사용하여 업데이트 됩니다. 2개를 사용할 것이므로 배열로 만들어 설정합니다.
-            std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+            // 이 경우처럼 전체 버퍼를 덮어쓰는 경우 범위에 대해 VK_WHOLE_SIZE 값을 사용할 수도 있습니다. 디스크립터의 구성은 VkWriteDescriptorSet 구조체의 배열을 매개변수로 사용하는 vkUpdateDescriptorSets 함수를 사용하여 업데이트 됩니다. 셰이더가 쓰는 바인딩만큼 배열에 담아 설정합니다.
+            // 셰이더가 쓰지 않아 레이아웃에서 빠진 바인딩은 쓰지 않습니다.
+            std::vector<VkWriteDescriptorSet> descriptorWrites;
 
             // 유니폼 버퍼를 위한 디스크립터 세트를 설정합니다.
-            descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            // 처음 두 필드는 업데이트할 디스크립터 세트와 바인딩을 지정합니다. 유니폼 버퍼 바인딩 인덱스를 0으로 지정했습니다. 
-            descriptorWrites[0].dstSet = descriptorSets[i];
-            descriptorWrites[0].dstBinding = 0;
-            // 디스크립터는 배열이 될 수 있으므로 업데이트하려는 배열의 첫 번째 인덱스도 지정해야 합니다. 배열을 사용하지 않으므로 인덱스는 단순히 0입니다.
-            descriptorWrites[0].dstArrayElement = 0;
-            // 디스크립터의 유형을 다시 지정해야 합니다. 인덱스 dstArrayElement에서 시작하여 배열에서 한 번에 여러 디스크립터를 업데이트할 수 있습니다.
-            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            // descriptorCount 필드는 업데이트하려는 배열 요소의 수를 지정합니다.
-            descriptorWrites[0].descriptorCount = 1;
-            // 마지막 필드는 실제로 디스크립터를 구성하는 descriptorCount 구조체가 있는 배열을 참조합니다. 세 가지 중 실제로 사용해야 하는 디스크립터의 유형에 따라 다릅니다. pBufferInfo 필드는 버퍼 데이터를 참조하는 디스크립터에 사용되며 pImageInfo는 이미지 데이터를 참조하는 디스크립터에 사용되며 pTexelBufferView는 버퍼 뷰를 참조하는 디스크립터에 사용됩니다. 디스크립터는 버퍼를 기반으로 하므로 pBufferInfo를 사용합니다.
-            descriptorWrites[0].pBufferInfo = &bufferInfo;
-            descriptorWrites[0].pImageInfo = nullptr; // Optional
-            descriptorWrites[0].pTexelBufferView = nullptr; // Optional
+            if (const VkDescriptorSetLayoutBinding* uniformBinding = pipelineLayoutDesc.findBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC))
+            {
+                VkWriteDescriptorSet descriptorWrite{};
+                descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                // 처음 두 필드는 업데이트할 디스크립터 세트와 바인딩을 지정합니다. 바인딩 인덱스는 리플렉션한 레이아웃에서 찾습니다. 
+                descriptorWrite.dstSet = descriptorSets[i];
+                descriptorWrite.dstBinding = uniformBinding->binding;
+                // 디스크립터는 배열이 될 수 있으므로 업데이트하려는 배열의 첫 번째 인덱스도 지정해야 합니다. 배열을 사용하지 않으므로 인덱스는 단순히 0입니다.
+                descriptorWrite.dstArrayElement = 0;
+                // 디스크립터의 유형을 다시 지정해야 합니다. 인덱스 dstArrayElement에서 시작하여 배열에서 한 번에 여러 디스크립터를 업데이트할 수 있습니다.
+                descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+                // descriptorCount 필드는 업데이트하려는 배열 요소의 수를 지정합니다.
+                descriptorWrite.descriptorCount = 1;
+                // 마지막 필드는 실제로 디스크립터를 구성하는 descriptorCount 구조체가 있는 배열을 참조합니다. 세 가지 중 실제로 사용해야 하는 디스크립터의 유형에 따라 다릅니다. pBufferInfo 필드는 버퍼 데이터를 참조하는 디스크립터에 사용되며 pImageInfo는 이미지 데이터를 참조하는 디스크립터에 사용되며 pTexelBufferView는 버퍼 뷰를 참조하는 디스크립터에 사용됩니다. 디스크립터는 버퍼를 기반으로 하므로 pBufferInfo를 사용합니다.
+                descriptorWrite.pBufferInfo = &bufferInfo;
+                descriptorWrite.pImageInfo = nullptr; // Optional
+                descriptorWrite.pTexelBufferView = nullptr; // Optional
+                descriptorWrites.push_back(descriptorWrite);
+            }
 
             // 마찬가지로 두번째 디스크립터 세트도 동일한 방식으로 설정합니다. 결합된 이미지 샘플러 구조에 대한 리소스는 VkDescriptorBufferInfo 구조체에 유니폼 버퍼 디스크립터에 대한 버퍼 리소스가 지정된 것처럼 VkDescriptorImageInfo 구조체에 지정되어야 합니다. 디스크립터는 버퍼와 마찬가지로 이 이미지 정보로 업데이트되어야 합니다. 이번에는 pBufferInfo 대신 pImageInfo 배열을 사용합니다. 디스크립터는 이제 셰이더에서 사용할 준비가 되었습니다!
-            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[1].dstSet = descriptorSets[i];
-            descriptorWrites[1].dstBinding = 1;
-            descriptorWrites[1].dstArrayElement = 0;
-            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptorWrites[1].descriptorCount = 1;
-            descriptorWrites[1].pImageInfo = &imageInfo;
+            if (const VkDescriptorSetLayoutBinding* samplerBinding = pipelineLayoutDesc.findBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER))
+            {
+                VkWriteDescriptorSet descriptorWrite{};
+                descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                descriptorWrite.dstSet = descriptorSets[i];
+                descriptorWrite.dstBinding = samplerBinding->binding;
+                descriptorWrite.dstArrayElement = 0;
+                descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                descriptorWrite.descriptorCount = 1;
+                descriptorWrite.pImageInfo = &imageInfo;
+                descriptorWrites.push_back(descriptorWrite);
+            }
 
             // 업데이트는 vkUpdateDescriptorSets를 사용하여 적용됩니다. VkWriteDescriptorSet의 배열과 VkCopyDescriptorSet의 배열이라는 두 가지 종류의 배열을 매개변수로 받아들입니다. 후자는 이름에서 알 수 있듯이 디스크립터를 서로 복사하는 데 사용할 수 있습니다.
             vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
@@ -2438,7 +3491,7 @@ private:
     }
 
     // 다양한 버퍼를 생성하여 메모리를 할당할때 공통적으로 사용될 함수
-    HELPER_FUNCTION void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+    HELPER_FUNCTION void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& bufferMemory)
     {
         // 버퍼를 생성하려면 VkBufferCreateInfo 구조체를 채워야 합니다.
         VkBufferCreateInfo bufferInfo{};
@@ -2466,98 +3519,243 @@ private:
         VkMemoryRequirements memRequirements;
         vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-        // 이제 findMemoryType 를 통해 그래픽카드가 해당 메모리 타입을 지원하는지 확인하여 VkMemoryAllocateInfo 구조를 채워 메모리를 실제로 할당할 수 있습니다.
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        // 메모리 할당은 이제 버텍스 버퍼의 메모리 요구 사항과 원하는 속성에서 파생된 크기와 유형을 지정하는 것 만큼 간단합니다. 클래스 멤버를 만들어 핸들을 저장하고 vkAllocateMemory 로 메모리를 할당합니다.
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to allocate buffer memory!");
-        }
+        // 이제 findMemoryType 를 통해 그래픽카드가 해당 메모리 타입을 지원하는지 확인하고, 그 메모리 유형의 풀에서 요구 사항에 맞게 정렬된 구간을 할당받습니다. 풀에 남은 공간이 없을 때만 새 블록을 위해 vkAllocateMemory 가 호출됩니다.
+        bufferMemory = memoryAllocator.allocate(memRequirements, findMemoryType(memRequirements.memoryTypeBits, properties), true);
 
         // 메모리 할당이 성공했다면 이제 vkBindBufferMemory를 사용하여 이 메모리를 버퍼와 연결할 수 있습니다.
-        // 네 번째 매개변수는 메모리 영역 내의 오프셋입니다. 이 메모리는 이 버텍스 버퍼를 위해 특별히 할당되었기 때문에 오프셋은 단순히 0입니다. 오프셋이 0이 아닌 경우 memRequirements.alignment로 나눌 수 있어야 합니다.
-        vkBindBufferMemory(device, buffer, bufferMemory, 0);
+        // 네 번째 매개변수는 메모리 영역 내의 오프셋입니다. 블록 안에서 할당받은 구간의 시작 위치를 넘겨줍니다. 할당기가 memRequirements.alignment 에 맞춰 두었으므로 그대로 사용하면 됩니다.
+        vkBindBufferMemory(device, buffer, bufferMemory.memory, bufferMemory.offset);
     }
 
     // 한 버퍼에서 다른 버퍼로 내용을 복사하는 함수
-    HELPER_FUNCTION void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+    HELPER_FUNCTION void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset)
     {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        VkCommandBuffer commandBuffer = beginTransferCommands();
 
         // 버퍼의 내용은 vkCmdCopyBuffer 명령을 사용하여 전송됩니다. 소스 및 대상(목적지) 버퍼를 인수로 사용하고 복사할 영역 배열을 사용합니다. 영역은 VkBufferCopy 구조체에 정의되며 소스 버퍼 오프셋, 대상(목적지) 버퍼 오프셋 및 크기로 구성됩니다. vkMapMemory 명령과 달리 여기에선 copyRegion.size에 VK_WHOLE_SIZE를 지정할 수 없습니다.
         VkBufferCopy copyRegion{};
-        //copyRegion.srcOffset = 0; // Optional
-        //copyRegion.dstOffset = 0; // Optional
+        copyRegion.srcOffset = srcOffset;
+        copyRegion.dstOffset = dstOffset;
         copyRegion.size = size;
+        // 타임스탬프 슬롯은 그래픽 명령 버퍼에서 초기화되므로 복사가 전용 전송 큐에서 실행될 때는 측정하지 않습니다.
+        uint32_t copyScope = uploadContext.hasDedicatedTransfer() ? GpuProfiler::INVALID_SCOPE : gpuProfiler.beginScope(commandBuffer, "copyBuffer");
         vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-        endSingleTimeCommands(commandBuffer);
+        gpuProfiler.endScope(commandBuffer, copyScope);
     }
 
-    HELPER_FUNCTION VkCommandBuffer beginSingleTimeCommands()
+    // 업로드 배치의 그래픽 명령 버퍼를 돌려줍니다. 밉맵 생성, 셰이더 읽기용 레이아웃 전환처럼 그래픽 큐가 필요한 업로드 명령을 기록합니다.
+    // 예전에는 명령마다 일회성 명령 버퍼를 만들어 제출하고 vkQueueWaitIdle 로 큐가 빌 때까지 기다렸지만, 이제는 submitUploads 전까지 같은 배치에 모아 한 번에 제출합니다.
+    HELPER_FUNCTION VkCommandBuffer beginUploadCommands()
     {
-        // 이러한 함수의 코드는 copyBuffer에 있는 기존 코드를 기반으로 합니다. 이제 해당 기능을 다음과 같이 단순화할 수 있습니다. 메모리 전송 작업은 그리기 명령과 마찬가지로 명령 버퍼를 사용하여 실행됩니다. 따라서 반드시 먼저 임시 명령 버퍼를 먼저 할당해야 합니다. 또한 이러한 임시 명령 버퍼들을 위해 별도의 커맨드 풀을 만드는 것도 좋습니다. 이러한 구현이 메모리 할당 최적화를 적용할 수 있기 때문입니다. 이 경우 명령 풀 생성에 VK_COMMAND_POOL_CREATE_TRANSIENT_BIT 플래그를 사용하는 것이 좋습니다.
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool = commandPool;
-        allocInfo.commandBufferCount = 1;
-
-        VkCommandBuffer commandBuffer;
-        vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
-
-        // 이제 바로 커멘드 버퍼에 명령 기록을 시작합니다. 명령 버퍼를 한 번만 사용하고 복사 작업 실행이 완료되고 함수에서 리턴할때까지 기다리도록 합니다. VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT를 사용하여 불칸 드라이버에게 그 의도를 알리는 것이 좋습니다.
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-        vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-        return commandBuffer;
+        beginUploadBatch();
+        return uploadContext.getGraphicsCommandBuffer();
     }
 
-    HELPER_FUNCTION void endSingleTimeCommands(VkCommandBuffer commandBuffer)
+    // 업로드 배치의 전송 명령 버퍼를 돌려줍니다. 스테이징 버퍼에서의 복사를 기록하며, 전용 전송 큐가 있으면 렌더링과 겹쳐 실행됩니다.
+    // 여기서 쓴 리소스를 그래픽 큐에서 사용하려면 uploadContext.transferOwnership 으로 소유권을 넘겨야 합니다.
+    HELPER_FUNCTION VkCommandBuffer beginTransferCommands()
     {
-        // 이 명령 버퍼에는 복사 명령만 포함되어 있으므로 그 직후에 기록을 중지할 수 있습니다. 이제 명령 버퍼를 실행하여 전송을 완료합니다.
-        vkEndCommandBuffer(commandBuffer);
-
-        // 그리기 명령과 달리 이번에는 기다려야 하는 이벤트가 없습니다. 우리는 버퍼에서 즉시 전송을 실행하기를 원합니다. 이 전송이 완료될 때까지 기다리는 두 가지 가능한 방법이 있습니다. 울타리를 사용하고 vkwaitForFences로 기다리거나 단순히 vkQueueWaitIdle로 전송 대기열이 유휴 상태가 될 때까지 기다릴 수 있습니다. 울타리를 사용하면 한 번에 하나씩 실행하는 대신 여러 전송을 동시에 예약하고 모두 완료될 때까지 기다릴 수 있습니다. 이는 불칸 드라이버에게 최적화할 수 있는 더 많은 기회를 제공할 수 있습니다.
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer;
+        beginUploadBatch();
+        return uploadContext.getTransferCommandBuffer();
+    }
 
-        vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(graphicsQueue);
+    HELPER_FUNCTION void beginUploadBatch()
+    {
+        if (uploadContext.isRecording())
+        {
+            return;
+        }
 
-        // 전송 작업에 사용된 명령 버퍼를 정리하는 것을 잊지 마십시오.
-        vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+        // 새 배치를 시작합니다. 일회성 명령용 타임스탬프 슬롯은 하나뿐이므로, 앞서 측정한 배치의 결과를 아직 읽지 못했다면 이번 배치는 측정하지 않습니다.
+        // 쿼리 초기화(vkCmdResetQueryPool)는 전송 큐에서 할 수 없으므로 슬롯은 그래픽 명령 버퍼에서 엽니다.
+        collectUploads();
+        VkCommandBuffer commandBuffer = uploadContext.getGraphicsCommandBuffer();
+        uploadProfiling = uploadProfileToken.id == 0;
+        if (uploadProfiling)
+        {
+            gpuProfiler.beginSlot(commandBuffer, gpuProfiler.immediateSlot(), frameNumber);
+        }
     }
 
-    // 그래픽 카드는 할당할 다양한 유형의 메모리를 제공할 수 있습니다. 각 메모리 유형은 허용되는 작업 및 성능 특성 측면에서 다릅니다. 사용할 올바른 유형의 메모리를 찾으려면 버퍼의 요구 사항과 자체 응용 프로그램 요구 사항을 결합해야 합니다.이를 위해 새로운 함수 findMemoryType을 생성해 보겠습니다.
-    HELPER_FUNCTION uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+    // 기록 중인 업로드 배치를 펜스와 함께 제출합니다. 돌려받은 토큰으로 uploadContext.isComplete 로 확인하거나 waitUploads 로 기다릴 수 있습니다.
+    HELPER_FUNCTION UploadToken submitUploads()
     {
-        // 먼저 vkGetPhysicalDeviceMemoryProperties를 사용하여 사용 가능한 메모리 유형에 대한 정보를 설정해야 합니다.
-        VkPhysicalDeviceMemoryProperties memProperties;
-        // VkPhysicalDeviceMemoryProperties 구조에는 두 개의 배열 memoryTypes 및 memoryHeaps가 있습니다. 메모리 힙은 전용 VRAM 및 VRAM 이 부족할 때를 위한 RAM 의 스왑 공간과 같은 고유한 메모리 리소스입니다. 이러한 힙에는 다양한 유형의 메모리가 있습니다. 지금은 메모리 유형에만 관심이 있고 메모리가 가져온 힙에는 관심이 없지만 이것이 성능에 영향을 미칠 수 있다고 상상할 수 있습니다.
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-        // 먼저 버퍼 자체에 적합한 메모리 유형을 찾아보겠습니다.
-        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+        if (uploadContext.isRecording() == false)
         {
-            // typeFilter 매개변수는 적합한 메모리 유형의 비트 필드를 지정하는 데 사용됩니다. 즉, 단순히 연속적으로 해당 인덱스 번째의 비트가 1로 설정되어 있는지 찾아가며 적절한 메모리 유형의 인덱스를 찾을 수 있습니다. 그러나 버텍스 버퍼에 적합한 메모리 유형에만 관심이 있는 것은 아닙니다.또한 버텍스 데이터를 해당 메모리에 쓸 수 있어야 합니다. memoryTypes 배열은 각 메모리 유형의 힙 및 속성을 지정하는 VkMemoryType 구조체로 구성됩니다. 속성은 CPU 에서 메모리에 쓸 수 있도록 매핑할 수 있는 것과 같은 메모리의 특수 기능을 정의합니다.이 속성은 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT로 표시되지만 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT 속성도 사용해야 합니다. 메모리를 매핑할 때 그 이유를 알게 될 것입니다.
-            // 추가로 하나 이상의 원하는 속성이 있을 수 있으므로 비트 AND 의 결과가 0 이 아니라 원하는 속성 비트 필드와 같은지 확인해야 합니다. 필요한 모든 속성을 포함하는 버퍼에 적합한 메모리 유형이 있으면 해당 인덱스를 반환하고, 그렇지 않으면 예외를 throw 합니다.
-            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-            {
-                return i;
-            }
+            return UploadToken{};
         }
 
-        throw std::runtime_error("Failed to find suitable memory type!");
+        if (uploadProfiling)
+        {
+            gpuProfiler.endSlot();
+        }
+        UploadToken token = uploadContext.submit();
+        // 이 배치에서 읽는 스테이징 링 영역은 배치가 끝나야 다시 쓸 수 있습니다.
+        stagingRing.retire(token.id);
+        if (uploadProfiling)
+        {
+            uploadProfileToken = token;
+            uploadProfiling = false;
+        }
+        return token;
+    }
+
+    HELPER_FUNCTION void waitUploads(UploadToken token)
+    {
+        uploadContext.wait(token);
+        collectUploads();
+    }
+
+    // 끝난 업로드 배치를 정리하고(스테이징 링 영역 회수) 측정한 배치가 끝났으면 그 GPU 시간을 읽습니다. 기다리지 않으므로 매 프레임 호출해도 됩니다.
+    HELPER_FUNCTION void collectUploads()
+    {
+        uploadContext.collect();
+        stagingRing.reclaim(uploadContext.getCompletedId());
+        if (uploadProfileToken.id != 0 && uploadContext.isComplete(uploadProfileToken))
+        {
+            gpuProfiler.collectSlot(gpuProfiler.immediateSlot());
+            uploadProfileToken = UploadToken{};
+        }
+    }
+
+    // 스테이징 링에서 size 바이트의 영역을 받습니다. 링이 가득 찼으면 기록 중인 배치를 제출하고 가장 오래된 배치가 끝나 영역이 돌아올 때까지 기다립니다.
+    HELPER_FUNCTION StagingRing::Region allocateStaging(VkDeviceSize size)
+    {
+        StagingRing::Region region;
+        collectUploads();
+        while (stagingRing.allocate(size, region) == false)
+        {
+            submitUploads();
+            if (uploadContext.getPendingCount() == 0)
+            {
+                throw std::runtime_error("Staging ring is too small for the upload! (Increase --staging-mb)");
+            }
+            waitUploads(UploadToken{ uploadContext.getCompletedId() + 1 });
+        }
+        return region;
+    }
+
+    // 데이터를 스테이징 링을 거쳐 장치 로컬 버퍼의 처음부터 복사합니다. 링의 1/4 보다 큰 데이터는 조각으로 나누어, 앞 조각이 복사되는 동안 다음 조각을 채웁니다.
+    HELPER_FUNCTION void uploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size)
+    {
+        const char* source = static_cast<const char*>(data);
+        for (VkDeviceSize offset = 0; offset < size;)
+        {
+            VkDeviceSize chunkSize = std::min(size - offset, stagingRing.getMaxChunkSize());
+            StagingRing::Region region = allocateStaging(chunkSize);
+            memcpy(region.data, source + offset, static_cast<size_t>(chunkSize));
+            copyBuffer(stagingRing.getBuffer(), dstBuffer, chunkSize, region.offset, offset);
+            offset += chunkSize;
+        }
+    }
+
+    // 빽빽하게 채워진 픽셀을 스테이징 링을 거쳐 이미지의 밉 레벨 mipLevel 로 복사합니다. 이미지는 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL 이어야 합니다.
+    // 압축 형식은 blockExtent x blockExtent 텍셀 블록(blockSize 바이트)의 행 단위로, 압축하지 않은 형식은 blockExtent = 1, blockSize = 텍셀 크기로 나눕니다.
+    // 링의 1/4 보다 큰 이미지는 행 단위 조각으로 나눕니다. 조각의 행 수는 복사하는 큐의 minImageTransferGranularity 높이의 배수로 맞춥니다.
+    HELPER_FUNCTION void uploadImage(VkImage image, uint32_t mipLevel, const void* pixels, uint32_t width, uint32_t height, uint32_t blockExtent, uint32_t blockSize)
+    {
+        // 행 수와 입도는 모두 블록 단위입니다. (압축 형식의 minImageTransferGranularity 는 블록 단위로 주어집니다.)
+        const uint32_t blockRows = (height + blockExtent - 1) / blockExtent;
+        VkDeviceSize rowSize = VkDeviceSize((width + blockExtent - 1) / blockExtent) * blockSize;
+        uint32_t maxRows = static_cast<uint32_t>(std::min<VkDeviceSize>(blockRows, stagingRing.getMaxChunkSize() / rowSize));
+        if (transferGranularity.width == 0)
+        {
+            // 입도가 (0, 0, 0) 인 큐는 밉 레벨 전체만 한 번에 복사할 수 있습니다.
+            maxRows = blockRows;
+        }
+        else if (maxRows < blockRows)
+        {
+            maxRows = std::max(maxRows / transferGranularity.height * transferGranularity.height, transferGranularity.height);
+        }
+        if (rowSize * maxRows > stagingRing.getCapacity())
+        {
+            throw std::runtime_error("Staging ring is too small for the image upload! (Increase --staging-mb)");
+        }
+
+        const char* source = static_cast<const char*>(pixels);
+        for (uint32_t row = 0; row < blockRows;)
+        {
+            uint32_t rows = std::min(maxRows, blockRows - row);
+            StagingRing::Region region = allocateStaging(rowSize * rows);
+            memcpy(region.data, source + rowSize * row, static_cast<size_t>(rowSize * rows));
+            // 이미지 영역은 텍셀 단위입니다. 마지막 조각은 레벨 끝에서 자릅니다.
+            copyBufferToImage(stagingRing.getBuffer(), image, mipLevel, width, std::min(rows * blockExtent, height - row * blockExtent), region.offset, row * blockExtent);
+            row += rows;
+        }
+    }
+
+    // 밉 체인의 레벨들을 스테이징 링의 한 영역에 담아, 레벨마다 영역(region)을 둔 vkCmdCopyBufferToImage 한 번으로 복사합니다. 이미지는 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL 이어야 합니다.
+    // 레벨들을 링 조각 크기까지 한 번의 복사로 묶고, 조각 하나보다 큰 레벨은 uploadImage 로 행 단위 조각으로 나누어 복사합니다. 레벨 전체를 복사하므로 전송 입도의 제약을 받지 않습니다.
+    // 레벨은 어디에 있든(밉 체인 배열, 매핑된 KTX2 파일) 스테이징 영역으로 바로 복사하므로, 메모리에 이어져 있거나 큰 레벨부터 놓여 있을 필요가 없습니다.
+    HELPER_FUNCTION void uploadMipChain(VkImage image, const MipBuilder::MipChainView& mips)
+    {
+        // 영역 안의 레벨 시작 위치는 bufferOffset 규칙(텍셀 / 블록 크기와 4 의 배수)을 만족하도록 MIP_BUILDER_LEVEL_ALIGNMENT 에 맞춥니다.
+        auto alignLevel = [](VkDeviceSize size) { return (size + MIP_BUILDER_LEVEL_ALIGNMENT - 1) & ~VkDeviceSize(MIP_BUILDER_LEVEL_ALIGNMENT - 1); };
+        const VkDeviceSize maxChunkSize = stagingRing.getMaxChunkSize();
+        std::vector<VkBufferImageCopy> regions;
+        for (size_t first = 0; first < mips.levels.size();)
+        {
+            if (mips.levels[first].size > maxChunkSize)
+            {
+                uploadImage(image, static_cast<uint32_t>(first), mips.levels[first].data, mips.levels[first].width, mips.levels[first].height, getBlockExtent(mips.format), getBlockSize(mips.format));
+                first++;
+                continue;
+            }
+
+            // first 부터 한 조각에 들어가는 레벨까지 묶습니다.
+            VkDeviceSize size = mips.levels[first].size;
+            size_t last = first + 1;
+            while (last < mips.levels.size() && alignLevel(size) + mips.levels[last].size <= maxChunkSize)
+            {
+                size = alignLevel(size) + mips.levels[last].size;
+                last++;
+            }
+            StagingRing::Region region = allocateStaging(size);
+
+            regions.clear();
+            VkDeviceSize offset = 0;
+            for (size_t level = first; level < last; level++)
+            {
+                memcpy(static_cast<char*>(region.data) + offset, mips.levels[level].data, mips.levels[level].size);
+
+                VkBufferImageCopy copy{};
+                copy.bufferOffset = region.offset + offset;
+                copy.bufferRowLength = 0;
+                copy.bufferImageHeight = 0;
+                copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                copy.imageSubresource.mipLevel = static_cast<uint32_t>(level);
+                copy.imageSubresource.baseArrayLayer = 0;
+                copy.imageSubresource.layerCount = 1;
+                copy.imageOffset = { 0, 0, 0 };
+                copy.imageExtent = { mips.levels[level].width, mips.levels[level].height, 1 };
+                regions.push_back(copy);
+                offset = alignLevel(offset + mips.levels[level].size);
+            }
+            vkCmdCopyBufferToImage(beginTransferCommands(), stagingRing.getBuffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+            first = last;
+        }
+    }
+
+    // 그래픽 카드는 할당할 다양한 유형의 메모리를 제공할 수 있습니다. 각 메모리 유형은 허용되는 작업 및 성능 특성 측면에서 다릅니다. 사용할 올바른 유형의 메모리를 찾으려면 버퍼의 요구 사항과 자체 응용 프로그램 요구 사항을 결합해야 합니다.이를 위해 새로운 함수 findMemoryType을 생성해 보겠습니다.
+    HELPER_FUNCTION uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+    {
+        // 먼저 vkGetPhysicalDeviceMemoryProperties를 사용하여 사용 가능한 메모리 유형에 대한 정보를 설정해야 합니다.
+        VkPhysicalDeviceMemoryProperties memProperties;
+        // VkPhysicalDeviceMemoryProperties 구조에는 두 개의 배열 memoryTypes 및 memoryHeaps가 있습니다. 메모리 힙은 전용 VRAM 및 VRAM 이 부족할 때를 위한 RAM 의 스왑 공간과 같은 고유한 메모리 리소스입니다. 이러한 힙에는 다양한 유형의 메모리가 있습니다. 지금은 메모리 유형에만 관심이 있고 메모리가 가져온 힙에는 관심이 없지만 이것이 성능에 영향을 미칠 수 있다고 상상할 수 있습니다.
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+        // 먼저 버퍼 자체에 적합한 메모리 유형을 찾아보겠습니다.
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+        {
+            // typeFilter 매개변수는 적합한 메모리 유형의 비트 필드를 지정하는 데 사용됩니다. 즉, 단순히 연속적으로 해당 인덱스 번째의 비트가 1로 설정되어 있는지 찾아가며 적절한 메모리 유형의 인덱스를 찾을 수 있습니다. 그러나 버텍스 버퍼에 적합한 메모리 유형에만 관심이 있는 것은 아닙니다.또한 버텍스 데이터를 해당 메모리에 쓸 수 있어야 합니다. memoryTypes 배열은 각 메모리 유형의 힙 및 속성을 지정하는 VkMemoryType 구조체로 구성됩니다. 속성은 CPU 에서 메모리에 쓸 수 있도록 매핑할 수 있는 것과 같은 메모리의 특수 기능을 정의합니다.이 속성은 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT로 표시되지만 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT 속성도 사용해야 합니다. 메모리를 매핑할 때 그 이유를 알게 될 것입니다.
+            // 추가로 하나 이상의 원하는 속성이 있을 수 있으므로 비트 AND 의 결과가 0 이 아니라 원하는 속성 비트 필드와 같은지 확인해야 합니다. 필요한 모든 속성을 포함하는 버퍼에 적합한 메모리 유형이 있으면 해당 인덱스를 반환하고, 그렇지 않으면 예외를 throw 합니다.
+            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+            {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("Failed to find suitable memory type!");
     }
 
 
@@ -2623,40 +3821,635 @@ private:
         // 사용할 동기화 프리미티브가 두 개 있고 동기화를 적용할 두 곳이 있습니다. 스왑체인 작업과 이전 프레임이 완료되기를 기다리는 것입니다. GPU에서 발생하기 때문에 스왑체인 작업에 세마포어를 사용하고 싶습니다. 따라서 우리가 도울 수만 있다면 호스트가 기다리게 만들고 싶지 않습니다. 이전 프레임이 끝날 때까지 기다리기 위해 반대 이유로 울타리를 사용하려고 합니다. 호스트가 기다려야 하기 때문입니다. 이것은 한 번에 하나 이상의 프레임을 그리지 않도록 하기 위한 것입니다. 매 프레임마다 커맨드 버퍼를 다시 기록하기 때문에 현재 프레임의 실행이 완료될 때까지 다음 프레임의 작업을 커맨드 버퍼에 기록할 수 없습니다. GPU 가 연산하는 동안 커맨드 버퍼에 새로운 내용을 덮어쓰고 싶지 않기 때문입니다.
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
         {
-            if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-                vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
-            {
-                throw std::runtime_error("Failed to create synchronization objects for a frame!");
-            }
+            if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
+                vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
+                vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create synchronization objects for a frame!");
+            }
+        }
+
+    }
+
+    // 2-25. 구간별 GPU 시간 측정기 생성
+    inline void createGpuProfiler()
+    {
+        // 프레임 구간과 업로드 구간 모두 그래픽 큐에서 실행되므로 그래픽 큐 패밀리의 타임스탬프 지원 여부를 사용합니다.
+        QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+        gpuProfiler.init(physicalDevice, device, indices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT);
+
+        if (gpuProfiler.isEnabled() == false)
+        {
+            std::cout << "@ [INFO] : Timestamp queries are not supported on the graphics queue. GPU times will not be reported.\n";
+        }
+    }
+
+
+
+    // 2-26. 디바이스 메모리 할당기 생성
+    inline void createMemoryAllocator()
+    {
+        memoryAllocator.init(physicalDevice, device, options.allocatorStrategy);
+    }
+
+
+
+    // 2-29. 리소스 캐시 준비
+    // 텍스쳐는 쓰지 않게 된 뒤에도 --texture-cache-mb 까지, 샘플러는 SAMPLER_CACHE_MAX_UNUSED 개까지 남겨 두었다가 가장 오래 쓰지 않은 것부터 지웁니다.
+    inline void createResourceCaches()
+    {
+        textureCache.init(uint64_t(options.textureCacheMiB) << 20, SIZE_MAX, [this](TextureResource& resource) { destroyTexture(resource); });
+        samplerCache.init(UINT64_MAX, SAMPLER_CACHE_MAX_UNUSED, [this](VkSampler& sampler) { vkDestroySampler(device, sampler, nullptr); });
+    }
+
+
+
+    // 2-30. 파이프라인 캐시 준비
+    // 지난 실행에서 저장한 캐시가 이 장치와 드라이버의 것이면 불러오고, 아니면 빈 캐시로 시작합니다. 종료할 때(cleanup) 저장합니다.
+    inline void createPipelineCache()
+    {
+        PipelineCacheStatus status = pipelineCache.init(physicalDevice, device, PIPELINE_CACHE_PATH, options.pipelineCache);
+        if (status == PipelineCacheStatus::Loaded)
+        {
+            std::cout << "@ [INFO] : Pipeline cache loaded from " << PIPELINE_CACHE_PATH << " (" << pipelineCache.getLoadedSize() / 1024 << " KiB)\n";
+        }
+        else if (status == PipelineCacheStatus::Corrupt || status == PipelineCacheStatus::Mismatch)
+        {
+            std::cout << "@ [WARNING] : Pipeline cache " << PIPELINE_CACHE_PATH << " ignored (" << toString(status) << "), starting with an empty cache\n";
+        }
+    }
+
+
+
+    // 2-31. 파이프라인 레지스트리 준비
+    // 작업 스레드가 compileGraphicsPipeline 으로 파이프라인 변형을 컴파일합니다. 컴파일 결과는 메인 스레드에서 updateAssets 가 반영합니다.
+    inline void createPipelineRegistry()
+    {
+        pipelineRegistry.init(device, PIPELINE_COMPILER_THREADS, [this](const GraphicsPipelineDesc& desc) { return compileGraphicsPipeline(desc); });
+    }
+
+
+
+    // 2-27. 업로드 컨텍스트 생성
+    inline void createUploadContext()
+    {
+        // 복사는 전용 전송 큐에서 렌더링과 겹쳐 실행하고, 밉맵 생성(vkCmdBlitImage)처럼 그래픽 큐가 필요한 작업은 소유권을 넘겨받은 뒤 그래픽 큐에서 실행합니다.
+        QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+        uint32_t transferFamily = indices.transferFamily.value_or(indices.graphicsFamily.value());
+        uploadContext.init(device, graphicsQueue, indices.graphicsFamily.value(), transferQueue, transferFamily);
+
+        if (uploadContext.hasDedicatedTransfer())
+        {
+            std::cout << "@ [INFO] : Uploading through dedicated transfer queue family " << transferFamily << "\n";
+        }
+        else
+        {
+            std::cout << "@ [INFO] : No dedicated transfer queue family. Uploading through the graphics queue.\n";
+        }
+
+        // 이미지를 조각으로 나누어 복사할 때 지켜야 하는 전송 입도. 그래픽 큐는 항상 (1, 1, 1) 입니다.
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+        transferGranularity = queueFamilies[transferFamily].minImageTransferGranularity;
+
+        // 모든 업로드가 나누어 쓸 스테이징 링 버퍼를 만듭니다. 호스트에서 볼 수 있는 블록은 할당기가 매핑해 두므로 프로그램이 끝날 때까지 같은 주소로 씁니다.
+        // 버퍼 -> 이미지 복사의 bufferOffset 은 텍셀 크기와 4 의 배수여야 하므로 영역은 16 바이트와 optimalBufferCopyOffsetAlignment 중 큰 값에 맞춥니다.
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        VkDeviceSize stagingSize = VkDeviceSize(options.stagingRingMiB) * 1024 * 1024;
+        createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingRingBuffer, stagingRingMemory);
+        stagingRing.init(stagingRingBuffer, stagingRingMemory.mappedData, stagingSize, std::max<VkDeviceSize>(16, properties.limits.optimalBufferCopyOffsetAlignment));
+        std::cout << "@ [INFO] : Staging ring : " << options.stagingRingMiB << " MiB\n";
+    }
+
+
+
+    // 2-28. 자리표시 텍스쳐와 메쉬 생성
+    // 백그라운드 로드가 끝날 때까지 그릴 1x1 흰색 텍스쳐와 두 겹의 사각형(vertices_sample, indices_sample)을 만듭니다. 몇 바이트뿐이므로 초기화를 늦추지 않습니다.
+    inline void createPlaceholderAssets()
+    {
+        const stbi_uc whitePixel[4] = { 255, 255, 255, 255 };
+        MipBuilder::MipChain whiteTexture;
+        MipBuilder::build(whitePixel, 1, 1, 0, whiteTexture);
+        createCachedTexture(TextureKey{ "<placeholder>", hashBytes(whitePixel, sizeof(whitePixel)), 0 }, whiteTexture.getView(), texture);
+
+        MeshAsset placeholder;
+        placeholder.layout = Vertex::getFloatLayout();
+        placeholder.vertexData = reinterpret_cast<const uint8_t*>(vertices_sample.data());
+        placeholder.vertexCount = static_cast<uint32_t>(vertices_sample.size());
+        placeholder.indexData = indices_sample.data();
+        placeholder.indexSize = sizeof(uint16_t);
+        placeholder.indexCount = static_cast<uint32_t>(indices_sample.size());
+        placeholder.cacheStats = MeshOptimizer::analyzeVertexCache(indices_sample.data(), placeholder.indexCount, placeholder.vertexCount);
+        CompactVertex::getPositionBounds(placeholder.layout, placeholder.vertexData, placeholder.vertexCount, placeholder.boundsMin, placeholder.boundsMax);
+        createVertexBuffer(placeholder, mesh);
+        createIndexBuffer(placeholder, mesh);
+    }
+
+
+
+    // 3. 계속해서 매 프레임 렌더
+    inline void mainLoop()
+    {
+        // 사용자가 창을 닫을 때까지는 계속 이벤트 처리를 하면서 루프를 돕니다.
+        while (!glfwWindowShouldClose(window))
+        {
+            // GLFW 윈도우 이벤트를 처리합니다.
+            glfwPollEvents();
+
+            // 계속해서 매 프레임 삼각형을 그립니다.
+            // 크게 Vulkan에서 프레임을 렌더링하는 것은 다음과 같은 공통 단계로 구성됩니다.
+            // 1) 이전 프레임이 완료될 때까지 기다립니다.
+            // 2) 스왑 체인에서 이미지를 획득합니다.
+            // 3) 해당 이미지에 장면을 그리는 커맨드 버퍼를 기록합니다.
+            // 4) 기록된 커맨드 버퍼를 제출합니다.
+            // 5) 스왑 체인 이미지를 제시합니다.
+            // 이후 장에서 그리기 기능을 확장할 것이지만 지금은 이것이 렌더 루프의 핵심입니다.
+            drawFrame();
+        }
+
+        // drawFrame의 모든 작업은 비동기식임을 기억하십시오. 이는 mainLoop에서 루프를 종료할 때 그리기 및 프레젠테이션 작업이 계속 진행 중일 수 있음을 의미합니다. 그런 일이 일어나는 동안 리소스를 정리하는 것은 나쁜 생각입니다. 이 문제를 해결하려면 mainLoop를 종료하고 창을 파괴하기 전에 추상적 장치가 작업을 완료할 때까지 기다려야 합니다. vkQueueWaitIdle을 사용하여 특정 명령 대기열의 작업이 완료될 때까지 기다릴 수도 있습니다. 이러한 기능은 동기화를 수행하는 매우 기본적인 방법으로 사용할 수 있습니다. 이제 창을 닫을 때 문제 없이 프로그램이 종료되는 것을 볼 수 있습니다.
+        vkDeviceWaitIdle(device);
+
+        // 최근 프레임들의 구간별 GPU 시간 통계를 출력합니다.
+        gpuProfiler.printStats(std::cout, "@ [INFO] : GPU ");
+
+        // 텍스쳐 / 샘플러 캐시의 항목별 메모리 사용량을 출력합니다.
+        textureCache.printStats(std::cout, "@ [INFO] : ", "Texture");
+        samplerCache.printStats(std::cout, "@ [INFO] : ", "Sampler");
+    }
+
+    // 3. (헤드리스 모드) 정해진 프레임 수만큼 렌더링하면서 프레임별 CPU / GPU 시간을 측정하고 출력합니다.
+    inline void benchmarkLoop()
+    {
+        // 자리표시 리소스를 그린 프레임이 통계에 섞이지 않도록, 백그라운드 로드한 에셋을 그리기 시작할 때까지는 측정하지 않고 렌더링만 합니다.
+        uint32_t warmupFrames = 0;
+        while (assetsReady == false)
+        {
+            drawFrame();
+            warmupFrames++;
+        }
+        std::cout << "@ [BENCH] Assets ready after " << warmupFrames << " warm-up frames\n";
+
+        std::vector<double> cpuFrameTimes(options.benchmarkFrames);
+        gpuFrameTimes.assign(options.benchmarkFrames, -1.0);
+        benchmarkFirstFrame = frameNumber;
+
+        auto benchmarkStart = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < options.benchmarkFrames; i++)
+        {
+            // CPU 시간은 drawFrame() 한 번에 걸린 시간입니다. 이전 프레임을 기다리는 펜스 대기 시간도 포함되므로 GPU 가 병목이면 CPU 시간도 함께 늘어납니다.
+            auto frameStart = std::chrono::high_resolution_clock::now();
+            drawFrame();
+            auto frameEnd = std::chrono::high_resolution_clock::now();
+            cpuFrameTimes[i] = std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+        }
+        vkDeviceWaitIdle(device);
+        auto benchmarkEnd = std::chrono::high_resolution_clock::now();
+
+        // 아직 읽지 않은 마지막 프레임들의 GPU 시간을 모두 수거합니다. (vkDeviceWaitIdle 이후이므로 결과가 준비되어 있습니다.)
+        for (uint32_t slot = 0; slot < MAX_FRAMES_IN_FLIGHT; slot++)
+        {
+            collectFrameTimestamps(slot);
+        }
+
+        // 자동화된 실행에서 쉽게 파싱할 수 있도록 CSV 형식으로 출력합니다.
+        std::cout << "@ [BENCH] frame,cpu_ms,gpu_ms\n";
+        for (uint32_t i = 0; i < options.benchmarkFrames; i++)
+        {
+            std::cout << i << ',' << cpuFrameTimes[i] << ',';
+            if (gpuFrameTimes[i] >= 0.0)
+            {
+                std::cout << gpuFrameTimes[i];
+            }
+            std::cout << '\n';
+        }
+
+        // 요약 통계를 출력합니다.
+        static auto printSummary = [](const char* name, std::vector<double> values)
+        {
+            values.erase(std::remove_if(values.begin(), values.end(), [](double v) { return v < 0.0; }), values.end());
+            if (values.empty())
+            {
+                std::cout << "@ [BENCH] " << name << " : n/a\n";
+                return;
+            }
+            std::sort(values.begin(), values.end());
+            double sum = 0.0;
+            for (double v : values)
+            {
+                sum += v;
+            }
+            size_t p99Index = std::min(values.size() - 1, static_cast<size_t>(values.size() * 0.99));
+            std::cout << "@ [BENCH] " << name << " : min " << values.front() << " ms, avg " << sum / values.size() << " ms, p99 " << values[p99Index] << " ms, max " << values.back() << " ms\n";
+        };
+        double totalSeconds = std::chrono::duration<double>(benchmarkEnd - benchmarkStart).count();
+        std::cout << "@ [BENCH] " << options.benchmarkFrames << " frames at " << swapChainExtent.width << "x" << swapChainExtent.height << " in " << totalSeconds << " s (" << options.benchmarkFrames / totalSeconds << " fps)\n";
+        printSummary("CPU drawFrame", cpuFrameTimes);
+        printSummary("GPU frame", gpuFrameTimes);
+
+        // 구간별 GPU 시간 (최근 프레임들 기준)
+        gpuProfiler.printStats(std::cout, "@ [BENCH] GPU ");
+        std::cout << "@ [BENCH] Mesh " << (options.optimizeMesh ? "optimized" : "not optimized") << " : ACMR " << mesh.cacheStats.acmr << ", ATVR " << mesh.cacheStats.atvr << ", vertex stride " << mesh.layout.stride << " bytes, index size " << mesh.indexSize << " bytes\n";
+        std::cout << "@ [BENCH] Texture " << toString(texture.format) << " : " << texture.mipLevels << " levels, " << texture.byteSize / 1024 << " KiB\n";
+        memoryAllocator.printStats(std::cout, "@ [BENCH] ");
+        std::cout << "@ [BENCH] Pipeline cache : " << toString(pipelineCache.getStatus()) << "\n";
+        pipelineRegistry.printStats(std::cout, "@ [BENCH] ");
+        layoutCache.printStats(std::cout, "@ [BENCH] ");
+        textureCache.printStats(std::cout, "@ [BENCH] ", "Texture");
+        samplerCache.printStats(std::cout, "@ [BENCH] ", "Sampler");
+    }
+
+    // 프레임 슬롯에 기록된 구간별 GPU 시간을 읽어 통계에 추가하고, 프레임 전체 시간은 벤치마크용 gpuFrameTimes 에도 저장합니다. 해당 슬롯의 펜스를 기다린 이후에만 호출하므로 결과를 기다리며 멈추지 않습니다.
+    HELPER_FUNCTION void collectFrameTimestamps(uint32_t slot)
+    {
+        for (const GpuProfiler::ScopeResult& result : gpuProfiler.collectSlot(slot))
+        {
+            if (std::strcmp(result.name, "Frame") == 0 && result.frameId >= benchmarkFirstFrame && result.frameId - benchmarkFirstFrame < gpuFrameTimes.size())
+            {
+                gpuFrameTimes[result.frameId - benchmarkFirstFrame] = result.milliseconds;
+            }
+        }
+    }
+
+    // 프레임 사이에 백그라운드 로드 결과를 반영합니다. 현재 프레임 슬롯의 펜스를 기다린 뒤, 명령 버퍼를 기록하기 전에 호출합니다.
+    HELPER_FUNCTION void updateAssets()
+    {
+        // 작업 스레드에서 끝난 에셋의 버퍼 / 이미지를 만들고 업로드를 제출합니다. 작업 스레드에서 던진 예외도 여기서 다시 던져집니다.
+        assetLoader.dispatchCompleted();
+        // 컴파일이 끝난 파이프라인도 반영합니다.
+        try
+        {
+            pipelineRegistry.update();
+        }
+        catch (const PipelineCompileError& error)
+        {
+            // 핫 리로드한 셰이더로 지금 메쉬의 파이프라인을 만들지 못했으면 프레임 루프를 멈추지 않고 예전 셰이더와 파이프라인으로 되돌립니다.
+            if (shaderPipelinePending == false || (error.desc == getPipelineDesc(mesh.layout)) == false)
+            {
+                throw;
+            }
+            cancelShaderReload(error.what());
+        }
+        updateShaderReload();
+
+        // 업로드 배치가 끝난 리소스만 그리기에 씁니다. 제출 직후에 바꾸어도 배치 끝의 배리어가 순서를 보장하지만, 그러면 이번 프레임이 그래픽 큐에서 업로드를 기다리게 되므로 그동안은 자리표시 리소스로 계속 그립니다.
+        if (pendingTexture.image != VK_NULL_HANDLE && uploadContext.isComplete(pendingTextureToken))
+        {
+            publishTexture();
+        }
+        // 메쉬는 그 버텍스 형식의 파이프라인도 준비되어야 바꿉니다. 컴파일 중이면 이전 메쉬와 그 파이프라인으로 계속 그리므로 이 스레드에서 컴파일을 기다리지 않습니다.
+        if (pendingMesh.vertexBuffer != VK_NULL_HANDLE && uploadContext.isComplete(pendingMeshToken))
+        {
+            VkPipeline pipeline = pipelineRegistry.request(getPipelineDesc(pendingMesh.layout), getPipelineLabel(pendingMesh.layout));
+            if (pipeline != VK_NULL_HANDLE)
+            {
+                publishMesh(pipeline);
+            }
+            else
+            {
+                pipelineWaitFrames++;
+            }
+        }
+
+        updateTextureStreaming();
+
+        // 이 프레임 슬롯의 디스크립터 셋이 예전 텍스쳐를 가리키면 새 텍스쳐로 고칩니다. 슬롯의 펜스를 기다렸으므로 이 디스크립터 셋을 읽는 명령은 실행 중이 아닙니다.
+        if (descriptorTextureGenerations[currentFrame] != textureGeneration)
+        {
+            updateTextureDescriptor(currentFrame);
+        }
+
+        // 펜스를 기다린 이 슬롯의 프레임까지, 즉 마지막 MAX_FRAMES_IN_FLIGHT - 1 개를 뺀 프레임들은 끝났으므로 그 프레임들이 쓰던 리소스를 해제합니다.
+        const uint64_t framesStillInFlight = MAX_FRAMES_IN_FLIGHT - 1;
+        deletionQueue.flush(frameNumber > framesStillInFlight ? frameNumber - framesStillInFlight : 0);
+
+        if (assetsReady == false && assetLoader.getPendingCount() == 0 && pendingTexture.image == VK_NULL_HANDLE && pendingMesh.vertexBuffer == VK_NULL_HANDLE)
+        {
+            assetsReady = true;
+            double readyMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - initStartTime).count();
+            std::cout << "@ [INFO] : Assets ready " << readyMs << " ms after start (frame " << frameNumber << ")\n";
+        }
+    }
+
+    // 셰이더 핫 리로드 : 감시하는 소스가 바뀌면 작업 스레드에서 다시 컴파일하고, 새 셰이더로 지금 메쉬의 파이프라인이 준비되면 바꿉니다.
+    // 컴파일하는 동안에는 예전 파이프라인으로 계속 그리고, 컴파일에 실패하면 오류를 출력한 뒤 예전 셰이더를 그대로 씁니다.
+    HELPER_FUNCTION void updateShaderReload()
+    {
+        if (shaderPipelinePending)
+        {
+            VkPipeline pipeline = pipelineRegistry.request(getPipelineDesc(mesh.layout), getPipelineLabel(mesh.layout));
+            if (pipeline == VK_NULL_HANDLE)
+            {
+                return;
+            }
+            graphicsPipeline = pipeline;
+            shaderPipelinePending = false;
+
+            // 예전 셰이더로 만든 파이프라인은 지금 실행 중인 프레임들이 끝난 뒤에 지웁니다.
+            releaseShaders(previousVertShaderModule, previousFragShaderModule);
+            double reloadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - shaderChangeTime).count();
+            std::cout << "@ [INFO] : Shaders reloaded, pipeline swapped " << reloadMs << " ms after the change\n";
+            return;
+        }
+
+        if (shaderCompilePending || shaderWatcher.poll() == false)
+        {
+            return;
+        }
+        shaderCompilePending = true;
+        shaderChangeTime = std::chrono::high_resolution_clock::now();
+
+        // 셰이더 컴파일은 Vulkan 이 필요 없으므로 에셋 로더의 작업 스레드에서 실행합니다. 소스는 둘 다 다시 읽지만 바뀌지 않은 쪽은 SPIR-V 캐시를 읽습니다.
+        assetLoader.enqueue([this]() -> AssetLoader::Publish
+        {
+            auto vertShader = std::make_shared<CompiledShader>();
+            auto fragShader = std::make_shared<CompiledShader>();
+            const bool vertCompiled = shaderLibrary.compile(vertShaderSource, *vertShader);
+            const bool fragCompiled = shaderLibrary.compile(fragShaderSource, *fragShader);
+            return [this, vertShader, fragShader, vertCompiled, fragCompiled]()
+            {
+                publishShaders(*vertShader, vertCompiled, *fragShader, fragCompiled);
+            };
+        });
+    }
+
+    // 다시 컴파일한 셰이더로 지금 메쉬의 파이프라인 컴파일을 시작합니다. 파이프라인이 준비되면 updateShaderReload 가 바꿉니다.
+    HELPER_FUNCTION void publishShaders(const CompiledShader& vertShader, bool vertCompiled, const CompiledShader& fragShader, bool fragCompiled)
+    {
+        shaderCompilePending = false;
+
+        // 새로 #include 한 파일도 감시합니다.
+        std::vector<std::string> dependencies = vertShader.dependencies;
+        dependencies.insert(dependencies.end(), fragShader.dependencies.begin(), fragShader.dependencies.end());
+        shaderWatcher.watch(dependencies);
+
+        if (vertCompiled == false || fragCompiled == false)
+        {
+            std::cout << "@ [WARNING] : Shader reload failed, keeping the previous shaders\n" << vertShader.error << fragShader.error << "\n";
+            return;
+        }
+
+        // 디스크립터 셋은 시작할 때의 레이아웃으로 할당했으므로, 새 셰이더의 디스크립터 바인딩과 푸시 상수가 같을 때만 바꿉니다.
+        // 같으면 파이프라인 레이아웃도 같으므로 바인딩한 디스크립터 셋을 새 파이프라인에서 그대로 씁니다.
+        PipelineLayoutDesc layoutDesc;
+        std::vector<uint32_t> inputLocations;
+        std::string error;
+        if (reflectShaders(vertShader.code, fragShader.code, layoutDesc, inputLocations, error) == false)
+        {
+            std::cout << "@ [WARNING] : Shader reload failed, keeping the previous shaders\n" << error << "\n";
+            return;
+        }
+        if ((layoutDesc == pipelineLayoutDesc) == false)
+        {
+            std::cout << "@ [WARNING] : Reloaded shaders use different descriptor bindings or push constants, restart to apply them\n";
+            return;
+        }
+        std::vector<VkVertexInputBindingDescription> bindings = mesh.layout.getBindingDescriptions();
+        std::vector<VkVertexInputAttributeDescription> attributes = mesh.layout.getAttributeDescriptions();
+        if (ShaderReflection::filterVertexInput(inputLocations, bindings, attributes, error) == false)
+        {
+            std::cout << "@ [WARNING] : Shader reload failed, keeping the previous shaders\n" << error << "\n";
+            return;
+        }
+
+        VkShaderModule newVertShaderModule = getShaderModule(vertShader.code);
+        VkShaderModule newFragShaderModule = getShaderModule(fragShader.code);
+        if (newVertShaderModule == vertShaderModule && newFragShaderModule == fragShaderModule)
+        {
+            std::cout << "@ [INFO] : Shader sources changed but the SPIR-V is the same, keeping the current pipeline\n";
+            return;
+        }
+        previousVertShaderModule = vertShaderModule;
+        previousFragShaderModule = fragShaderModule;
+        previousVertexInputLocations = vertexInputLocations;
+        vertShaderModule = newVertShaderModule;
+        fragShaderModule = newFragShaderModule;
+        vertexInputLocations = inputLocations;
+
+        // 업로드 중인 메쉬도 새 셰이더의 파이프라인 변형을 요청하게 됩니다. (getPipelineDesc)
+        pipelineRegistry.request(getPipelineDesc(mesh.layout), getPipelineLabel(mesh.layout));
+        shaderPipelinePending = true;
+    }
+
+    // 새 셰이더로 지금 메쉬의 파이프라인을 컴파일하지 못했습니다. 새 셰이더 모듈과 그것으로 만든 변형을 빼고 예전 셰이더로 되돌립니다.
+    HELPER_FUNCTION void cancelShaderReload(const std::string& error)
+    {
+        std::cout << "@ [WARNING] : Shader reload failed, keeping the previous pipeline\n" << error << "\n";
+        const VkShaderModule failedVertShaderModule = vertShaderModule;
+        const VkShaderModule failedFragShaderModule = fragShaderModule;
+        vertShaderModule = previousVertShaderModule;
+        fragShaderModule = previousFragShaderModule;
+        vertexInputLocations = previousVertexInputLocations;
+        shaderPipelinePending = false;
+        releaseShaders(failedVertShaderModule, failedFragShaderModule);
+    }
+
+    // 지금 쓰지 않는 셰이더 모듈을 레지스트리에서 빼고, 그 모듈로 만든 파이프라인은 지금 실행 중인 프레임들이 끝난 뒤에 지웁니다.
+    HELPER_FUNCTION void releaseShaders(VkShaderModule vertModule, VkShaderModule fragModule)
+    {
+        std::vector<VkPipeline> retiredPipelines;
+        if (vertModule != vertShaderModule)
+        {
+            pipelineRegistry.releaseShader(vertModule, retiredPipelines);
+        }
+        if (fragModule != fragShaderModule)
+        {
+            pipelineRegistry.releaseShader(fragModule, retiredPipelines);
+        }
+        deletionQueue.push(frameNumber, [this, retiredPipelines]()
+        {
+            for (VkPipeline retiredPipeline : retiredPipelines)
+            {
+                vkDestroyPipeline(device, retiredPipeline, nullptr);
+            }
+        });
+    }
+
+    // 텍스쳐 스트리밍 : 업로드 중인 텍스쳐가 없으면 화면 크기와 메모리 예산으로 정한 레벨부터의 꼬리로 텍스쳐를 다시 만들어 올립니다.
+    // 예전 이미지는 publishTexture 가 지연 해제하므로 내린 레벨의 메모리가 실제로 돌아옵니다. 새로 올라온 레벨은 샘플러의 minLod 를 낮추어 가며 서서히 보여 줍니다.
+    HELPER_FUNCTION void updateTextureStreaming()
+    {
+        if (streamedTexture == nullptr || textureStreamer.getResidentBase() >= textureStreamer.getLevelCount())
+        {
+            return;
+        }
+
+        if (pendingTexture.image == VK_NULL_HANDLE)
+        {
+            const VkDeviceSize budget = getTextureBudget();
+
+            // 텍스쳐 캐시에 남겨 둔 예전 꼬리 이미지들이 예산을 넘기게 하면 레벨을 내리기 전에 그것부터 지웁니다.
+            if (textureStreamer.getTailSize(textureStreamer.getResidentBase()) + textureCache.getUnusedBytes() > budget)
+            {
+                textureCache.trim(0, 0);
+            }
+
+            const uint32_t base = textureStreamer.selectBase(meshScreenDiameter, budget);
+            if (base != textureStreamer.getResidentBase())
+            {
+                // 예전에 올렸던 꼬리가 텍스쳐 캐시에 남아 있으면 업로드 없이 바로 씁니다.
+                const uint32_t residentBase = textureStreamer.getResidentBase();
+                TextureKey key = streamedTexture->key;
+                key.firstLevel = base;
+                const bool cached = publishCachedTexture(key, base);
+                if (cached == false)
+                {
+                    createCachedTexture(key, streamedTexture->view.getTail(base), pendingTexture);
+                    pendingTextureBase = base;
+                    pendingTextureToken = submitUploads();
+                }
+                std::cout << "@ [INFO] : Texture streaming : mip " << residentBase << " -> " << base << " (" << (textureStreamer.getTailSize(base) >> 10) << " KiB, "
+                    << meshScreenDiameter << " px on screen, budget " << (budget >> 20) << " MiB" << (cached ? ", cached" : "") << ")\n";
+            }
+        }
+
+        // minLod 가 바뀐 샘플러로 바꾸고, 예전 샘플러는 그것을 쓰던 프레임들이 끝난 뒤에 샘플러 캐시로 돌려줍니다. 디스크립터는 프레임 슬롯마다 updateTextureDescriptor 가 고칩니다.
+        const float minLod = textureStreamer.getMinLod(TextureStreamer::Clock::now());
+        if (minLod != textureSamplerKey.info.minLod)
+        {
+            SamplerKey retiredSampler = textureSamplerKey;
+            createTextureSampler(minLod);
+            textureGeneration++;
+            deletionQueue.push(frameNumber, [this, retiredSampler]() { samplerCache.release(retiredSampler); });
+        }
+    }
+
+    // 텍스쳐 스트리밍의 메모리 예산 (바이트). 텍스쳐 메모리가 있는 힙에서 텍스쳐가 쓸 수 있는 크기입니다.
+    // VK_EXT_memory_budget 이 있으면 힙의 예산에서 지금 텍스쳐와 텍스쳐 캐시에 남겨 둔 텍스쳐를 뺀 사용량(다른 리소스, 다른 프로세스 몫)을 빼고, 없으면 힙 크기를 씁니다. --texture-budget-mb 가 있으면 그 값을 넘지 않습니다.
+    HELPER_FUNCTION VkDeviceSize getTextureBudget() const
+    {
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+        const uint32_t heapIndex = memProperties.memoryTypes[texture.memory.memoryTypeIndex].heapIndex;
+
+        VkDeviceSize budget = memProperties.memoryHeaps[heapIndex].size;
+        if (getPhysicalDeviceMemoryProperties2 != nullptr)
+        {
+            VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+            budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+            VkPhysicalDeviceMemoryProperties2 memProperties2{};
+            memProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+            memProperties2.pNext = &budgetProperties;
+            getPhysicalDeviceMemoryProperties2(physicalDevice, &memProperties2);
+
+            const VkDeviceSize textureUsage = texture.memory.size + textureCache.getUnusedBytes();
+            const VkDeviceSize otherUsage = budgetProperties.heapUsage[heapIndex] - std::min(budgetProperties.heapUsage[heapIndex], textureUsage);
+            budget = budgetProperties.heapBudget[heapIndex] - std::min(budgetProperties.heapBudget[heapIndex], otherUsage);
+        }
+        if (options.textureBudgetMiB != 0)
+        {
+            budget = std::min(budget, VkDeviceSize(options.textureBudgetMiB) << 20);
+        }
+        return budget;
+    }
+
+    // 업로드가 끝난 텍스쳐를 그리기용으로 바꿉니다. 예전 텍스쳐는 이미 제출한 프레임들이 끝난 뒤에 텍스쳐 캐시로 돌려줍니다. (다른 곳에서 쓰지 않으면 캐시가 한도에 맞춰 지웁니다.)
+    HELPER_FUNCTION void publishTexture()
+    {
+        TextureKey retired = texture.key;
+        texture = pendingTexture;
+        pendingTexture = TextureResource{};
+        textureGeneration++;
+        if (streamedTexture)
+        {
+            textureStreamer.onResident(pendingTextureBase, TextureStreamer::Clock::now());
+        }
+        deletionQueue.push(frameNumber, [this, retired]() { textureCache.release(retired); });
+    }
+
+    // 텍스쳐 캐시에 key 의 텍스쳐가 있으면 업로드 없이 바로 그리기용으로 바꿉니다. base 는 그 이미지의 레벨 0 이 스트리밍하는 밉 체인의 몇 번째 레벨인지입니다.
+    HELPER_FUNCTION bool publishCachedTexture(const TextureKey& key, uint32_t base)
+    {
+        const TextureResource* cached = textureCache.acquire(key);
+        if (cached == nullptr)
+        {
+            return false;
+        }
+        pendingTexture = *cached;
+        pendingTextureBase = base;
+        publishTexture();
+        return true;
+    }
+
+    // 밉 체인으로 텍스쳐를 만들어 업로드를 기록하고 텍스쳐 캐시에 넣습니다. 항목의 크기는 실제로 할당한 메모리 크기입니다. 업로드는 호출하는 쪽에서 제출합니다.
+    HELPER_FUNCTION void createCachedTexture(const TextureKey& key, const MipBuilder::MipChainView& mips, TextureResource& resource)
+    {
+        createTextureImage(mips, resource);
+        createTextureImageView(resource);
+        resource.key = key;
+        textureCache.insert(key, resource, resource.memory.size, key.path + " (mip " + std::to_string(key.firstLevel) + ", " + toString(resource.format) + ", " + std::to_string(resource.mipLevels) + " levels)");
+    }
+
+    // 업로드가 끝난 메쉬를 그리기용으로 바꿉니다. pipeline 은 새 메쉬의 버텍스 형식으로 파이프라인 레지스트리가 컴파일한 파이프라인입니다.
+    // 예전 메쉬는 나중에 지우지만 예전 파이프라인은 레지스트리에 남겨 두어 같은 형식의 메쉬를 다시 불러오면 그대로 씁니다.
+    HELPER_FUNCTION void publishMesh(VkPipeline pipeline)
+    {
+        MeshResource retired = mesh;
+        mesh = pendingMesh;
+        pendingMesh = MeshResource{};
+        graphicsPipeline = pipeline;
+
+        if (pipelineWaitFrames > 0)
+        {
+            std::cout << "@ [INFO] : Mesh published after drawing the previous mesh for " << pipelineWaitFrames << " frames while its pipeline compiled\n";
+            pipelineWaitFrames = 0;
         }
 
+        deletionQueue.push(frameNumber, [this, retired]() mutable
+        {
+            destroyMesh(retired);
+        });
     }
 
+    // 프레임 슬롯의 디스크립터 셋에서 결합된 이미지 샘플러만 지금 그리기에 쓰는 텍스쳐로 고칩니다. 셰이더가 텍스쳐를 쓰지 않으면 고칠 바인딩이 없습니다.
+    HELPER_FUNCTION void updateTextureDescriptor(uint32_t slot)
+    {
+        descriptorTextureGenerations[slot] = textureGeneration;
+        const VkDescriptorSetLayoutBinding* samplerBinding = pipelineLayoutDesc.findBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        if (samplerBinding == nullptr)
+        {
+            return;
+        }
 
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = texture.view;
+        imageInfo.sampler = textureSampler;
+
+        VkWriteDescriptorSet descriptorWrite{};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = descriptorSets[slot];
+        descriptorWrite.dstBinding = samplerBinding->binding;
+        descriptorWrite.dstArrayElement = 0;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+    }
 
-    // 3. 계속해서 매 프레임 렌더
-    inline void mainLoop()
+    HELPER_FUNCTION void destroyTexture(TextureResource& resource)
     {
-        // 사용자가 창을 닫을 때까지는 계속 이벤트 처리를 하면서 루프를 돕니다.
-        while (!glfwWindowShouldClose(window))
-        {
-            // GLFW 윈도우 이벤트를 처리합니다.
-            glfwPollEvents();
+        vkDestroyImageView(device, resource.view, nullptr);
+        vkDestroyImage(device, resource.image, nullptr);
+        memoryAllocator.free(resource.memory);
+        resource = TextureResource{};
+    }
 
-            // 계속해서 매 프레임 삼각형을 그립니다.
-            // 크게 Vulkan에서 프레임을 렌더링하는 것은 다음과 같은 공통 단계로 구성됩니다.
-            // 1) 이전 프레임이 완료될 때까지 기다립니다.
-            // 2) 스왑 체인에서 이미지를 획득합니다.
-            // 3) 해당 이미지에 장면을 그리는 커맨드 버퍼를 기록합니다.
-            // 4) 기록된 커맨드 버퍼를 제출합니다.
-            // 5) 스왑 체인 이미지를 제시합니다.
-            // 이후 장에서 그리기 기능을 확장할 것이지만 지금은 이것이 렌더 루프의 핵심입니다.
-            drawFrame();
+    HELPER_FUNCTION void destroyMesh(MeshResource& resource)
+    {
+        vkDestroyBuffer(device, resource.vertexBuffer, nullptr);
+        memoryAllocator.free(resource.vertexBufferMemory);
+        if (resource.constantColorBuffer != VK_NULL_HANDLE)
+        {
+            vkDestroyBuffer(device, resource.constantColorBuffer, nullptr);
+            memoryAllocator.free(resource.constantColorBufferMemory);
         }
-
-        // drawFrame의 모든 작업은 비동기식임을 기억하십시오. 이는 mainLoop에서 루프를 종료할 때 그리기 및 프레젠테이션 작업이 계속 진행 중일 수 있음을 의미합니다. 그런 일이 일어나는 동안 리소스를 정리하는 것은 나쁜 생각입니다. 이 문제를 해결하려면 mainLoop를 종료하고 창을 파괴하기 전에 추상적 장치가 작업을 완료할 때까지 기다려야 합니다. vkQueueWaitIdle을 사용하여 특정 명령 대기열의 작업이 완료될 때까지 기다릴 수도 있습니다. 이러한 기능은 동기화를 수행하는 매우 기본적인 방법으로 사용할 수 있습니다. 이제 창을 닫을 때 문제 없이 프로그램이 종료되는 것을 볼 수 있습니다.
-        vkDeviceWaitIdle(device);
+        vkDestroyBuffer(device, resource.indexBuffer, nullptr);
+        memoryAllocator.free(resource.indexBufferMemory);
+        resource = MeshResource{};
     }
 
     // 하나의 프레임을 그립니다.
@@ -2667,25 +4460,42 @@ private:
         // vkwaitForFences 함수는 펜스들의 배열을 가지고 이들 중 일부 또는 모든 펜스가 신호를 받을 때까지 호스트에서 기다립니다. 여기서 전달하는 VK_TRUE는 모든 펜스들이 신호를 받을때까지 기다림을 의미합니다. 이 함수에는 64비트 무부호 정수 UINT64_MAX의 최대값으로 설정한 시간 초과 매개변수도 있습니다. 이 시간을 초과하면 그냥 대기를 끝냅니다.
         vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
 
+        // 펜스를 기다렸으므로 이 슬롯에서 지난번에 제출한 프레임의 GPU 타임스탬프를 멈춤 없이 읽을 수 있습니다.
+        collectFrameTimestamps(currentFrame);
+
+        // 끝난 업로드 배치의 스테이징 버퍼를 해제합니다. 펜스 상태만 확인하므로 멈추지 않습니다.
+        collectUploads();
+
+        // 백그라운드 로드가 끝난 에셋을 업로드하고, 업로드가 끝난 에셋을 그리기에 쓰도록 바꿉니다.
+        updateAssets();
+
         // 스왑 체인에서 이미지 가져오기
         // drawFrame 함수에서 다음으로 해야 할 일은 스왑 체인에서 이미지를 가져오는 것입니다. 스왑 체인은 확장 기능이므로 vk*KHR 명명 규칙이 있는 함수를 사용해야 합니다. vkAcquireNextImageKHR의 처음 두 매개변수는 이미지를 획득하려는 논리적 장치와 스왑 체인입니다. 세 번째 매개변수는 이미지를 사용할 수 있는 시간 제한(나노초)을 지정합니다. 64비트 부호 없는 정수의 최대값을 사용하면 시간 초과를 효과적으로 비활성화할 수 있습니다. 다음 두 매개변수는 프레젠테이션 엔진이 이미지를 사용하여 완료할 때 신호를 보낼 동기화 개체를 지정합니다. 그것이 우리가 그림을 그리기 시작할 수 있는 시점입니다. 세마포어, 펜스 또는 둘 다를 지정할 수 있습니다. 여기서는 이를 위해 imageAvailableSemaphore를 사용할 것입니다. 마지막 매개변수는 사용 가능한 스왑 체인 이미지의 인덱스를 출력할 변수를 지정합니다. 인덱스는 swapChainImages 배열의 VkImage를 참조합니다. 해당 인덱스를 사용하여 VkFrameBuffer를 선택합니다.
         uint32_t imageIndex;
-        VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
-
-        // 이제 스왑 체인 재생이 필요한 시점을 파악하고 새로운 recreateSwapChain 함수를 호출하기만 하면 됩니다. 운 좋게도 Vulkan은 일반적으로 프레젠테이션 중에 스왑 체인이 더 이상 적절하지 않은 경우(화면 크기 조정 등)를 알려줍니다.
-        // vkAcquireNextImageKHR 및 vkQueuePresentKHR 함수는 이를 나타내기 위해 다음과 같은 특수 값을 반환할 수 있습니다.
-        // VK_ERROR_OUT_OF_DATE_KHR: 스왑 체인이 표면과 호환되지 않아 더 이상 렌더링에 사용할 수 없습니다. 일반적으로 창 크기 조정 후에 발생합니다.
-        // VK_SUBOPTIMAL_KHR: 스왑 체인을 사용하여 표면에 성공적으로 표시할 수 있지만 표면 속성이 더 이상 정확히 일치하지 않습니다.
-        if (result == VK_ERROR_OUT_OF_DATE_KHR)
+        if (options.headless)
         {
-            // 이미지 획득을 시도할 때 스왑 체인이 오래된 것으로 판명되면 더 이상 이미지에 표시할 수 없습니다. 따라서 스왑 체인을 즉시 다시 만들고 다음 drawFrame 호출에서 다시 시도해야 합니다. 스왑 체인이 차선책인 경우에도 그렇게 하도록 결정할 수 있지만 일단은 이미지를 얻었기 때문에 이 경우에도 계속 진행하기로 결정했습니다. VK_SUCCESS 및 VK_SUBOPTIMAL_KHR 모두 "성공" 반환 코드로 간주됩니다.
-            recreateSwapChain();
-            // 스왑 체인을 재생성하고 바로 drawFrame()을 나가서 재실행 하도록 만들었습니다. 문제는 이후에 명령을 제출하는 작업이 생략되며 그에 따라 펜스에 신호가 가지 않아 위에서 사용한 vkwaitForFences 함수에서 교착 상태가 발생해 영원히 대기하는 문제가 있습니다. 고맙게도 vkResetFences 를 아래로 내려 간단히 수정할 수 있습니다. 작업을 제출할 것임을 확실히 알 수 있을 때까지 펜스 재설정(vkResetFences) 을 연기하십시오. vkResetFences 호출 전에 return 하면 펜스는 여전히 신호 활성화 상태이기 때문에 다음에 동일한 펜스 개체를 사용할 때 vkwaitForFences 가 교착 상태에 빠지지 않습니다.
-            return;
+            // 헤드리스 모드에는 스왑 체인이 없으므로 프레임 슬롯 번호의 오프스크린 이미지에 바로 그립니다. 해당 슬롯의 펜스를 이미 기다렸으므로 이미지는 사용 가능한 상태입니다.
+            imageIndex = currentFrame;
         }
-        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+        else
         {
-            throw std::runtime_error("Failed to acquire swap chain image!");
+            VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+
+            // 이제 스왑 체인 재생이 필요한 시점을 파악하고 새로운 recreateSwapChain 함수를 호출하기만 하면 됩니다. 운 좋게도 Vulkan은 일반적으로 프레젠테이션 중에 스왑 체인이 더 이상 적절하지 않은 경우(화면 크기 조정 등)를 알려줍니다.
+            // vkAcquireNextImageKHR 및 vkQueuePresentKHR 함수는 이를 나타내기 위해 다음과 같은 특수 값을 반환할 수 있습니다.
+            // VK_ERROR_OUT_OF_DATE_KHR: 스왑 체인이 표면과 호환되지 않아 더 이상 렌더링에 사용할 수 없습니다. 일반적으로 창 크기 조정 후에 발생합니다.
+            // VK_SUBOPTIMAL_KHR: 스왑 체인을 사용하여 표면에 성공적으로 표시할 수 있지만 표면 속성이 더 이상 정확히 일치하지 않습니다.
+            if (result == VK_ERROR_OUT_OF_DATE_KHR)
+            {
+                // 이미지 획득을 시도할 때 스왑 체인이 오래된 것으로 판명되면 더 이상 이미지에 표시할 수 없습니다. 따라서 스왑 체인을 즉시 다시 만들고 다음 drawFrame 호출에서 다시 시도해야 합니다. 스왑 체인이 차선책인 경우에도 그렇게 하도록 결정할 수 있지만 일단은 이미지를 얻었기 때문에 이 경우에도 계속 진행하기로 결정했습니다. VK_SUCCESS 및 VK_SUBOPTIMAL_KHR 모두 "성공" 반환 코드로 간주됩니다.
+                recreateSwapChain();
+                // 스왑 체인을 재생성하고 바로 drawFrame()을 나가서 재실행 하도록 만들었습니다. 문제는 이후에 명령을 제출하는 작업이 생략되며 그에 따라 펜스에 신호가 가지 않아 위에서 사용한 vkwaitForFences 함수에서 교착 상태가 발생해 영원히 대기하는 문제가 있습니다. 고맙게도 vkResetFences 를 아래로 내려 간단히 수정할 수 있습니다. 작업을 제출할 것임을 확실히 알 수 있을 때까지 펜스 재설정(vkResetFences) 을 연기하십시오. vkResetFences 호출 전에 return 하면 펜스는 여전히 신호 활성화 상태이기 때문에 다음에 동일한 펜스 개체를 사용할 때 vkwaitForFences 가 교착 상태에 빠지지 않습니다.
+                return;
+            }
+            else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+            {
+                throw std::runtime_error("Failed to acquire swap chain image!");
+            }
         }
 
 
@@ -2709,7 +4519,7 @@ private:
         // 처음 세 개의 매개변수는 실행이 시작되기 전에 대기할 세마포어와 파이프라인의 어느 단계에서 대기할 것인지 지정합니다. 사용할 수 있을 때까지 이미지에 색상을 기록하기를 원하므로 색상 어태치먼트에 기록하는 그래픽 파이프라인의 단계를 지정하고 있습니다. 즉, 이론적으로 구현은 이미 이미지를 사용할 수 없는 동안 버텍스 셰이더 등의 실행을 시작할 수 있습니다. waitStages 배열의 각 항목은 pWaitSemaphores 에 동일한 인덱스로 있는 세마포어에 해당합니다.
         VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
         VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.waitSemaphoreCount = options.headless ? 0 : 1; // 헤드리스 모드에서는 기다릴 스왑 체인 이미지가 없습니다.
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
 
@@ -2719,7 +4529,7 @@ private:
 
         // signalSemaphoreCount 및 pSignalSemaphores 매개변수는 커맨드 버퍼가 실행을 완료한 후 신호를 보낼 세마포어를 지정합니다. 우리의 경우에는 그 목적을 위해 renderFinishedSemaphore를 사용하고 있습니다.
         VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
-        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.signalSemaphoreCount = options.headless ? 0 : 1; // 헤드리스 모드에서는 프레젠테이션을 하지 않으므로 신호를 보낼 필요가 없습니다.
         submitInfo.pSignalSemaphores = signalSemaphores;
 
         // 이제 vkQueueSubmit을 사용하여 그래픽 대기열에 커맨드 버퍼를 제출할 수 있습니다. 이 함수는 워크로드가 훨씬 더 클 때 효율성을 위해 인수로 VkSubmitInfo 구조의 배열을 사용합니다. 마지막 매개변수는 커맨드 버퍼가 실행을 완료할 때 신호를 보낼 선택적 펜스를 참조합니다. 이를 통해 언제 커맨드 버퍼를 재사용해도 안전한지 알 수 있으므로 inFlightFence에 제공하고자 합니다. 이제 다음 프레임에서 CPU는 새 명령을 기록하기 전에 이 커맨드 버퍼의 실행이 완료될 때까지 기다립니다.
@@ -2727,6 +4537,21 @@ private:
         {
             throw std::runtime_error("Failed to submit draw command buffer!");
         }
+        frameNumber++;
+
+        if (firstFrameReported == false)
+        {
+            firstFrameReported = true;
+            double firstFrameMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - initStartTime).count();
+            std::cout << "@ [INFO] : First frame submitted " << firstFrameMs << " ms after start" << (assetsReady ? "" : " (drawing placeholders)") << "\n";
+        }
+
+        // 헤드리스 모드에서는 프레젠테이션 단계가 없으므로 다음 프레임 슬롯으로 넘어가고 끝냅니다.
+        if (options.headless)
+        {
+            currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+            return;
+        }
 
         // 프레젠테이션
         // 프레임 그리기의 마지막 단계는 결과를 스왑 체인에 다시 제출하여 결국 화면에 표시되도록 하는 것입니다.
@@ -2744,7 +4569,7 @@ private:
         presentInfo.pResults = nullptr; // Optional
 
         // vkQueuePresentKHR 함수는 이미지를 스왑 체인에 표시하라는 요청을 제출합니다. 다음 장에서 vkAcquireNextImageKHR 및 vkQueuePresentKHR 모두에 대해 오류 처리를 추가할 것입니다. 지금까지 본 기능과 달리 오류가 반드시 프로그램이 종료되어야 함을 의미하지는 않기 때문입니다. 커맨드 버퍼가 담긴 큐를 제출하면 이제 삼각형이 표시되어야 합니다.
-        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+        VkResult result = vkQueuePresentKHR(presentQueue, &presentInfo);
 
         // 많은 드라이버와 플랫폼이 창 크기 조정 후 VK_ERROR_OUT_OF_DATE_KHR을 자동으로 트리거하지만 항상 발생한다고 보장할 수 없습니다. 때문에 프레임 버퍼 크기 조정을 직접 감지하도록 framebufferResized 를 만들어 사용하였습니다.
         // vkQueuePresentKHR 후에 이 작업을 수행하여 세마포어가 일관된 상태에 있는지 확인하는 것이 중요합니다. 그렇지 않으면 신호된 세마포어가 제대로 대기되지 않을 수 있습니다. 이제 실제로 크기 조정을 감지하기 위해 GLFW 프레임워크에서 glfwSetFramebufferSizeCallback 함수를 사용하여 콜백을 설정할 수 있습니다.
@@ -2779,19 +4604,44 @@ private:
 
         // 아직 사용 중일 수 있는 리소스를 건드리면 안 되기 때문에 여기서 추상적 디바이스의 사용이 완료될 때까지 대기합니다.
         vkDeviceWaitIdle(device);
+        auto recreateStart = std::chrono::high_resolution_clock::now();
 
         // 우리가 해야 할 첫 번째 일은 스왑 체인 자체를 다시 만드는 것입니다. 스왑 체인 이미지를 기반으로 하고 있는 이미지 뷰를 다시 만들어야 하고, 스왑 체인 이미지의 형식에 의존하고 있는 렌더 패스도 다시 만들어야 합니다. 스왑 체인 이미지 형식이 창 크기 조정과 같은 작업 중에 변경되는 경우는 드물지만 그래도 처리해야 합니다. 뷰포트 및 가위 직사각형 크기 설정은 그래픽 파이프라인 생성 중에 지정되므로 파이프라인도 다시 빌드해야 합니다. 뷰포트 및 가위 직사각형에 동적 상태를 사용하여 파이프라인 재빌드를 피할 수도 있습니다. 마지막으로 프레임 버퍼는 스왑 체인 이미지에 직접적으로 의존하기 떄문에 프레임 버퍼도 새로 만들어야 합니다.
         // 스왑 체인을 다시 만들기 위해 이전 버전을 정리합니다.
         cleanupSwapChain();
 
         // 아래가 스왑 체인을 다시 만드는 데 필요한 모든 것입니다! 그러나 이 접근 방식의 단점은 새 스왑 체인을 만들기 전에 모든 렌더링이 중지된다는 것입니다. 이전 스왑 체인에서 이미지에 명령을 그리는 동안 새 스왑 체인을 만들 수 있습니다. VkSwapchainCreateInfoKHR 구조체의 oldSwapChain 필드에 이전 스왑 체인을 전달하고 사용을 마치는 즉시 이전 스왑 체인을 파괴함으로써 새로운 스왑 체인과 자연스럽게 연결시킬 수도 있습니다.
+        // 뷰포트와 시저는 동적 스테이트이므로 렌더 패스와 그래픽스 파이프라인은 그대로 씁니다. 다만 스왑 체인 이미지 형식이 바뀌면 렌더 패스가 호환되지 않으므로 둘 다 다시 만듭니다.
+        const VkFormat previousFormat = swapChainImageFormat;
         createSwapChain();
         createImageViews();
-        createRenderPass();
-        createGraphicsPipeline();
+        const bool rebuildPipeline = swapChainImageFormat != previousFormat;
+        double pipelineMs = 0.0;
+        if (rebuildPipeline)
+        {
+            // 예전 렌더 패스로 만든 파이프라인은 모두 쓸 수 없으므로 레지스트리를 비우고, 지금 그리는 메쉬의 파이프라인만 기다려서 다시 만듭니다. 다른 변형은 요청할 때 다시 컴파일합니다.
+            // clear 는 예전 렌더 패스로 컴파일 중인 작업이 모두 끝난 뒤에 돌아오므로 그다음에 렌더 패스를 지웁니다.
+            pipelineRegistry.clear();
+            vkDestroyRenderPass(device, renderPass, nullptr);
+            createRenderPass();
+            auto pipelineStart = std::chrono::high_resolution_clock::now();
+            graphicsPipeline = pipelineRegistry.wait(getPipelineDesc(mesh.layout), getPipelineLabel(mesh.layout));
+            pipelineMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - pipelineStart).count();
+        }
         createColorResources(); // 멀티샘플링을 위해 깊이 이미지 말고도 추가로 컬러 이미지도 만들었었습니다.
         createDepthResources();
         createFramebuffers();
+
+        double recreateMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - recreateStart).count();
+        std::cout << "@ [INFO] : Swap chain recreated in " << recreateMs << " ms (";
+        if (rebuildPipeline)
+        {
+            std::cout << "format changed, graphics pipeline rebuilt in " << pipelineMs << " ms, pipeline cache " << toString(pipelineCache.getStatus()) << ")\n";
+        }
+        else
+        {
+            std::cout << "graphics pipeline kept)\n";
+        }
     }
 
     // 버텍스 셰이더로 전달할 유니폼 버퍼(MVP 변환행렬) 업데이트
@@ -2805,7 +4655,9 @@ private:
 
         UniformBufferObject ubo{};
         // glm::rotate 함수는 기존 변형, 회전 각도 및 회전 축을 매개변수로 사용합니다. glm::mat4(1.0f) 생성자는 단위 행렬을 반환합니다. time * glm::radians(90.0f) 회전 각도를 사용하여 초당 90도 회전을 합니다. @@@@@@ 회전속도를 느리게 하기 위해 초당 30도로 변경하였음.
-        ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(30.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        const glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), time * glm::radians(30.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        // 압축된 위치는 메쉬 경계 상자 안의 [0, 1] 값이므로 원래 좌표로 되돌리는 변환을 먼저 적용합니다. (압축하지 않은 메쉬는 단위 행렬)
+        ubo.model = rotation * mesh.layout.getDequantizeMatrix();
         // 뷰 변환을 위해 위에서 45도 각도로 지오메트리를 보기로 결정했습니다. glm::lookAt 함수는 눈 위치, 중심 위치 및 위쪽 축을 매개변수로 사용합니다.
         ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
         // 저는 45도 수직 시야각으로 원근 투영을 사용하기로 선택했습니다. 다른 매개변수는 종횡비, 근거리 및 원거리 보기 평면입니다. 크기 조정 후 창의 새 너비와 높이를 고려하려면 현재 스왑 체인 범위를 사용하여 종횡비를 계산하는 것이 중요합니다. 이제 투영 행렬이 종횡비를 수정하기 때문에 직사각형이 정사각형으로 변경되었습니다. updateUniformBuffer는 화면 크기 조정을 처리하므로 recreateSwapChain 에서 설정한 디스크립터를 다시 만들 필요가 없습니다.
@@ -2813,11 +4665,13 @@ private:
         // GLM은 원래 클립 좌표의 Y 좌표가 반전되는 OpenGL용으로 설계되었습니다. 이를 보상하는 가장 쉬운 방법은 투영 행렬에서 Y축의 배율 인수에서 부호를 뒤집는 것입니다. 이렇게 하지 않으면 이미지가 거꾸로 렌더링됩니다.
         ubo.proj[1][1] *= -1;
 
+        // 텍스쳐 스트리밍이 필요한 밉 레벨을 고를 수 있도록 메쉬의 경계 구가 화면에서 차지하는 지름을 구해 둡니다. 경계 구는 위치 복원 변환 전의 원래 좌표입니다.
+        meshScreenDiameter = getScreenDiameter(glm::vec3(ubo.view * rotation * glm::vec4(mesh.boundsCenter, 1.0f)), mesh.boundsRadius, glm::radians(45.0f), float(swapChainExtent.height));
+
         // 이제 모든 변환이 정의되었으므로 유니폼 버퍼 개체의 데이터를 현재 유니폼 버퍼에 복사할 수 있습니다. 이것은 스테이징 버퍼가 없는 것을 제외하고 정점 버퍼에 대해 했던 것과 똑같은 방식으로 발생합니다. 이런 식으로 UBO를 사용하여 자주 변경되는 값을 셰이더에 전달하는 것은 최고로 효율적인 방법은 아닙니다. 작은 데이터 버퍼를 셰이더에 전달하는 더 효율적인 방법은 푸시 상수를 이용하는 것입니다. 우리는 미래에 이것들을 살펴볼 것입니다. 다음 장에서는 셰이더가 이 변환 데이터에 액세스할 수 있도록 VkBuffers를 유니폼 버퍼 디스크립터에 실제로 바인딩하는 디스크립터 세트를 살펴보겠습니다.
-        void* data;
-        vkMapMemory(device, uniformBuffersMemory[currentImage], 0, sizeof(ubo), 0, &data);
-        memcpy(data, &ubo, sizeof(ubo));
-        vkUnmapMemory(device, uniformBuffersMemory[currentImage]);
+        // 이 프레임 슬롯의 펜스를 이미 기다렸으므로 링 버퍼를 처음부터 다시 채웁니다. 매핑 호출 없이 복사만 하고, 그리기할 때 사용할 동적 오프셋을 받아둡니다.
+        uniformRing.beginFrame(currentImage);
+        objectUniformOffset = uniformRing.push(ubo);
     }
 
     // 커맨드 버퍼를 기록하도록 해주는 함수입니다.
@@ -2844,6 +4698,10 @@ private:
             throw std::runtime_error("Failed to begin recording command buffer!");
         }
 
+        // 이 프레임 슬롯의 타임스탬프 쿼리들을 초기화하고 프레임 전체 구간을 엽니다. 쿼리 초기화는 렌더 패스 밖에서 해야 합니다.
+        gpuProfiler.beginSlot(commandBuffer, currentFrame, frameNumber);
+        uint32_t frameScope = gpuProfiler.beginScope(commandBuffer, "Frame");
+
         // 그리기는 vkCmdBeginRenderPass로 렌더 패스를 시작하는 것으로 그리기는 시작됩니다. 렌더 패스는 VkRenderPassBeginInfo 구조체의 일부 매개변수를 사용하여 구성됩니다.
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -2868,31 +4726,54 @@ private:
         // VK_SUBPASS_CONTENTS_INLINE: 렌더 패스 명령은 기본 커맨드 버퍼 자체에 포함되며 보조 커맨드 버퍼는 실행되지 않습니다.
         // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : 렌더 패스 명령은 보조 커맨드 버퍼에서 실행됩니다.
         // 보조 커맨드 버퍼를 사용하지 않을 것이므로 첫 번째 옵션을 사용하겠습니다.
+        uint32_t colorPassScope = gpuProfiler.beginScope(commandBuffer, "MSAA color pass");
         vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
         // 이제 그래픽 파이프라인을 바인딩할 수 있습니다.
         // 두 번째 매개변수는 파이프라인 개체가 그래픽 또는 컴퓨팅 파이프라인인지 지정합니다. 이제 Vulkan에 그래픽 파이프라인에서 실행할 작업과 프래그먼트 셰이더에서 사용할 어태치먼트을 지정했으므로 남은 것은 삼각형을 그리도록 지시하는 것뿐입니다.
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 
+        // 파이프라인의 동적 스테이트인 뷰포트와 시저를 지금 스왑 체인 크기로 정합니다. 프레임 버퍼 전체를 덮으며, 깊이 범위는 0 ~ 1 입니다.
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = static_cast<float>(swapChainExtent.width);
+        viewport.height = static_cast<float>(swapChainExtent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.offset = { 0, 0 };
+        scissor.extent = swapChainExtent;
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
 
         // 이제 렌더링 작업 동안 버텍스 버퍼를 바인딩 하면 됩니다.
-        VkBuffer vertexBuffers[] = { vertexBuffer };
+        VkBuffer vertexBuffers[] = { mesh.vertexBuffer };
         VkDeviceSize offsets[] = { 0 };
         // vkCmdBindVertexBuffers 함수는 이전 장에서 설정한 것과 같이 버텍스 버퍼를 바인딩에 바인딩하는 데 사용됩니다. 명령 버퍼 외에 처음 두 매개변수는 버텍스 버퍼를 지정할 오프셋과 바인딩 수를 지정합니다. 마지막 두 매개변수는 바인딩할 버텍스 버퍼의 배열과 버텍스 데이터 읽기를 시작할 바이트 오프셋을 지정합니다.
         vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        // 색상이 일정한 형식이면 바인딩 1 에 그 색상 버퍼를 묶습니다. (인스턴스 단위로 읽으므로 모든 버텍스가 같은 색상을 받습니다.)
+        if (mesh.layout.hasConstantColor())
+        {
+            vkCmdBindVertexBuffers(commandBuffer, 1, 1, &mesh.constantColorBuffer, offsets);
+        }
 
 
         // 인덱스 버퍼를 활용하여 그립니다.
         // 그리기에 인덱스 버퍼를 사용하면 recordCommandBuffer에 두 가지 변경 사항이 포함됩니다. 버텍스 버퍼에 대해 했던 것처럼 먼저 인덱스 버퍼를 바인딩해야 합니다. 차이점은 하나의 인덱스 버퍼만 가질 수 있다는 것입니다. 불행히도 각 버텍스의 세부 속성 활용을 위해 다른 인덱스를 사용할 수는 없으므로 하나의 속성만 달라지더라도 꼭짓점 데이터를 완전히 복제해 새로 구성해야 합니다. 인덱스 버퍼는 인덱스 버퍼, 바이트 오프셋 및 인덱스 데이터 유형을 매개 변수로 포함하는 vkCmdBindIndexBuffer로 바인딩됩니다. 앞에서 언급했듯이 가능한 유형은 VK_INDEX_TYPE_UINT16 및 VK_INDEX_TYPE_UINT32입니다. 인덱스 버퍼를 바인딩하는 것만으로는 아직 아무 것도 변경되지 않습니다. 또한 Vulkan이 인덱스 버퍼를 사용하도록 지시하기 위해 그리기 명령을 변경해야 합니다. vkCmdDraw 줄을 제거하고 vkCmdDrawIndexed로 바꿉니다. 이 함수에 대한 호출은 vkCmdDraw와 매우 유사합니다. 처음 두 매개변수는 인덱스 수와 인스턴스 수를 지정합니다. 우리는 인스턴싱을 사용하지 않으므로 단지 1개의 인스턴스를 지정하였습니다. 인덱스 수는 버텍스 버퍼에 전달될 버텍스의 수를 나타냅니다. 다음 매개변수는 인덱스 버퍼에 대한 오프셋을 지정하며 값 1을 사용하면 그래픽 카드가 두 번째 인덱스에서 읽기 시작합니다. 마지막에서 두 번째 매개변수는 인덱스 버퍼의 인덱스에 추가할 오프셋을 지정합니다. 마지막 매개변수는 우리가 사용하지 않는 인스턴싱을 위한 오프셋을 지정합니다. 이제 프로그램을 실행하면 직사각형이 표시됩니다. 65535보다 더 많은 정점이 있을 것이기 때문에 인덱스 유형을 uint16_t에서 uint32_t로 변경해야 합니다.
-        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+        // 인덱스 타입은 메쉬를 임포트할 때 고른 indexType (버텍스가 65536 개보다 적으면 VK_INDEX_TYPE_UINT16) 입니다.
+        vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer, 0, mesh.indexType);
 
 
         // 이제 vkCmdBindDescriptorSets를 사용하여 셰이더의 디스크립터에 각 프레임에 대해 설정된 올바른 디스크립터를 실제로 바인딩하기 위해 recordCommandBuffer 함수를 업데이트해야 합니다. 이것은 vkCmdDrawIndexed 호출 전에 수행해야 합니다. 버텍스 및 인덱스 버퍼와 달리 디스크립터 세트는 그래픽 파이프라인에 고유하지 않습니다. 따라서 디스크립터 세트를 그래픽 또는 컴퓨팅 파이프라인에 바인딩할지 여부를 지정해야 합니다. 다음 매개변수는 디스크립터의 기반이 되는 레이아웃입니다. 다음에 계속되는 세 개의 매개변수는 디스크립터 집합의 인덱스의 첫번째 요소, 바인딩할 집합 수 및 바인딩할 집합 배열을 지정합니다. 잠시 후 다시 이 문제로 돌아가겠습니다. 마지막 두 매개변수는 동적 디스크립터에 사용되는 오프셋 배열을 지정합니다. 미래 장에서 이에 대해 살펴보겠습니다.
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+        // 동적 유니폼 버퍼를 사용하므로 이 그리기가 읽을 UBO 의 링 버퍼 내 오프셋을 함께 넘깁니다. 셰이더가 UBO 를 쓰지 않아 레이아웃에서 빠졌으면 오프셋을 넘기지 않습니다.
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], pipelineLayoutDesc.getDynamicOffsetCount(0), &objectUniformOffset);
 
         
         // 이제 인덱스 버퍼를 사용해 버텍스를 재사용하여 메모리를 절약하는 방법을 알게 되었습니다. 이것은 우리가 복잡한 3D 모델을 로드할 미래에 특히 중요해질 것입니다. 이전 장에서 이미 단일 메모리 할당에서 버퍼와 같은 여러 리소스를 할당해야 한다고 언급했었는데 거기에 더해 드라이버 개발자는 버텍스 및 인덱스 버퍼와 같은 여러 버퍼를 하나의 VkBuffer에 저장하고 vkCmdBindVertexBuffers와 같은 명령에서 오프셋을 사용할 것을 권장합니다. 이 경우 데이터가 더 가깝기 때문에 데이터가 캐시 친화적이라는 장점이 있습니다. 물론 데이터가 새로 고쳐지면 동일한 렌더링 작업 중에 사용되지 않는 경우 여러 리소스에 대해 동일한 메모리 청크를 재사용할 수도 있습니다. 이것을 앨리어싱이라고 하며 일부 Vulkan 함수에는 이를 수행하도록 지정하는 명시적 플래그가 있습니다.
-        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+        vkCmdDrawIndexed(commandBuffer, mesh.indexCount, 1, 0, 0, 0);
         
         /*
         인덱스 버퍼를 사용하지 않는 버전
@@ -2905,10 +4786,17 @@ private:
         vkCmdDraw(commandBuffer, static_cast<uint32_t>(vertices.size()), 1, 0, 0);
         */
 
+        // 멀티샘플 이미지의 리졸브는 서브패스가 끝날 때 렌더 패스 안에서 일어나므로 별도의 명령이 없습니다. 그리기가 모두 끝난 시점과 렌더 패스가 끝난 시점 사이를 리졸브 (및 어태치먼트 저장) 시간으로 측정합니다.
+        gpuProfiler.endScope(commandBuffer, colorPassScope);
+        uint32_t resolveScope = gpuProfiler.beginScope(commandBuffer, "MSAA resolve", VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
 
         // 이제 렌더 패스를 종료할 수 있습니다.
         vkCmdEndRenderPass(commandBuffer);
 
+        gpuProfiler.endScope(commandBuffer, resolveScope);
+        gpuProfiler.endScope(commandBuffer, frameScope);
+        gpuProfiler.endSlot();
+
         // 그리고 이제 커맨드 버퍼 기록을 마쳤습니다.
         if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
         {
@@ -2921,38 +4809,44 @@ private:
     // 4. 프로그램 종료
     inline void cleanup()
     {
+        // 작업 스레드를 먼저 멈춥니다. 실행 중인 로드가 끝날 때까지 기다리지만, 그 결과는 업로드하지 않고 버립니다.
+        assetLoader.destroy();
+
+        // 모든 프레임이 끝났으므로 교체하고 남은 리소스를 모두 지웁니다. (mainLoop / benchmarkLoop 끝에서 vkDeviceWaitIdle 을 호출했습니다.)
+        deletionQueue.flushAll();
+
         // 스왑 체인을 다시 만들기 위해 이전 버전을 정리합니다.
         cleanupSwapChain();
+        destroyRenderPassAndPipeline();
 
         // 매 프레임마다 새로운 변환으로 유니폼 버퍼를 업데이트하는 별도의 함수를 작성할 것이므로 여기에는 vkMapMemory가 없습니다. 유니폼 데이터는 모든 그리기 호출에 사용되므로 이를 포함하는 버퍼는 렌더링을 중지할 때만 파괴되어야 합니다.
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
         {
             vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-            vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
+            memoryAllocator.free(uniformBuffersMemory[i]);
         }
 
         // 디스크립터 풀이 파괴되면 디스크립터 세트는 자동으로 소멸되므로 디스크립터 세트를 명시적으로 정리할 필요가 없습니다. vkAllocateDescriptorSets에 대한 호출은 각각 하나의 유니폼 버퍼 디스크립터가 있는 디스크립터 세트를 할당합니다.
         vkDestroyDescriptorPool(device, descriptorPool, nullptr);
 
-        // 더 이상 이미지에 액세스할 필요가 없을 때 샘플러를 정리합니다.
-        vkDestroySampler(device, textureSampler, nullptr);
-        // 이미지 자체를 지우기 전에 이미지 뷰를 우선 정리해야 합니다.
-        vkDestroyImageView(device, textureImageView, nullptr);
-
+        // 더 이상 이미지에 액세스할 필요가 없을 때 샘플러를 정리합니다. 샘플러는 모두 샘플러 캐시에 있으므로 캐시를 비우면 함께 지워집니다.
+        samplerCache.clear();
+        // 이미지 자체를 지우기 전에 이미지 뷰를 우선 정리해야 합니다. (destroyTexture)
         // 기본 텍스처 이미지는 프로그램이 끝날 때까지 사용됩니다. 이제 이미지는 텍스처를 포함하지만 그래픽 파이프라인에서 액세스할 수 있는 방법이 여전히 필요합니다. 다음 장에서 이에 대해 다룰 것입니다.
-        vkDestroyImage(device, textureImage, nullptr);
-        vkFreeMemory(device, textureImageMemory, nullptr);
-
-        // 디스크립터 세트 레이아웃은 프로그램이 끝날 때까지 새 그래픽 파이프라인을 생성하는 동안 계속 유지되어야 합니다.
-        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+        // 그리기에 쓰는 텍스쳐, 업로드 중인 텍스쳐, 쓰지 않아 남겨 둔 텍스쳐 모두 텍스쳐 캐시에 있습니다.
+        // 업로드가 끝나기 전에 종료하면 아직 그리기에 쓰지 않은 텍스쳐와 메쉬가 남아 있을 수 있습니다. 업로드 배치는 아래에서 기다리므로 먼저 기다린 뒤에 지웁니다.
+        uploadContext.waitAll();
+        textureCache.clear();
+        texture = TextureResource{};
+        pendingTexture = TextureResource{};
 
         // 물론 C++의 동적 메모리 할당과 마찬가지로 메모리는 어느 시점에선 해제되어야 합니다. 버퍼 객체에 묶인 메모리는 버퍼가 더 이상 사용되지 않으면 해제될 수 있으므로 버퍼가 파괴된 후에 해제하도록 합니다. 버퍼는 프로그램이 끝날 때까지 명령을 렌더링하는 데 사용할 수 있어야 하며 스왑 체인에 의존하지 않으므로 cleanup()에서 정리 하였습니다.
-        // 버텍스 버퍼를 지웁니다.
-        vkDestroyBuffer(device, vertexBuffer, nullptr);
-        vkFreeMemory(device, vertexBufferMemory, nullptr);
-        // 인덱스 버퍼를 지웁니다. 인덱스 버퍼는 버텍스 버퍼와 마찬가지로 프로그램 끝에서 정리해야 합니다.
-        vkDestroyBuffer(device, indexBuffer, nullptr);
-        vkFreeMemory(device, indexBufferMemory, nullptr);
+        // 버텍스 버퍼와 인덱스 버퍼를 지웁니다. 인덱스 버퍼는 버텍스 버퍼와 마찬가지로 프로그램 끝에서 정리해야 합니다.
+        destroyMesh(mesh);
+        if (pendingMesh.vertexBuffer != VK_NULL_HANDLE)
+        {
+            destroyMesh(pendingMesh);
+        }
 
         // 세마포어와 펜스는 모든 명령이 완료되고 더 이상 동기화가 필요하지 않을 때 프로그램 끝에서 정리해야 합니다.
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
@@ -2962,9 +4856,30 @@ private:
             vkDestroyFence(device, inFlightFences[i], nullptr);
         }
 
+        // 남은 업로드 배치를 기다려 스테이징 링 영역을 돌려받은 뒤 업로드 컨텍스트의 명령 풀과 펜스, 스테이징 링 버퍼를 지웁니다.
+        uploadContext.waitAll();
+        collectUploads();
+        uploadContext.destroy();
+        vkDestroyBuffer(device, stagingRingBuffer, nullptr);
+        memoryAllocator.free(stagingRingMemory);
+
+        // GPU 시간 측정기의 타임스탬프 쿼리 풀을 지웁니다.
+        gpuProfiler.destroy();
+
         // 명령은 프로그램 전체에서 화면에 무언가를 그리는 데 사용되므로 풀은 마지막에만 파괴되어야 합니다.
         vkDestroyCommandPool(device, commandPool, nullptr);
 
+        // 모든 리소스의 메모리를 돌려받았으므로 메모리 블록들을 해제합니다.
+        memoryAllocator.destroy();
+
+        // 이번 실행에서 만든 파이프라인까지 담긴 캐시를 저장해서 다음 실행이 컴파일 없이 시작하게 합니다.
+        size_t savedBytes = pipelineCache.save();
+        if (savedBytes != 0)
+        {
+            std::cout << "@ [INFO] : Pipeline cache saved to " << PIPELINE_CACHE_PATH << " (" << savedBytes / 1024 << " KiB)\n";
+        }
+        pipelineCache.destroy();
+
         // 추상적 디바이스 개체를 지웁니다.
         vkDestroyDevice(device, nullptr);
 
@@ -2974,35 +4889,55 @@ private:
             DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
         }
 
-        // 서피스 개체를 지웁니다.
-        vkDestroySurfaceKHR(instance, surface, nullptr);
+        // 서피스 개체를 지웁니다. (헤드리스 모드에서는 만들지 않았습니다.)
+        if (options.headless == false)
+        {
+            vkDestroySurfaceKHR(instance, surface, nullptr);
+        }
 
         // 불칸 개체를 지웁니다. (인스턴스 핸들, 메모리를 직접 관리하기 위한 커스텀 얼로케이터 콜백)
         vkDestroyInstance(instance, nullptr);
 
-        // GLFW 윈도우를 지웁니다.
-        glfwDestroyWindow(window);
+        if (options.headless == false)
+        {
+            // GLFW 윈도우를 지웁니다.
+            glfwDestroyWindow(window);
 
-        // GLFW 를 종료합니다.
-        glfwTerminate();
+            // GLFW 를 종료합니다.
+            glfwTerminate();
+        }
 
 
         // std::unique_ptr 나 std::shared_ptr 등을 써서 우아하게 RAII 를 처리할 수도 있지만 학습을 위해 모든 자원을 명시적으로 소멸합니다.
         // Possible to handle RAII more elegantly with std::unique_ptr or std::shared_ptr etc, but explicitly destroy all resources for learning now.
     }
 
+    // 그래픽스 파이프라인과 렌더 패스를 지웁니다. 프로그램을 끝낼 때만 호출합니다. (스왑 체인 이미지 형식이 바뀌면 recreateSwapChain 이 렌더 패스와 파이프라인만 다시 만듭니다.)
+    HELPER_FUNCTION void destroyRenderPassAndPipeline()
+    {
+        // 그래픽 파이프라인은 일반적인 그리기 작업에 항상 필요하므로 프로그램 종료 시에만 제거해야 합니다. 컴파일 중인 파이프라인을 기다린 뒤 모든 변형과 셰이더 모듈을 지웁니다.
+        pipelineRegistry.destroy();
+
+        // 파이프라인 레이아웃은 프로그램 수명 내내 참조되므로 마지막에 삭제해야 합니다. 디스크립터 세트 레이아웃도 프로그램이 끝날 때까지 새 그래픽 파이프라인을 생성하는 동안 계속 유지되어야 합니다.
+        // 둘 다 레이아웃 캐시에 있으므로 캐시를 비우면 함께 지워집니다.
+        layoutCache.destroy();
+
+        // 파이프라인 레이아웃과 마찬가지로 렌더 패스는 프로그램 전체에서 참조되므로 마지막에만 정리해야 합니다.
+        vkDestroyRenderPass(device, renderPass, nullptr);
+    }
+
     // 스왑 체인을 다시 만들기 전에 이전 버전을 정리합니다. 또는 프로그램 종료를 위해 스왑 체인에 쓰인 모든 개체들을 지웁니다.
     HELPER_FUNCTION void cleanupSwapChain()
     {
         // 스왑 체인을 지울때 깊이 이미지에 관련된 모든 것들도 정리해야 합니다.
         vkDestroyImageView(device, depthImageView, nullptr);
         vkDestroyImage(device, depthImage, nullptr);
-        vkFreeMemory(device, depthImageMemory, nullptr);
+        memoryAllocator.free(depthImageMemory);
 
         // 멀티샘플링을 위해 이미지 컬러 이미지도 만들었으므로 모두 정리해야 합니다.
         vkDestroyImageView(device, colorImageView, nullptr);
         vkDestroyImage(device, colorImage, nullptr);
-        vkFreeMemory(device, colorImageMemory, nullptr);
+        memoryAllocator.free(colorImageMemory);
 
         // 이미지 뷰들과 랜더패스를 지우기 전에 먼저 이들을 사용하고 있는 프레임 버퍼를 삭제해야 합니다.
         for (auto framebuffer : swapChainFramebuffers)
@@ -3010,14 +4945,7 @@ private:
             vkDestroyFramebuffer(device, framebuffer, nullptr);
         }
 
-        // 그래픽 파이프라인은 일반적인 그리기 작업에 항상 필요하므로 프로그램 종료 시에만 제거해야 합니다.
-        vkDestroyPipeline(device, graphicsPipeline, nullptr);
-
-        // 파이프라인 레이아웃은 프로그램 수명 내내 참조되므로 마지막에 삭제해야 합니다.
-        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-
-        // 파이프라인 레이아웃과 마찬가지로 렌더 패스는 프로그램 전체에서 참조되므로 마지막에만 정리해야 합니다.
-        vkDestroyRenderPass(device, renderPass, nullptr);
+        // 그래픽스 파이프라인, 파이프라인 레이아웃, 렌더 패스는 스왑 체인 크기에 묶여 있지 않으므로 여기서 지우지 않습니다. (destroyRenderPassAndPipeline)
 
         // 이미지와 달리 이미지 뷰는 명시적으로 생성되었으므로 프로그램 종료 시 전부 지워야 합니다.
         for (auto imageView : swapChainImageViews)
@@ -3025,15 +4953,366 @@ private:
             vkDestroyImageView(device, imageView, nullptr);
         }
 
+        // 헤드리스 모드의 오프스크린 이미지는 직접 만든 것이므로 메모리까지 직접 지워야 합니다.
+        if (options.headless)
+        {
+            for (size_t i = 0; i < swapChainImages.size(); i++)
+            {
+                vkDestroyImage(device, swapChainImages[i], nullptr);
+                memoryAllocator.free(offscreenImagesMemory[i]);
+            }
+            return;
+        }
+
         // 스왑 체인 개체를 지웁니다.
         vkDestroySwapchainKHR(device, swapChain, nullptr);
     }
 };
 
 
-int main()
+// 버텍스 중복 제거 마이크로 벤치마크 (--bench-obj 의 일부)
+// 로드된 메쉬의 모서리 배열을 다시 펼쳐서 중복 제거만 여러 방식으로 측정합니다. 모든 방식의 결과가 같은지도 확인합니다.
+static void benchmarkVertexDedup(const std::vector<Vertex>& meshVertices, const std::vector<uint32_t>& meshIndices, uint32_t threadCount)
+{
+    // 비교용으로 남겨둔 이전 std::hash<Vertex> 구현 (세 glm 해시의 시프트 / XOR 결합)
+    struct LegacyVertexHash
+    {
+        size_t operator()(Vertex const& vertex) const
+        {
+            return ((std::hash<glm::vec3>()(vertex.position) ^ (std::hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^ (std::hash<glm::vec2>()(vertex.texCoord) << 1);
+        }
+    };
+
+    std::vector<Vertex> corners(meshIndices.size());
+    for (size_t i = 0; i < meshIndices.size(); i++)
+    {
+        corners[i] = meshVertices[meshIndices[i]];
+    }
+
+    // 한 방식을 OBJ_BENCHMARK_RUNS 번 실행하여 가장 빠른 시간과 결과가 같은지를 출력합니다.
+    auto measure = [&](const char* name, auto dedup)
+    {
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        double best = std::numeric_limits<double>::max();
+        for (uint32_t run = 0; run < OBJ_BENCHMARK_RUNS; run++)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            dedup(vertices, indices);
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+        }
+
+        bool identical = vertices.size() == meshVertices.size() && indices == meshIndices
+            && std::memcmp(vertices.data(), meshVertices.data(), vertices.size() * sizeof(Vertex)) == 0;
+        std::cout << "@ [BENCH] dedup " << name << " : " << best << " ms (" << corners.size() / best / 1000.0 << " M corners/s)" << (identical ? "" : " OUTPUT DIFFERS") << "\n";
+    };
+
+    // 1. 이전 loadModel 의 방식 : 노드 기반 unordered_map, count() 후 operator[] 로 두 번 해시
+    measure("unordered_map legacy hash", [&](std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        vertices.clear();
+        indices.clear();
+        std::unordered_map<Vertex, uint32_t, LegacyVertexHash> uniqueVertices{};
+        for (const Vertex& vertex : corners)
+        {
+            if (uniqueVertices.count(vertex) == 0)
+            {
+                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+                vertices.push_back(vertex);
+            }
+            indices.push_back(uniqueVertices[vertex]);
+        }
+    });
+
+    // 2. 해시 함수만 바꾼 unordered_map (한 번의 emplace 로 조회와 삽입)
+    measure("unordered_map hashVertex", [&](std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        vertices.clear();
+        indices.clear();
+        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+        for (const Vertex& vertex : corners)
+        {
+            auto inserted = uniqueVertices.emplace(vertex, static_cast<uint32_t>(vertices.size()));
+            if (inserted.second)
+            {
+                vertices.push_back(vertex);
+            }
+            indices.push_back(inserted.first->second);
+        }
+    });
+
+    // 3. 선형 탐사 테이블 (단일 스레드 / 멀티 스레드)
+    measure("VertexTable 1 thread", [&](std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        VertexDedup::deduplicate<Vertex>(corners.size(), 1, [&](size_t corner) { return corners[corner]; }, vertices, indices);
+    });
+    std::string parallelName = "VertexTable " + std::to_string(threadCount) + " threads";
+    measure(parallelName.c_str(), [&](std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        VertexDedup::deduplicate<Vertex>(corners.size(), threadCount, [&](size_t corner) { return corners[corner]; }, vertices, indices);
+    });
+}
+
+// OBJ 로드 벤치마크 (--bench-obj)
+// 같은 파일을 단일 스레드 경로와 멀티스레드 경로로 OBJ_BENCHMARK_RUNS 번씩 로드하여 시간을 비교하고, 두 결과가 같은지 확인합니다. Vulkan 은 초기화하지 않습니다.
+static int benchmarkObjImport(const std::string& path, uint32_t importThreads)
+{
+    // 첫 번째로 측정되는 경로만 디스크에서 읽는 시간을 떠안지 않도록 파일 전체를 미리 한 번 읽어 페이지 캐시에 올려둡니다.
+    uint64_t sourceHash = 0;
+    uint64_t sourceSize = 0;
+    if (MeshCache::hashSourceFile(path, sourceHash, sourceSize) == false)
+    {
+        std::cerr << "\033[1;31m@ [ERROR] : Failed to open OBJ File : " << path << "\033[0m\n";
+        return EXIT_FAILURE;
+    }
+
+    uint32_t threadCount = VertexDedup::resolveThreadCount(importThreads);
+    std::cout << "@ [BENCH] " << path << " (" << sourceSize / (1024.0 * 1024.0) << " MiB), " << threadCount << " threads, " << OBJ_BENCHMARK_RUNS << " runs\n";
+    std::cout << "@ [BENCH] path,run,total_ms,parse_ms,dedup_ms\n";
+
+    std::vector<Vertex> serialVertices, parallelVertices;
+    std::vector<uint32_t> serialIndices, parallelIndices;
+    double serialBest = std::numeric_limits<double>::max();
+    double parallelBest = std::numeric_limits<double>::max();
+
+    for (uint32_t run = 0; run < OBJ_BENCHMARK_RUNS; run++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        loadObjSerial(path, serialVertices, serialIndices);
+        double serialMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        serialBest = std::min(serialBest, serialMs);
+        std::cout << "@ [BENCH] serial," << run << "," << serialMs << ",,\n";
+
+        double parseMs = 0.0;
+        double dedupMs = 0.0;
+        start = std::chrono::high_resolution_clock::now();
+        loadObjParallel(path, threadCount, parallelVertices, parallelIndices, &parseMs, &dedupMs);
+        double parallelMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        parallelBest = std::min(parallelBest, parallelMs);
+        std::cout << "@ [BENCH] parallel," << run << "," << parallelMs << "," << parseMs << "," << dedupMs << "\n";
+    }
+
+    std::cout << "@ [BENCH] serial best " << serialBest << " ms, parallel best " << parallelBest << " ms (x" << serialBest / parallelBest << ")\n";
+    std::cout << "@ [BENCH] " << parallelVertices.size() << " vertices, " << parallelIndices.size() << " indices\n";
+
+    // 사각형 이상의 면이 있으면 두 파서의 삼각형 분할 방식이 달라 결과가 다를 수 있으므로 실패로 처리하지 않고 경고만 출력합니다.
+    bool identical = serialVertices.size() == parallelVertices.size() && serialIndices == parallelIndices
+        && std::memcmp(serialVertices.data(), parallelVertices.data(), serialVertices.size() * sizeof(Vertex)) == 0;
+    if (identical)
+    {
+        std::cout << "@ [BENCH] Outputs are identical\n";
+    }
+    else
+    {
+        std::cout << "@ [WARNING] : Serial and parallel outputs differ (" << serialVertices.size() << " vs " << parallelVertices.size() << " vertices). Models with non-triangle faces are triangulated differently by the two parsers.\n";
+    }
+
+    benchmarkVertexDedup(parallelVertices, parallelIndices, threadCount);
+
+    // 로드 직후 적용하는 메쉬 최적화의 비용과 효과
+    MeshOptimizer::Report report = MeshOptimizer::optimize(parallelVertices, parallelIndices, offsetof(Vertex, position));
+    std::cout << "@ [BENCH] mesh optimize : " << report.milliseconds << " ms, ACMR " << report.before.acmr << " -> " << report.after.acmr << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << ", " << report.clusterCount << " overdraw clusters\n";
+    return EXIT_SUCCESS;
+}
+
+
+// 사용법 출력
+static void printUsage(const char* programName)
+{
+    std::cout << "Usage : " << programName << " [--headless] [--frames N] [--width W] [--height H] [--allocator linear|buddy|tlsf] [--import-threads N] [--no-mesh-optimize] [--no-quantize] [--gpu-mipmaps] [--no-texture-atlas] [--texture-format auto|rgba8|bc1|bc3|bc7] [--no-texture-streaming] [--texture-budget-mb N] [--texture-cache-mb N] [--no-pipeline-cache] [--no-shader-reload] [--staging-mb N] [--bench-obj PATH]\n"
+        << "\t--headless   Render offscreen without a window and print per-frame CPU / GPU times\n"
+        << "\t--frames N   Number of frames to render in headless mode (default " << DEFAULT_BENCHMARK_FRAMES << ")\n"
+        << "\t--width W    Offscreen render target width in headless mode (default " << WIDTH << ")\n"
+        << "\t--height H   Offscreen render target height in headless mode (default " << HEIGHT << ")\n"
+        << "\t--allocator  Sub-allocation strategy inside device memory blocks (default tlsf)\n"
+        << "\t--import-threads N  Threads used to parse and deduplicate OBJ files and to compress textures (default : hardware threads)\n"
+        << "\t--no-mesh-optimize  Keep the OBJ triangle / vertex order (skip vertex cache, overdraw and vertex fetch optimization)\n"
+        << "\t--no-quantize       Upload 32-byte float vertices instead of the per-mesh compact format (16-bit positions / UVs)\n"
+        << "\t--gpu-mipmaps       Upload only mip level 0 and fill the other levels with vkCmdBlitImage instead of the CPU mip builder\n"
+        << "\t--no-texture-atlas  Use only the default texture instead of packing the model's material textures into one atlas\n"
+        << "\t--texture-format F  Texture upload format (default auto : BC1 for opaque, BC7 for transparent textures, RGBA8 without BC support)\n"
+        << "\t--no-texture-streaming  Upload every mip level at once instead of streaming levels by screen size and memory budget\n"
+        << "\t--texture-budget-mb N   Memory budget for streamed textures (default : VK_EXT_memory_budget heap budget, or the heap size)\n"
+        << "\t--texture-cache-mb N    Memory kept for textures no longer in use so they can be shared again without decoding or uploading (default " << DEFAULT_TEXTURE_CACHE_MIB << " MiB, 0 deletes them right away)\n"
+        << "\t--no-pipeline-cache     Compile pipelines without loading or saving " << PIPELINE_CACHE_PATH << "\n"
+        << "\t--no-shader-reload      Do not watch the GLSL shader sources for changes (shaders are still compiled at startup)\n"
+        << "\t--staging-mb N      Size of the persistent staging ring shared by all uploads (default " << DEFAULT_STAGING_RING_MIB << " MiB)\n"
+        << "\t--bench-obj PATH    Compare single-threaded and multithreaded OBJ loading on PATH and exit\n";
+}
+
+// 커맨드 라인 인수를 AppOptions 로 해석합니다. 잘못된 인수가 있으면 예외를 던집니다.
+static AppOptions parseOptions(int argc, char* argv[])
+{
+    AppOptions options;
+
+    // 숫자 값을 받는 옵션의 다음 인수를 읽어옵니다.
+    // 0 에 뜻이 있는 옵션(--texture-cache-mb 0 : 캐시하지 않음)만 allowZero 로 0 을 받습니다.
+    auto nextValue = [&](int& i, bool allowZero = false) -> uint32_t
+    {
+        if (i + 1 >= argc)
+        {
+            throw std::invalid_argument(std::string("Missing value for ") + argv[i]);
+        }
+        unsigned long value = std::stoul(argv[++i]);
+        if ((value == 0 && allowZero == false) || value > std::numeric_limits<uint32_t>::max())
+        {
+            throw std::invalid_argument(std::string("Invalid value for ") + argv[i - 1]);
+        }
+        return static_cast<uint32_t>(value);
+    };
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--headless")
+        {
+            options.headless = true;
+        }
+        else if (arg == "--frames")
+        {
+            options.benchmarkFrames = nextValue(i);
+        }
+        else if (arg == "--width")
+        {
+            options.width = nextValue(i);
+        }
+        else if (arg == "--height")
+        {
+            options.height = nextValue(i);
+        }
+        else if (arg == "--allocator" && i + 1 < argc)
+        {
+            std::string strategy = argv[++i];
+            if (strategy == "linear")
+            {
+                options.allocatorStrategy = AllocationStrategy::Linear;
+            }
+            else if (strategy == "buddy")
+            {
+                options.allocatorStrategy = AllocationStrategy::Buddy;
+            }
+            else if (strategy == "tlsf")
+            {
+                options.allocatorStrategy = AllocationStrategy::Tlsf;
+            }
+            else
+            {
+                throw std::invalid_argument("Unknown allocator : " + strategy);
+            }
+        }
+        else if (arg == "--import-threads")
+        {
+            options.importThreads = nextValue(i);
+        }
+        else if (arg == "--no-mesh-optimize")
+        {
+            options.optimizeMesh = false;
+        }
+        else if (arg == "--no-quantize")
+        {
+            options.quantizeVertices = false;
+        }
+        else if (arg == "--no-texture-atlas")
+        {
+            options.textureAtlas = false;
+        }
+        else if (arg == "--gpu-mipmaps")
+        {
+            options.cpuMipmaps = false;
+        }
+        else if (arg == "--texture-format" && i + 1 < argc)
+        {
+            std::string format = argv[++i];
+            if (format == "auto")
+            {
+                options.textureCompression = TextureCompression::Auto;
+            }
+            else if (format == "rgba8")
+            {
+                options.textureCompression = TextureCompression::None;
+            }
+            else if (format == "bc1")
+            {
+                options.textureCompression = TextureCompression::Bc1;
+            }
+            else if (format == "bc3")
+            {
+                options.textureCompression = TextureCompression::Bc3;
+            }
+            else if (format == "bc7")
+            {
+                options.textureCompression = TextureCompression::Bc7;
+            }
+            else
+            {
+                throw std::invalid_argument("Unknown texture format : " + format);
+            }
+        }
+        else if (arg == "--no-texture-streaming")
+        {
+            options.textureStreaming = false;
+        }
+        else if (arg == "--texture-budget-mb")
+        {
+            options.textureBudgetMiB = nextValue(i);
+        }
+        else if (arg == "--texture-cache-mb")
+        {
+            options.textureCacheMiB = nextValue(i, true);
+        }
+        else if (arg == "--no-pipeline-cache")
+        {
+            options.pipelineCache = false;
+        }
+        else if (arg == "--no-shader-reload")
+        {
+            options.shaderReload = false;
+        }
+        else if (arg == "--staging-mb")
+        {
+            options.stagingRingMiB = nextValue(i);
+        }
+        else if (arg == "--bench-obj" && i + 1 < argc)
+        {
+            options.benchObjPath = argv[++i];
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown argument : " + arg);
+        }
+    }
+
+    return options;
+}
+
+int main(int argc, char* argv[])
 {
-    HelloTriangleApplication app;
+    AppOptions options;
+    try
+    {
+        options = parseOptions(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (options.benchObjPath.empty() == false)
+    {
+        try
+        {
+            return benchmarkObjImport(options.benchObjPath, options.importThreads);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    HelloTriangleApplication app(options);
 
     // HelloTriangleApplication 앱을 실행하다 오류 발생시 main 에서 에외를 받습니다. | Exception will propagate back to the main function.
     try
@@ -0,0 +1,153 @@
+#pragma once
+
+// 읽기 전용 메모리 매핑 파일
+// 파일 내용을 std::vector 로 읽어오는 대신 운영체제의 페이지 캐시를 그대로 주소 공간에 매핑합니다. 큰 캐시 파일을 복사 없이 바로 스테이징 버퍼로 옮길 때 사용합니다.
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    // 파일을 엽니다. 파일이 없거나 비어 있으면 false 를 반환합니다.
+    bool open(const std::string& path)
+    {
+        close();
+
+#ifdef _WIN32
+        fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (fileHandle == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize{};
+        if (GetFileSizeEx(fileHandle, &fileSize) == FALSE || fileSize.QuadPart == 0)
+        {
+            close();
+            return false;
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+
+        mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle == nullptr)
+        {
+            close();
+            return false;
+        }
+
+        data = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+        fileDescriptor = ::open(path.c_str(), O_RDONLY);
+        if (fileDescriptor < 0)
+        {
+            return false;
+        }
+
+        struct stat fileStat{};
+        if (fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0)
+        {
+            close();
+            return false;
+        }
+        size = static_cast<size_t>(fileStat.st_size);
+
+        data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        if (data == MAP_FAILED)
+        {
+            data = nullptr;
+        }
+#endif
+
+        if (data == nullptr)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (data != nullptr)
+        {
+            UnmapViewOfFile(data);
+        }
+        if (mappingHandle != nullptr)
+        {
+            CloseHandle(mappingHandle);
+            mappingHandle = nullptr;
+        }
+        if (fileHandle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(fileHandle);
+            fileHandle = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (data != nullptr)
+        {
+            munmap(data, size);
+        }
+        if (fileDescriptor >= 0)
+        {
+            ::close(fileDescriptor);
+            fileDescriptor = -1;
+        }
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    bool isOpen() const
+    {
+        return data != nullptr;
+    }
+
+    const uint8_t* getData() const
+    {
+        return static_cast<const uint8_t*>(data);
+    }
+
+    size_t getSize() const
+    {
+        return size;
+    }
+
+private:
+    void* data = nullptr;
+    size_t size = 0;
+
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+};
@@ -0,0 +1,916 @@
+#pragma once
+
+// 디바이스 메모리 부분 할당기
+// 리소스마다 vkAllocateMemory 를 호출하면 maxMemoryAllocationCount 한도(일부 하드웨어에서는 4096개)에 금방 도달하고 할당 자체의 비용도 큽니다.
+// 이 할당기는 메모리 유형(findMemoryType 의 결과)마다 풀을 두고, 풀은 큰 VkDeviceMemory 블록을 만들어 그 안의 정렬된 구간을 나누어 줍니다.
+// 블록 안의 구간 관리 방식은 선형(Linear), 버디(Buddy), TLSF 중에서 고를 수 있습니다. 블록 크기의 절반보다 큰 리소스는 전용 할당(dedicated)을 사용합니다.
+// 구간 관리 로직(LinearSubAllocator, BuddySubAllocator, TlsfSubAllocator)은 불칸 호출 없이 오프셋만 다루므로 따로 떼어 검증할 수 있습니다.
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <set>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+#include <cstdint>
+
+
+// 블록 안의 구간을 나누는 방식
+enum class AllocationStrategy
+{
+    Linear, // 앞에서부터 차례로 잘라줍니다. 가장 빠르지만 블록의 모든 구간이 해제되어야 공간이 재사용됩니다. (수명이 비슷한 리소스를 한꺼번에 올릴 때 적합)
+    Buddy,  // 2의 거듭제곱 크기로 나누고 합칩니다. 외부 단편화가 적고 예측 가능하지만 크기를 올림하므로 내부 단편화가 생깁니다.
+    Tlsf,   // Two-Level Segregated Fit. 임의 크기를 O(1) 에 가까운 시간으로 할당/해제하며 인접한 빈 구간을 즉시 합칩니다.
+};
+
+inline const char* toString(AllocationStrategy strategy)
+{
+    switch (strategy)
+    {
+    case AllocationStrategy::Linear:
+        return "linear";
+    case AllocationStrategy::Buddy:
+        return "buddy";
+    case AllocationStrategy::Tlsf:
+        return "tlsf";
+    }
+    return "unknown";
+}
+
+
+// 블록 하나의 사용 현황. 단편화 정도는 1 - (가장 큰 빈 구간 / 전체 빈 공간) 으로 계산합니다. 빈 공간이 하나로 모여 있으면 0 입니다.
+struct SubAllocatorStats
+{
+    VkDeviceSize capacity = 0;          // 블록 크기
+    VkDeviceSize usedBytes = 0;         // 요청된 크기의 합
+    VkDeviceSize reservedBytes = 0;     // 정렬 및 올림을 포함하여 실제로 점유된 크기의 합
+    VkDeviceSize freeBytes = 0;         // 다시 할당할 수 있는 크기의 합
+    VkDeviceSize largestFreeRange = 0;  // 한 번에 할당할 수 있는 가장 큰 연속 구간
+    uint32_t freeRangeCount = 0;        // 연속된 빈 구간의 수
+    uint32_t allocationCount = 0;
+
+    double fragmentation() const
+    {
+        return freeBytes == 0 ? 0.0 : 1.0 - static_cast<double>(largestFreeRange) / static_cast<double>(freeBytes);
+    }
+};
+
+
+// 블록 안의 오프셋을 관리하는 인터페이스
+class SubAllocator
+{
+public:
+    virtual ~SubAllocator() = default;
+
+    // 성공하면 offset 과 해제할 때 넘길 handle 을 채우고 true 를 반환합니다. 공간이 없으면 false 를 반환합니다.
+    virtual bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint64_t& handle) = 0;
+    virtual void free(uint64_t handle) = 0;
+    virtual SubAllocatorStats getStats() const = 0;
+    virtual bool isEmpty() const = 0;
+
+protected:
+    static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+};
+
+
+// 선형 할당기 : 헤드 포인터만 앞으로 움직입니다. 개별 해제는 개수만 세다가 모두 해제되면 처음부터 다시 사용합니다.
+class LinearSubAllocator : public SubAllocator
+{
+public:
+    explicit LinearSubAllocator(VkDeviceSize capacity) : capacity(capacity)
+    {
+    }
+
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint64_t& handle) override
+    {
+        VkDeviceSize aligned = alignUp(head, alignment);
+        if (aligned + size > capacity)
+        {
+            return false;
+        }
+
+        offset = aligned;
+        handle = size;
+        head = aligned + size;
+        usedBytes += size;
+        allocationCount++;
+        return true;
+    }
+
+    void free(uint64_t handle) override
+    {
+        usedBytes -= handle;
+        if (--allocationCount == 0)
+        {
+            head = 0;
+        }
+    }
+
+    SubAllocatorStats getStats() const override
+    {
+        SubAllocatorStats stats;
+        stats.capacity = capacity;
+        stats.usedBytes = usedBytes;
+        stats.reservedBytes = head;
+        stats.freeBytes = capacity - head;
+        stats.largestFreeRange = capacity - head;
+        stats.freeRangeCount = (capacity > head) ? 1 : 0;
+        stats.allocationCount = allocationCount;
+        return stats;
+    }
+
+    bool isEmpty() const override
+    {
+        return allocationCount == 0;
+    }
+
+private:
+    VkDeviceSize capacity;
+    VkDeviceSize head = 0;
+    VkDeviceSize usedBytes = 0;
+    uint32_t allocationCount = 0;
+};
+
+
+// 버디 할당기 : 블록을 반으로 계속 나누어 요청 크기 이상인 가장 작은 2의 거듭제곱 조각을 줍니다. 해제할 때 짝(buddy)이 비어 있으면 다시 합칩니다.
+// 크기가 2^k 인 조각은 항상 2^k 에 정렬된 위치에 있으므로 정렬 요구 사항은 크기를 올림하는 것만으로 만족됩니다. capacity 는 2의 거듭제곱이어야 합니다.
+class BuddySubAllocator : public SubAllocator
+{
+public:
+    static constexpr VkDeviceSize MIN_BLOCK_SIZE = 256;
+
+    explicit BuddySubAllocator(VkDeviceSize capacity) : capacity(capacity)
+    {
+        if (capacity < MIN_BLOCK_SIZE || (capacity & (capacity - 1)) != 0)
+        {
+            throw std::invalid_argument("Buddy allocator capacity must be a power of two!");
+        }
+
+        uint32_t orderCount = 1;
+        while ((MIN_BLOCK_SIZE << (orderCount - 1)) < capacity)
+        {
+            orderCount++;
+        }
+        freeLists.resize(orderCount);
+        freeLists[orderCount - 1].insert(0);
+    }
+
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint64_t& handle) override
+    {
+        VkDeviceSize needed = std::max({ size, alignment, MIN_BLOCK_SIZE });
+        uint32_t order = 0;
+        while (blockSize(order) < needed)
+        {
+            if (++order >= freeLists.size())
+            {
+                return false;
+            }
+        }
+
+        // 필요한 크기 이상의 빈 조각 중 가장 작은 것을 찾습니다.
+        uint32_t found = order;
+        while (found < freeLists.size() && freeLists[found].empty())
+        {
+            found++;
+        }
+        if (found == freeLists.size())
+        {
+            return false;
+        }
+
+        // 찾은 조각을 필요한 크기가 될 때까지 반으로 나누고 뒤쪽 절반은 빈 목록에 넣습니다.
+        VkDeviceSize blockOffset = *freeLists[found].begin();
+        freeLists[found].erase(freeLists[found].begin());
+        while (found > order)
+        {
+            found--;
+            freeLists[found].insert(blockOffset + blockSize(found));
+        }
+
+        allocations[blockOffset] = { order, size };
+        usedBytes += size;
+        reservedBytes += blockSize(order);
+
+        offset = blockOffset;
+        handle = blockOffset;
+        return true;
+    }
+
+    void free(uint64_t handle) override
+    {
+        auto it = allocations.find(handle);
+        if (it == allocations.end())
+        {
+            return;
+        }
+
+        VkDeviceSize blockOffset = it->first;
+        uint32_t order = it->second.order;
+        usedBytes -= it->second.size;
+        reservedBytes -= blockSize(order);
+        allocations.erase(it);
+
+        // 짝이 비어 있는 동안 계속 합쳐 올라갑니다.
+        while (order + 1 < freeLists.size())
+        {
+            VkDeviceSize buddy = blockOffset ^ blockSize(order);
+            auto buddyIt = freeLists[order].find(buddy);
+            if (buddyIt == freeLists[order].end())
+            {
+                break;
+            }
+            freeLists[order].erase(buddyIt);
+            blockOffset = std::min(blockOffset, buddy);
+            order++;
+        }
+        freeLists[order].insert(blockOffset);
+    }
+
+    SubAllocatorStats getStats() const override
+    {
+        SubAllocatorStats stats;
+        stats.capacity = capacity;
+        stats.usedBytes = usedBytes;
+        stats.reservedBytes = reservedBytes;
+        stats.freeBytes = capacity - reservedBytes;
+        stats.allocationCount = static_cast<uint32_t>(allocations.size());
+
+        // 서로 다른 크기의 빈 조각이 붙어 있을 수 있으므로 오프셋 순으로 정렬해 실제 연속 구간을 셉니다.
+        std::vector<std::pair<VkDeviceSize, VkDeviceSize>> ranges;
+        for (uint32_t order = 0; order < freeLists.size(); order++)
+        {
+            for (VkDeviceSize blockOffset : freeLists[order])
+            {
+                ranges.push_back({ blockOffset, blockSize(order) });
+            }
+        }
+        std::sort(ranges.begin(), ranges.end());
+
+        VkDeviceSize rangeEnd = 0;
+        VkDeviceSize rangeSize = 0;
+        for (const auto& range : ranges)
+        {
+            if (rangeSize > 0 && range.first == rangeEnd)
+            {
+                rangeSize += range.second;
+            }
+            else
+            {
+                stats.freeRangeCount++;
+                rangeSize = range.second;
+            }
+            rangeEnd = range.first + range.second;
+            stats.largestFreeRange = std::max(stats.largestFreeRange, rangeSize);
+        }
+        return stats;
+    }
+
+    bool isEmpty() const override
+    {
+        return allocations.empty();
+    }
+
+private:
+    struct Allocation
+    {
+        uint32_t order;
+        VkDeviceSize size;
+    };
+
+    VkDeviceSize blockSize(uint32_t order) const
+    {
+        return MIN_BLOCK_SIZE << order;
+    }
+
+    VkDeviceSize capacity;
+    VkDeviceSize usedBytes = 0;
+    VkDeviceSize reservedBytes = 0;
+    std::vector<std::set<VkDeviceSize>> freeLists;                  // 크기 단계(order)별 빈 조각의 오프셋
+    std::unordered_map<VkDeviceSize, Allocation> allocations;       // 할당된 조각의 오프셋 -> 크기 단계
+};
+
+
+// TLSF 할당기 : 빈 구간을 크기에 따라 2단계(2의 거듭제곱 구간 x 그 안의 SL_COUNT 등분)로 분류한 목록에 보관하고, 비트맵으로 알맞은 목록을 바로 찾습니다.
+// 모든 구간은 GRANULARITY 의 배수로 관리하며, 해제 시 물리적으로 인접한 빈 구간과 즉시 합치므로 빈 구간끼리 붙어 있는 경우는 없습니다.
+class TlsfSubAllocator : public SubAllocator
+{
+public:
+    static constexpr VkDeviceSize GRANULARITY = 256;
+
+    explicit TlsfSubAllocator(VkDeviceSize capacity) : capacity(capacity / GRANULARITY * GRANULARITY)
+    {
+        for (auto& heads : freeHeads)
+        {
+            std::fill(std::begin(heads), std::end(heads), NONE);
+        }
+        std::fill(std::begin(secondLevelBitmaps), std::end(secondLevelBitmaps), 0u);
+
+        Block block{};
+        block.offset = 0;
+        block.size = this->capacity;
+        block.free = true;
+        block.prevPhysical = block.nextPhysical = NONE;
+        insertFreeBlock(createBlock(block));
+    }
+
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint64_t& handle) override
+    {
+        VkDeviceSize requested = size;
+        size = alignUp(std::max<VkDeviceSize>(size, 1), GRANULARITY);
+
+        // GRANULARITY 보다 큰 정렬은 앞쪽에 남을 수 있는 여백만큼 더 큰 구간을 찾습니다.
+        VkDeviceSize searchSize = size + ((alignment > GRANULARITY) ? alignment - GRANULARITY : 0);
+        uint32_t index = findSuitableBlock(searchSize);
+        if (index == NONE)
+        {
+            return false;
+        }
+        removeFreeBlock(index);
+
+        // 정렬을 맞추기 위한 앞쪽 여백은 별도의 빈 구간으로 떼어냅니다. (여백도 GRANULARITY 의 배수입니다.)
+        VkDeviceSize padding = alignUp(blocks[index].offset, std::max(alignment, GRANULARITY)) - blocks[index].offset;
+        if (padding > 0)
+        {
+            uint32_t front = splitFront(index, padding);
+            insertFreeBlock(front);
+        }
+
+        // 남는 뒤쪽 공간도 빈 구간으로 돌려줍니다.
+        if (blocks[index].size - size >= GRANULARITY)
+        {
+            uint32_t back = splitFront(index, size);
+            std::swap(index, back);
+            insertFreeBlock(back);
+        }
+
+        Block& block = blocks[index];
+        block.free = false;
+        block.requestedSize = requested;
+        usedBytes += requested;
+        reservedBytes += block.size;
+        allocationCount++;
+
+        offset = block.offset;
+        handle = index;
+        return true;
+    }
+
+    void free(uint64_t handle) override
+    {
+        uint32_t index = static_cast<uint32_t>(handle);
+        Block& block = blocks[index];
+        usedBytes -= block.requestedSize;
+        reservedBytes -= block.size;
+        allocationCount--;
+        block.free = true;
+
+        // 앞뒤의 빈 구간과 합칩니다.
+        uint32_t prev = block.prevPhysical;
+        if (prev != NONE && blocks[prev].free)
+        {
+            removeFreeBlock(prev);
+            index = mergeWithNext(prev);
+        }
+        uint32_t next = blocks[index].nextPhysical;
+        if (next != NONE && blocks[next].free)
+        {
+            removeFreeBlock(next);
+            index = mergeWithNext(index);
+        }
+        insertFreeBlock(index);
+    }
+
+    SubAllocatorStats getStats() const override
+    {
+        SubAllocatorStats stats;
+        stats.capacity = capacity;
+        stats.usedBytes = usedBytes;
+        stats.reservedBytes = reservedBytes;
+        stats.freeBytes = capacity - reservedBytes;
+        stats.allocationCount = allocationCount;
+        for (const Block& block : blocks)
+        {
+            if (block.size > 0 && block.free)
+            {
+                stats.freeRangeCount++;
+                stats.largestFreeRange = std::max(stats.largestFreeRange, block.size);
+            }
+        }
+        return stats;
+    }
+
+    bool isEmpty() const override
+    {
+        return allocationCount == 0;
+    }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    static constexpr uint32_t SL_LOG2 = 4;                      // 2의 거듭제곱 구간 하나를 16 등분합니다.
+    static constexpr uint32_t SL_COUNT = 1u << SL_LOG2;
+    static constexpr uint32_t GRANULARITY_LOG2 = 8;
+    static constexpr uint32_t FL_COUNT = 64 - GRANULARITY_LOG2;
+
+    struct Block
+    {
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;              // 0 이면 재사용을 기다리는 빈 슬롯입니다.
+        VkDeviceSize requestedSize = 0;
+        bool free = false;
+        uint32_t prevPhysical = NONE;       // 오프셋 순으로 인접한 구간
+        uint32_t nextPhysical = NONE;
+        uint32_t prevFree = NONE;           // 같은 크기 분류의 빈 구간 목록
+        uint32_t nextFree = NONE;
+    };
+
+    static uint32_t log2(VkDeviceSize value)
+    {
+        uint32_t result = 0;
+        while (value >>= 1)
+        {
+            result++;
+        }
+        return result;
+    }
+
+    // 크기가 속하는 분류를 계산합니다. GRANULARITY * SL_COUNT 미만의 작은 구간은 첫 번째 분류를 GRANULARITY 단위로 나누어 씁니다.
+    static void mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl)
+    {
+        VkDeviceSize units = size >> GRANULARITY_LOG2;
+        if (units < SL_COUNT)
+        {
+            fl = 0;
+            sl = static_cast<uint32_t>(units);
+            return;
+        }
+        uint32_t msb = log2(units);
+        fl = msb - SL_LOG2 + 1;
+        sl = static_cast<uint32_t>((units >> (msb - SL_LOG2)) ^ SL_COUNT);
+    }
+
+    // 분류 안의 어떤 구간이든 size 이상이 되도록 다음 분류의 경계까지 올림한 뒤 분류를 계산합니다.
+    uint32_t findSuitableBlock(VkDeviceSize size) const
+    {
+        VkDeviceSize units = size >> GRANULARITY_LOG2;
+        if (units >= SL_COUNT)
+        {
+            units += (VkDeviceSize(1) << (log2(units) - SL_LOG2)) - 1;
+        }
+
+        uint32_t fl, sl;
+        mapping(units << GRANULARITY_LOG2, fl, sl);
+        if (fl >= FL_COUNT)
+        {
+            return NONE;
+        }
+
+        uint32_t slMap = secondLevelBitmaps[fl] & (~0u << sl);
+        if (slMap == 0)
+        {
+            uint64_t flMap = firstLevelBitmap & (fl + 1 < 64 ? (~0ull << (fl + 1)) : 0);
+            if (flMap == 0)
+            {
+                return NONE;
+            }
+            fl = lowestBit(flMap);
+            slMap = secondLevelBitmaps[fl];
+        }
+        sl = lowestBit(slMap);
+        return freeHeads[fl][sl];
+    }
+
+    static uint32_t lowestBit(uint64_t value)
+    {
+        uint32_t result = 0;
+        while ((value & 1) == 0)
+        {
+            value >>= 1;
+            result++;
+        }
+        return result;
+    }
+
+    uint32_t createBlock(const Block& block)
+    {
+        if (recycledBlocks.empty() == false)
+        {
+            uint32_t index = recycledBlocks.back();
+            recycledBlocks.pop_back();
+            blocks[index] = block;
+            return index;
+        }
+        blocks.push_back(block);
+        return static_cast<uint32_t>(blocks.size()) - 1;
+    }
+
+    void insertFreeBlock(uint32_t index)
+    {
+        Block& block = blocks[index];
+        block.free = true;
+        uint32_t fl, sl;
+        mapping(block.size, fl, sl);
+
+        block.prevFree = NONE;
+        block.nextFree = freeHeads[fl][sl];
+        if (block.nextFree != NONE)
+        {
+            blocks[block.nextFree].prevFree = index;
+        }
+        freeHeads[fl][sl] = index;
+        secondLevelBitmaps[fl] |= 1u << sl;
+        firstLevelBitmap |= 1ull << fl;
+    }
+
+    void removeFreeBlock(uint32_t index)
+    {
+        Block& block = blocks[index];
+        uint32_t fl, sl;
+        mapping(block.size, fl, sl);
+
+        if (block.prevFree != NONE)
+        {
+            blocks[block.prevFree].nextFree = block.nextFree;
+        }
+        else
+        {
+            freeHeads[fl][sl] = block.nextFree;
+        }
+        if (block.nextFree != NONE)
+        {
+            blocks[block.nextFree].prevFree = block.prevFree;
+        }
+        block.prevFree = block.nextFree = NONE;
+
+        if (freeHeads[fl][sl] == NONE)
+        {
+            secondLevelBitmaps[fl] &= ~(1u << sl);
+            if (secondLevelBitmaps[fl] == 0)
+            {
+                firstLevelBitmap &= ~(1ull << fl);
+            }
+        }
+    }
+
+    // 구간의 앞쪽 frontSize 만큼을 새 구간으로 떼어내 그 번호를 반환합니다. 원래 구간은 뒤쪽이 됩니다.
+    uint32_t splitFront(uint32_t index, VkDeviceSize frontSize)
+    {
+        Block front{};
+        front.offset = blocks[index].offset;
+        front.size = frontSize;
+        front.prevPhysical = blocks[index].prevPhysical;
+        front.nextPhysical = index;
+        uint32_t frontIndex = createBlock(front);
+
+        Block& block = blocks[index];
+        if (block.prevPhysical != NONE)
+        {
+            blocks[block.prevPhysical].nextPhysical = frontIndex;
+        }
+        block.prevPhysical = frontIndex;
+        block.offset += frontSize;
+        block.size -= frontSize;
+        return frontIndex;
+    }
+
+    // 구간을 바로 뒤의 구간과 합치고 남은 구간의 번호를 반환합니다.
+    uint32_t mergeWithNext(uint32_t index)
+    {
+        uint32_t next = blocks[index].nextPhysical;
+        blocks[index].size += blocks[next].size;
+        blocks[index].nextPhysical = blocks[next].nextPhysical;
+        if (blocks[next].nextPhysical != NONE)
+        {
+            blocks[blocks[next].nextPhysical].prevPhysical = index;
+        }
+        blocks[next] = Block{};
+        recycledBlocks.push_back(next);
+        return index;
+    }
+
+    VkDeviceSize capacity;
+    VkDeviceSize usedBytes = 0;
+    VkDeviceSize reservedBytes = 0;
+    uint32_t allocationCount = 0;
+
+    std::vector<Block> blocks;
+    std::vector<uint32_t> recycledBlocks;
+    uint64_t firstLevelBitmap = 0;
+    uint32_t secondLevelBitmaps[FL_COUNT];
+    uint32_t freeHeads[FL_COUNT][SL_COUNT];
+};
+
+
+// 할당 결과. 리소스를 바인딩할 때 memory 와 offset 을 사용합니다.
+struct MemoryAllocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mappedData = nullptr;         // HOST_VISIBLE 메모리 유형이면 블록 전체가 영구적으로 매핑되어 있으며 이 할당의 시작 주소를 가리킵니다.
+
+    // 해제할 때 사용하는 내부 정보
+    uint32_t memoryTypeIndex = 0;
+    uint32_t blockIndex = UINT32_MAX;   // UINT32_MAX 이면 전용 할당입니다.
+    uint64_t handle = 0;
+};
+
+
+class MemoryAllocator
+{
+public:
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, AllocationStrategy strategy, VkDeviceSize preferredBlockSize = DEFAULT_BLOCK_SIZE)
+    {
+        this->device = device;
+        this->strategy = strategy;
+        this->preferredBlockSize = preferredBlockSize;
+
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        bufferImageGranularity = properties.limits.bufferImageGranularity;
+        maxMemoryAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+        pools.clear();
+        pools.resize(memoryProperties.memoryTypeCount);
+    }
+
+    // memoryTypeIndex 의 풀에서 요구 사항에 맞는 구간을 할당합니다. linearResource 는 버퍼나 LINEAR 타일링 이미지이면 true, OPTIMAL 타일링 이미지이면 false 입니다.
+    MemoryAllocation allocate(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, bool linearResource)
+    {
+        VkDeviceSize size = requirements.size;
+        VkDeviceSize alignment = requirements.alignment;
+
+        // 같은 메모리 안에서 버퍼와 OPTIMAL 이미지가 bufferImageGranularity 크기의 페이지를 공유하면 안 됩니다. 이미지의 시작과 끝을 페이지 경계에 맞춰 이미지가 페이지를 단독으로 차지하게 합니다.
+        if (linearResource == false)
+        {
+            alignment = std::max(alignment, bufferImageGranularity);
+            size = (size + bufferImageGranularity - 1) / bufferImageGranularity * bufferImageGranularity;
+        }
+
+        Pool& pool = pools[memoryTypeIndex];
+        VkDeviceSize blockSize = getBlockSize(memoryTypeIndex);
+
+        MemoryAllocation allocation;
+        allocation.memoryTypeIndex = memoryTypeIndex;
+        allocation.size = requirements.size;
+
+        // 큰 리소스는 블록을 낭비하지 않도록 전용 할당을 사용합니다.
+        if (size > blockSize / 2)
+        {
+            allocation.memory = allocateDeviceMemory(size, memoryTypeIndex);
+            allocation.mappedData = mapIfHostVisible(allocation.memory, memoryTypeIndex);
+            pool.dedicatedCount++;
+            pool.dedicatedBytes += allocation.size;
+            return allocation;
+        }
+
+        // 기존 블록에서 먼저 찾아보고, 없으면 새 블록을 만듭니다.
+        for (uint32_t i = 0; i < pool.blocks.size(); i++)
+        {
+            Block& block = pool.blocks[i];
+            if (block.memory != VK_NULL_HANDLE && block.subAllocator->allocate(size, alignment, allocation.offset, allocation.handle))
+            {
+                return fillAllocation(allocation, block, i);
+            }
+        }
+
+        Block block;
+        block.memory = allocateDeviceMemory(blockSize, memoryTypeIndex);
+        block.mappedData = mapIfHostVisible(block.memory, memoryTypeIndex);
+        block.subAllocator = createSubAllocator(blockSize);
+
+        uint32_t blockIndex = static_cast<uint32_t>(pool.blocks.size());
+        for (uint32_t i = 0; i < pool.blocks.size(); i++)
+        {
+            if (pool.blocks[i].memory == VK_NULL_HANDLE)
+            {
+                blockIndex = i;
+                break;
+            }
+        }
+        if (blockIndex == pool.blocks.size())
+        {
+            pool.blocks.push_back(std::move(block));
+        }
+        else
+        {
+            pool.blocks[blockIndex] = std::move(block);
+        }
+
+        if (pool.blocks[blockIndex].subAllocator->allocate(size, alignment, allocation.offset, allocation.handle) == false)
+        {
+            throw std::runtime_error("Failed to sub-allocate memory from a new block!");
+        }
+        return fillAllocation(allocation, pool.blocks[blockIndex], blockIndex);
+    }
+
+    // 할당을 해제하고 allocation 을 빈 상태로 되돌립니다. 빈 할당은 무시합니다.
+    void free(MemoryAllocation& allocation)
+    {
+        if (allocation.memory == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        Pool& pool = pools[allocation.memoryTypeIndex];
+        if (allocation.blockIndex == UINT32_MAX)
+        {
+            pool.dedicatedCount--;
+            pool.dedicatedBytes -= allocation.size;
+            vkFreeMemory(device, allocation.memory, nullptr);
+            deviceMemoryCount--;
+        }
+        else
+        {
+            Block& block = pool.blocks[allocation.blockIndex];
+            block.subAllocator->free(allocation.handle);
+
+            // 풀에 다른 블록이 남아 있으면 완전히 빈 블록은 돌려줍니다. 마지막 블록은 다음 할당을 위해 남겨둡니다.
+            if (block.subAllocator->isEmpty() && countLiveBlocks(pool) > 1)
+            {
+                vkFreeMemory(device, block.memory, nullptr);
+                deviceMemoryCount--;
+                block = Block{};
+            }
+        }
+
+        allocation = MemoryAllocation{};
+    }
+
+    // 모든 블록을 해제합니다. 이 시점에는 모든 리소스가 이미 해제되어 있어야 합니다.
+    void destroy()
+    {
+        for (Pool& pool : pools)
+        {
+            for (Block& block : pool.blocks)
+            {
+                if (block.memory != VK_NULL_HANDLE)
+                {
+                    vkFreeMemory(device, block.memory, nullptr);
+                }
+            }
+            pool.blocks.clear();
+        }
+        pools.clear();
+        deviceMemoryCount = 0;
+    }
+
+    // 현재 살아있는 VkDeviceMemory 개수 (maxMemoryAllocationCount 와 비교할 값)
+    uint32_t getDeviceMemoryCount() const
+    {
+        return deviceMemoryCount;
+    }
+
+    // 메모리 유형별 블록 사용량과 단편화 정도를 출력합니다.
+    void printStats(std::ostream& out, const char* prefix) const
+    {
+        out << prefix << "Memory allocator (" << toString(strategy) << ") : " << deviceMemoryCount << " / " << maxMemoryAllocationCount << " device memory objects\n";
+        for (uint32_t type = 0; type < pools.size(); type++)
+        {
+            const Pool& pool = pools[type];
+            SubAllocatorStats total;
+            uint32_t blockCount = 0;
+            for (const Block& block : pool.blocks)
+            {
+                if (block.memory == VK_NULL_HANDLE)
+                {
+                    continue;
+                }
+                SubAllocatorStats stats = block.subAllocator->getStats();
+                total.capacity += stats.capacity;
+                total.usedBytes += stats.usedBytes;
+                total.reservedBytes += stats.reservedBytes;
+                total.freeBytes += stats.freeBytes;
+                total.freeRangeCount += stats.freeRangeCount;
+                total.allocationCount += stats.allocationCount;
+                total.largestFreeRange = std::max(total.largestFreeRange, stats.largestFreeRange);
+                blockCount++;
+            }
+            if (blockCount == 0 && pool.dedicatedCount == 0)
+            {
+                continue;
+            }
+
+            out << prefix << "  type " << type << " : " << blockCount << " blocks, " << total.allocationCount << " allocations, "
+                << total.usedBytes / 1024 << " KiB used / " << total.reservedBytes / 1024 << " KiB reserved / " << total.capacity / 1024 << " KiB, "
+                << total.freeRangeCount << " free ranges (largest " << total.largestFreeRange / 1024 << " KiB), fragmentation " << static_cast<int>(total.fragmentation() * 100.0) << "%, "
+                << pool.dedicatedCount << " dedicated (" << pool.dedicatedBytes / 1024 << " KiB)\n";
+        }
+    }
+
+private:
+    struct Block
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mappedData = nullptr;
+        std::unique_ptr<SubAllocator> subAllocator;
+    };
+
+    struct Pool
+    {
+        std::vector<Block> blocks;      // 해제된 블록은 memory 가 VK_NULL_HANDLE 인 채로 자리만 남아 MemoryAllocation::blockIndex 를 유지합니다.
+        uint32_t dedicatedCount = 0;
+        VkDeviceSize dedicatedBytes = 0;
+    };
+
+    // 힙이 작은 메모리 유형(예: 256MB BAR 메모리)은 힙 크기의 1/8 을 넘지 않도록 블록을 줄입니다. 버디 할당기를 위해 항상 2의 거듭제곱으로 맞춥니다.
+    VkDeviceSize getBlockSize(uint32_t memoryTypeIndex) const
+    {
+        VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+        VkDeviceSize limit = std::min(preferredBlockSize, heapSize / 8);
+        VkDeviceSize blockSize = BuddySubAllocator::MIN_BLOCK_SIZE;
+        while (blockSize * 2 <= limit)
+        {
+            blockSize *= 2;
+        }
+        return blockSize;
+    }
+
+    std::unique_ptr<SubAllocator> createSubAllocator(VkDeviceSize capacity) const
+    {
+        switch (strategy)
+        {
+        case AllocationStrategy::Linear:
+            return std::make_unique<LinearSubAllocator>(capacity);
+        case AllocationStrategy::Buddy:
+            return std::make_unique<BuddySubAllocator>(capacity);
+        case AllocationStrategy::Tlsf:
+        default:
+            return std::make_unique<TlsfSubAllocator>(capacity);
+        }
+    }
+
+    VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex)
+    {
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+        VkDeviceMemory memory;
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate device memory!");
+        }
+        deviceMemoryCount++;
+        return memory;
+    }
+
+    // 같은 VkDeviceMemory 를 여러 번 매핑할 수 없으므로 HOST_VISIBLE 블록은 만들 때 한 번만 전체를 매핑해 두고 구간마다 주소를 나누어 줍니다.
+    void* mapIfHostVisible(VkDeviceMemory memory, uint32_t memoryTypeIndex)
+    {
+        if ((memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0)
+        {
+            return nullptr;
+        }
+
+        void* data = nullptr;
+        if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to map device memory!");
+        }
+        return data;
+    }
+
+    MemoryAllocation& fillAllocation(MemoryAllocation& allocation, const Block& block, uint32_t blockIndex)
+    {
+        allocation.memory = block.memory;
+        allocation.blockIndex = blockIndex;
+        if (block.mappedData != nullptr)
+        {
+            allocation.mappedData = static_cast<char*>(block.mappedData) + allocation.offset;
+        }
+        return allocation;
+    }
+
+    static uint32_t countLiveBlocks(const Pool& pool)
+    {
+        uint32_t count = 0;
+        for (const Block& block : pool.blocks)
+        {
+            if (block.memory != VK_NULL_HANDLE)
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    VkDevice device = VK_NULL_HANDLE;
+    AllocationStrategy strategy = AllocationStrategy::Tlsf;
+    VkDeviceSize preferredBlockSize = DEFAULT_BLOCK_SIZE;
+    VkDeviceSize bufferImageGranularity = 1;
+    uint32_t maxMemoryAllocationCount = 0;
+    uint32_t deviceMemoryCount = 0;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    std::vector<Pool> pools;
+};
@@ -0,0 +1,169 @@
+#pragma once
+
+// 바이너리 메쉬 캐시
+// OBJ 파싱과 중복 버텍스 제거가 끝난 버텍스 / 인덱스 배열을 그대로 파일에 저장해 두고, 다음 실행부터는 파일을 메모리 매핑하여 파싱 없이 바로 스테이징 버퍼로 복사합니다.
+// 캐시는 소스 파일 내용의 해시, 소스 크기, 메타데이터 크기, 빌드 옵션, 포맷 버전이 모두 같을 때만 유효합니다. 버텍스 크기와 인덱스 크기는 메쉬마다 다를 수 있으므로 헤더에 기록해 두고 메타데이터와 함께 호출하는 쪽에서 해석합니다. 하나라도 다르면 다시 만듭니다.
+//
+// 파일 구조 (리틀 엔디안, 모든 배열은 16 바이트 경계에서 시작)
+// [MeshCacheHeader][메타데이터 : metadataSize (버텍스 형식 등)][버텍스 배열 : vertexCount x vertexStride][인덱스 배열 : indexCount x indexSize]
+
+#include "Hash.h"
+#include "MappedFile.h"
+
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+
+// 캐시를 만드는 과정(OBJ 해석 방식, 버텍스 가공 등)이 바뀌면 반드시 올려서 이전 캐시를 무효화해야 합니다.
+constexpr uint32_t MESH_CACHE_VERSION = 5;
+
+// MeshCacheHeader::buildFlags. 같은 원본이라도 다른 옵션으로 만든 캐시는 사용하지 않습니다.
+constexpr uint32_t MESH_CACHE_FLAG_OPTIMIZED = 1u << 0;    // MeshOptimizer 로 삼각형 / 버텍스 순서를 바꾼 메쉬
+constexpr uint32_t MESH_CACHE_FLAG_QUANTIZED = 1u << 1;    // CompactVertex 로 압축한 버텍스
+
+struct MeshCacheHeader
+{
+    char magic[4];              // "NFMC"
+    uint32_t version;           // MESH_CACHE_VERSION
+    uint64_t sourceHash;        // 원본 파일 내용의 hashBytes
+    uint64_t sourceSize;        // 원본 파일 크기
+    uint32_t vertexStride;      // 버텍스 하나의 바이트 수
+    uint32_t indexSize;         // sizeof(인덱스 타입). 메쉬마다 2 (uint16_t) 또는 4 (uint32_t)
+    uint32_t buildFlags;        // MESH_CACHE_FLAG_* 조합
+    uint32_t metadataSize;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t metadataOffset;    // 파일 시작부터 메타데이터까지의 바이트
+    uint64_t vertexOffset;      // 파일 시작부터 버텍스 배열까지의 바이트
+    uint64_t indexOffset;       // 파일 시작부터 인덱스 배열까지의 바이트
+};
+
+// 매핑된 캐시 파일 안의 배열 위치. 캐시 파일(MappedFile)이 열려 있는 동안만 유효합니다.
+struct MeshCacheView
+{
+    const void* metadata = nullptr;
+    const void* vertices = nullptr;
+    uint32_t vertexStride = 0;
+    uint64_t vertexCount = 0;
+    const void* indices = nullptr;
+    uint32_t indexSize = 0;
+    uint64_t indexCount = 0;
+};
+
+namespace MeshCache
+{
+    inline uint64_t alignOffset(uint64_t offset)
+    {
+        return (offset + 15) & ~uint64_t(15);
+    }
+
+    // 원본 파일 내용을 해시합니다. 파일을 열 수 없으면 false 를 반환합니다.
+    inline bool hashSourceFile(const std::string& path, uint64_t& hash, uint64_t& size)
+    {
+        MappedFile source;
+        if (source.open(path) == false)
+        {
+            return false;
+        }
+        hash = hashBytes(source.getData(), source.getSize());
+        size = source.getSize();
+        return true;
+    }
+
+    // 캐시 파일을 매핑하고 헤더를 검증합니다. 캐시가 없거나 원본 / 포맷과 맞지 않으면 false 를 반환하며 file 은 닫힌 상태가 됩니다.
+    inline bool open(MappedFile& file, const std::string& cachePath, uint64_t sourceHash, uint64_t sourceSize, uint32_t buildFlags, uint32_t metadataSize, MeshCacheView& view)
+    {
+        if (file.open(cachePath) == false)
+        {
+            return false;
+        }
+
+        MeshCacheHeader header{};
+        if (file.getSize() < sizeof(header))
+        {
+            file.close();
+            return false;
+        }
+        std::memcpy(&header, file.getData(), sizeof(header));
+
+        bool valid = std::memcmp(header.magic, "NFMC", 4) == 0
+            && header.version == MESH_CACHE_VERSION
+            && header.sourceHash == sourceHash
+            && header.sourceSize == sourceSize
+            && (header.indexSize == sizeof(uint16_t) || header.indexSize == sizeof(uint32_t))
+            && header.buildFlags == buildFlags
+            && header.metadataSize == metadataSize
+            && header.metadataOffset + metadataSize <= file.getSize()
+            && header.vertexOffset + header.vertexCount * header.vertexStride <= file.getSize()
+            && header.indexOffset + header.indexCount * header.indexSize <= file.getSize();
+        if (valid == false)
+        {
+            file.close();
+            return false;
+        }
+
+        view.metadata = file.getData() + header.metadataOffset;
+        view.vertices = file.getData() + header.vertexOffset;
+        view.vertexStride = header.vertexStride;
+        view.vertexCount = header.vertexCount;
+        view.indices = file.getData() + header.indexOffset;
+        view.indexSize = header.indexSize;
+        view.indexCount = header.indexCount;
+        return true;
+    }
+
+    // 캐시 파일을 씁니다. 쓰는 도중 종료되어도 깨진 캐시가 남지 않도록 임시 파일에 쓴 뒤 이름을 바꿉니다. 실패해도 렌더링에는 지장이 없으므로 false 만 반환합니다.
+    inline bool write(const std::string& cachePath, uint64_t sourceHash, uint64_t sourceSize, const void* metadata, uint32_t metadataSize, const void* vertices, uint64_t vertexCount, uint32_t vertexStride, const void* indices, uint64_t indexCount, uint32_t indexSize, uint32_t buildFlags)
+    {
+        MeshCacheHeader header{};
+        std::memcpy(header.magic, "NFMC", 4);
+        header.version = MESH_CACHE_VERSION;
+        header.sourceHash = sourceHash;
+        header.sourceSize = sourceSize;
+        header.vertexStride = vertexStride;
+        header.indexSize = indexSize;
+        header.buildFlags = buildFlags;
+        header.metadataSize = metadataSize;
+        header.vertexCount = vertexCount;
+        header.indexCount = indexCount;
+        header.metadataOffset = alignOffset(sizeof(header));
+        header.vertexOffset = alignOffset(header.metadataOffset + metadataSize);
+        header.indexOffset = alignOffset(header.vertexOffset + vertexCount * vertexStride);
+
+        std::string tempPath = cachePath + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                return false;
+            }
+
+            static const char padding[16] = {};
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(padding, header.metadataOffset - sizeof(header));
+            out.write(static_cast<const char*>(metadata), metadataSize);
+            out.write(padding, header.vertexOffset - (header.metadataOffset + metadataSize));
+            out.write(static_cast<const char*>(vertices), vertexCount * vertexStride);
+            out.write(padding, header.indexOffset - (header.vertexOffset + vertexCount * vertexStride));
+            out.write(static_cast<const char*>(indices), indexCount * indexSize);
+            if (!out)
+            {
+                out.close();
+                std::remove(tempPath.c_str());
+                return false;
+            }
+        }
+
+        // rename 은 대상이 이미 있으면 실패하는 플랫폼(Windows)이 있으므로 먼저 지웁니다.
+        std::remove(cachePath.c_str());
+        if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0)
+        {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+}
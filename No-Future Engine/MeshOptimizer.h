@@ -0,0 +1,388 @@
+#pragma once
+
+// 메쉬 최적화
+// OBJ 에서 읽은 삼각형은 파일에 적힌 면 순서 그대로라 버텍스 셰이더 결과 캐시(post-transform cache)의 적중률이 낮고 버텍스 버퍼를 무작위로 읽게 됩니다. 버퍼를 만들기 전에 아래 세 단계를 차례로 적용합니다.
+// 1. optimizeVertexCache : Tipsify (Sander et al. 2007, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw") 로 삼각형 순서를 캐시 지역성이 좋도록 바꿉니다.
+// 2. optimizeOverdraw : 1 의 결과를 캐시 효율이 크게 나빠지지 않는 클러스터로 나누고, 바깥을 향하는 클러스터가 먼저 그려지도록 정렬하여 시점에 관계없이 오버드로우를 줄입니다. (같은 논문의 시점 독립 정렬)
+// 3. optimizeVertexFetch : 인덱스 버퍼에서 처음 참조되는 순서대로 버텍스를 다시 배치하여 버텍스 읽기가 순차적이 되도록 합니다.
+// 효과는 ACMR (삼각형당 캐시 미스 수, 0.5 ~ 3.0) 과 ATVR (버텍스당 캐시 미스 수, 1.0 이 최선) 로 확인합니다.
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+
+// 캐시 시뮬레이션과 Tipsify 가 가정하는 FIFO 캐시 크기. 최근 GPU 는 고정된 크기의 캐시를 쓰지 않지만 16 ~ 32 사이에서 결과가 거의 같습니다.
+constexpr uint32_t MESH_OPTIMIZER_CACHE_SIZE = 16;
+
+// 오버드로우 클러스터를 나눌 때 허용하는 ACMR 증가 비율 (1.05 = 5% 까지 나빠지는 것을 허용)
+constexpr float MESH_OPTIMIZER_OVERDRAW_THRESHOLD = 1.05f;
+
+
+namespace MeshOptimizer
+{
+    struct VertexCacheStats
+    {
+        double acmr = 0.0;  // average cache miss ratio : 캐시 미스 수 / 삼각형 수
+        double atvr = 0.0;  // average transformed vertex ratio : 캐시 미스 수 / 참조된 버텍스 수
+    };
+
+    struct Report
+    {
+        VertexCacheStats before;
+        VertexCacheStats after;
+        size_t clusterCount = 0;
+        double milliseconds = 0.0;
+    };
+
+    // FIFO 캐시를 흉내내어 ACMR / ATVR 을 계산합니다. IndexT 는 uint16_t 또는 uint32_t 입니다.
+    template<typename IndexT>
+    VertexCacheStats analyzeVertexCache(const IndexT* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = MESH_OPTIMIZER_CACHE_SIZE)
+    {
+        VertexCacheStats stats;
+        if (indexCount < 3)
+        {
+            return stats;
+        }
+
+        // 버텍스가 캐시에 들어간 시점. 현재 시점과의 차이가 cacheSize 보다 작으면 아직 캐시에 남아있습니다.
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        std::vector<bool> referenced(vertexCount, false);
+        uint32_t timestamp = cacheSize + 1;
+        size_t misses = 0;
+        size_t uniqueCount = 0;
+
+        for (size_t i = 0; i < indexCount; i++)
+        {
+            uint32_t vertex = indices[i];
+            if (timestamp - cacheTime[vertex] > cacheSize)
+            {
+                cacheTime[vertex] = timestamp++;
+                misses++;
+            }
+            if (referenced[vertex] == false)
+            {
+                referenced[vertex] = true;
+                uniqueCount++;
+            }
+        }
+
+        stats.acmr = static_cast<double>(misses) / (indexCount / 3);
+        stats.atvr = static_cast<double>(misses) / uniqueCount;
+        return stats;
+    }
+
+    // Tipsify. destination 에 삼각형 순서를 바꾼 인덱스를 기록합니다. (indices 와 같은 배열이면 안 됩니다.)
+    // hardClusters 를 넘기면 막다른 곳에 도달하여 캐시와 무관한 버텍스에서 다시 시작한 위치(삼각형 번호)를 기록합니다. optimizeOverdraw 의 입력으로 사용합니다.
+    inline void optimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = MESH_OPTIMIZER_CACHE_SIZE, std::vector<uint32_t>* hardClusters = nullptr)
+    {
+        const size_t triangleCount = indexCount / 3;
+
+        // 버텍스 -> 인접 삼각형 목록 (CSR 형식)
+        std::vector<uint32_t> liveTriangles(vertexCount, 0);
+        for (size_t i = 0; i < indexCount; i++)
+        {
+            liveTriangles[indices[i]]++;
+        }
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+        }
+        std::vector<uint32_t> adjacency(indexCount);
+        {
+            std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < indexCount; i++)
+            {
+                adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> deadEndStack;
+        std::vector<uint32_t> candidates;
+        uint32_t timestamp = cacheSize + 1;
+        size_t scanCursor = 0;     // 막다른 곳에서 남은 삼각형이 있는 버텍스를 찾기 위한 순차 탐색 위치
+        size_t outputTriangles = 0;
+
+        if (hardClusters != nullptr)
+        {
+            hardClusters->clear();
+            hardClusters->push_back(0);
+        }
+
+        // 막다른 곳에 도달하면 최근에 출력한 버텍스 스택에서, 그것도 없으면 순차 탐색으로 남은 삼각형이 있는 버텍스를 찾습니다.
+        auto skipDeadEnd = [&]() -> int64_t
+        {
+            while (deadEndStack.empty() == false)
+            {
+                uint32_t vertex = deadEndStack.back();
+                deadEndStack.pop_back();
+                if (liveTriangles[vertex] > 0)
+                {
+                    return vertex;
+                }
+            }
+            while (scanCursor < vertexCount)
+            {
+                if (liveTriangles[scanCursor] > 0)
+                {
+                    return static_cast<int64_t>(scanCursor);
+                }
+                scanCursor++;
+            }
+            return -1;
+        };
+
+        int64_t fanningVertex = skipDeadEnd();
+        while (fanningVertex >= 0)
+        {
+            // 부채꼴 버텍스에 인접한, 아직 출력하지 않은 삼각형을 모두 출력합니다.
+            candidates.clear();
+            for (uint32_t a = adjacencyOffsets[fanningVertex]; a < adjacencyOffsets[fanningVertex + 1]; a++)
+            {
+                uint32_t triangle = adjacency[a];
+                if (emitted[triangle])
+                {
+                    continue;
+                }
+
+                for (uint32_t corner = 0; corner < 3; corner++)
+                {
+                    uint32_t vertex = indices[triangle * 3 + corner];
+                    destination[outputTriangles * 3 + corner] = vertex;
+                    deadEndStack.push_back(vertex);
+                    candidates.push_back(vertex);
+                    liveTriangles[vertex]--;
+                    if (timestamp - cacheTime[vertex] > cacheSize)
+                    {
+                        cacheTime[vertex] = timestamp++;
+                    }
+                }
+                emitted[triangle] = true;
+                outputTriangles++;
+            }
+
+            // 다음 부채꼴 버텍스 선택 : 남은 삼각형을 모두 출력한 뒤에도 캐시에 남아있을 후보 중 가장 오래된 것을 고릅니다.
+            int64_t nextVertex = -1;
+            int64_t bestPriority = -1;
+            for (uint32_t vertex : candidates)
+            {
+                if (liveTriangles[vertex] == 0)
+                {
+                    continue;
+                }
+                int64_t priority = 0;
+                if (timestamp - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+                {
+                    priority = timestamp - cacheTime[vertex];
+                }
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    nextVertex = vertex;
+                }
+            }
+
+            if (nextVertex < 0)
+            {
+                nextVertex = skipDeadEnd();
+                if (hardClusters != nullptr && nextVertex >= 0 && outputTriangles > hardClusters->back())
+                {
+                    hardClusters->push_back(static_cast<uint32_t>(outputTriangles));
+                }
+            }
+            fanningVertex = nextVertex;
+        }
+    }
+
+    // 삼각형 범위 [begin, end) 를 빈 캐시에서 시작하여 그렸을 때의 캐시 미스 수
+    inline size_t countCacheMisses(const uint32_t* indices, size_t beginTriangle, size_t endTriangle, std::vector<uint32_t>& cacheTime, uint32_t& timestamp, uint32_t cacheSize)
+    {
+        // 이전 범위의 기록이 남지 않도록 시점을 cacheSize 만큼 건너뜁니다.
+        timestamp += cacheSize + 1;
+        size_t misses = 0;
+        for (size_t i = beginTriangle * 3; i < endTriangle * 3; i++)
+        {
+            if (timestamp - cacheTime[indices[i]] > cacheSize)
+            {
+                cacheTime[indices[i]] = timestamp++;
+                misses++;
+            }
+        }
+        return misses;
+    }
+
+    // optimizeVertexCache 의 결과를 클러스터 단위로 정렬하여 오버드로우를 줄입니다. indices 를 제자리에서 바꿉니다.
+    // positions 는 첫 버텍스의 위치(float 3 개)를 가리키고, positionStride 는 버텍스 사이의 바이트 간격입니다.
+    inline size_t optimizeOverdraw(uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride, size_t vertexCount, const std::vector<uint32_t>& hardClusters, uint32_t cacheSize = MESH_OPTIMIZER_CACHE_SIZE, float threshold = MESH_OPTIMIZER_OVERDRAW_THRESHOLD)
+    {
+        const size_t triangleCount = indexCount / 3;
+        if (triangleCount == 0 || hardClusters.empty())
+        {
+            return 0;
+        }
+
+        // 1. 각 하드 클러스터 안에서, 지금까지의 ACMR 이 클러스터 전체 ACMR x threshold 이하로 내려올 때마다 더 작은 클러스터로 나눕니다.
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        uint32_t timestamp = 0;
+        std::vector<uint32_t> clusters;
+        for (size_t h = 0; h < hardClusters.size(); h++)
+        {
+            size_t begin = hardClusters[h];
+            size_t end = (h + 1 < hardClusters.size()) ? hardClusters[h + 1] : triangleCount;
+            double clusterAcmr = static_cast<double>(countCacheMisses(indices, begin, end, cacheTime, timestamp, cacheSize)) / (end - begin);
+
+            clusters.push_back(static_cast<uint32_t>(begin));
+            timestamp += cacheSize + 1;
+            size_t misses = 0;
+            size_t start = begin;
+            for (size_t triangle = begin; triangle < end; triangle++)
+            {
+                for (uint32_t corner = 0; corner < 3; corner++)
+                {
+                    uint32_t vertex = indices[triangle * 3 + corner];
+                    if (timestamp - cacheTime[vertex] > cacheSize)
+                    {
+                        cacheTime[vertex] = timestamp++;
+                        misses++;
+                    }
+                }
+
+                if (triangle + 1 < end && static_cast<double>(misses) / (triangle + 1 - start) <= clusterAcmr * threshold)
+                {
+                    clusters.push_back(static_cast<uint32_t>(triangle + 1));
+                    timestamp += cacheSize + 1;
+                    misses = 0;
+                    start = triangle + 1;
+                }
+            }
+        }
+
+        auto position = [&](uint32_t vertex) -> const float*
+        {
+            return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + vertex * positionStride);
+        };
+
+        // 2. 메쉬 전체의 중심
+        double meshCenter[3] = { 0.0, 0.0, 0.0 };
+        for (size_t i = 0; i < indexCount; i++)
+        {
+            const float* p = position(indices[i]);
+            meshCenter[0] += p[0];
+            meshCenter[1] += p[1];
+            meshCenter[2] += p[2];
+        }
+        for (double& c : meshCenter)
+        {
+            c /= static_cast<double>(indexCount);
+        }
+
+        // 3. 클러스터마다 면적 가중 중심과 법선을 구하고, (클러스터 중심 - 메쉬 중심) . 법선 을 정렬 키로 사용합니다. 값이 클수록 바깥쪽을 향하므로 먼저 그리면 안쪽 면을 가리게 됩니다.
+        std::vector<float> sortKeys(clusters.size());
+        for (size_t c = 0; c < clusters.size(); c++)
+        {
+            size_t begin = clusters[c];
+            size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+
+            double center[3] = { 0.0, 0.0, 0.0 };
+            double normal[3] = { 0.0, 0.0, 0.0 };
+            double areaSum = 0.0;
+            for (size_t triangle = begin; triangle < end; triangle++)
+            {
+                const float* p0 = position(indices[triangle * 3 + 0]);
+                const float* p1 = position(indices[triangle * 3 + 1]);
+                const float* p2 = position(indices[triangle * 3 + 2]);
+
+                double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+                double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+                double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+                double area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    center[axis] += (p0[axis] + p1[axis] + p2[axis]) / 3.0 * area;
+                    normal[axis] += n[axis];    // 외적의 길이가 면적의 2 배이므로 그대로 더하면 면적 가중 합이 됩니다.
+                }
+                areaSum += area;
+            }
+
+            double invArea = areaSum > 0.0 ? 1.0 / areaSum : 0.0;
+            double normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            double invNormal = normalLength > 0.0 ? 1.0 / normalLength : 0.0;
+
+            double key = 0.0;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                key += (center[axis] * invArea - meshCenter[axis]) * normal[axis] * invNormal;
+            }
+            sortKeys[c] = static_cast<float>(key);
+        }
+
+        // 4. 정렬 키가 큰 클러스터부터 다시 씁니다. 같은 키는 원래 순서를 유지합니다.
+        std::vector<uint32_t> order(clusters.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+        std::vector<uint32_t> source(indices, indices + indexCount);
+        size_t written = 0;
+        for (uint32_t c : order)
+        {
+            size_t begin = clusters[c];
+            size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+            std::memcpy(indices + written, source.data() + begin * 3, (end - begin) * 3 * sizeof(uint32_t));
+            written += (end - begin) * 3;
+        }
+        return clusters.size();
+    }
+
+    // 인덱스 버퍼에서 처음 참조되는 순서대로 버텍스를 재배치하고 인덱스를 고칩니다. 참조되지 않는 버텍스는 버립니다.
+    template<typename VertexT>
+    void optimizeVertexFetch(std::vector<VertexT>& vertices, std::vector<uint32_t>& indices)
+    {
+        constexpr uint32_t UNASSIGNED = UINT32_MAX;
+        std::vector<uint32_t> remap(vertices.size(), UNASSIGNED);
+        std::vector<VertexT> reordered;
+        reordered.reserve(vertices.size());
+
+        for (uint32_t& index : indices)
+        {
+            if (remap[index] == UNASSIGNED)
+            {
+                remap[index] = static_cast<uint32_t>(reordered.size());
+                reordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices.swap(reordered);
+    }
+
+    // 세 단계를 차례로 적용하고 전후의 ACMR / ATVR 을 돌려줍니다. positionOffset 은 버텍스 구조체 안의 위치(float 3 개)의 오프셋입니다.
+    template<typename VertexT>
+    Report optimize(std::vector<VertexT>& vertices, std::vector<uint32_t>& indices, size_t positionOffset)
+    {
+        Report report;
+        auto start = std::chrono::high_resolution_clock::now();
+        report.before = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+        std::vector<uint32_t> hardClusters;
+        std::vector<uint32_t> reordered(indices.size());
+        optimizeVertexCache(reordered.data(), indices.data(), indices.size(), vertices.size(), MESH_OPTIMIZER_CACHE_SIZE, &hardClusters);
+        indices.swap(reordered);
+
+        const float* positions = reinterpret_cast<const float*>(reinterpret_cast<const char*>(vertices.data()) + positionOffset);
+        report.clusterCount = optimizeOverdraw(indices.data(), indices.size(), positions, sizeof(VertexT), vertices.size(), hardClusters);
+
+        optimizeVertexFetch(vertices, indices);
+
+        report.after = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+        report.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        return report;
+    }
+}
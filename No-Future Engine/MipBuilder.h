@@ -0,0 +1,463 @@
+#pragma once
+
+// CPU 밉맵 생성
+// vkCmdBlitImage 로 밉 체인을 만들면 포맷이 VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT 를 지원해야 하고, 그래픽 큐에서 레벨마다 배리어와 blit 을 기록해야 합니다.
+// 또 SRGB 이미지의 blit 필터링이 선형 공간에서 일어나는지는 구현마다 다릅니다. 감마 공간에서 평균을 내면 밝고 어두운 텍셀이 섞인 부분이 멀리서 어두워집니다.
+// 그래서 에셋 로더의 작업 스레드에서 sRGB 를 선형으로 풀어 2x2 박스 필터로 줄이고 다시 sRGB 로 인코딩하여 밉 체인 전체를 만듭니다. 알파는 선형 값 그대로 평균합니다.
+// 결과는 모든 레벨이 이어붙은 하나의 배열이라 스테이징 영역 하나와 영역(region)이 여러 개인 vkCmdCopyBufferToImage 한 번으로 올릴 수 있습니다.
+// 필터링 커널은 SSE2 (x64 기본) 를 쓰고, SSE2 가 없으면 스칼라 코드를 사용합니다. 프로그램 전체를 /arch:AVX2 로 빌드하면 AVX2 가 없는 CPU 에서 시작하지도 못하므로,
+// AVX2 커널은 MipBuilderAvx2.cpp 에만 /arch:AVX2 를 주어 따로 빌드하고 실행 중에 CPU 가 AVX2 를 지원할 때만 부릅니다. (hasAvx2)
+// 중간 레벨은 float 로 들고 내려가므로 레벨마다 8 비트로 다시 양자화한 오차가 쌓이지 않습니다.
+
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_BUILDER_SSE2
+#define MIP_BUILDER_AVX2    // MipBuilderAvx2.cpp 를 함께 빌드합니다.
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+
+// 레벨 시작 위치의 정렬. 버퍼 -> 이미지 복사의 bufferOffset 은 텍셀 크기(4) 또는 압축 블록 크기(8, 16)의 배수여야 합니다.
+constexpr size_t MIP_BUILDER_LEVEL_ALIGNMENT = 16;
+
+
+// 밉 체인에 담긴 텍셀의 형식. BC 형식은 4x4 텍셀 블록 단위로 저장됩니다. (TextureCompressor.h)
+enum class TextureFormat : uint32_t
+{
+    Rgba8 = 0,  // 압축하지 않은 RGBA8 sRGB (텍셀당 4 바이트)
+    Bc1 = 1,    // RGB 5:6:5 두 끝점 + 2 비트 인덱스, 알파 없음 (블록당 8 바이트)
+    Bc3 = 2,    // BC1 색상 + 8 비트 알파 두 끝점 + 3 비트 인덱스 (블록당 16 바이트)
+    Bc7 = 3,    // 모드 6 : RGBA 7 비트 + p 비트 끝점, 4 비트 인덱스 (블록당 16 바이트)
+};
+
+inline const char* toString(TextureFormat format)
+{
+    switch (format)
+    {
+    case TextureFormat::Rgba8:
+        return "rgba8";
+    case TextureFormat::Bc1:
+        return "bc1";
+    case TextureFormat::Bc3:
+        return "bc3";
+    case TextureFormat::Bc7:
+        return "bc7";
+    }
+    return "unknown";
+}
+
+// 블록 한 변의 텍셀 수. 압축하지 않은 형식은 텍셀 하나를 블록 하나로 봅니다.
+inline uint32_t getBlockExtent(TextureFormat format)
+{
+    return format == TextureFormat::Rgba8 ? 1 : 4;
+}
+
+// 블록 하나의 바이트 수
+inline uint32_t getBlockSize(TextureFormat format)
+{
+    switch (format)
+    {
+    case TextureFormat::Bc1:
+        return 8;
+    case TextureFormat::Bc3:
+    case TextureFormat::Bc7:
+        return 16;
+    default:
+        return 4;
+    }
+}
+
+// width x height 레벨 하나의 바이트 수. 블록 크기로 나누어지지 않는 가장자리도 블록 하나를 차지합니다.
+inline size_t getLevelByteSize(TextureFormat format, uint32_t width, uint32_t height)
+{
+    const uint32_t extent = getBlockExtent(format);
+    return size_t((width + extent - 1) / extent) * ((height + extent - 1) / extent) * getBlockSize(format);
+}
+
+
+namespace MipBuilder
+{
+    struct Level
+    {
+        size_t offset = 0;      // MipChain::data 안에서 레벨이 시작하는 바이트 위치
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    // 업로드할 밉 체인을 복사하지 않고 가리키는 보기. MipChain 의 배열이나 매핑된 KTX2 파일(Ktx2Reader.h)의 레벨을 가리키므로 그 메모리가 살아 있는 동안만 유효합니다.
+    // 레벨들이 한 배열에 이어져 있을 필요가 없어서, KTX2 처럼 작은 레벨부터 저장된 파일도 그대로 가리킬 수 있습니다.
+    struct MipChainView
+    {
+        struct LevelData
+        {
+            const uint8_t* data = nullptr;  // format 의 블록이 행 우선으로 빽빽하게 채워진 레벨
+            size_t size = 0;
+            uint32_t width = 0;
+            uint32_t height = 0;
+        };
+
+        TextureFormat format = TextureFormat::Rgba8;
+        std::vector<LevelData> levels;
+
+        uint32_t getWidth() const { return levels.empty() ? 0 : levels[0].width; }
+        uint32_t getHeight() const { return levels.empty() ? 0 : levels[0].height; }
+        size_t getByteSize() const
+        {
+            size_t size = 0;
+            for (const LevelData& level : levels)
+            {
+                size += level.size;
+            }
+            return size;
+        }
+
+        // firstLevel 부터 마지막 레벨까지. 완전한 밉 체인의 꼬리도 완전한 밉 체인이므로 그대로 더 작은 텍스쳐로 올릴 수 있습니다. (텍스쳐 스트리밍)
+        MipChainView getTail(size_t firstLevel) const
+        {
+            MipChainView tail;
+            tail.format = format;
+            tail.levels.assign(levels.begin() + std::min(firstLevel, levels.size()), levels.end());
+            return tail;
+        }
+    };
+
+    // sRGB 밉 체인. 레벨 0 은 원본 이미지입니다. 각 레벨은 format 의 블록이 행 우선으로 빽빽하게 채워져 있습니다.
+    struct MipChain
+    {
+        TextureFormat format = TextureFormat::Rgba8;
+        std::vector<uint8_t> data;
+        std::vector<Level> levels;
+        double milliseconds = 0.0;  // 레벨 1 이상을 만드는 데 걸린 시간
+
+        uint32_t getWidth() const { return levels.empty() ? 0 : levels[0].width; }
+        uint32_t getHeight() const { return levels.empty() ? 0 : levels[0].height; }
+        const uint8_t* getLevelData(size_t level) const { return data.data() + levels[level].offset; }
+        size_t getLevelSize(size_t level) const { return getLevelByteSize(format, levels[level].width, levels[level].height); }
+
+        MipChainView getView() const
+        {
+            MipChainView view;
+            view.format = format;
+            for (size_t level = 0; level < levels.size(); level++)
+            {
+                view.levels.push_back({ getLevelData(level), getLevelSize(level), levels[level].width, levels[level].height });
+            }
+            return view;
+        }
+    };
+
+    // 가장 큰 변을 1 이 될 때까지 반으로 나누는 횟수 + 1
+    inline uint32_t getFullLevelCount(uint32_t width, uint32_t height)
+    {
+        return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+    }
+
+    inline float decodeSrgb(float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    inline float encodeSrgb(float value)
+    {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    // sRGB 변환 표. 디코딩은 256 개 값 그대로, 인코딩은 float 의 지수와 가수 상위 8 비트로 나눈 구간마다 시작 값과 기울기를 두고 구간 안을 선형 보간합니다.
+    // 구간 안에서 곡선이 거의 직선이라 pow 로 계산한 값과의 차이는 반올림 경계에서 1 을 넘지 않습니다. 2^-13 아래는 sRGB 곡선의 선형 구간이므로 표 없이 계산합니다.
+    struct SrgbTables
+    {
+        static constexpr uint32_t MIN_BITS = 0x39000000;    // 2^-13
+        static constexpr uint32_t ONE_BITS = 0x3F800000;    // 1.0
+        static constexpr uint32_t BUCKET_SHIFT = 15;        // 가수 23 비트 중 상위 8 비트로 구간을 나눕니다.
+        static constexpr uint32_t BUCKET_COUNT = (ONE_BITS - MIN_BITS) >> BUCKET_SHIFT;
+
+        float decode[256];
+        float encodeBase[BUCKET_COUNT];
+        float encodeSlope[BUCKET_COUNT];
+
+        SrgbTables()
+        {
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                decode[i] = decodeSrgb(i / 255.0f);
+            }
+            for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+            {
+                uint32_t beginBits = MIN_BITS + (i << BUCKET_SHIFT);
+                uint32_t endBits = beginBits + (1u << BUCKET_SHIFT);
+                float begin, end;
+                memcpy(&begin, &beginBits, sizeof(float));
+                memcpy(&end, &endBits, sizeof(float));
+                encodeBase[i] = encodeSrgb(begin) * 255.0f;
+                encodeSlope[i] = encodeSrgb(end) * 255.0f - encodeBase[i];
+            }
+        }
+    };
+
+    // 함수 안의 정적 변수는 처음 호출할 때 한 번만 초기화되며, 작업 스레드 여러 개가 동시에 불러도 안전합니다.
+    inline const SrgbTables& getSrgbTables()
+    {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    inline uint8_t encodeSrgb8(const SrgbTables& tables, float linear)
+    {
+        if (!(linear > 0.0f))   // NaN 도 0 으로 보냅니다.
+        {
+            return 0;
+        }
+        uint32_t bits;
+        memcpy(&bits, &linear, sizeof(float));
+        if (bits >= SrgbTables::ONE_BITS)
+        {
+            return 255;
+        }
+        if (bits < SrgbTables::MIN_BITS)
+        {
+            return static_cast<uint8_t>(linear * (12.92f * 255.0f) + 0.5f);
+        }
+        uint32_t bucket = (bits - SrgbTables::MIN_BITS) >> SrgbTables::BUCKET_SHIFT;
+        float fraction = static_cast<float>(bits & ((1u << SrgbTables::BUCKET_SHIFT) - 1)) * (1.0f / (1u << SrgbTables::BUCKET_SHIFT));
+        return static_cast<uint8_t>(tables.encodeBase[bucket] + tables.encodeSlope[bucket] * fraction + 0.5f);
+    }
+
+    inline uint8_t encodeUnorm8(float value)
+    {
+        return static_cast<uint8_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+#if defined(MIP_BUILDER_AVX2)
+    // MipBuilderAvx2.cpp 의 AVX2 커널. 8 개 단위로 처리할 수 있는 만큼만 처리하고 처리한 수를 반환하므로, 나머지는 아래 SSE2 / 스칼라 코드가 이어서 처리합니다.
+    size_t addRowsAvx2(float* dst, const float* a, const float* b, size_t count);
+    uint32_t reducePairsAvx2(float* dst, const float* src, uint32_t dstTexels, float scale);
+
+    // CPU 와 운영체제가 AVX2 를 지원하는지 확인합니다. (YMM 레지스터 저장은 운영체제가 켜 두어야 합니다. XGETBV)
+    inline bool detectAvx2()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (osxsave == false || avx == false || (_xgetbv(0) & 0x6) != 0x6)
+        {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    inline bool hasAvx2()
+    {
+        static const bool supported = detectAvx2();
+        return supported;
+    }
+#endif
+
+    // dst = a + b (float count 개)
+    inline void addRows(float* dst, const float* a, const float* b, size_t count)
+    {
+        size_t i = 0;
+#if defined(MIP_BUILDER_AVX2)
+        if (hasAvx2())
+        {
+            i = addRowsAvx2(dst, a, b, count);
+        }
+#endif
+#if defined(MIP_BUILDER_SSE2)
+        for (; i + 4 <= count; i += 4)
+        {
+            _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        }
+#endif
+        for (; i < count; i++)
+        {
+            dst[i] = a[i] + b[i];
+        }
+    }
+
+    // 가로로 이웃한 RGBA 텍셀 두 개씩을 더해 scale 을 곱합니다. dst[x] = (src[2x] + src[2x + 1]) * scale
+    inline void reducePairs(float* dst, const float* src, uint32_t dstTexels, float scale)
+    {
+        uint32_t x = 0;
+#if defined(MIP_BUILDER_AVX2)
+        if (hasAvx2())
+        {
+            x = reducePairsAvx2(dst, src, dstTexels, scale);
+        }
+#endif
+#if defined(MIP_BUILDER_SSE2)
+        const __m128 scale4 = _mm_set1_ps(scale);
+        for (; x < dstTexels; x++)
+        {
+            __m128 sum = _mm_add_ps(_mm_loadu_ps(src + x * 8), _mm_loadu_ps(src + x * 8 + 4));
+            _mm_storeu_ps(dst + x * 4, _mm_mul_ps(sum, scale4));
+        }
+#endif
+        for (; x < dstTexels; x++)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                dst[x * 4 + c] = (src[x * 8 + c] + src[x * 8 + 4 + c]) * scale;
+            }
+        }
+    }
+
+    // 원본 한 레벨(srcWidth x srcHeight)을 반으로 줄여 dst 에 선형 float RGBA 로 씁니다. getRow(y) 는 원본 y 행의 선형 float RGBA 를 돌려줍니다.
+    // 홀수 크기의 마지막 행 / 열은 버리지 않고 마지막 텍셀에 세 번째 탭으로 더하므로 원본의 모든 텍셀이 같은 무게로 반영됩니다.
+    template<typename GetRow>
+    void downsample(GetRow getRow, uint32_t srcWidth, uint32_t srcHeight, float* dst, std::vector<float>& rowSum)
+    {
+        const uint32_t dstWidth = std::max(1u, srcWidth / 2);
+        const uint32_t dstHeight = std::max(1u, srcHeight / 2);
+        const size_t rowFloats = size_t(srcWidth) * 4;
+        rowSum.resize(rowFloats);
+
+        for (uint32_t y = 0; y < dstHeight; y++)
+        {
+            // 세로 방향 : 두 행(또는 세 행, 한 행)을 더합니다.
+            uint32_t rowCount;
+            if (srcHeight == 1)
+            {
+                memcpy(rowSum.data(), getRow(0), rowFloats * sizeof(float));
+                rowCount = 1;
+            }
+            else
+            {
+                addRows(rowSum.data(), getRow(y * 2), getRow(y * 2 + 1), rowFloats);
+                rowCount = 2;
+                if ((srcHeight & 1) && y == dstHeight - 1)
+                {
+                    addRows(rowSum.data(), rowSum.data(), getRow(y * 2 + 2), rowFloats);
+                    rowCount = 3;
+                }
+            }
+
+            // 가로 방향 : 이웃한 두 텍셀(또는 세 텍셀, 한 텍셀)을 더하고 탭 수로 나눕니다.
+            float* dstRow = dst + size_t(y) * dstWidth * 4;
+            if (srcWidth == 1)
+            {
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    dstRow[c] = rowSum[c] / rowCount;
+                }
+                continue;
+            }
+
+            reducePairs(dstRow, rowSum.data(), dstWidth, 1.0f / (rowCount * 2));
+            if (srcWidth & 1)
+            {
+                const float* last = rowSum.data() + size_t(dstWidth - 1) * 8;
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    dstRow[(dstWidth - 1) * 4 + c] = (last[c] + last[4 + c] + last[8 + c]) / (rowCount * 3);
+                }
+            }
+        }
+    }
+
+    // chain.format 기준으로 levelCount 개 레벨의 크기와 위치를 정하고 data 를 그 크기로 맞춥니다.
+    inline void layoutLevels(MipChain& chain, uint32_t width, uint32_t height, uint32_t levelCount)
+    {
+        chain.levels.resize(levelCount);
+        size_t offset = 0;
+        for (uint32_t level = 0; level < levelCount; level++)
+        {
+            chain.levels[level].offset = offset;
+            chain.levels[level].width = std::max(1u, width >> level);
+            chain.levels[level].height = std::max(1u, height >> level);
+            offset += chain.getLevelSize(level);
+            offset = (offset + MIP_BUILDER_LEVEL_ALIGNMENT - 1) & ~(MIP_BUILDER_LEVEL_ALIGNMENT - 1);
+        }
+        chain.data.resize(offset);
+    }
+
+    // RGBA8 sRGB 픽셀(width x height)로 밉 체인을 만듭니다. maxLevels 가 0 이면 1x1 까지 모든 레벨을, 1 이면 레벨 0 만 담습니다.
+    inline void build(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t maxLevels, MipChain& chain)
+    {
+        uint32_t levelCount = getFullLevelCount(width, height);
+        if (maxLevels != 0)
+        {
+            levelCount = std::min(levelCount, maxLevels);
+        }
+
+        chain.format = TextureFormat::Rgba8;
+        layoutLevels(chain, width, height, levelCount);
+        memcpy(chain.data.data(), pixels, chain.getLevelSize(0));
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        const SrgbTables& tables = getSrgbTables();
+
+        // 레벨 1 은 원본 바이트를 행마다 선형으로 풀어 읽고, 그 아래 레벨은 바로 위 레벨의 float 결과를 읽습니다.
+        std::vector<float> decodedRows[2] = { std::vector<float>(size_t(width) * 4), std::vector<float>(size_t(width) * 4) };
+        std::vector<float> rowSum;
+        std::vector<float> previous;
+        std::vector<float> current;
+        for (uint32_t level = 1; level < levelCount; level++)
+        {
+            const uint32_t srcWidth = chain.levels[level - 1].width;
+            const uint32_t srcHeight = chain.levels[level - 1].height;
+            const uint32_t dstWidth = chain.levels[level].width;
+            const uint32_t dstHeight = chain.levels[level].height;
+            current.resize(size_t(dstWidth) * dstHeight * 4);
+
+            if (level == 1)
+            {
+                // 한 번에 함께 더하는 두 행은 짝수 / 홀수 행이므로 행 번호의 홀짝으로 두 버퍼를 번갈아 씁니다.
+                auto getRow = [&](uint32_t y) -> const float*
+                {
+                    const uint8_t* row = pixels + size_t(y) * width * 4;
+                    float* decoded = decodedRows[y & 1].data();
+                    for (size_t i = 0; i < size_t(width) * 4; i += 4)
+                    {
+                        decoded[i + 0] = tables.decode[row[i + 0]];
+                        decoded[i + 1] = tables.decode[row[i + 1]];
+                        decoded[i + 2] = tables.decode[row[i + 2]];
+                        decoded[i + 3] = row[i + 3] * (1.0f / 255.0f);
+                    }
+                    return decoded;
+                };
+                downsample(getRow, srcWidth, srcHeight, current.data(), rowSum);
+            }
+            else
+            {
+                auto getRow = [&](uint32_t y) -> const float*
+                {
+                    return previous.data() + size_t(y) * srcWidth * 4;
+                };
+                downsample(getRow, srcWidth, srcHeight, current.data(), rowSum);
+            }
+
+            uint8_t* dst = chain.data.data() + chain.levels[level].offset;
+            for (size_t i = 0; i < current.size(); i += 4)
+            {
+                dst[i + 0] = encodeSrgb8(tables, current[i + 0]);
+                dst[i + 1] = encodeSrgb8(tables, current[i + 1]);
+                dst[i + 2] = encodeSrgb8(tables, current[i + 2]);
+                dst[i + 3] = encodeUnorm8(current[i + 3]);
+            }
+            previous.swap(current);
+        }
+
+        chain.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+    }
+}
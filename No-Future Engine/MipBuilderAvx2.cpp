@@ -0,0 +1,37 @@
+// MipBuilder.h 의 AVX2 필터링 커널
+// 이 파일만 /arch:AVX2 (프로젝트 설정의 파일별 EnableEnhancedInstructionSet) 로 빌드합니다. 나머지 프로그램은 SSE2 로 빌드하므로 AVX2 가 없는 CPU 에서도 실행되고,
+// 여기의 함수는 MipBuilder::hasAvx2 로 CPU 를 확인한 뒤에만 부릅니다. 헤더의 인라인 함수를 여기서 부르면 AVX2 로 컴파일된 본문이 다른 파일의 같은 함수 대신 링크될 수 있으므로 부르지 않습니다.
+
+#include "MipBuilder.h"
+
+#include <immintrin.h>
+
+
+namespace MipBuilder
+{
+    size_t addRowsAvx2(float* dst, const float* a, const float* b, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        }
+        return i;
+    }
+
+    uint32_t reducePairsAvx2(float* dst, const float* src, uint32_t dstTexels, float scale)
+    {
+        // 한 번에 원본 텍셀 4 개(t0 t1 | t2 t3)를 읽어 128 비트 절반끼리 (t0 t2) + (t1 t3) 로 더합니다.
+        uint32_t x = 0;
+        const __m256 scale8 = _mm256_set1_ps(scale);
+        for (; x + 2 <= dstTexels; x += 2)
+        {
+            __m256 a = _mm256_loadu_ps(src + x * 8);
+            __m256 b = _mm256_loadu_ps(src + x * 8 + 8);
+            __m256 even = _mm256_permute2f128_ps(a, b, 0x20);
+            __m256 odd = _mm256_permute2f128_ps(a, b, 0x31);
+            _mm256_storeu_ps(dst + x * 4, _mm256_mul_ps(_mm256_add_ps(even, odd), scale8));
+        }
+        return x;
+    }
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+// OBJ 머티리얼 읽기
+// 텍스쳐 아틀라스(TextureAtlas.h)를 만들려면 모델이 쓰는 머티리얼마다의 디퓨즈 텍스쳐와, 삼각형마다 어느 머티리얼을 쓰는지 알아야 합니다.
+// 멀티스레드 파서(tinyobj_opt)는 mtllib 을 작업 디렉터리 기준으로 열어서 모델 폴더의 .mtl 을 찾지 못하므로, 여기서 직접 읽습니다.
+// - readLibrary : OBJ 의 mtllib 줄을 찾아 MTL 파일에서 newmtl / map_Kd 만 읽습니다. 텍스쳐 경로는 MTL 파일이 있는 폴더 기준입니다.
+// - assignTriangles : usemtl 줄과 면(f) 줄을 따라가며 삼각형마다 머티리얼 번호를 매깁니다. n 각형 면은 파서와 같이 n - 2 개의 삼각형으로 셉니다.
+
+#include "MappedFile.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+
+
+struct ObjMaterial
+{
+    std::string name;
+    std::string diffuseTexture;     // map_Kd 의 경로 (MTL 파일 폴더 기준으로 풀어 둔 경로). 없으면 빈 문자열
+};
+
+namespace ObjMaterials
+{
+    inline bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t';
+    }
+
+    // 줄 앞의 키워드(예: "usemtl")가 맞으면 키워드 뒤의 값(앞뒤 공백, 줄 끝 \r 제외)을 value 에 담습니다.
+    inline bool readKeyword(const char* line, const char* lineEnd, const char* keyword, std::string& value)
+    {
+        const size_t keywordLength = std::strlen(keyword);
+        if (size_t(lineEnd - line) <= keywordLength || std::memcmp(line, keyword, keywordLength) != 0 || isSpace(line[keywordLength]) == false)
+        {
+            return false;
+        }
+        const char* begin = line + keywordLength;
+        while (begin < lineEnd && isSpace(*begin))
+        {
+            begin++;
+        }
+        const char* end = lineEnd;
+        while (end > begin && (isSpace(end[-1]) || end[-1] == '\r'))
+        {
+            end--;
+        }
+        value.assign(begin, end);
+        return true;
+    }
+
+    // buffer 의 줄마다 visit(줄 시작, 줄 끝) 을 호출합니다. visit 이 false 를 반환하면 멈춥니다.
+    template <typename Visit>
+    inline void forEachLine(const char* buffer, size_t length, Visit&& visit)
+    {
+        const char* end = buffer + length;
+        const char* line = buffer;
+        while (line < end)
+        {
+            const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', size_t(end - line)));
+            if (lineEnd == nullptr)
+            {
+                lineEnd = end;
+            }
+            while (line < lineEnd && isSpace(*line))
+            {
+                line++;
+            }
+            if (visit(line, lineEnd) == false)
+            {
+                return;
+            }
+            line = lineEnd + 1;
+        }
+    }
+
+    inline std::string getDirectory(const std::string& path)
+    {
+        size_t slash = path.find_last_of("/\\");
+        return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    }
+
+    // OBJ 의 머티리얼 라이브러리를 읽습니다. mtllib 이 없거나 파일을 열 수 없으면 false 를 반환합니다.
+    // mtllib 은 보통 파일 앞부분에 있으므로 첫 번째 면이 나오면 더 찾지 않습니다.
+    inline bool readLibrary(const std::string& objPath, std::vector<ObjMaterial>& materials)
+    {
+        materials.clear();
+
+        MappedFile obj;
+        if (obj.open(objPath) == false)
+        {
+            return false;
+        }
+
+        std::string libraryName;
+        forEachLine(reinterpret_cast<const char*>(obj.getData()), obj.getSize(), [&](const char* line, const char* lineEnd)
+        {
+            return readKeyword(line, lineEnd, "mtllib", libraryName) == false && (lineEnd - line < 2 || line[0] != 'f' || isSpace(line[1]) == false);
+        });
+        if (libraryName.empty())
+        {
+            return false;
+        }
+
+        const std::string libraryPath = getDirectory(objPath) + libraryName;
+        MappedFile library;
+        if (library.open(libraryPath) == false)
+        {
+            return false;
+        }
+
+        std::string value;
+        forEachLine(reinterpret_cast<const char*>(library.getData()), library.getSize(), [&](const char* line, const char* lineEnd)
+        {
+            if (readKeyword(line, lineEnd, "newmtl", value))
+            {
+                materials.push_back(ObjMaterial{ value, std::string() });
+            }
+            else if (materials.empty() == false && readKeyword(line, lineEnd, "map_Kd", value))
+            {
+                // -s, -o 같은 옵션이 앞에 올 수 있으므로 마지막 토큰을 경로로 씁니다. (공백이 있는 경로는 지원하지 않습니다.)
+                size_t space = value.find_last_of(" \t");
+                materials.back().diffuseTexture = getDirectory(libraryPath) + (space == std::string::npos ? value : value.substr(space + 1));
+            }
+            return true;
+        });
+        return true;
+    }
+
+    // 삼각형 순서대로 머티리얼 번호(materials 의 인덱스, 없으면 -1)를 triangleMaterials 에 담습니다. 파서가 삼각형으로 나눈 면의 순서와 같습니다.
+    inline void assignTriangles(const char* buffer, size_t length, const std::vector<ObjMaterial>& materials, std::vector<int32_t>& triangleMaterials)
+    {
+        triangleMaterials.clear();
+
+        int32_t current = -1;
+        std::string name;
+        forEachLine(buffer, length, [&](const char* line, const char* lineEnd)
+        {
+            if (lineEnd - line >= 2 && line[0] == 'f' && isSpace(line[1]))
+            {
+                uint32_t cornerCount = 0;
+                for (const char* c = line + 1; c < lineEnd; c++)
+                {
+                    if (isSpace(c[-1]) && isSpace(*c) == false && *c != '\r')
+                    {
+                        cornerCount++;
+                    }
+                }
+                if (cornerCount >= 3)
+                {
+                    triangleMaterials.insert(triangleMaterials.end(), cornerCount - 2, current);
+                }
+            }
+            else if (readKeyword(line, lineEnd, "usemtl", name))
+            {
+                current = -1;
+                for (size_t i = 0; i < materials.size(); i++)
+                {
+                    if (materials[i].name == name)
+                    {
+                        current = static_cast<int32_t>(i);
+                        break;
+                    }
+                }
+            }
+            return true;
+        });
+    }
+}
@@ -0,0 +1,216 @@
+#pragma once
+
+// 디스크에 저장하는 파이프라인 캐시
+// vkCreateGraphicsPipelines 는 SPIR-V 를 GPU 기계어로 컴파일하므로 시작할 때와 스왑 체인을 다시 만들 때마다 시간이 듭니다.
+// VkPipelineCache 에 컴파일 결과를 모아 두고 프로그램을 끝낼 때 파일로 저장하면, 다음 실행부터는 같은 파이프라인을 컴파일 없이 만듭니다.
+// 캐시 데이터는 드라이버가 만든 것이라 다른 장치나 다른 드라이버 버전에서는 쓸 수 없습니다. 그래서 드라이버 헤더(VkPipelineCacheHeaderVersionOne)의
+// vendorID, deviceID, pipelineCacheUUID 가 지금 장치와 같은지 먼저 확인하고, 다르면 빈 캐시로 시작합니다. (잘못된 데이터를 넘기면 일부 드라이버는 멈추기도 합니다.)
+// 파일이 중간에 잘리거나 깨진 경우도 드라이버에 넘기기 전에 걸러내도록 데이터 크기와 해시를 앞에 붙여 저장합니다.
+// VkPipelineCache 는 드라이버가 내부에서 동기화하므로 파이프라인 레지스트리(PipelineRegistry.h)의 작업 스레드들은 이 캐시를 그대로 함께 씁니다.
+// 스레드마다 캐시를 따로 두면 파일에서 불러온 데이터를 쓰지 못하므로 캐시는 하나만 둡니다.
+//
+// 파일 구조 (리틀 엔디안)
+// [PipelineCacheFileHeader][vkGetPipelineCacheData 의 데이터 : dataSize]
+
+#include "Hash.h"
+#include "MappedFile.h"
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+
+// 파일 구조가 바뀌면 올려서 이전 파일을 무효화합니다.
+constexpr uint32_t PIPELINE_CACHE_FILE_VERSION = 1;
+
+struct PipelineCacheFileHeader
+{
+    char magic[4];              // "NFPC"
+    uint32_t version;           // PIPELINE_CACHE_FILE_VERSION
+    uint64_t dataSize;          // 뒤따르는 드라이버 데이터의 바이트 수
+    uint64_t dataHash;          // 드라이버 데이터의 hashBytes
+};
+
+// 시작할 때 파일을 어떻게 불러왔는지
+enum class PipelineCacheStatus
+{
+    Disabled,   // 캐시를 쓰지 않습니다. (--no-pipeline-cache)
+    Missing,    // 파일이 없어 빈 캐시로 시작했습니다.
+    Corrupt,    // 파일이 잘렸거나 깨져서 빈 캐시로 시작했습니다.
+    Mismatch,   // 다른 장치나 드라이버가 만든 파일이라 빈 캐시로 시작했습니다.
+    Loaded,     // 파일의 데이터로 캐시를 만들었습니다.
+};
+
+inline const char* toString(PipelineCacheStatus status)
+{
+    switch (status)
+    {
+    case PipelineCacheStatus::Disabled:
+        return "disabled";
+    case PipelineCacheStatus::Missing:
+        return "missing";
+    case PipelineCacheStatus::Corrupt:
+        return "corrupt";
+    case PipelineCacheStatus::Mismatch:
+        return "device or driver mismatch";
+    case PipelineCacheStatus::Loaded:
+        return "loaded";
+    }
+    return "unknown";
+}
+
+
+class PipelineCache
+{
+public:
+    // path 의 파일을 검증해서 캐시를 만듭니다. enabled 가 false 이면 캐시 없이(VK_NULL_HANDLE) 파이프라인을 만들고 파일도 쓰지 않습니다.
+    PipelineCacheStatus init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path, bool enabled)
+    {
+        this->device = device;
+        this->path = path;
+        if (enabled == false)
+        {
+            status = PipelineCacheStatus::Disabled;
+            return status;
+        }
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        std::vector<uint8_t> initialData;
+        status = readFile(initialData);
+
+        VkPipelineCacheCreateInfo cacheInfo{};
+        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        cacheInfo.initialDataSize = initialData.size();
+        cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+        if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create pipeline cache!");
+        }
+        loadedSize = initialData.size();
+        return status;
+    }
+
+    // vkCreate*Pipelines 에 넘길 캐시. 캐시를 쓰지 않으면 VK_NULL_HANDLE 입니다.
+    VkPipelineCache get() const { return cache; }
+    PipelineCacheStatus getStatus() const { return status; }
+    size_t getLoadedSize() const { return loadedSize; }
+
+    // 캐시 데이터를 파일로 저장하고 저장한 바이트 수를 반환합니다. 쓰는 도중 종료되어도 깨진 파일이 남지 않도록 임시 파일에 쓴 뒤 이름을 바꿉니다.
+    // 실패해도 다음 실행이 컴파일을 다시 할 뿐이므로 0 만 반환합니다.
+    size_t save() const
+    {
+        if (cache == VK_NULL_HANDLE)
+        {
+            return 0;
+        }
+        size_t dataSize = 0;
+        if (vkGetPipelineCacheData(device, cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+        {
+            return 0;
+        }
+        std::vector<uint8_t> data(dataSize);
+        if (vkGetPipelineCacheData(device, cache, &dataSize, data.data()) != VK_SUCCESS)
+        {
+            return 0;
+        }
+        data.resize(dataSize);
+
+        PipelineCacheFileHeader header{};
+        std::memcpy(header.magic, "NFPC", 4);
+        header.version = PIPELINE_CACHE_FILE_VERSION;
+        header.dataSize = data.size();
+        header.dataHash = hashBytes(data.data(), data.size());
+
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                return 0;
+            }
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(data.data()), data.size());
+            if (!out)
+            {
+                out.close();
+                std::remove(tempPath.c_str());
+                return 0;
+            }
+        }
+
+        // rename 은 대상이 이미 있으면 실패하는 플랫폼(Windows)이 있으므로 먼저 지웁니다.
+        std::remove(path.c_str());
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(tempPath.c_str());
+            return 0;
+        }
+        return data.size();
+    }
+
+    void destroy()
+    {
+        if (cache != VK_NULL_HANDLE)
+        {
+            vkDestroyPipelineCache(device, cache, nullptr);
+            cache = VK_NULL_HANDLE;
+        }
+    }
+
+private:
+    // 파일을 읽어 우리 헤더와 드라이버 헤더를 모두 검증하고, 통과하면 드라이버 데이터를 data 에 담습니다.
+    PipelineCacheStatus readFile(std::vector<uint8_t>& data) const
+    {
+        MappedFile file;
+        if (file.open(path) == false)
+        {
+            return PipelineCacheStatus::Missing;
+        }
+
+        PipelineCacheFileHeader header{};
+        if (file.getSize() < sizeof(header))
+        {
+            return PipelineCacheStatus::Corrupt;
+        }
+        std::memcpy(&header, file.getData(), sizeof(header));
+        const uint8_t* driverData = file.getData() + sizeof(header);
+        if (std::memcmp(header.magic, "NFPC", 4) != 0 || header.version != PIPELINE_CACHE_FILE_VERSION
+            || header.dataSize != file.getSize() - sizeof(header) || hashBytes(driverData, header.dataSize) != header.dataHash)
+        {
+            return PipelineCacheStatus::Corrupt;
+        }
+
+        // 드라이버 데이터는 항상 VkPipelineCacheHeaderVersionOne 으로 시작합니다. (headerSize, headerVersion, vendorID, deviceID, pipelineCacheUUID)
+        VkPipelineCacheHeaderVersionOne driverHeader{};
+        if (header.dataSize < sizeof(driverHeader))
+        {
+            return PipelineCacheStatus::Corrupt;
+        }
+        std::memcpy(&driverHeader, driverData, sizeof(driverHeader));
+        if (driverHeader.headerSize < sizeof(driverHeader) || driverHeader.headerSize > header.dataSize || driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+        {
+            return PipelineCacheStatus::Corrupt;
+        }
+        if (driverHeader.vendorID != properties.vendorID || driverHeader.deviceID != properties.deviceID
+            || std::memcmp(driverHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+        {
+            return PipelineCacheStatus::Mismatch;
+        }
+
+        data.assign(driverData, driverData + header.dataSize);
+        return PipelineCacheStatus::Loaded;
+    }
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties properties{};
+    std::string path;
+    PipelineCacheStatus status = PipelineCacheStatus::Disabled;
+    size_t loadedSize = 0;                  // 파일에서 불러온 드라이버 데이터의 바이트 수
+};
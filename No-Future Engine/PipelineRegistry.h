@@ -0,0 +1,378 @@
+#pragma once
+
+// 그래픽스 파이프라인 레지스트리
+// 머티리얼과 버텍스 형식이 늘어나면 파이프라인 조합도 늘어나고, vkCreateGraphicsPipelines 가 셰이더를 컴파일하는 시간이 로드 시간의 대부분이 됩니다.
+// 파이프라인을 만드는 데 쓰는 상태(셰이더 모듈, 버텍스 입력, 래스터라이저, 블렌딩, 깊이, MSAA, 렌더 패스)를 키(GraphicsPipelineDesc)로 삼아 한 번 만든 파이프라인을 다시 씁니다.
+// - request : 키의 파이프라인이 준비되어 있으면 바로 반환하고, 없으면 작업 스레드에 컴파일을 맡긴 뒤 VK_NULL_HANDLE 을 반환합니다. 같은 키를 다시 요청해도 컴파일은 한 번만 합니다.
+//   호출하는 쪽은 컴파일이 끝날 때까지 이미 준비된 파이프라인(예: 이전 메쉬와 그 파이프라인)으로 계속 그리므로, 프레임 도중 메인 스레드에서 컴파일하는 일이 없습니다.
+// - update : 끝난 컴파일 결과를 메인 스레드에서 반영합니다. 매 프레임 호출합니다. 컴파일에 실패한 키는 항목에서 빼고 PipelineCompileError 를 던지므로, 다시 요청하면 다시 컴파일합니다.
+// - wait : 첫 프레임처럼 그릴 파이프라인이 하나도 없을 때만 컴파일이 끝날 때까지 기다립니다.
+// 작업 스레드는 디스크 파이프라인 캐시(PipelineCache.h)를 함께 씁니다. VkPipelineCache 는 드라이버가 내부에서 동기화하므로 여러 스레드가 동시에 넘겨도 됩니다.
+// 셰이더 모듈은 SPIR-V 내용의 해시로 한 번만 만들고 키에는 모듈 핸들을 넣으므로, 내용이 같은 셰이더는 같은 키가 됩니다.
+
+#include "AssetLoader.h"
+#include "Hash.h"
+
+#include <vulkan/vulkan.h>
+
+#include <unordered_map>
+#include <functional>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+
+
+// 그래픽스 파이프라인 하나를 정하는 상태. 뷰포트와 시저는 동적 스테이트이므로 들어가지 않습니다.
+struct GraphicsPipelineDesc
+{
+    VkShaderModule vertexShader = VK_NULL_HANDLE;
+    VkShaderModule fragmentShader = VK_NULL_HANDLE;
+    std::vector<VkVertexInputBindingDescription> bindings;
+    std::vector<VkVertexInputAttributeDescription> attributes;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    VkBool32 depthTestEnable = VK_TRUE;
+    VkBool32 depthWriteEnable = VK_TRUE;
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+    VkPipelineColorBlendAttachmentState blend{     // 컬러 어태치먼트 하나의 블렌딩 설정. 기본값은 블렌딩 없이 RGBA 를 모두 씁니다.
+        VK_FALSE, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD,
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+    };
+    VkSampleCountFlagBits rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    VkBool32 sampleShadingEnable = VK_FALSE;
+    float minSampleShading = 0.0f;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    uint32_t subpass = 0;
+
+    // 구조체의 패딩이 섞이지 않도록 필드를 하나씩 모아서 비교하고 해시합니다. float 필드는 비트 그대로 씁니다.
+    std::vector<uint64_t> getFields() const
+    {
+        uint32_t minSampleShadingBits;
+        std::memcpy(&minSampleShadingBits, &minSampleShading, sizeof(minSampleShadingBits));
+
+        std::vector<uint64_t> fields = {
+            uint64_t(vertexShader), uint64_t(fragmentShader), uint64_t(layout), uint64_t(renderPass), subpass,
+            uint64_t(topology), uint64_t(polygonMode), cullMode, uint64_t(frontFace),
+            depthTestEnable, depthWriteEnable, uint64_t(depthCompareOp),
+            blend.blendEnable, uint64_t(blend.srcColorBlendFactor), uint64_t(blend.dstColorBlendFactor), uint64_t(blend.colorBlendOp),
+            uint64_t(blend.srcAlphaBlendFactor), uint64_t(blend.dstAlphaBlendFactor), uint64_t(blend.alphaBlendOp), blend.colorWriteMask,
+            uint64_t(rasterizationSamples), sampleShadingEnable, minSampleShadingBits,
+            bindings.size(), attributes.size()
+        };
+        for (const VkVertexInputBindingDescription& binding : bindings)
+        {
+            fields.insert(fields.end(), { binding.binding, binding.stride, uint64_t(binding.inputRate) });
+        }
+        for (const VkVertexInputAttributeDescription& attribute : attributes)
+        {
+            fields.insert(fields.end(), { attribute.location, attribute.binding, uint64_t(attribute.format), attribute.offset });
+        }
+        return fields;
+    }
+
+    bool operator==(const GraphicsPipelineDesc& other) const
+    {
+        return getFields() == other.getFields();
+    }
+};
+
+struct GraphicsPipelineDescHash
+{
+    size_t operator()(const GraphicsPipelineDesc& desc) const
+    {
+        const std::vector<uint64_t> fields = desc.getFields();
+        return static_cast<size_t>(hashBytes(fields.data(), fields.size() * sizeof(uint64_t)));
+    }
+};
+
+
+// 작업 스레드에서 파이프라인 컴파일에 실패하면 update 와 wait 가 던집니다. 호출하는 쪽이 어떤 파이프라인이 실패했는지 알 수 있도록 키를 담습니다.
+struct PipelineCompileError : std::runtime_error
+{
+    GraphicsPipelineDesc desc;
+
+    PipelineCompileError(const GraphicsPipelineDesc& desc, const std::string& message) : std::runtime_error(message), desc(desc)
+    {
+    }
+};
+
+
+class PipelineRegistry
+{
+public:
+    // 작업 스레드에서 desc 로 파이프라인을 만드는 함수. 외부 동기화가 필요 없는 Vulkan 함수(vkCreateGraphicsPipelines 등)만 불러야 합니다.
+    using Compile = std::function<VkPipeline(const GraphicsPipelineDesc&)>;
+
+    void init(VkDevice device, uint32_t threadCount, Compile compile)
+    {
+        this->device = device;
+        this->compile = std::move(compile);
+        compiler.init(threadCount);
+    }
+
+    // 내용 해시가 hash 인 셰이더 모듈을 찾습니다. 없으면 VK_NULL_HANDLE 을 반환하므로 호출하는 쪽이 만들어서 addShader 로 넣습니다.
+    VkShaderModule findShader(uint64_t hash) const
+    {
+        auto found = shaders.find(hash);
+        return found == shaders.end() ? VK_NULL_HANDLE : found->second;
+    }
+
+    // 셰이더 모듈의 소유권을 넘겨받습니다. releaseShader 로 빼지 않으면 destroy 에서 지웁니다.
+    VkShaderModule addShader(uint64_t hash, VkShaderModule module)
+    {
+        if (shaders.emplace(hash, module).second == false)
+        {
+            throw std::runtime_error("Pipeline registry already has the shader module!");
+        }
+        return module;
+    }
+
+    // 셰이더 모듈을 더 이상 쓰지 않습니다. (셰이더 핫 리로드) 그 모듈로 만든 파이프라인을 레지스트리에서 빼서 pipelines 에 담으므로, 호출하는 쪽이 그 파이프라인을 쓰는 프레임이 끝난 뒤에 지웁니다.
+    // 컴파일 중인 작업이 모듈을 쓰고 있을 수 있으므로 모듈은 그 작업들이 모두 끝난 뒤에 지웁니다. (destroyRetiredShaders) 컴파일 중이던 파이프라인은 끝나는 대로 publish 에서 지웁니다.
+    // 파이프라인은 만든 뒤에 셰이더 모듈을 참조하지 않으므로, 예전 파이프라인으로 그리는 프레임이 남아 있어도 모듈은 지워도 됩니다.
+    void releaseShader(VkShaderModule module, std::vector<VkPipeline>& pipelines)
+    {
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if (it->first.vertexShader == module || it->first.fragmentShader == module)
+            {
+                if (it->second.pipeline != VK_NULL_HANDLE)
+                {
+                    pipelines.push_back(it->second.pipeline);
+                }
+                it = entries.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        for (auto it = shaders.begin(); it != shaders.end(); ++it)
+        {
+            if (it->second == module)
+            {
+                retiredShaders.push_back(module);
+                shaders.erase(it);
+                break;
+            }
+        }
+        destroyRetiredShaders();
+    }
+
+    // 준비된 파이프라인을 반환합니다. 없으면 컴파일을 시작하고(이미 컴파일 중이면 기다리는 요청만 셉니다) VK_NULL_HANDLE 을 반환합니다. label 은 로그와 printStats 에 씁니다.
+    VkPipeline request(const GraphicsPipelineDesc& desc, const std::string& label)
+    {
+        auto found = entries.find(desc);
+        if (found != entries.end())
+        {
+            if (found->second.pipeline == VK_NULL_HANDLE)
+            {
+                pendingRequests++;
+            }
+            return found->second.pipeline;
+        }
+
+        entries.emplace(desc, Entry{ VK_NULL_HANDLE, label, 0.0 });
+        compilingShaders[desc.vertexShader]++;
+        compilingShaders[desc.fragmentShader]++;
+        auto job = std::make_shared<GraphicsPipelineDesc>(desc);
+        compiler.enqueue([this, job]() -> AssetLoader::Publish
+        {
+            // 예외를 에셋 로더로 넘기면 같이 끝난 다른 작업의 완료 함수가 실행되지 않으므로, 여기서 잡아 publish 에서 실패로 처리합니다.
+            auto compileStart = std::chrono::high_resolution_clock::now();
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            std::string error;
+            try
+            {
+                pipeline = compile(*job);
+            }
+            catch (const std::exception& e)
+            {
+                error = e.what();
+            }
+            double compileMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - compileStart).count();
+            return [this, job, pipeline, compileMs, error]()
+            {
+                publish(*job, pipeline, compileMs, error);
+            };
+        });
+        return VK_NULL_HANDLE;
+    }
+
+    // 끝난 컴파일 결과를 반영합니다. 컴파일에 실패한 파이프라인이 있으면 PipelineCompileError 를 하나씩 던집니다. 매 프레임 메인 스레드에서 호출합니다.
+    void update()
+    {
+        compiler.dispatchCompleted();
+        destroyRetiredShaders();
+        throwFailure();
+    }
+
+    // desc 의 파이프라인이 준비될 때까지 기다립니다. 그릴 파이프라인이 하나도 없는 시작할 때와 렌더 패스를 다시 만들었을 때만 씁니다.
+    VkPipeline wait(const GraphicsPipelineDesc& desc, const std::string& label)
+    {
+        VkPipeline pipeline = request(desc, label);
+        while (pipeline == VK_NULL_HANDLE)
+        {
+            if (compiler.waitCompleted() == 0)
+            {
+                throw std::runtime_error("Pipeline registry lost the compile job for " + label);
+            }
+            throwFailure();
+            pipeline = entries.at(desc).pipeline;
+        }
+        return pipeline;
+    }
+
+    // 모든 파이프라인을 지웁니다. 렌더 패스를 다시 만들면 예전 렌더 패스로 만든 파이프라인은 쓸 수 없으므로 호출합니다. GPU 가 멈춘 뒤에 호출해야 합니다.
+    // 컴파일 중인 작업은 예전 렌더 패스를 쓰고 있으므로, 호출하는 쪽이 렌더 패스를 지우기 전에 모두 끝나기를 기다립니다. 지우는 파이프라인의 컴파일 실패는 버립니다.
+    void clear()
+    {
+        while (compiler.waitCompleted() != 0)
+        {
+        }
+        failures.clear();
+        for (auto& entry : entries)
+        {
+            if (entry.second.pipeline != VK_NULL_HANDLE)
+            {
+                vkDestroyPipeline(device, entry.second.pipeline, nullptr);
+            }
+        }
+        entries.clear();
+    }
+
+    // 컴파일 중인 작업이 끝나기를 기다린 뒤 작업 스레드를 멈추고 파이프라인과 셰이더 모듈을 모두 지웁니다.
+    void destroy()
+    {
+        while (compiler.waitCompleted() != 0)
+        {
+        }
+        compiler.destroy();
+        clear();
+        for (auto& shader : shaders)
+        {
+            vkDestroyShaderModule(device, shader.second, nullptr);
+        }
+        shaders.clear();
+        for (VkShaderModule module : retiredShaders)
+        {
+            vkDestroyShaderModule(device, module, nullptr);
+        }
+        retiredShaders.clear();
+    }
+
+    size_t getPipelineCount() const { return entries.size(); }
+    size_t getPendingCount() const { return compiler.getPendingCount(); }
+
+    // 컴파일한 파이프라인 수와 시간, 컴파일을 기다린 요청 수, 그리고 파이프라인별 컴파일 시간을 출력합니다.
+    void printStats(std::ostream& out, const char* prefix) const
+    {
+        out << prefix << "Pipeline registry : " << entries.size() << " pipelines, " << compiledCount << " compiled on workers, avg " << totalCompileMs / std::max<size_t>(1, compiledCount)
+            << " ms, " << pendingRequests << " requests waited on a pending compile\n";
+        for (const auto& entry : entries)
+        {
+            out << prefix << "  " << entry.second.label << " : ";
+            if (entry.second.pipeline == VK_NULL_HANDLE)
+            {
+                out << "compiling\n";
+            }
+            else
+            {
+                out << entry.second.compileMs << " ms\n";
+            }
+        }
+    }
+
+private:
+    struct Entry
+    {
+        VkPipeline pipeline;            // 컴파일 중이면 VK_NULL_HANDLE
+        std::string label;
+        double compileMs;
+    };
+
+    // 메인 스레드에서 컴파일 결과를 항목에 넣습니다. 그사이 releaseShader 로 빠진 요청의 결과면 바로 지웁니다.
+    // 실패한 요청은 항목에서 빼서 다음 request 가 다시 컴파일하게 하고, update 나 wait 에서 던지도록 모아 둡니다.
+    void publish(const GraphicsPipelineDesc& desc, VkPipeline pipeline, double compileMs, const std::string& error)
+    {
+        finishCompile(desc.vertexShader);
+        finishCompile(desc.fragmentShader);
+        auto found = entries.find(desc);
+        if (pipeline == VK_NULL_HANDLE)
+        {
+            if (found != entries.end())
+            {
+                failures.emplace_back(desc, "Failed to compile graphics pipeline " + found->second.label + " : " + error);
+                entries.erase(found);
+            }
+            return;
+        }
+
+        compiledCount++;
+        totalCompileMs += compileMs;
+        if (found == entries.end())
+        {
+            vkDestroyPipeline(device, pipeline, nullptr);
+            return;
+        }
+        found->second.pipeline = pipeline;
+        found->second.compileMs = compileMs;
+    }
+
+    void finishCompile(VkShaderModule module)
+    {
+        auto found = compilingShaders.find(module);
+        if (--found->second == 0)
+        {
+            compilingShaders.erase(found);
+        }
+    }
+
+    // releaseShader 로 뺀 모듈 중 컴파일 중인 작업이 더 이상 쓰지 않는 것을 지웁니다.
+    void destroyRetiredShaders()
+    {
+        for (auto it = retiredShaders.begin(); it != retiredShaders.end();)
+        {
+            if (compilingShaders.count(*it) == 0)
+            {
+                vkDestroyShaderModule(device, *it, nullptr);
+                it = retiredShaders.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void throwFailure()
+    {
+        if (failures.empty() == false)
+        {
+            PipelineCompileError failure = failures.front();
+            failures.erase(failures.begin());
+            throw failure;
+        }
+    }
+
+    VkDevice device = VK_NULL_HANDLE;
+    Compile compile;
+    AssetLoader compiler;                                   // 컴파일 작업 스레드 풀. 완료 함수(publish)는 메인 스레드에서 실행됩니다.
+    std::unordered_map<GraphicsPipelineDesc, Entry, GraphicsPipelineDescHash> entries;
+    std::unordered_map<uint64_t, VkShaderModule> shaders;   // SPIR-V 내용 해시 -> 셰이더 모듈
+    std::vector<VkShaderModule> retiredShaders;             // releaseShader 로 뺐지만 아직 컴파일 중인 작업이 쓰고 있는 모듈
+    std::unordered_map<VkShaderModule, uint32_t> compilingShaders; // 모듈마다 그 모듈을 쓰는 컴파일 중인 작업 수
+    std::vector<PipelineCompileError> failures;             // 아직 던지지 않은 컴파일 실패
+    size_t compiledCount = 0;
+    double totalCompileMs = 0.0;
+    uint64_t pendingRequests = 0;
+};
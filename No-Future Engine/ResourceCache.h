@@ -0,0 +1,231 @@
+#pragma once
+
+// 참조 수를 세는 리소스 캐시
+// 같은 이미지를 여러 메쉬가 쓰거나 같은 설정의 샘플러를 다시 만들 때, 디코딩 / 업로드 / 생성을 다시 하지 않고 이미 만든 리소스를 나누어 씁니다.
+// - acquire 로 찾은 항목과 insert 로 넣은 항목은 참조 수가 1 씩 올라가고, release 할 때마다 내려갑니다.
+// - 참조 수가 0 이 된 항목은 바로 지우지 않고 남겨 두었다가, 쓰지 않는 항목의 바이트 수나 개수가 한도를 넘으면 가장 오래 쓰지 않은 항목부터 지웁니다. (LRU)
+// - release 는 GPU 가 그 리소스를 더 이상 읽지 않을 때(DeletionQueue 를 거쳐서) 호출해야 합니다. 한도를 넘으면 release 안에서 바로 지우기 때문입니다.
+// 항목마다 바이트 수와 이름을 기억해서 printStats 로 항목별 메모리 사용량을 출력합니다.
+
+#include "Hash.h"
+
+#include <vulkan/vulkan.h>
+
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <string>
+#include <array>
+#include <ostream>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+
+
+// 텍스쳐 캐시 키. 같은 경로라도 파일 내용이나 빌드 설정이 바뀌면 다른 텍스쳐입니다.
+struct TextureKey
+{
+    std::string path;                   // 텍스쳐의 원본 경로 (아틀라스는 아틀라스 캐시 경로)
+    uint64_t contentHash = 0;           // 원본 파일 내용과 빌드 설정(압축 방식, 밉 체인 생성 위치)의 해시
+    uint32_t firstLevel = 0;            // 이미지의 레벨 0 이 전체 밉 체인의 몇 번째 레벨인지. 텍스쳐 스트리밍은 레벨마다 꼬리 이미지를 따로 만듭니다.
+
+    bool operator==(const TextureKey& other) const
+    {
+        return path == other.path && contentHash == other.contentHash && firstLevel == other.firstLevel;
+    }
+};
+
+struct TextureKeyHash
+{
+    size_t operator()(const TextureKey& key) const
+    {
+        return static_cast<size_t>(hashBytes(key.path.data(), key.path.size(), key.contentHash ^ key.firstLevel));
+    }
+};
+
+// 샘플러 캐시 키. VkSamplerCreateInfo 의 모든 필드를 비교합니다. pNext 로 이어지는 구조체(예: 샘플러 YCbCr 변환)는 지원하지 않습니다.
+struct SamplerKey
+{
+    VkSamplerCreateInfo info{};
+
+    SamplerKey() = default;
+    explicit SamplerKey(const VkSamplerCreateInfo& info) : info(info)
+    {
+        if (info.pNext != nullptr)
+        {
+            throw std::runtime_error("Sampler cache does not support extension structures!");
+        }
+    }
+
+    // 구조체의 패딩이 섞이지 않도록 필드를 하나씩 모아서 비교하고 해시합니다. float 필드는 비트 그대로 씁니다.
+    std::array<uint32_t, 16> getFields() const
+    {
+        auto bits = [](float value)
+        {
+            uint32_t result;
+            std::memcpy(&result, &value, sizeof(result));
+            return result;
+        };
+        return {
+            info.flags, uint32_t(info.magFilter), uint32_t(info.minFilter), uint32_t(info.mipmapMode),
+            uint32_t(info.addressModeU), uint32_t(info.addressModeV), uint32_t(info.addressModeW), bits(info.mipLodBias),
+            info.anisotropyEnable, bits(info.maxAnisotropy), info.compareEnable, uint32_t(info.compareOp),
+            bits(info.minLod), bits(info.maxLod), uint32_t(info.borderColor), info.unnormalizedCoordinates
+        };
+    }
+
+    bool operator==(const SamplerKey& other) const
+    {
+        return getFields() == other.getFields();
+    }
+};
+
+struct SamplerKeyHash
+{
+    size_t operator()(const SamplerKey& key) const
+    {
+        const std::array<uint32_t, 16> fields = key.getFields();
+        return static_cast<size_t>(hashBytes(fields.data(), sizeof(fields)));
+    }
+};
+
+
+template <typename Key, typename Value, typename KeyHash>
+class ResourceCache
+{
+public:
+    using Destroy = std::function<void(Value&)>;
+
+    // maxUnusedBytes / maxUnusedCount : 참조 수가 0 인 항목을 남겨 둘 한도. destroy : 항목을 지울 때 값의 리소스를 해제하는 함수
+    void init(uint64_t maxUnusedBytes, size_t maxUnusedCount, Destroy destroy)
+    {
+        this->maxUnusedBytes = maxUnusedBytes;
+        this->maxUnusedCount = maxUnusedCount;
+        this->destroy = std::move(destroy);
+    }
+
+    // 키가 있으면 참조 수를 올리고 값을 반환합니다. 없으면 nullptr 를 반환하므로 호출하는 쪽이 만들어서 insert 합니다.
+    const Value* acquire(const Key& key)
+    {
+        auto found = index.find(key);
+        if (found == index.end())
+        {
+            misses++;
+            return nullptr;
+        }
+        hits++;
+        Entry& entry = *found->second;
+        if (entry.refCount == 0)
+        {
+            unusedBytes -= entry.byteSize;
+            unusedCount--;
+        }
+        entry.refCount++;
+        entries.splice(entries.begin(), entries, found->second);
+        return &entry.value;
+    }
+
+    // 새로 만든 값을 참조 수 1 로 넣습니다. label 과 byteSize 는 printStats 에 씁니다.
+    const Value& insert(const Key& key, Value value, uint64_t byteSize, std::string label)
+    {
+        if (index.count(key) != 0)
+        {
+            throw std::runtime_error("Resource cache already has an entry for " + label);
+        }
+        entries.push_front(Entry{ key, std::move(value), byteSize, std::move(label), 1 });
+        index.emplace(key, entries.begin());
+        totalBytes += byteSize;
+        return entries.front().value;
+    }
+
+    // 참조 수를 내립니다. 0 이 되면 가장 최근에 쓴 항목으로 남겨 두고, 한도를 넘은 만큼 오래된 항목을 지웁니다.
+    void release(const Key& key)
+    {
+        auto found = index.find(key);
+        if (found == index.end() || found->second->refCount == 0)
+        {
+            throw std::runtime_error("Released a resource that is not held!");
+        }
+        Entry& entry = *found->second;
+        entry.refCount--;
+        if (entry.refCount == 0)
+        {
+            unusedBytes += entry.byteSize;
+            unusedCount++;
+            entries.splice(entries.begin(), entries, found->second);
+            trim(maxUnusedBytes, maxUnusedCount);
+        }
+    }
+
+    // 쓰지 않는 항목이 maxBytes 와 maxCount 안에 들어올 때까지 가장 오래 쓰지 않은 것부터 지웁니다.
+    void trim(uint64_t maxBytes, size_t maxCount)
+    {
+        auto it = entries.end();
+        while ((unusedBytes > maxBytes || unusedCount > maxCount) && it != entries.begin())
+        {
+            --it;
+            if (it->refCount != 0)
+            {
+                continue;
+            }
+            unusedBytes -= it->byteSize;
+            unusedCount--;
+            totalBytes -= it->byteSize;
+            evictions++;
+            destroy(it->value);
+            index.erase(it->key);
+            it = entries.erase(it);
+        }
+    }
+
+    // 참조 수와 관계없이 모든 항목을 지웁니다. 프로그램을 끝낼 때 GPU 가 멈춘 뒤에 호출합니다.
+    void clear()
+    {
+        for (Entry& entry : entries)
+        {
+            destroy(entry.value);
+        }
+        entries.clear();
+        index.clear();
+        totalBytes = 0;
+        unusedBytes = 0;
+        unusedCount = 0;
+    }
+
+    size_t getEntryCount() const { return entries.size(); }
+    uint64_t getTotalBytes() const { return totalBytes; }
+    uint64_t getUnusedBytes() const { return unusedBytes; }
+
+    // 캐시 전체와 항목별 메모리 사용량을 최근에 쓴 순서로 출력합니다.
+    void printStats(std::ostream& out, const char* prefix, const char* name) const
+    {
+        out << prefix << name << " cache : " << entries.size() << " entries (" << unusedCount << " unused), " << totalBytes / 1024 << " KiB (" << unusedBytes / 1024 << " KiB unused), "
+            << hits << " hits, " << misses << " misses, " << evictions << " evictions\n";
+        for (const Entry& entry : entries)
+        {
+            out << prefix << "  " << entry.label << " : " << entry.refCount << " refs, " << entry.byteSize / 1024 << " KiB\n";
+        }
+    }
+
+private:
+    struct Entry
+    {
+        Key key;
+        Value value;
+        uint64_t byteSize;
+        std::string label;
+        uint32_t refCount;
+    };
+
+    std::list<Entry> entries;           // 앞쪽일수록 최근에 acquire / insert / release 한 항목
+    std::unordered_map<Key, typename std::list<Entry>::iterator, KeyHash> index;
+    Destroy destroy;
+    uint64_t maxUnusedBytes = 0;
+    size_t maxUnusedCount = 0;
+    uint64_t totalBytes = 0;
+    uint64_t unusedBytes = 0;
+    size_t unusedCount = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+};
@@ -0,0 +1,342 @@
+#pragma once
+
+// 런타임 GLSL 컴파일과 셰이더 핫 리로드
+// 셰이더를 glslc 로 미리 컴파일해 두면(Shaders/Compile Shaders.bat) 셰이더를 고칠 때마다 배치 파일을 돌리고 프로그램을 다시 시작해야 합니다.
+// SDK 에 들어 있는 shaderc 로 GLSL 소스를 실행 중에 SPIR-V 로 컴파일하고, 소스가 바뀌면 다시 컴파일해서 파이프라인을 바꿉니다.
+// - 캐시 : define 을 적용하고 #include 를 펼친 전처리 결과의 해시를 키로 SPIR-V 를 소스 옆 파일("x.vert.spvcache")에 저장합니다. 전처리는 컴파일보다 훨씬 빠르므로 소스가 그대로면 컴파일을 건너뜁니다.
+// - 감시 : ShaderWatcher 가 소스와 #include 한 파일의 수정 시각을 주기적으로 확인합니다. 파일 변경 알림 API 는 플랫폼마다 다르므로 std::filesystem 으로 폴링합니다.
+// compile 은 init 에서 만든 상수 shaderc::Compiler 만 쓰고 컴파일 옵션은 호출마다 새로 만들므로 여러 작업 스레드에서 동시에 불러도 됩니다.
+// 고치는 중인 소스는 컴파일되지 않는 경우가 많으므로, 실패해도 예외를 던지지 않고 오류 메시지를 돌려줍니다. 호출하는 쪽은 예전 셰이더를 계속 씁니다.
+// shaderc_shared.dll 은 지연 로드(/DELAYLOAD)하므로 DLL 이 없어도 프로그램은 시작합니다. init 이 DLL 을 불러 보고, 없으면 compile 이 항상 실패해서 미리 컴파일한 ".spv" 를 쓰게 됩니다.
+//
+// 캐시 파일 구조 (리틀 엔디안)
+// [ShaderCacheHeader][SPIR-V : codeSize]
+
+#include "Hash.h"
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <delayimp.h>
+#endif
+
+#include <shaderc/shaderc.hpp>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <chrono>
+#include <algorithm>
+#include <utility>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+
+// 컴파일 옵션(대상 환경, 최적화 수준)이나 파일 구조가 바뀌면 올려서 이전 캐시를 무효화합니다.
+constexpr uint32_t SHADER_CACHE_VERSION = 1;
+constexpr const char* SHADER_CACHE_EXTENSION = ".spvcache";
+constexpr const char* SHADERC_DLL_NAME = "shaderc_shared.dll"; // 프로젝트 설정의 /DELAYLOAD 와 같은 이름이어야 합니다.
+
+// 감시하는 파일의 수정 시각을 확인하는 간격. 파일 몇 개의 stat 이라 짧게 두어도 부담이 없습니다.
+constexpr std::chrono::milliseconds SHADER_WATCH_INTERVAL(250);
+
+struct ShaderCacheHeader
+{
+    char magic[4];              // "NFSC"
+    uint32_t version;           // SHADER_CACHE_VERSION
+    uint64_t sourceHash;        // 전처리한 소스와 셰이더 종류의 hashBytes
+    uint64_t codeSize;          // 뒤따르는 SPIR-V 의 바이트 수
+    uint64_t codeHash;          // SPIR-V 의 hashBytes
+};
+
+// 컴파일할 셰이더 하나
+struct ShaderSource
+{
+    std::string path;                                           // GLSL 소스 경로
+    shaderc_shader_kind kind = shaderc_glsl_infer_from_source;  // shaderc_vertex_shader, shaderc_fragment_shader 등
+    std::vector<std::pair<std::string, std::string>> defines;   // 컴파일할 때 정의할 매크로 (이름, 값)
+};
+
+struct CompiledShader
+{
+    std::vector<char> code;                 // SPIR-V. readFile 로 읽은 .spv 와 같은 형식입니다.
+    std::vector<std::string> dependencies;  // 소스와 #include 한 파일들. 핫 리로드가 이 파일들을 감시합니다.
+    uint64_t sourceHash = 0;
+    bool cacheHit = false;                  // 컴파일하지 않고 SPIR-V 캐시를 읽었는지
+    std::string error;                      // 실패하면 오류 메시지
+};
+
+
+class ShaderLibrary
+{
+public:
+    // shaderc 를 준비합니다. Windows 에서는 지연 로드하는 shaderc DLL 을 먼저 불러 보고, 없으면 false 를 반환합니다. 작업 스레드가 compile 을 부르기 전에 한 번 호출합니다.
+    bool init()
+    {
+#ifdef _WIN32
+        // 지연 로드한 함수를 처음 부를 때 DLL 이 없으면 구조적 예외가 나므로, 미리 모든 import 를 불러서 실패를 HRESULT 로 받습니다.
+        if (FAILED(__HrLoadAllImportsForDll(SHADERC_DLL_NAME)))
+        {
+            return false;
+        }
+#endif
+        compiler = std::make_unique<shaderc::Compiler>();
+        return compiler->IsValid();
+    }
+
+    bool isAvailable() const { return compiler != nullptr && compiler->IsValid(); }
+
+    // source 를 SPIR-V 로 컴파일합니다. 실패하면 false 를 반환하고 result.error 에 shaderc 의 오류 메시지를 담습니다.
+    bool compile(const ShaderSource& source, CompiledShader& result) const
+    {
+        result = CompiledShader{};
+        result.dependencies.push_back(source.path);
+        if (isAvailable() == false)
+        {
+            result.error = std::string("shaderc is not available (") + SHADERC_DLL_NAME + ")";
+            return false;
+        }
+
+        std::string text;
+        if (readText(source.path, text) == false)
+        {
+            result.error = "Failed to open shader source : " + source.path;
+            return false;
+        }
+
+        shaderc::CompileOptions options;
+        for (const auto& define : source.defines)
+        {
+            options.AddMacroDefinition(define.first, define.second);
+        }
+        options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+        options.SetOptimizationLevel(shaderc_optimization_level_performance);
+        options.SetIncluder(std::make_unique<Includer>(result.dependencies));
+
+        // define 과 #include 를 적용한 결과가 같으면 SPIR-V 도 같으므로 전처리 결과로 캐시를 찾습니다.
+        shaderc::PreprocessedSourceCompilationResult preprocessed = compiler->PreprocessGlsl(text, source.kind, source.path.c_str(), options);
+        if (preprocessed.GetCompilationStatus() != shaderc_compilation_status_success)
+        {
+            result.error = preprocessed.GetErrorMessage();
+            return false;
+        }
+        result.sourceHash = hashBytes(preprocessed.cbegin(), size_t(preprocessed.cend() - preprocessed.cbegin()), uint64_t(source.kind));
+
+        const std::string cachePath = source.path + SHADER_CACHE_EXTENSION;
+        if (readCache(cachePath, result.sourceHash, result.code))
+        {
+            result.cacheHit = true;
+            return true;
+        }
+
+        shaderc::SpvCompilationResult spirv = compiler->CompileGlslToSpv(text, source.kind, source.path.c_str(), options);
+        if (spirv.GetCompilationStatus() != shaderc_compilation_status_success)
+        {
+            result.error = spirv.GetErrorMessage();
+            return false;
+        }
+        const char* codeBegin = reinterpret_cast<const char*>(spirv.cbegin());
+        const char* codeEnd = reinterpret_cast<const char*>(spirv.cend());
+        result.code.assign(codeBegin, codeEnd);
+
+        // 소스를 전처리와 컴파일에서 두 번 읽었으므로 #include 한 파일이 두 번씩 들어 있습니다.
+        std::sort(result.dependencies.begin() + 1, result.dependencies.end());
+        result.dependencies.erase(std::unique(result.dependencies.begin() + 1, result.dependencies.end()), result.dependencies.end());
+
+        // 캐시를 쓰지 못해도 다음 실행이 다시 컴파일할 뿐이므로 결과는 그대로 씁니다.
+        writeCache(cachePath, result.sourceHash, result.code);
+        return true;
+    }
+
+private:
+    // #include "x.glsl" 를 포함하는 파일의 폴더 기준으로 찾고, 찾은 파일을 dependencies 에 더합니다.
+    class Includer : public shaderc::CompileOptions::IncluderInterface
+    {
+    public:
+        explicit Includer(std::vector<std::string>& dependencies) : dependencies(dependencies) {}
+
+        shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type, const char* requestingSource, size_t) override
+        {
+            auto include = std::make_unique<Include>();
+            include->path = getDirectory(requestingSource) + requestedSource;
+            if (readText(include->path, include->content))
+            {
+                dependencies.push_back(include->path);
+            }
+            else
+            {
+                // shaderc 는 source_name 이 비어 있으면 content 를 오류 메시지로 씁니다.
+                include->content = "Failed to open include file : " + include->path;
+                include->path.clear();
+            }
+            include->result.source_name = include->path.c_str();
+            include->result.source_name_length = include->path.size();
+            include->result.content = include->content.c_str();
+            include->result.content_length = include->content.size();
+            include->result.user_data = include.get();
+            return &include.release()->result;
+        }
+
+        void ReleaseInclude(shaderc_include_result* data) override
+        {
+            delete static_cast<Include*>(data->user_data);
+        }
+
+    private:
+        struct Include
+        {
+            std::string path;
+            std::string content;
+            shaderc_include_result result{};
+        };
+
+        std::vector<std::string>& dependencies;
+    };
+
+    static std::string getDirectory(const std::string& path)
+    {
+        size_t slash = path.find_last_of("/\\");
+        return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    }
+
+    static bool readText(const std::string& path, std::string& text)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+        std::ostringstream stream;
+        stream << file.rdbuf();
+        text = stream.str();
+        return true;
+    }
+
+    // 헤더와 SPIR-V 해시가 모두 맞을 때만 code 에 담습니다.
+    static bool readCache(const std::string& path, uint64_t sourceHash, std::vector<char>& code)
+    {
+        MappedFile file;
+        if (file.open(path) == false || file.getSize() < sizeof(ShaderCacheHeader))
+        {
+            return false;
+        }
+        ShaderCacheHeader header{};
+        std::memcpy(&header, file.getData(), sizeof(header));
+        const uint8_t* data = file.getData() + sizeof(header);
+        if (std::memcmp(header.magic, "NFSC", 4) != 0 || header.version != SHADER_CACHE_VERSION || header.sourceHash != sourceHash
+            || header.codeSize != file.getSize() - sizeof(header) || header.codeSize % sizeof(uint32_t) != 0 || hashBytes(data, header.codeSize) != header.codeHash)
+        {
+            return false;
+        }
+        code.assign(reinterpret_cast<const char*>(data), reinterpret_cast<const char*>(data) + header.codeSize);
+        return true;
+    }
+
+    // 쓰는 도중 종료되어도 깨진 파일이 남지 않도록 임시 파일에 쓴 뒤 이름을 바꿉니다.
+    static bool writeCache(const std::string& path, uint64_t sourceHash, const std::vector<char>& code)
+    {
+        ShaderCacheHeader header{};
+        std::memcpy(header.magic, "NFSC", 4);
+        header.version = SHADER_CACHE_VERSION;
+        header.sourceHash = sourceHash;
+        header.codeSize = code.size();
+        header.codeHash = hashBytes(code.data(), code.size());
+
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                return false;
+            }
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(code.data(), code.size());
+            if (!out)
+            {
+                out.close();
+                std::remove(tempPath.c_str());
+                return false;
+            }
+        }
+
+        // rename 은 대상이 이미 있으면 실패하는 플랫폼(Windows)이 있으므로 먼저 지웁니다.
+        std::remove(path.c_str());
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    std::unique_ptr<shaderc::Compiler> compiler;   // init 에서 만듭니다. shaderc DLL 이 없으면 nullptr 입니다.
+};
+
+
+// 파일들의 수정 시각을 기억해 두고 바뀐 파일이 있는지 확인합니다. 메인 스레드에서만 씁니다.
+class ShaderWatcher
+{
+public:
+    // 감시할 파일 목록을 바꿉니다. 이미 감시하던 파일은 기억해 둔 수정 시각을 그대로 두므로, 컴파일하는 사이에 다시 저장한 변경도 놓치지 않습니다.
+    void watch(const std::vector<std::string>& paths)
+    {
+        std::vector<WatchedFile> watched;
+        for (const std::string& path : paths)
+        {
+            auto found = std::find_if(files.begin(), files.end(), [&](const WatchedFile& file) { return file.path == path; });
+            if (found != files.end())
+            {
+                watched.push_back(*found);
+            }
+            else if (std::none_of(watched.begin(), watched.end(), [&](const WatchedFile& file) { return file.path == path; }))
+            {
+                watched.push_back(WatchedFile{ path, getWriteTime(path) });
+            }
+        }
+        files = std::move(watched);
+    }
+
+    // SHADER_WATCH_INTERVAL 이 지났으면 수정 시각을 확인해서, 바뀐 파일이 있으면 true 를 반환합니다. 매 프레임 호출합니다.
+    bool poll()
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastPoll < SHADER_WATCH_INTERVAL)
+        {
+            return false;
+        }
+        lastPoll = now;
+
+        bool changed = false;
+        for (WatchedFile& file : files)
+        {
+            std::filesystem::file_time_type writeTime = getWriteTime(file.path);
+            if (writeTime != file.writeTime)
+            {
+                file.writeTime = writeTime;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+private:
+    struct WatchedFile
+    {
+        std::string path;
+        std::filesystem::file_time_type writeTime;
+    };
+
+    // 편집기가 파일을 지우고 새로 쓰는 동안에는 파일이 없을 수 있으므로 오류 대신 가장 이른 시각을 씁니다.
+    static std::filesystem::file_time_type getWriteTime(const std::string& path)
+    {
+        std::error_code error;
+        std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+        return error ? std::filesystem::file_time_type::min() : writeTime;
+    }
+
+    std::vector<WatchedFile> files;
+    std::chrono::steady_clock::time_point lastPoll{};
+};
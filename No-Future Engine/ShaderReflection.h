@@ -0,0 +1,422 @@
+#pragma once
+
+// SPIR-V 리플렉션으로 만드는 파이프라인 레이아웃과 버텍스 입력
+// 디스크립터 셋 레이아웃, 디스크립터 풀, 버텍스 속성을 셰이더에 맞춰 손으로 적어 두면 셰이더를 고칠 때마다 세 곳을 함께 고쳐야 하고, 셰이더가 더 이상 쓰지 않는 바인딩이 남기 쉽습니다.
+// SDK 에 들어 있는 SPIRV-Reflect 로 스테이지마다 SPIR-V 를 읽어서 이 정보를 만듭니다.
+// - 디스크립터 : 진입점(main)이 실제로 읽거나 쓰는 바인딩만 모읍니다. 선언만 하고 쓰지 않는 바인딩은 레이아웃에서 빠집니다. 여러 스테이지가 같은 바인딩을 쓰면 stageFlags 를 합칩니다.
+// - 푸시 상수 : 스테이지마다 진입점이 쓰는 푸시 상수 블록의 범위를 모으고, 범위가 같은 스테이지들은 하나로 합칩니다.
+// - 버텍스 입력 : 버텍스 셰이더가 읽는 location 만 남깁니다. 형식과 오프셋은 메쉬의 버텍스 형식(VertexLayout)이 정하므로 리플렉션은 어떤 속성이 필요한지만 정합니다.
+// LayoutCache 는 내용이 같은 디스크립터 셋 레이아웃과 파이프라인 레이아웃을 한 번만 만듭니다. 파이프라인 레이아웃 핸들이 같은 파이프라인끼리는 바인딩한 디스크립터 셋을 그대로 쓸 수 있으므로,
+// 셰이더를 다시 불러와도 인터페이스가 같으면 디스크립터 셋을 다시 할당하거나 바인딩할 필요가 없습니다.
+
+#include "Hash.h"
+
+#include <spirv_reflect.h>
+#include <vulkan/vulkan.h>
+
+#include <unordered_map>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <ostream>
+#include <stdexcept>
+#include <cstdint>
+
+
+// 스테이지 하나에서 읽은 리소스
+struct ShaderStageLayout
+{
+    VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+    std::vector<std::pair<uint32_t, VkDescriptorSetLayoutBinding>> bindings;   // (셋 번호, 바인딩). stageFlags 는 이 스테이지입니다.
+    std::vector<VkPushConstantRange> pushConstants;
+    std::vector<uint32_t> inputLocations;                                       // 버텍스 셰이더가 읽는 입력의 location (내장 변수 제외)
+};
+
+// 디스크립터 셋 레이아웃 하나를 정하는 바인딩들. 바인딩 번호 순으로 정렬되어 있습니다.
+struct DescriptorSetLayoutDesc
+{
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+    // 불변 샘플러는 쓰지 않으므로 pImmutableSamplers 는 비교하지 않습니다.
+    std::vector<uint64_t> getFields() const
+    {
+        std::vector<uint64_t> fields = { bindings.size() };
+        for (const VkDescriptorSetLayoutBinding& binding : bindings)
+        {
+            fields.insert(fields.end(), { binding.binding, uint64_t(binding.descriptorType), binding.descriptorCount, binding.stageFlags });
+        }
+        return fields;
+    }
+
+    bool operator==(const DescriptorSetLayoutDesc& other) const
+    {
+        return getFields() == other.getFields();
+    }
+};
+
+struct DescriptorSetLayoutDescHash
+{
+    size_t operator()(const DescriptorSetLayoutDesc& desc) const
+    {
+        const std::vector<uint64_t> fields = desc.getFields();
+        return static_cast<size_t>(hashBytes(fields.data(), fields.size() * sizeof(uint64_t)));
+    }
+};
+
+// 파이프라인 레이아웃 하나를 정하는 셋 레이아웃들과 푸시 상수 범위. sets[i] 가 셋 번호 i 이며, 셰이더가 건너뛴 셋 번호는 빈 셋 레이아웃으로 채웁니다.
+struct PipelineLayoutDesc
+{
+    std::vector<DescriptorSetLayoutDesc> sets;
+    std::vector<VkPushConstantRange> pushConstants;
+
+    std::vector<uint64_t> getFields() const
+    {
+        std::vector<uint64_t> fields = { sets.size(), pushConstants.size() };
+        for (const DescriptorSetLayoutDesc& set : sets)
+        {
+            const std::vector<uint64_t> setFields = set.getFields();
+            fields.insert(fields.end(), setFields.begin(), setFields.end());
+        }
+        for (const VkPushConstantRange& range : pushConstants)
+        {
+            fields.insert(fields.end(), { range.stageFlags, range.offset, range.size });
+        }
+        return fields;
+    }
+
+    bool operator==(const PipelineLayoutDesc& other) const
+    {
+        return getFields() == other.getFields();
+    }
+
+    // 셋 set 에서 유형이 type 인 첫 번째 바인딩. 셰이더가 쓰지 않아 빠졌으면 nullptr 를 반환합니다.
+    const VkDescriptorSetLayoutBinding* findBinding(uint32_t set, VkDescriptorType type) const
+    {
+        if (set >= sets.size())
+        {
+            return nullptr;
+        }
+        for (const VkDescriptorSetLayoutBinding& binding : sets[set].bindings)
+        {
+            if (binding.descriptorType == type)
+            {
+                return &binding;
+            }
+        }
+        return nullptr;
+    }
+
+    // 셋 set 을 바인딩할 때 넘겨야 하는 동적 오프셋의 수
+    uint32_t getDynamicOffsetCount(uint32_t set) const
+    {
+        uint32_t count = 0;
+        if (set < sets.size())
+        {
+            for (const VkDescriptorSetLayoutBinding& binding : sets[set].bindings)
+            {
+                if (binding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || binding.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC)
+                {
+                    count += binding.descriptorCount;
+                }
+            }
+        }
+        return count;
+    }
+
+    // 셋마다 setCount 개씩 할당할 디스크립터 풀의 크기
+    std::vector<VkDescriptorPoolSize> getPoolSizes(uint32_t setCount) const
+    {
+        std::vector<VkDescriptorPoolSize> poolSizes;
+        for (const DescriptorSetLayoutDesc& set : sets)
+        {
+            for (const VkDescriptorSetLayoutBinding& binding : set.bindings)
+            {
+                auto found = std::find_if(poolSizes.begin(), poolSizes.end(), [&](const VkDescriptorPoolSize& size) { return size.type == binding.descriptorType; });
+                if (found == poolSizes.end())
+                {
+                    poolSizes.push_back({ binding.descriptorType, 0 });
+                    found = poolSizes.end() - 1;
+                }
+                found->descriptorCount += binding.descriptorCount * setCount;
+            }
+        }
+        return poolSizes;
+    }
+};
+
+struct PipelineLayoutDescHash
+{
+    size_t operator()(const PipelineLayoutDesc& desc) const
+    {
+        const std::vector<uint64_t> fields = desc.getFields();
+        return static_cast<size_t>(hashBytes(fields.data(), fields.size() * sizeof(uint64_t)));
+    }
+};
+
+
+namespace ShaderReflection
+{
+    // 진입점 main 이 쓰는 디스크립터 바인딩, 푸시 상수 블록, 입력 변수를 읽습니다. 실패하면 error 에 이유를 담고 false 를 반환합니다.
+    inline bool reflect(const std::vector<char>& code, ShaderStageLayout& result, std::string& error)
+    {
+        SpvReflectShaderModule module;
+        if (spvReflectCreateShaderModule(code.size(), code.data(), &module) != SPV_REFLECT_RESULT_SUCCESS)
+        {
+            error = "Failed to reflect SPIR-V";
+            return false;
+        }
+
+        result = ShaderStageLayout{};
+        result.stage = static_cast<VkShaderStageFlagBits>(module.shader_stage);
+        const char* entryPoint = "main";
+        bool succeeded = true;
+
+        uint32_t count = 0;
+        std::vector<SpvReflectDescriptorBinding*> bindings;
+        if (spvReflectEnumerateEntryPointDescriptorBindings(&module, entryPoint, &count, nullptr) == SPV_REFLECT_RESULT_SUCCESS)
+        {
+            bindings.resize(count);
+            spvReflectEnumerateEntryPointDescriptorBindings(&module, entryPoint, &count, bindings.data());
+        }
+        for (const SpvReflectDescriptorBinding* binding : bindings)
+        {
+            // 진입점에서 닿는 함수가 읽거나 쓰지 않는 바인딩은 레이아웃에 넣지 않습니다.
+            if (binding->accessed == 0)
+            {
+                continue;
+            }
+            uint32_t descriptorCount = 1;
+            for (uint32_t i = 0; i < binding->array.dims_count; i++)
+            {
+                descriptorCount *= binding->array.dims[i];
+            }
+            if (descriptorCount == 0)
+            {
+                error = std::string("Runtime descriptor arrays are not supported : ") + binding->name;
+                succeeded = false;
+                break;
+            }
+            VkDescriptorSetLayoutBinding layoutBinding{};
+            layoutBinding.binding = binding->binding;
+            layoutBinding.descriptorType = static_cast<VkDescriptorType>(binding->descriptor_type);
+            layoutBinding.descriptorCount = descriptorCount;
+            layoutBinding.stageFlags = result.stage;
+            result.bindings.emplace_back(binding->set, layoutBinding);
+        }
+
+        std::vector<SpvReflectBlockVariable*> pushConstants;
+        if (succeeded && spvReflectEnumerateEntryPointPushConstantBlocks(&module, entryPoint, &count, nullptr) == SPV_REFLECT_RESULT_SUCCESS)
+        {
+            pushConstants.resize(count);
+            spvReflectEnumerateEntryPointPushConstantBlocks(&module, entryPoint, &count, pushConstants.data());
+        }
+        for (const SpvReflectBlockVariable* block : pushConstants)
+        {
+            result.pushConstants.push_back({ VkShaderStageFlags(result.stage), block->offset, block->size });
+        }
+
+        if (succeeded && result.stage == VK_SHADER_STAGE_VERTEX_BIT)
+        {
+            std::vector<SpvReflectInterfaceVariable*> inputs;
+            if (spvReflectEnumerateEntryPointInputVariables(&module, entryPoint, &count, nullptr) == SPV_REFLECT_RESULT_SUCCESS)
+            {
+                inputs.resize(count);
+                spvReflectEnumerateEntryPointInputVariables(&module, entryPoint, &count, inputs.data());
+            }
+            for (const SpvReflectInterfaceVariable* input : inputs)
+            {
+                // gl_VertexIndex 같은 내장 변수는 버텍스 버퍼에서 읽지 않습니다.
+                if ((input->decoration_flags & SPV_REFLECT_DECORATION_BUILT_IN) == 0)
+                {
+                    result.inputLocations.push_back(input->location);
+                }
+            }
+            std::sort(result.inputLocations.begin(), result.inputLocations.end());
+        }
+
+        spvReflectDestroyShaderModule(&module);
+        return succeeded;
+    }
+
+    // 스테이지들의 리소스를 파이프라인 레이아웃 하나로 합칩니다. 같은 바인딩을 스테이지마다 다른 유형이나 개수로 쓰면 false 를 반환합니다.
+    // dynamicUniformBuffers 가 true 이면 유니폼 버퍼를 동적 유니폼 버퍼로 만듭니다. 셰이더 쪽 선언은 같으므로 리플렉션으로는 구분할 수 없고, 엔진이 어떻게 바인딩할지로 정합니다.
+    inline bool merge(const std::vector<ShaderStageLayout>& stages, bool dynamicUniformBuffers, PipelineLayoutDesc& result, std::string& error)
+    {
+        result = PipelineLayoutDesc{};
+        for (const ShaderStageLayout& stage : stages)
+        {
+            for (const auto& [set, stageBinding] : stage.bindings)
+            {
+                VkDescriptorSetLayoutBinding binding = stageBinding;
+                if (dynamicUniformBuffers && binding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+                {
+                    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+                }
+                if (set >= result.sets.size())
+                {
+                    result.sets.resize(set + 1);
+                }
+                std::vector<VkDescriptorSetLayoutBinding>& bindings = result.sets[set].bindings;
+                auto found = std::find_if(bindings.begin(), bindings.end(), [&](const VkDescriptorSetLayoutBinding& other) { return other.binding == binding.binding; });
+                if (found == bindings.end())
+                {
+                    bindings.push_back(binding);
+                }
+                else if (found->descriptorType != binding.descriptorType || found->descriptorCount != binding.descriptorCount)
+                {
+                    error = "Descriptor set " + std::to_string(set) + " binding " + std::to_string(binding.binding) + " is declared differently between shader stages";
+                    return false;
+                }
+                else
+                {
+                    found->stageFlags |= binding.stageFlags;
+                }
+            }
+
+            for (const VkPushConstantRange& range : stage.pushConstants)
+            {
+                auto found = std::find_if(result.pushConstants.begin(), result.pushConstants.end(),
+                    [&](const VkPushConstantRange& other) { return other.offset == range.offset && other.size == range.size; });
+                if (found == result.pushConstants.end())
+                {
+                    result.pushConstants.push_back(range);
+                }
+                else
+                {
+                    found->stageFlags |= range.stageFlags;
+                }
+            }
+        }
+
+        for (DescriptorSetLayoutDesc& set : result.sets)
+        {
+            std::sort(set.bindings.begin(), set.bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+        }
+        return true;
+    }
+
+    // 메쉬의 버텍스 입력에서 셰이더가 읽지 않는 속성과, 남은 속성이 쓰지 않는 바인딩을 뺍니다. 셰이더가 읽는 location 을 메쉬가 주지 않으면 false 를 반환합니다.
+    inline bool filterVertexInput(const std::vector<uint32_t>& inputLocations, std::vector<VkVertexInputBindingDescription>& bindings, std::vector<VkVertexInputAttributeDescription>& attributes, std::string& error)
+    {
+        for (uint32_t location : inputLocations)
+        {
+            if (std::none_of(attributes.begin(), attributes.end(), [&](const VkVertexInputAttributeDescription& attribute) { return attribute.location == location; }))
+            {
+                error = "The vertex shader reads location " + std::to_string(location) + " which the vertex layout does not provide";
+                return false;
+            }
+        }
+        attributes.erase(std::remove_if(attributes.begin(), attributes.end(),
+            [&](const VkVertexInputAttributeDescription& attribute) { return std::binary_search(inputLocations.begin(), inputLocations.end(), attribute.location) == false; }), attributes.end());
+        bindings.erase(std::remove_if(bindings.begin(), bindings.end(),
+            [&](const VkVertexInputBindingDescription& binding)
+            {
+                return std::none_of(attributes.begin(), attributes.end(), [&](const VkVertexInputAttributeDescription& attribute) { return attribute.binding == binding.binding; });
+            }), bindings.end());
+        return true;
+    }
+}
+
+
+class LayoutCache
+{
+public:
+    void init(VkDevice device)
+    {
+        this->device = device;
+    }
+
+    // desc 의 파이프라인 레이아웃을 반환합니다. 내용이 같은 레이아웃이 이미 있으면 그것을, 없으면 셋 레이아웃부터 (역시 중복 없이) 만듭니다.
+    VkPipelineLayout getPipelineLayout(const PipelineLayoutDesc& desc)
+    {
+        auto found = pipelineLayouts.find(desc);
+        if (found != pipelineLayouts.end())
+        {
+            pipelineLayoutHits++;
+            return found->second;
+        }
+
+        std::vector<VkDescriptorSetLayout> setLayoutHandles;
+        for (const DescriptorSetLayoutDesc& set : desc.sets)
+        {
+            setLayoutHandles.push_back(findOrCreateSetLayout(set));
+        }
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayoutHandles.size());
+        pipelineLayoutInfo.pSetLayouts = setLayoutHandles.data();
+        pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(desc.pushConstants.size());
+        pipelineLayoutInfo.pPushConstantRanges = desc.pushConstants.data();
+
+        VkPipelineLayout pipelineLayout;
+        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create pipeline layout!");
+        }
+        pipelineLayouts.emplace(desc, pipelineLayout);
+        return pipelineLayout;
+    }
+
+    // 셋 레이아웃을 반환합니다. 디스크립터 셋을 할당할 때 씁니다. 이미 만든 레이아웃이면 재사용으로 셉니다.
+    VkDescriptorSetLayout getSetLayout(const DescriptorSetLayoutDesc& desc)
+    {
+        if (setLayouts.count(desc) != 0)
+        {
+            setLayoutHits++;
+        }
+        return findOrCreateSetLayout(desc);
+    }
+
+    void printStats(std::ostream& out, const char* prefix) const
+    {
+        out << prefix << "Layout cache : " << pipelineLayouts.size() << " pipeline layouts (" << pipelineLayoutHits << " reused), "
+            << setLayouts.size() << " descriptor set layouts (" << setLayoutHits << " reused)\n";
+    }
+
+    // 모든 레이아웃을 지웁니다. 그 레이아웃으로 만든 파이프라인을 모두 지운 뒤에 호출합니다.
+    void destroy()
+    {
+        for (const auto& entry : pipelineLayouts)
+        {
+            vkDestroyPipelineLayout(device, entry.second, nullptr);
+        }
+        for (const auto& entry : setLayouts)
+        {
+            vkDestroyDescriptorSetLayout(device, entry.second, nullptr);
+        }
+        pipelineLayouts.clear();
+        setLayouts.clear();
+    }
+
+private:
+    // 셋 레이아웃을 찾거나 만듭니다. getPipelineLayout 이 안에서 찾는 것은 재사용으로 세지 않습니다.
+    VkDescriptorSetLayout findOrCreateSetLayout(const DescriptorSetLayoutDesc& desc)
+    {
+        auto found = setLayouts.find(desc);
+        if (found != setLayouts.end())
+        {
+            return found->second;
+        }
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = static_cast<uint32_t>(desc.bindings.size());
+        layoutInfo.pBindings = desc.bindings.data();
+
+        VkDescriptorSetLayout setLayout;
+        if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create descriptor set layout!");
+        }
+        setLayouts.emplace(desc, setLayout);
+        return setLayout;
+    }
+
+    VkDevice device = VK_NULL_HANDLE;
+    std::unordered_map<PipelineLayoutDesc, VkPipelineLayout, PipelineLayoutDescHash> pipelineLayouts;
+    std::unordered_map<DescriptorSetLayoutDesc, VkDescriptorSetLayout, DescriptorSetLayoutDescHash> setLayouts;
+    uint64_t pipelineLayoutHits = 0;
+    uint64_t setLayoutHits = 0;
+};
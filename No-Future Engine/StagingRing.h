@@ -0,0 +1,145 @@
+#pragma once
+
+// 영구 매핑된 스테이징 링 버퍼
+// 업로드마다 호스트에서 볼 수 있는 스테이징 버퍼를 만들고 지우는 대신, 시작할 때 만든 하나의 스테이징 버퍼를 앞에서부터 차례로 나누어 씁니다.
+// 나누어 준 영역은 그 영역을 읽는 업로드 배치의 번호(UploadToken::id)에 묶어 두었다가, 배치의 펜스가 신호되면 할당한 순서대로 돌려받습니다.
+// 링보다 큰 업로드는 호출하는 쪽에서 getMaxChunkSize 이하의 조각으로 나누어 요청합니다. 링이 가득 차면 allocate 가 실패하므로 배치를 제출하고 가장 오래된 배치를 기다린 뒤 다시 시도합니다.
+// 이렇게 하면 레벨 로드 중의 할당 / 해제가 사라지고 스테이징 메모리 사용량이 링 크기로 제한됩니다.
+
+#include <vulkan/vulkan.h>
+
+#include <deque>
+#include <algorithm>
+#include <cstdint>
+
+
+class StagingRing
+{
+public:
+    // 나누어 준 영역. offset 은 링 버퍼 안의 바이트 오프셋(복사 명령의 srcOffset / bufferOffset), data 는 그 위치의 매핑된 주소입니다.
+    struct Region
+    {
+        VkDeviceSize offset = 0;
+        void* data = nullptr;
+    };
+
+    // buffer 는 VK_BUFFER_USAGE_TRANSFER_SRC_BIT 로 만든 호스트 일관성 버퍼, mappedData 는 그 버퍼가 매핑된 주소입니다.
+    // alignment : 영역 시작 오프셋의 정렬. 버퍼 -> 이미지 복사의 bufferOffset 은 텍셀 크기와 4 의 배수여야 하므로 optimalBufferCopyOffsetAlignment 이상을 권장합니다.
+    void init(VkBuffer buffer, void* mappedData, VkDeviceSize capacity, VkDeviceSize alignment)
+    {
+        this->buffer = buffer;
+        this->mappedData = static_cast<char*>(mappedData);
+        this->capacity = capacity;
+        this->alignment = std::max<VkDeviceSize>(alignment, 4);
+        spans.clear();
+    }
+
+    VkBuffer getBuffer() const
+    {
+        return buffer;
+    }
+
+    VkDeviceSize getCapacity() const
+    {
+        return capacity;
+    }
+
+    // 한 번에 요청할 조각의 최대 크기. 링의 1/4 로 제한하여 앞 조각들이 GPU 에서 복사되는 동안 다음 조각을 채울 수 있게 합니다.
+    VkDeviceSize getMaxChunkSize() const
+    {
+        return std::max<VkDeviceSize>(capacity / 4 / alignment * alignment, alignment);
+    }
+
+    // size 바이트의 영역을 잡습니다. 지금 연속된 빈 공간이 부족하면 false 를 반환합니다. (size 는 capacity 이하여야 합니다.)
+    bool allocate(VkDeviceSize size, Region& region)
+    {
+        VkDeviceSize start = 0;
+        if (spans.empty() == false)
+        {
+            VkDeviceSize tail = spans.front().start;
+            VkDeviceSize head = alignUp(spans.back().end);
+            bool wrapped = spans.back().start < tail;
+            if (wrapped)
+            {
+                // [head, tail) 만 비어 있습니다.
+                if (head + size > tail)
+                {
+                    return false;
+                }
+                start = head;
+            }
+            else if (head + size <= capacity)
+            {
+                start = head;
+            }
+            else if (size <= tail)
+            {
+                // 끝에 남은 공간이 부족하면 처음으로 돌아갑니다. 끝의 남은 공간은 앞 영역들을 돌려받을 때 함께 비워집니다.
+                start = 0;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        else if (size > capacity)
+        {
+            return false;
+        }
+
+        spans.push_back(Span{ start, start + size, PENDING });
+        region.offset = start;
+        region.data = mappedData + start;
+        return true;
+    }
+
+    // 지금까지 잡았지만 아직 배치에 묶이지 않은 영역들을 batchId 의 배치에 묶습니다. 배치를 제출한 직후에 호출합니다.
+    void retire(uint64_t batchId)
+    {
+        for (auto it = spans.rbegin(); it != spans.rend() && it->batchId == PENDING; ++it)
+        {
+            it->batchId = batchId;
+        }
+    }
+
+    // completedBatchId 이하의 배치에 묶인 영역들을 돌려받습니다.
+    void reclaim(uint64_t completedBatchId)
+    {
+        while (spans.empty() == false && spans.front().batchId != PENDING && spans.front().batchId <= completedBatchId)
+        {
+            spans.pop_front();
+        }
+    }
+
+    // 아직 돌려받지 못한 영역이 차지하는 바이트 (링 끝에서 버려진 공간은 제외)
+    VkDeviceSize getUsedBytes() const
+    {
+        VkDeviceSize used = 0;
+        for (const Span& span : spans)
+        {
+            used += span.end - span.start;
+        }
+        return used;
+    }
+
+private:
+    static constexpr uint64_t PENDING = UINT64_MAX;
+
+    struct Span
+    {
+        VkDeviceSize start;
+        VkDeviceSize end;
+        uint64_t batchId;   // 이 영역을 읽는 업로드 배치. 아직 제출 전이면 PENDING
+    };
+
+    VkDeviceSize alignUp(VkDeviceSize offset) const
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    char* mappedData = nullptr;
+    VkDeviceSize capacity = 0;
+    VkDeviceSize alignment = 16;
+    std::deque<Span> spans;     // 할당한 순서대로의 영역들. 앞이 가장 오래된 영역입니다.
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+// 텍스쳐 아틀라스
+// 머티리얼마다 작은 텍스쳐를 따로 두면 머티리얼이 바뀔 때마다 디스크립터를 다시 바인딩하고 그리기 호출을 나누어야 합니다.
+// 임포트할 때 stb_rect_pack 으로 모든 텍스쳐를 큰 텍스쳐 하나에 배치하고 UV 를 그 위치로 옮기면, 모든 머티리얼이 디스크립터 하나와 그리기 호출 하나를 함께 씁니다.
+// - 배치 : 이미지 크기만 있으면 되므로(stbi_info) 디코딩 전에 정해 두고, 메쉬 임포트(UV 변환)와 텍스쳐 로드(픽셀 합치기)가 같은 배치를 따로 씁니다.
+// - 여백 : 이미지마다 가장자리 텍셀을 TEXTURE_ATLAS_PADDING 만큼 늘려 둘러서, 선형 필터링과 작은 밉 레벨에서 옆 이미지 색이 번지지 않게 합니다.
+// - 정렬 : 위치와 크기를 4 텍셀(BC 블록) 단위로 맞춰서 블록 압축할 때 한 블록에 두 이미지가 섞이지 않습니다.
+// 아틀라스 안에서는 반복(REPEAT) 주소 지정을 할 수 없으므로 [0, 1] 을 벗어난 UV 는 이미지 가장자리로 고정됩니다.
+
+#include "Hash.h"
+
+#include <stb_rect_pack.h>
+#include <stb_image.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+
+constexpr uint32_t TEXTURE_ATLAS_PADDING = 8;       // 이미지 둘레에 늘려 둘 텍셀 수. 레벨이 내려갈 때마다 반으로 줄어 레벨 3 까지 번지지 않습니다.
+constexpr uint32_t TEXTURE_ATLAS_ALIGNMENT = 4;     // 배치 단위 (BC 블록 크기)
+constexpr uint32_t TEXTURE_ATLAS_MAX_EXTENT = 8192; // 아틀라스 한 변의 최대 크기. 모든 장치가 지원하는 maxImageDimension2D 는 4096 이지만 데스크톱 GPU 는 대부분 16384 입니다.
+
+
+struct TextureAtlasEntry
+{
+    std::string path;                   // 이미지 파일 경로. 비어 있으면 흰색으로 채웁니다. (텍스쳐가 없는 머티리얼용)
+    uint32_t width = 0;                 // 이미지 크기
+    uint32_t height = 0;
+    uint32_t x = 0;                     // 아틀라스 안에서 이미지(여백 제외)가 시작하는 위치
+    uint32_t y = 0;
+};
+
+struct TextureAtlasLayout
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<TextureAtlasEntry> entries;
+
+    bool empty() const { return entries.empty(); }
+
+    // entry 번째 이미지의 UV(위쪽이 0)를 아틀라스의 UV 로 바꿉니다.
+    glm::vec2 remap(size_t entry, glm::vec2 texCoord) const
+    {
+        const TextureAtlasEntry& e = entries[entry];
+        texCoord = glm::clamp(texCoord, glm::vec2(0.0f), glm::vec2(1.0f));
+        return glm::vec2((float(e.x) + texCoord.x * float(e.width)) / float(width), (float(e.y) + texCoord.y * float(e.height)) / float(height));
+    }
+
+    // 배치가 바뀌면 아틀라스를 쓰는 메쉬 / 텍스쳐 캐시를 다시 만들어야 하므로 캐시 키에 섞습니다.
+    uint64_t getHash() const
+    {
+        uint64_t hash = hashBytes(&width, sizeof(width), height);
+        for (const TextureAtlasEntry& entry : entries)
+        {
+            const uint32_t rect[4] = { entry.x, entry.y, entry.width, entry.height };
+            hash = hashBytes(rect, sizeof(rect), hash);
+            hash = hashBytes(entry.path.data(), entry.path.size(), hash);
+        }
+        return hash;
+    }
+};
+
+namespace TextureAtlas
+{
+    // entries 의 크기(width, height)로 배치를 정해 layout 에 담습니다. 가장 작은 정사각형부터 넓혀 가며 시도하고, TEXTURE_ATLAS_MAX_EXTENT 에도 들어가지 않으면 false 를 반환합니다.
+    inline bool pack(const std::vector<TextureAtlasEntry>& entries, TextureAtlasLayout& layout)
+    {
+        // 여백을 포함한 크기를 정렬 단위로 나타냅니다. 배치도 단위 좌표로 하므로 위치가 저절로 정렬됩니다.
+        std::vector<stbrp_rect> rects(entries.size());
+        uint64_t area = 0;
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            rects[i].id = static_cast<int>(i);
+            rects[i].w = static_cast<stbrp_coord>((entries[i].width + 2 * TEXTURE_ATLAS_PADDING + TEXTURE_ATLAS_ALIGNMENT - 1) / TEXTURE_ATLAS_ALIGNMENT);
+            rects[i].h = static_cast<stbrp_coord>((entries[i].height + 2 * TEXTURE_ATLAS_PADDING + TEXTURE_ATLAS_ALIGNMENT - 1) / TEXTURE_ATLAS_ALIGNMENT);
+            area += uint64_t(rects[i].w) * rects[i].h;
+        }
+
+        const uint32_t maxUnits = TEXTURE_ATLAS_MAX_EXTENT / TEXTURE_ATLAS_ALIGNMENT;
+        uint32_t side = std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(double(area)))));
+        while (side <= maxUnits)
+        {
+            std::vector<stbrp_node> nodes(side);
+            stbrp_context context;
+            stbrp_init_target(&context, static_cast<int>(side), static_cast<int>(side), nodes.data(), static_cast<int>(nodes.size()));
+            if (stbrp_pack_rects(&context, rects.data(), static_cast<int>(rects.size())) != 0)
+            {
+                // 사용한 높이까지만 아틀라스로 씁니다.
+                uint32_t usedHeight = 0;
+                layout.entries = entries;
+                for (const stbrp_rect& rect : rects)
+                {
+                    TextureAtlasEntry& entry = layout.entries[rect.id];
+                    entry.x = uint32_t(rect.x) * TEXTURE_ATLAS_ALIGNMENT + TEXTURE_ATLAS_PADDING;
+                    entry.y = uint32_t(rect.y) * TEXTURE_ATLAS_ALIGNMENT + TEXTURE_ATLAS_PADDING;
+                    usedHeight = std::max(usedHeight, uint32_t(rect.y + rect.h));
+                }
+                layout.width = side * TEXTURE_ATLAS_ALIGNMENT;
+                layout.height = usedHeight * TEXTURE_ATLAS_ALIGNMENT;
+                return true;
+            }
+            if (side == maxUnits)
+            {
+                break;
+            }
+            side = std::min(maxUnits, side + std::max(1u, side / 8));
+        }
+        layout = TextureAtlasLayout{};
+        return false;
+    }
+
+    // layout 의 이미지들을 디코딩해서 RGBA8 아틀라스 한 장(width x height x 4 바이트)으로 합칩니다. 여백은 이미지의 가장자리 텍셀로 채웁니다.
+    inline void compose(const TextureAtlasLayout& layout, std::vector<uint8_t>& pixels)
+    {
+        pixels.assign(size_t(layout.width) * layout.height * 4, 0);
+        for (const TextureAtlasEntry& entry : layout.entries)
+        {
+            int width = static_cast<int>(entry.width);
+            int height = static_cast<int>(entry.height);
+            std::vector<uint8_t> white;
+            std::unique_ptr<stbi_uc, void (*)(void*)> imageOwner(nullptr, stbi_image_free);
+            const uint8_t* image = nullptr;
+            if (entry.path.empty())
+            {
+                white.assign(size_t(width) * height * 4, 255);
+                image = white.data();
+            }
+            else
+            {
+                int channels;
+                imageOwner.reset(stbi_load(entry.path.c_str(), &width, &height, &channels, STBI_rgb_alpha));
+                image = imageOwner.get();
+                if (image == nullptr)
+                {
+                    throw std::runtime_error("Failed to load atlas texture : " + entry.path);
+                }
+                if (uint32_t(width) != entry.width || uint32_t(height) != entry.height)
+                {
+                    throw std::runtime_error("Atlas texture changed size after packing : " + entry.path);
+                }
+            }
+
+            const int32_t pad = static_cast<int32_t>(TEXTURE_ATLAS_PADDING);
+            for (int32_t row = -pad; row < height + pad; row++)
+            {
+                const uint8_t* srcRow = image + size_t(std::clamp(row, 0, height - 1)) * width * 4;
+                uint8_t* dstRow = pixels.data() + (size_t(entry.y + row) * layout.width + entry.x) * 4;
+                std::memcpy(dstRow, srcRow, size_t(width) * 4);
+                for (int32_t column = 1; column <= pad; column++)
+                {
+                    std::memcpy(dstRow - column * 4, srcRow, 4);
+                    std::memcpy(dstRow + (width - 1 + column) * 4, srcRow + (width - 1) * 4, 4);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+// 바이너리 텍스쳐 캐시
+// 디코딩, 밉맵 생성, 블록 압축까지 끝난 밉 체인을 그대로 파일에 저장해 두고, 다음 실행부터는 이미지 디코딩과 압축 없이 파일 내용을 바로 업로드에 사용합니다.
+// 캐시는 소스 파일 내용의 해시, 소스 크기, 빌드 옵션(요청한 압축 방식), 포맷 버전이 모두 같을 때만 유효합니다. 하나라도 다르면 다시 만듭니다.
+// 레벨의 위치는 형식, 크기, 레벨 수로부터 MipBuilder::layoutLevels 가 다시 계산하므로 파일에는 밉 체인 데이터만 저장합니다.
+//
+// 파일 구조 (리틀 엔디안, 데이터는 16 바이트 경계에서 시작)
+// [TextureCacheHeader][밉 체인 데이터 : dataSize]
+
+#include "MappedFile.h"
+#include "MipBuilder.h"
+
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+
+// 캐시를 만드는 과정(밉맵 필터, 압축 인코더 등)이 바뀌면 반드시 올려서 이전 캐시를 무효화해야 합니다.
+constexpr uint32_t TEXTURE_CACHE_VERSION = 1;
+
+struct TextureCacheHeader
+{
+    char magic[4];              // "NFTC"
+    uint32_t version;           // TEXTURE_CACHE_VERSION
+    uint64_t sourceHash;        // 원본 파일 내용의 hashBytes
+    uint64_t sourceSize;        // 원본 파일 크기
+    uint32_t buildFlags;        // 캐시를 만든 옵션. 같은 원본이라도 다른 옵션으로 만든 캐시는 사용하지 않습니다.
+    uint32_t format;            // TextureFormat
+    uint32_t width;             // 레벨 0 의 크기
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t reserved;
+    uint64_t dataOffset;        // 파일 시작부터 밉 체인 데이터까지의 바이트
+    uint64_t dataSize;
+};
+
+namespace TextureCache
+{
+    // 캐시 파일을 읽고 헤더를 검증하여 chain 을 채웁니다. 캐시가 없거나 원본 / 포맷과 맞지 않으면 false 를 반환합니다.
+    inline bool open(const std::string& cachePath, uint64_t sourceHash, uint64_t sourceSize, uint32_t buildFlags, MipBuilder::MipChain& chain)
+    {
+        MappedFile file;
+        if (file.open(cachePath) == false)
+        {
+            return false;
+        }
+
+        TextureCacheHeader header{};
+        if (file.getSize() < sizeof(header))
+        {
+            return false;
+        }
+        std::memcpy(&header, file.getData(), sizeof(header));
+
+        bool valid = std::memcmp(header.magic, "NFTC", 4) == 0
+            && header.version == TEXTURE_CACHE_VERSION
+            && header.sourceHash == sourceHash
+            && header.sourceSize == sourceSize
+            && header.buildFlags == buildFlags
+            && header.format <= static_cast<uint32_t>(TextureFormat::Bc7)
+            && header.width != 0 && header.height != 0
+            && header.levelCount != 0 && header.levelCount <= MipBuilder::getFullLevelCount(header.width, header.height)
+            && header.dataOffset + header.dataSize <= file.getSize();
+        if (valid == false)
+        {
+            return false;
+        }
+
+        chain.format = static_cast<TextureFormat>(header.format);
+        MipBuilder::layoutLevels(chain, header.width, header.height, header.levelCount);
+        if (chain.data.size() != header.dataSize)
+        {
+            chain.levels.clear();
+            chain.data.clear();
+            return false;
+        }
+        std::memcpy(chain.data.data(), file.getData() + header.dataOffset, chain.data.size());
+        return true;
+    }
+
+    // 캐시 파일을 씁니다. 쓰는 도중 종료되어도 깨진 캐시가 남지 않도록 임시 파일에 쓴 뒤 이름을 바꿉니다. 실패해도 렌더링에는 지장이 없으므로 false 만 반환합니다.
+    inline bool write(const std::string& cachePath, uint64_t sourceHash, uint64_t sourceSize, uint32_t buildFlags, const MipBuilder::MipChain& chain)
+    {
+        TextureCacheHeader header{};
+        std::memcpy(header.magic, "NFTC", 4);
+        header.version = TEXTURE_CACHE_VERSION;
+        header.sourceHash = sourceHash;
+        header.sourceSize = sourceSize;
+        header.buildFlags = buildFlags;
+        header.format = static_cast<uint32_t>(chain.format);
+        header.width = chain.getWidth();
+        header.height = chain.getHeight();
+        header.levelCount = static_cast<uint32_t>(chain.levels.size());
+        header.dataOffset = (sizeof(header) + 15) & ~uint64_t(15);
+        header.dataSize = chain.data.size();
+
+        std::string tempPath = cachePath + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                return false;
+            }
+
+            static const char padding[16] = {};
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(padding, header.dataOffset - sizeof(header));
+            out.write(reinterpret_cast<const char*>(chain.data.data()), chain.data.size());
+            if (!out)
+            {
+                out.close();
+                std::remove(tempPath.c_str());
+                return false;
+            }
+        }
+
+        // rename 은 대상이 이미 있으면 실패하는 플랫폼(Windows)이 있으므로 먼저 지웁니다.
+        std::remove(cachePath.c_str());
+        if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0)
+        {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,391 @@
+#pragma once
+
+// 텍스쳐 블록 압축
+// MipBuilder 로 만든 RGBA8 밉 체인을 4x4 텍셀 블록 단위의 BC 형식으로 압축합니다. 압축한 텍스쳐는 GPU 메모리에서도 압축된 채로 샘플링되므로 메모리와 대역폭이 BC1 은 1/8, BC3 / BC7 은 1/4 로 줄어듭니다.
+// BC1 / BC3 은 stb_dxt 로, BC7 은 아래의 모드 6 인코더로 압축합니다. 모드 6 은 블록 하나를 RGBA 끝점 두 개와 16 단계 인덱스로 나타내는 단일 구간(subset) 모드라 구현이 간단하면서도 BC1 보다 화질이 훨씬 좋습니다.
+// 블록들은 서로 독립적이므로 모든 레벨의 블록을 하나의 범위로 보고 스레드 수만큼 나누어 동시에 압축합니다.
+// stb_dxt 의 구현(STB_DXT_IMPLEMENTATION)은 Main.cpp 에서 만듭니다.
+
+#include "MipBuilder.h"
+#include "VertexDedup.h"
+
+#include <stb_dxt.h>
+
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+
+// 텍스쳐를 불러올 때 고를 형식
+enum class TextureCompression
+{
+    Auto,   // 알파가 모두 255 인 텍스쳐는 BC1, 투명한 텍셀이 있으면 BC7
+    None,   // 압축하지 않고 RGBA8 로 올립니다.
+    Bc1,
+    Bc3,
+    Bc7,
+};
+
+inline const char* toString(TextureCompression compression)
+{
+    switch (compression)
+    {
+    case TextureCompression::Auto:
+        return "auto";
+    case TextureCompression::None:
+        return "rgba8";
+    case TextureCompression::Bc1:
+        return "bc1";
+    case TextureCompression::Bc3:
+        return "bc3";
+    case TextureCompression::Bc7:
+        return "bc7";
+    }
+    return "unknown";
+}
+
+
+namespace TextureCompressor
+{
+    // 레벨 0 에 불투명하지 않은 텍셀이 있는지 확인합니다.
+    inline bool hasTransparency(const MipBuilder::MipChain& chain)
+    {
+        const uint8_t* pixels = chain.getLevelData(0);
+        const size_t texelCount = size_t(chain.getWidth()) * chain.getHeight();
+        for (size_t i = 0; i < texelCount; i++)
+        {
+            if (pixels[i * 4 + 3] != 255)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline TextureFormat chooseFormat(TextureCompression compression, const MipBuilder::MipChain& chain)
+    {
+        switch (compression)
+        {
+        case TextureCompression::Auto:
+            return hasTransparency(chain) ? TextureFormat::Bc7 : TextureFormat::Bc1;
+        case TextureCompression::Bc1:
+            return TextureFormat::Bc1;
+        case TextureCompression::Bc3:
+            return TextureFormat::Bc3;
+        case TextureCompression::Bc7:
+            return TextureFormat::Bc7;
+        default:
+            return TextureFormat::Rgba8;
+        }
+    }
+
+    // BC7 모드 6 의 4 비트 인덱스 보간 가중치 (/ 64)
+    constexpr uint32_t BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // 끝점 하나를 7 비트 성분 + 공유 p 비트로 양자화합니다. 복원 값은 (성분 << 1) | p 입니다. 두 p 비트 중 오차가 작은 쪽을 고릅니다.
+    inline void quantizeBc7Endpoint(const float value[4], uint8_t quantized[4], uint8_t& pbit)
+    {
+        float bestError = -1.0f;
+        for (uint32_t p = 0; p < 2; p++)
+        {
+            uint8_t candidate[4];
+            float error = 0.0f;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                int q = static_cast<int>(std::floor((value[c] - p) * 0.5f + 0.5f));
+                candidate[c] = static_cast<uint8_t>(std::min(std::max(q, 0), 127));
+                float difference = float((candidate[c] << 1) | p) - value[c];
+                error += difference * difference;
+            }
+            if (bestError < 0.0f || error < bestError)
+            {
+                bestError = error;
+                std::memcpy(quantized, candidate, 4);
+                pbit = static_cast<uint8_t>(p);
+            }
+        }
+    }
+
+    // 양자화한 두 끝점 사이의 16 단계 색상 중 텍셀마다 가장 가까운 것을 고르고, 제곱 오차의 합을 반환합니다.
+    inline uint32_t fitBc7Indices(const uint8_t texels[64], const uint8_t q0[4], uint8_t p0, const uint8_t q1[4], uint8_t p1, uint8_t indices[16])
+    {
+        int palette[16][4];
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            int e0 = (q0[c] << 1) | p0;
+            int e1 = (q1[c] << 1) | p1;
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                palette[i][c] = (e0 * int(64 - BC7_WEIGHTS4[i]) + e1 * int(BC7_WEIGHTS4[i]) + 32) >> 6;
+            }
+        }
+
+        uint32_t totalError = 0;
+        for (uint32_t t = 0; t < 16; t++)
+        {
+            uint32_t bestError = UINT32_MAX;
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                uint32_t error = 0;
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    int difference = palette[i][c] - texels[t * 4 + c];
+                    error += static_cast<uint32_t>(difference * difference);
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    indices[t] = static_cast<uint8_t>(i);
+                }
+            }
+            totalError += bestError;
+        }
+        return totalError;
+    }
+
+    // 128 비트 블록에 LSB 부터 차례로 비트를 씁니다.
+    struct BlockWriter
+    {
+        uint64_t bits[2] = { 0, 0 };
+        uint32_t position = 0;
+
+        void write(uint32_t value, uint32_t count)
+        {
+            for (uint32_t i = 0; i < count; i++, position++)
+            {
+                bits[position >> 6] |= uint64_t((value >> i) & 1) << (position & 63);
+            }
+        }
+    };
+
+    // 4x4 RGBA8 블록(행 우선 64 바이트)을 BC7 모드 6 으로 압축합니다.
+    // 끝점은 색상 공분산의 주축(power iteration)에 텍셀을 투영한 양 끝으로 잡고, 인덱스를 고른 뒤 최소 제곱으로 끝점을 두 번 다시 맞춥니다.
+    inline void compressBc7Block(uint8_t dst[16], const uint8_t texels[64])
+    {
+        float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (uint32_t t = 0; t < 16; t++)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                mean[c] += texels[t * 4 + c];
+            }
+        }
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            mean[c] /= 16.0f;
+        }
+
+        float covariance[4][4] = {};
+        for (uint32_t t = 0; t < 16; t++)
+        {
+            float d[4];
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                d[c] = texels[t * 4 + c] - mean[c];
+            }
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                for (uint32_t j = 0; j < 4; j++)
+                {
+                    covariance[i][j] += d[i] * d[j];
+                }
+            }
+        }
+
+        float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        for (uint32_t iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = {};
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                for (uint32_t j = 0; j < 4; j++)
+                {
+                    next[i] += covariance[i][j] * axis[j];
+                }
+            }
+            float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+            if (length < 1e-6f)
+            {
+                break;
+            }
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                axis[c] = next[c] / length;
+            }
+        }
+
+        float minProjection = 0.0f;
+        float maxProjection = 0.0f;
+        for (uint32_t t = 0; t < 16; t++)
+        {
+            float projection = 0.0f;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                projection += (texels[t * 4 + c] - mean[c]) * axis[c];
+            }
+            minProjection = std::min(minProjection, projection);
+            maxProjection = std::max(maxProjection, projection);
+        }
+
+        float endpoints[2][4];
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            endpoints[0][c] = std::min(std::max(mean[c] + axis[c] * minProjection, 0.0f), 255.0f);
+            endpoints[1][c] = std::min(std::max(mean[c] + axis[c] * maxProjection, 0.0f), 255.0f);
+        }
+
+        uint8_t q0[4], q1[4], p0 = 0, p1 = 0;
+        uint8_t indices[16];
+        quantizeBc7Endpoint(endpoints[0], q0, p0);
+        quantizeBc7Endpoint(endpoints[1], q1, p1);
+        uint32_t bestError = fitBc7Indices(texels, q0, p0, q1, p1, indices);
+
+        // 인덱스를 고정하고 (1 - w) * e0 + w * e1 이 텍셀에 가장 가깝도록 끝점을 성분마다 최소 제곱으로 다시 구합니다.
+        for (uint32_t refinement = 0; refinement < 2 && bestError > 0; refinement++)
+        {
+            float a = 0.0f, b = 0.0f, d = 0.0f;
+            float rhs0[4] = {}, rhs1[4] = {};
+            for (uint32_t t = 0; t < 16; t++)
+            {
+                float w = BC7_WEIGHTS4[indices[t]] / 64.0f;
+                a += (1.0f - w) * (1.0f - w);
+                b += (1.0f - w) * w;
+                d += w * w;
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    rhs0[c] += (1.0f - w) * texels[t * 4 + c];
+                    rhs1[c] += w * texels[t * 4 + c];
+                }
+            }
+            float determinant = a * d - b * b;
+            if (std::fabs(determinant) < 1e-6f)
+            {
+                break;
+            }
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                endpoints[0][c] = std::min(std::max((d * rhs0[c] - b * rhs1[c]) / determinant, 0.0f), 255.0f);
+                endpoints[1][c] = std::min(std::max((a * rhs1[c] - b * rhs0[c]) / determinant, 0.0f), 255.0f);
+            }
+
+            uint8_t r0[4], r1[4], rp0 = 0, rp1 = 0;
+            uint8_t refinedIndices[16];
+            quantizeBc7Endpoint(endpoints[0], r0, rp0);
+            quantizeBc7Endpoint(endpoints[1], r1, rp1);
+            uint32_t error = fitBc7Indices(texels, r0, rp0, r1, rp1, refinedIndices);
+            if (error >= bestError)
+            {
+                break;
+            }
+            bestError = error;
+            std::memcpy(q0, r0, 4);
+            std::memcpy(q1, r1, 4);
+            p0 = rp0;
+            p1 = rp1;
+            std::memcpy(indices, refinedIndices, 16);
+        }
+
+        // 첫 텍셀의 인덱스는 최상위 비트를 저장하지 않으므로(앵커) 0 이어야 합니다. 아니면 끝점을 바꾸고 인덱스를 뒤집습니다.
+        if (indices[0] >= 8)
+        {
+            std::swap(q0, q1);
+            std::swap(p0, p1);
+            for (uint32_t t = 0; t < 16; t++)
+            {
+                indices[t] = static_cast<uint8_t>(15 - indices[t]);
+            }
+        }
+
+        // 모드 6 : 모드 비트 0000001, R0 R1 G0 G1 B0 B1 A0 A1 (각 7 비트), P0, P1, 인덱스 (앵커 3 비트 + 15 x 4 비트)
+        BlockWriter writer;
+        writer.write(1u << 6, 7);
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            writer.write(q0[c], 7);
+            writer.write(q1[c], 7);
+        }
+        writer.write(p0, 1);
+        writer.write(p1, 1);
+        writer.write(indices[0], 3);
+        for (uint32_t t = 1; t < 16; t++)
+        {
+            writer.write(indices[t], 4);
+        }
+        std::memcpy(dst, writer.bits, 16);
+    }
+
+    inline void compressBlock(TextureFormat format, uint8_t* dst, const uint8_t texels[64])
+    {
+        switch (format)
+        {
+        case TextureFormat::Bc1:
+            stb_compress_dxt_block(dst, texels, 0, STB_DXT_HIGHQUAL);
+            break;
+        case TextureFormat::Bc3:
+            stb_compress_dxt_block(dst, texels, 1, STB_DXT_HIGHQUAL);
+            break;
+        case TextureFormat::Bc7:
+            compressBc7Block(dst, texels);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // RGBA8 밉 체인(source)의 모든 레벨을 format 으로 압축하여 result 에 담습니다. 4 의 배수가 아닌 레벨(2x2, 1x1 등)은 가장자리 텍셀을 반복하여 블록을 채웁니다.
+    inline void compress(const MipBuilder::MipChain& source, TextureFormat format, uint32_t threadCount, MipBuilder::MipChain& result)
+    {
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        result.format = format;
+        MipBuilder::layoutLevels(result, source.getWidth(), source.getHeight(), static_cast<uint32_t>(source.levels.size()));
+
+        // 모든 레벨의 블록에 이어지는 번호를 붙입니다. levelFirstBlock[level] 은 그 레벨의 첫 블록 번호입니다.
+        std::vector<size_t> levelFirstBlock(source.levels.size() + 1, 0);
+        for (size_t level = 0; level < source.levels.size(); level++)
+        {
+            size_t blocksWide = (source.levels[level].width + 3) / 4;
+            size_t blocksHigh = (source.levels[level].height + 3) / 4;
+            levelFirstBlock[level + 1] = levelFirstBlock[level] + blocksWide * blocksHigh;
+        }
+
+        const uint32_t blockSize = getBlockSize(format);
+        VertexDedup::parallelRanges(levelFirstBlock.back(), threadCount, [&](uint32_t, size_t begin, size_t end)
+        {
+            size_t level = std::upper_bound(levelFirstBlock.begin(), levelFirstBlock.end(), begin) - levelFirstBlock.begin() - 1;
+            uint8_t texels[64];
+            for (size_t block = begin; block < end; block++)
+            {
+                while (block >= levelFirstBlock[level + 1])
+                {
+                    level++;
+                }
+
+                const uint32_t width = source.levels[level].width;
+                const uint32_t height = source.levels[level].height;
+                const uint32_t blocksWide = (width + 3) / 4;
+                const uint32_t blockX = static_cast<uint32_t>((block - levelFirstBlock[level]) % blocksWide);
+                const uint32_t blockY = static_cast<uint32_t>((block - levelFirstBlock[level]) / blocksWide);
+                const uint8_t* pixels = source.getLevelData(level);
+                for (uint32_t y = 0; y < 4; y++)
+                {
+                    uint32_t sourceY = std::min(blockY * 4 + y, height - 1);
+                    for (uint32_t x = 0; x < 4; x++)
+                    {
+                        uint32_t sourceX = std::min(blockX * 4 + x, width - 1);
+                        std::memcpy(texels + (y * 4 + x) * 4, pixels + (size_t(sourceY) * width + sourceX) * 4, 4);
+                    }
+                }
+
+                uint8_t* dst = result.data.data() + result.levels[level].offset + (block - levelFirstBlock[level]) * blockSize;
+                compressBlock(format, dst, texels);
+            }
+        });
+
+        result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+    }
+}
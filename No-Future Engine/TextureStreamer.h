@@ -0,0 +1,163 @@
+#pragma once
+
+// 텍스쳐 스트리밍 (밉 레벨 상주 관리)
+// 텍스쳐의 모든 레벨을 처음부터 장치 메모리에 올려두지 않고, 작은 레벨들만 먼저 올린 뒤 화면에서 차지하는 크기에 필요한 레벨까지 한 레벨씩 올립니다.
+// 메모리 예산(VK_EXT_memory_budget 또는 --texture-budget-mb)을 넘으면 큰 레벨부터 바로 내립니다. 가장 작은 레벨 하나는 항상 남깁니다.
+// 상주하는 레벨은 항상 residentBase 부터 마지막 레벨까지의 꼬리(MipChainView::getTail)라서, 이미지를 그 꼬리 크기로 다시 만들어 올리고 예전 이미지는 지연 해제합니다.
+// 희소(sparse) 이미지 없이 Vulkan 1.0 기능만 쓰며, 내린 레벨의 메모리가 실제로 돌아옵니다.
+// 새 레벨이 올라오면 샘플러의 minLod 를 올라온 레벨 수만큼 올렸다가 조금씩 0 으로 내려, 흐린 텍스쳐가 한 프레임에 선명해지는 튐 없이 보이게 합니다.
+// 이 클래스는 어떤 레벨을 상주시킬지만 정하고, 이미지 생성과 업로드는 호출하는 쪽(Main.cpp)이 합니다.
+
+#include "MipBuilder.h"
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+
+constexpr uint32_t TEXTURE_STREAMING_INITIAL_EXTENT = 64;   // 처음 올릴 꼬리의 가장 큰 변. 이보다 작은 레벨들만 먼저 올립니다.
+constexpr uint32_t TEXTURE_STREAMING_LEVEL_MARGIN = 1;      // 화면 크기로 구한 레벨보다 이만큼 더 큰 레벨까지 올립니다. 텍스쳐가 아틀라스라 메쉬 하나가 텍스쳐 일부만 쓰는 경우를 고려합니다.
+constexpr uint32_t TEXTURE_STREAMING_HYSTERESIS = 1;        // 화면 크기 때문에 레벨을 내리는 것은 필요한 레벨보다 이만큼 더 많이 올라와 있을 때만 합니다. (경계에서 올렸다 내렸다 반복하지 않도록)
+constexpr float TEXTURE_LOD_FADE_SECONDS = 0.25f;           // 새로 올라온 레벨 하나가 minLod 를 따라 완전히 보이기까지의 시간
+constexpr float TEXTURE_LOD_FADE_STEPS = 4.0f;              // minLod 를 레벨당 이만큼의 단계로 나누어 바꿉니다. 단계마다 샘플러를 다시 만들기 때문입니다.
+
+
+class TextureStreamer
+{
+public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    // 스트리밍할 밉 체인의 레벨 크기를 기억하고, 처음 올릴 꼬리의 시작 레벨을 반환합니다. 밉 체인은 모든 레벨이 있어야 합니다.
+    uint32_t init(const MipBuilder::MipChainView& chain)
+    {
+        levelSizes.clear();
+        for (const MipBuilder::MipChainView::LevelData& level : chain.levels)
+        {
+            levelSizes.push_back(level.size);
+        }
+        extent = std::max(chain.getWidth(), chain.getHeight());
+
+        uint32_t base = 0;
+        while (base + 1 < getLevelCount() && (extent >> base) > TEXTURE_STREAMING_INITIAL_EXTENT)
+        {
+            base++;
+        }
+        residentBase = getLevelCount();
+        fadeLevels = 0.0f;
+        return base;
+    }
+
+    uint32_t getLevelCount() const { return static_cast<uint32_t>(levelSizes.size()); }
+    uint32_t getResidentBase() const { return residentBase; }
+
+    // base 부터 마지막 레벨까지의 바이트 수
+    VkDeviceSize getTailSize(uint32_t base) const
+    {
+        VkDeviceSize size = 0;
+        for (uint32_t level = base; level < getLevelCount(); level++)
+        {
+            size += levelSizes[level];
+        }
+        return size;
+    }
+
+    // 화면에서 footprint 픽셀을 차지할 때 필요한 가장 큰 레벨. 텍셀 하나가 픽셀 하나보다 작아지지 않는 레벨에서 여유(TEXTURE_STREAMING_LEVEL_MARGIN)만큼 더 올립니다.
+    uint32_t getWantedBase(float footprint) const
+    {
+        if (footprint >= float(extent) || std::isfinite(footprint) == false)
+        {
+            return 0;
+        }
+        float level = std::floor(std::log2(float(extent) / std::max(footprint, 1.0f)));
+        uint32_t base = level > float(TEXTURE_STREAMING_LEVEL_MARGIN) ? uint32_t(level) - TEXTURE_STREAMING_LEVEL_MARGIN : 0;
+        return std::min(base, getLevelCount() - 1);
+    }
+
+    // 예산 안에 들어가는 가장 큰 꼬리의 시작 레벨. 가장 작은 레벨조차 넘으면 마지막 레벨입니다.
+    uint32_t getBudgetBase(VkDeviceSize budget) const
+    {
+        uint32_t base = 0;
+        while (base + 1 < getLevelCount() && getTailSize(base) > budget)
+        {
+            base++;
+        }
+        return base;
+    }
+
+    // 다음에 상주시킬 꼬리의 시작 레벨. 지금과 같으면 바꿀 것이 없습니다.
+    // 예산을 넘으면 바로 필요한 만큼 내리고, 올릴 때는 업로드가 한 프레임에 몰리지 않도록 한 레벨씩 올립니다.
+    uint32_t selectBase(float footprint, VkDeviceSize budget) const
+    {
+        const uint32_t budgetBase = getBudgetBase(budget);
+        if (budgetBase > residentBase)
+        {
+            return budgetBase;
+        }
+
+        const uint32_t wantedBase = std::max(getWantedBase(footprint), budgetBase);
+        if (wantedBase < residentBase)
+        {
+            return residentBase - 1;
+        }
+        if (wantedBase > residentBase + TEXTURE_STREAMING_HYSTERESIS)
+        {
+            return wantedBase;
+        }
+        return residentBase;
+    }
+
+    // base 부터의 꼬리가 그리기에 쓰이기 시작했을 때 호출합니다. 레벨이 늘었으면 그 수만큼 minLod 를 올려 서서히 보이게 합니다.
+    void onResident(uint32_t base, Clock::time_point now)
+    {
+        float remaining = getFade(now);
+        if (base < residentBase && residentBase < getLevelCount())
+        {
+            remaining += float(residentBase - base);
+        }
+        // 레벨을 내렸으면 새 이미지의 레벨 0 은 예전 이미지에서 더 작은 레벨이므로 남은 페이드도 그만큼 줄어듭니다.
+        else if (base > residentBase)
+        {
+            remaining = std::max(0.0f, remaining - float(base - residentBase));
+        }
+        residentBase = base;
+        fadeLevels = remaining;
+        fadeStart = now;
+    }
+
+    // 샘플러에 쓸 minLod. 0 이면 상주하는 레벨을 모두 씁니다. TEXTURE_LOD_FADE_STEPS 단계로 올림해 두어 매 프레임 값이 바뀌지 않습니다.
+    float getMinLod(Clock::time_point now) const
+    {
+        return std::ceil(getFade(now) * TEXTURE_LOD_FADE_STEPS) / TEXTURE_LOD_FADE_STEPS;
+    }
+
+private:
+    float getFade(Clock::time_point now) const
+    {
+        float elapsed = std::chrono::duration<float>(now - fadeStart).count();
+        return std::max(0.0f, fadeLevels - elapsed / TEXTURE_LOD_FADE_SECONDS);
+    }
+
+    std::vector<size_t> levelSizes;         // 전체 밉 체인의 레벨별 바이트 수
+    uint32_t extent = 0;                    // 레벨 0 의 가장 큰 변
+    uint32_t residentBase = 0;              // 그리기에 쓰는 이미지의 레벨 0 이 전체 밉 체인의 몇 번째 레벨인지. 아직 없으면 getLevelCount()
+    float fadeLevels = 0.0f;                // fadeStart 때의 minLod
+    Clock::time_point fadeStart;
+};
+
+
+// 뷰 공간 중심과 반지름으로 나타낸 경계 구가 화면에서 차지하는 지름 (픽셀). 카메라가 구 안에 있으면 무한대입니다.
+inline float getScreenDiameter(const glm::vec3& viewCenter, float radius, float fovY, float viewportHeight)
+{
+    const float distance = -viewCenter.z;
+    if (distance <= radius)
+    {
+        return std::numeric_limits<float>::infinity();
+    }
+    return radius / (distance * std::tan(fovY * 0.5f)) * viewportHeight;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+// 프레임별 유니폼 링 버퍼
+// 비행 중인 프레임마다 영구적으로 매핑된 호스트 일관성(HOST_COHERENT) 버퍼를 하나씩 두고, 그리기마다 필요한 유니폼 데이터를 앞에서부터 차례로 기록합니다.
+// push 가 돌려주는 오프셋을 VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC 디스크립터의 동적 오프셋으로 넘기면, 디스크립터 세트를 새로 만들거나 메모리를 매핑하지 않고도 오브젝트 수에 관계없이 그리기별 데이터를 전달할 수 있습니다.
+// 프레임 슬롯의 펜스를 기다린 뒤 beginFrame 으로 헤드를 되돌리므로 GPU 가 아직 읽고 있는 영역을 덮어쓰는 일은 없습니다.
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+
+
+class UniformRingBuffer
+{
+public:
+    // bytesPerFrame : 한 프레임 동안 기록할 수 있는 최대 바이트, minAlignment : VkPhysicalDeviceLimits::minUniformBufferOffsetAlignment
+    void init(uint32_t frameCount, VkDeviceSize bytesPerFrame, VkDeviceSize minAlignment)
+    {
+        this->bytesPerFrame = bytesPerFrame;
+        this->alignment = std::max<VkDeviceSize>(minAlignment, 1);
+        frames.assign(frameCount, Frame{});
+    }
+
+    // 프레임 슬롯이 사용할 버퍼와 그 버퍼가 매핑된 주소를 지정합니다. 버퍼는 bytesPerFrame 이상이어야 합니다.
+    void setFrameStorage(uint32_t frame, VkBuffer buffer, void* mappedData)
+    {
+        frames[frame].buffer = buffer;
+        frames[frame].mappedData = static_cast<char*>(mappedData);
+    }
+
+    // 프레임 슬롯의 펜스를 기다린 뒤에 호출하여 기록 위치를 처음으로 되돌립니다.
+    void beginFrame(uint32_t frame)
+    {
+        currentFrame = frame;
+        frames[frame].head = 0;
+    }
+
+    // 데이터를 현재 프레임 영역에 복사하고 동적 오프셋을 돌려줍니다.
+    uint32_t push(const void* data, VkDeviceSize size)
+    {
+        Frame& frame = frames[currentFrame];
+        VkDeviceSize offset = (frame.head + alignment - 1) / alignment * alignment;
+        if (offset + size > bytesPerFrame)
+        {
+            throw std::runtime_error("Uniform ring buffer overflow!");
+        }
+
+        std::memcpy(frame.mappedData + offset, data, static_cast<size_t>(size));
+        frame.head = offset + size;
+        highWatermark = std::max(highWatermark, frame.head);
+        return static_cast<uint32_t>(offset);
+    }
+
+    template<typename T>
+    uint32_t push(const T& data)
+    {
+        return push(&data, sizeof(T));
+    }
+
+    VkBuffer getBuffer(uint32_t frame) const
+    {
+        return frames[frame].buffer;
+    }
+
+    VkDeviceSize getBytesPerFrame() const
+    {
+        return bytesPerFrame;
+    }
+
+    // 한 프레임에 가장 많이 사용한 바이트 수 (bytesPerFrame 을 조정할 때 참고)
+    VkDeviceSize getHighWatermark() const
+    {
+        return highWatermark;
+    }
+
+private:
+    struct Frame
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        char* mappedData = nullptr;
+        VkDeviceSize head = 0;
+    };
+
+    std::vector<Frame> frames;
+    uint32_t currentFrame = 0;
+    VkDeviceSize bytesPerFrame = 0;
+    VkDeviceSize alignment = 1;
+    VkDeviceSize highWatermark = 0;
+};
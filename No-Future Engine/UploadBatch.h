@@ -0,0 +1,397 @@
+#pragma once
+
+// 묶음 업로드 컨텍스트
+// 버퍼 복사, 버퍼 -> 이미지 복사, 레이아웃 전환, 밉맵 생성처럼 한 번만 실행할 명령들을 하나의 명령 버퍼(배치)에 모아 기록하고 펜스와 함께 한 번에 제출합니다.
+// 예전처럼 명령마다 명령 버퍼를 만들어 vkQueueSubmit + vkQueueWaitIdle 로 큐가 빌 때까지 기다리면, 텍스쳐가 있는 모델 하나를 로드하는 동안 GPU 왕복이 여러 번 차례로 일어나고 그동안 CPU 도 멈춰 있습니다.
+// submit 이 돌려주는 토큰으로 배치가 끝났는지 확인(isComplete)하거나 기다릴(wait) 수 있습니다. 스테이징 버퍼처럼 배치가 끝난 뒤에 해제해야 하는 리소스는 releaseAfterCompletion 으로 맡겨두면 collect 에서 해제됩니다.
+// 배치의 마지막에는 전송 쓰기를 이후 제출들의 버텍스 입력 / 셰이더 읽기에 보이게 하는 메모리 배리어를 기록하므로, 같은 큐에 나중에 제출된 그리기는 CPU 대기 없이 업로드 결과를 안전하게 읽습니다.
+//
+// 그래픽 큐와 다른 전용 전송 큐 패밀리가 있으면 배치는 두 개의 명령 버퍼로 나뉩니다.
+// - 전송 명령 버퍼 (전송 큐) : 스테이징 버퍼에서의 복사와 전송 전 레이아웃 전환. 끝에서 리소스 소유권을 그래픽 큐 패밀리로 넘깁니다(release).
+// - 그래픽 명령 버퍼 (그래픽 큐) : 소유권을 넘겨받고(acquire) 밉맵 생성처럼 그래픽 큐에서만 할 수 있는 작업을 이어서 실행합니다. 전송 제출이 신호하는 세마포어를 기다리고, 배치의 펜스는 이 제출에 붙습니다.
+// 그래서 복사는 렌더링과 겹쳐 전송 큐에서 실행되고 drawFrame 은 멈추지 않습니다. 큐 패밀리가 하나뿐인 장치에서는 두 명령 버퍼가 같은 그래픽 명령 버퍼가 되고 소유권 이전은 생략되므로 같은 코드가 그대로 동작합니다.
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
+
+
+// 제출한 배치를 가리키는 토큰. 0 은 아무 배치도 가리키지 않으며 항상 끝난 것으로 취급합니다.
+struct UploadToken
+{
+    uint64_t id = 0;
+};
+
+class UploadContext
+{
+public:
+    // graphicsQueue / graphicsFamily 는 소유권을 넘겨받고 그래픽 작업을 실행할 큐, transferQueue / transferFamily 는 복사를 실행할 큐입니다. 두 패밀리가 같으면 그래픽 큐 하나만 사용합니다.
+    // 명령 버퍼는 큐 패밀리마다 자체 명령 풀에서 할당하고 배치가 끝나면 재사용합니다.
+    void init(VkDevice device, VkQueue graphicsQueue, uint32_t graphicsFamily, VkQueue transferQueue, uint32_t transferFamily)
+    {
+        this->device = device;
+        this->graphicsQueue = graphicsQueue;
+        this->graphicsFamily = graphicsFamily;
+        this->transferQueue = transferQueue;
+        this->transferFamily = transferFamily;
+
+        graphicsPool = createCommandPool(graphicsFamily);
+        if (hasDedicatedTransfer())
+        {
+            transferPool = createCommandPool(transferFamily);
+        }
+    }
+
+    // 남은 배치를 모두 기다리고 맡겨둔 리소스를 해제한 뒤 명령 풀과 펜스를 정리합니다.
+    void destroy()
+    {
+        if (graphicsPool == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        if (isRecording())
+        {
+            submit();
+        }
+        waitAll();
+        collect();
+
+        for (Batch& batch : freeBatches)
+        {
+            vkDestroyFence(device, batch.fence, nullptr);
+            if (batch.semaphore != VK_NULL_HANDLE)
+            {
+                vkDestroySemaphore(device, batch.semaphore, nullptr);
+            }
+        }
+        freeBatches.clear();
+        vkDestroyCommandPool(device, graphicsPool, nullptr);
+        graphicsPool = VK_NULL_HANDLE;
+        if (transferPool != VK_NULL_HANDLE)
+        {
+            vkDestroyCommandPool(device, transferPool, nullptr);
+            transferPool = VK_NULL_HANDLE;
+        }
+    }
+
+    // 그래픽 큐와 다른 전송 큐 패밀리를 사용하는지 여부
+    bool hasDedicatedTransfer() const
+    {
+        return transferFamily != graphicsFamily;
+    }
+
+    bool isRecording() const
+    {
+        return recording.graphicsCommandBuffer != VK_NULL_HANDLE;
+    }
+
+    // 기록 중인 배치의 전송 명령 버퍼를 돌려줍니다. 복사와 전송 전 레이아웃 전환처럼 전송 큐에서 실행할 수 있는 명령만 기록해야 합니다. 기록 중인 배치가 없으면 새로 시작합니다.
+    VkCommandBuffer getTransferCommandBuffer()
+    {
+        if (isRecording() == false)
+        {
+            begin();
+        }
+        return recording.transferCommandBuffer;
+    }
+
+    // 기록 중인 배치의 그래픽 명령 버퍼를 돌려줍니다. 전송 명령 버퍼의 내용과 소유권 이전이 끝난 뒤에 실행됩니다.
+    VkCommandBuffer getGraphicsCommandBuffer()
+    {
+        if (isRecording() == false)
+        {
+            begin();
+        }
+        return recording.graphicsCommandBuffer;
+    }
+
+    // 전송 명령 버퍼에서 쓴 버퍼의 소유권을 그래픽 큐 패밀리로 넘깁니다. dstStage / dstAccess 는 그래픽 큐에서 처음 사용할 단계와 접근입니다.
+    // 전용 전송 큐가 없으면 소유권 이전이 필요 없으며 배치 끝의 메모리 배리어가 그 역할을 합니다.
+    void transferOwnership(VkBuffer buffer, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+    {
+        if (hasDedicatedTransfer() == false)
+        {
+            return;
+        }
+
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = transferFamily;
+        barrier.dstQueueFamilyIndex = graphicsFamily;
+        barrier.buffer = buffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+
+        // release : 전송 큐에서 쓰기를 끝내고 소유권을 내놓습니다. 받는 쪽의 접근 마스크는 무시되므로 0 입니다.
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(getTransferCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+        // acquire : 그래픽 큐에서 같은 배리어로 소유권을 받습니다. 쓰기는 세마포어로 이미 보이므로 보내는 쪽의 접근 마스크는 0 입니다.
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(getGraphicsCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    }
+
+    // 이미지 버전. 레이아웃은 layout 그대로 유지하며 소유권만 넘깁니다.
+    void transferOwnership(VkImage image, const VkImageSubresourceRange& range, VkImageLayout layout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+    {
+        if (hasDedicatedTransfer() == false)
+        {
+            return;
+        }
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = layout;
+        barrier.newLayout = layout;
+        barrier.srcQueueFamilyIndex = transferFamily;
+        barrier.dstQueueFamilyIndex = graphicsFamily;
+        barrier.image = image;
+        barrier.subresourceRange = range;
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(getTransferCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(getGraphicsCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    // 기록 중인 배치가 GPU 에서 끝난 뒤에 실행할 정리 작업(스테이징 버퍼 해제 등)을 맡깁니다.
+    void releaseAfterCompletion(std::function<void()> release)
+    {
+        getGraphicsCommandBuffer();
+        recording.releases.push_back(std::move(release));
+    }
+
+    // 기록 중인 배치를 펜스와 함께 제출하고 토큰을 돌려줍니다. 기록 중인 배치가 없으면 빈 토큰을 돌려줍니다.
+    UploadToken submit()
+    {
+        if (isRecording() == false)
+        {
+            return UploadToken{};
+        }
+
+        // 배치 안의 전송 쓰기가 이후 제출들의 버텍스 / 인덱스 / 유니폼 / 셰이더 읽기에 보이도록 합니다. 이미지 레이아웃은 각 이미지의 배리어에서 이미 전환되었습니다.
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(recording.graphicsCommandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+            1, &barrier,
+            0, nullptr,
+            0, nullptr);
+
+        // 전용 전송 큐가 있으면 복사를 먼저 전송 큐에 제출하고, 그래픽 제출은 그 복사가 끝났음을 알리는 세마포어를 기다립니다.
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        if (hasDedicatedTransfer())
+        {
+            if (vkEndCommandBuffer(recording.transferCommandBuffer) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to record upload transfer command buffer!");
+            }
+
+            VkSubmitInfo transferSubmitInfo{};
+            transferSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            transferSubmitInfo.commandBufferCount = 1;
+            transferSubmitInfo.pCommandBuffers = &recording.transferCommandBuffer;
+            transferSubmitInfo.signalSemaphoreCount = 1;
+            transferSubmitInfo.pSignalSemaphores = &recording.semaphore;
+            if (vkQueueSubmit(transferQueue, 1, &transferSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to submit upload transfer command buffer!");
+            }
+
+            submitInfo.waitSemaphoreCount = 1;
+            submitInfo.pWaitSemaphores = &recording.semaphore;
+            submitInfo.pWaitDstStageMask = &waitStage;
+        }
+
+        if (vkEndCommandBuffer(recording.graphicsCommandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to record upload command buffer!");
+        }
+
+        // 배치의 펜스는 그래픽 제출에 붙습니다. 그래픽 제출이 세마포어를 기다리므로 펜스가 신호되면 전송 명령 버퍼와 세마포어도 다시 쓸 수 있습니다.
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &recording.graphicsCommandBuffer;
+        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, recording.fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to submit upload command buffer!");
+        }
+
+        recording.id = ++lastSubmittedId;
+        pendingBatches.push_back(std::move(recording));
+        recording = Batch{};
+        return UploadToken{ lastSubmittedId };
+    }
+
+    // 토큰의 배치가 끝났는지 기다리지 않고 확인합니다. 끝난 배치들은 이때 함께 정리됩니다.
+    bool isComplete(UploadToken token)
+    {
+        collect();
+        return token.id <= lastCompletedId;
+    }
+
+    // 토큰의 배치가 끝날 때까지 기다립니다.
+    void wait(UploadToken token)
+    {
+        for (const Batch& batch : pendingBatches)
+        {
+            if (batch.id > token.id)
+            {
+                break;
+            }
+            vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+        }
+        collect();
+    }
+
+    void waitAll()
+    {
+        wait(UploadToken{ lastSubmittedId });
+    }
+
+    // 끝난 배치(펜스가 신호된 배치)를 제출 순서대로 정리합니다. 맡겨둔 정리 작업을 실행하고 명령 버퍼와 펜스는 다음 배치를 위해 남겨둡니다.
+    void collect()
+    {
+        size_t completed = 0;
+        while (completed < pendingBatches.size() && vkGetFenceStatus(device, pendingBatches[completed].fence) == VK_SUCCESS)
+        {
+            Batch& batch = pendingBatches[completed];
+            for (std::function<void()>& release : batch.releases)
+            {
+                release();
+            }
+            batch.releases.clear();
+            lastCompletedId = batch.id;
+
+            vkResetFences(device, 1, &batch.fence);
+            vkResetCommandBuffer(batch.graphicsCommandBuffer, 0);
+            if (batch.transferCommandBuffer != batch.graphicsCommandBuffer)
+            {
+                vkResetCommandBuffer(batch.transferCommandBuffer, 0);
+            }
+            freeBatches.push_back(std::move(batch));
+            completed++;
+        }
+        pendingBatches.erase(pendingBatches.begin(), pendingBatches.begin() + completed);
+    }
+
+    size_t getPendingCount() const
+    {
+        return pendingBatches.size();
+    }
+
+    // 끝난 것으로 확인된 가장 최근 배치의 번호. 배치는 제출 순서대로 끝나므로 이 번호 이하의 배치는 모두 끝났습니다.
+    uint64_t getCompletedId() const
+    {
+        return lastCompletedId;
+    }
+
+private:
+    struct Batch
+    {
+        VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;    // 전용 전송 큐가 없으면 graphicsCommandBuffer 와 같습니다.
+        VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE;
+        VkSemaphore semaphore = VK_NULL_HANDLE;                     // 전송 제출 -> 그래픽 제출 (전용 전송 큐가 있을 때만)
+        VkFence fence = VK_NULL_HANDLE;
+        uint64_t id = 0;
+        std::vector<std::function<void()>> releases;
+    };
+
+    VkCommandPool createCommandPool(uint32_t queueFamilyIndex)
+    {
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+        VkCommandPool pool;
+        if (vkCreateCommandPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create upload command pool!");
+        }
+        return pool;
+    }
+
+    VkCommandBuffer allocateCommandBuffer(VkCommandPool pool)
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = pool;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate upload command buffer!");
+        }
+        return commandBuffer;
+    }
+
+    void begin()
+    {
+        if (freeBatches.empty() == false)
+        {
+            recording = std::move(freeBatches.back());
+            freeBatches.pop_back();
+        }
+        else
+        {
+            recording.graphicsCommandBuffer = allocateCommandBuffer(graphicsPool);
+            recording.transferCommandBuffer = recording.graphicsCommandBuffer;
+            if (hasDedicatedTransfer())
+            {
+                recording.transferCommandBuffer = allocateCommandBuffer(transferPool);
+
+                VkSemaphoreCreateInfo semaphoreInfo{};
+                semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+                if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &recording.semaphore) != VK_SUCCESS)
+                {
+                    throw std::runtime_error("Failed to create upload semaphore!");
+                }
+            }
+
+            VkFenceCreateInfo fenceInfo{};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if (vkCreateFence(device, &fenceInfo, nullptr, &recording.fence) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create upload fence!");
+            }
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(recording.graphicsCommandBuffer, &beginInfo);
+        if (recording.transferCommandBuffer != recording.graphicsCommandBuffer)
+        {
+            vkBeginCommandBuffer(recording.transferCommandBuffer, &beginInfo);
+        }
+    }
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue graphicsQueue = VK_NULL_HANDLE;
+    VkQueue transferQueue = VK_NULL_HANDLE;
+    uint32_t graphicsFamily = 0;
+    uint32_t transferFamily = 0;
+    VkCommandPool graphicsPool = VK_NULL_HANDLE;
+    VkCommandPool transferPool = VK_NULL_HANDLE;    // 전용 전송 큐가 있을 때만
+
+    Batch recording;                    // 기록 중인 배치
+    std::vector<Batch> pendingBatches;  // 제출했지만 아직 끝나지 않은 배치 (제출 순서)
+    std::vector<Batch> freeBatches;     // 재사용할 명령 버퍼와 펜스
+    uint64_t lastSubmittedId = 0;
+    uint64_t lastCompletedId = 0;
+};
@@ -0,0 +1,219 @@
+#pragma once
+
+// 병렬 버텍스 중복 제거
+// 면의 모서리(corner) 배열을 스레드 수만큼 연속 구간으로 나누고, 스레드마다 자신의 해시 테이블로 구간 안의 중복을 먼저 제거합니다.
+// 그 다음 구간 순서대로 각 스레드의 고유 버텍스 목록을 전역 테이블에 합치고, 지역 인덱스를 전역 인덱스로 다시 씁니다.
+// 구간을 앞에서부터 순서대로 합치므로 고유 버텍스가 처음 등장한 순서가 그대로 유지되어, 결과 vertices / indices 는 하나의 스레드로 순회하며 중복을 제거한 결과와 바이트 단위로 같습니다.
+//
+// 해시 테이블은 std::unordered_map 대신 미리 크기를 잡아둔 선형 탐사(open addressing) 테이블(VertexTable)을 사용합니다. 슬롯에는 버텍스 배열의 인덱스와 해시 상위 32 비트만 저장하므로 고유 버텍스마다 힙 할당이 일어나지 않고, 조회와 삽입을 한 번의 해시 계산으로 끝냅니다.
+// 버텍스 형식에 관계없이 쓸 수 있도록 버텍스의 원시 바이트를 float 배열로 보고 해시하므로, float 만으로 이루어지고 패딩이 없는 버텍스 구조체라면 다른 메쉬 임포터에서도 그대로 사용할 수 있습니다.
+
+#include "Hash.h"
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace VertexDedup
+{
+    // 0 을 넘기면 하드웨어 스레드 수를 사용합니다.
+    inline uint32_t resolveThreadCount(uint32_t requested)
+    {
+        if (requested != 0)
+        {
+            return requested;
+        }
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // 버텍스의 원시 바이트에 대한 64 비트 해시. operator== 는 -0.0f 와 +0.0f 를 같은 값으로 보므로 해시하기 전에 -0.0f 를 +0.0f 로 바꿉니다.
+    // NaN 은 자기 자신과도 같지 않으므로 NaN 이 들어간 모서리는 항상 새로운 버텍스로 추가됩니다. (이전의 count() 후 operator[] 방식은 이 경우 인덱스 0 을 잘못 기록했습니다.)
+    template<typename VertexT>
+    inline uint64_t hashVertex(const VertexT& vertex)
+    {
+        // float 가 아닌 성분(압축된 정수 등)이 있어도 같은 버텍스는 같은 해시를 가지므로 결과는 올바릅니다. (-0.0f 처리가 해시 분포에만 약간 영향을 줄 뿐입니다.)
+        static_assert(std::is_trivially_copyable<VertexT>::value && sizeof(VertexT) % sizeof(float) == 0, "VertexT must be a padding-free struct whose size is a multiple of 4 bytes");
+
+        float values[sizeof(VertexT) / sizeof(float)];
+        std::memcpy(values, &vertex, sizeof(VertexT));
+        for (float& value : values)
+        {
+            if (value == 0.0f)
+            {
+                value = 0.0f;
+            }
+        }
+        return hashBytes(values, sizeof(values));
+    }
+
+    // 고유 버텍스 배열에 대한 선형 탐사 해시 테이블
+    // 버텍스 자체는 호출하는 쪽의 배열(vertices)에 저장하고, 테이블에는 그 배열의 인덱스만 둡니다. 부하율이 1/2 을 넘으면 두 배로 키웁니다.
+    template<typename VertexT>
+    class VertexTable
+    {
+    public:
+        // expectedCount : 예상되는 고유 버텍스 수. 이 수만큼은 테이블을 다시 만들지 않고 삽입할 수 있습니다.
+        explicit VertexTable(size_t expectedCount)
+        {
+            size_t capacity = 16;
+            while (capacity < expectedCount * 2)
+            {
+                capacity *= 2;
+            }
+            slots.assign(capacity, Slot{});
+            mask = capacity - 1;
+        }
+
+        // vertex 와 같은 버텍스가 vertices 에 이미 있으면 그 인덱스를, 없으면 vertices 끝에 추가하고 새 인덱스를 반환합니다.
+        uint32_t insert(const VertexT& vertex, std::vector<VertexT>& vertices)
+        {
+            if ((count + 1) * 2 > slots.size())
+            {
+                grow(vertices);
+            }
+
+            uint64_t hash = hashVertex(vertex);
+            uint32_t tag = static_cast<uint32_t>(hash >> 32);
+            for (size_t slot = static_cast<size_t>(hash) & mask;; slot = (slot + 1) & mask)
+            {
+                Slot& entry = slots[slot];
+                if (entry.index == EMPTY)
+                {
+                    entry.tag = tag;
+                    entry.index = static_cast<uint32_t>(vertices.size());
+                    vertices.push_back(vertex);
+                    count++;
+                    return entry.index;
+                }
+                if (entry.tag == tag && vertices[entry.index] == vertex)
+                {
+                    return entry.index;
+                }
+            }
+        }
+
+    private:
+        static constexpr uint32_t EMPTY = UINT32_MAX;
+
+        struct Slot
+        {
+            uint32_t tag = 0;       // 해시 상위 32 비트. 버텍스를 비교하기 전에 먼저 걸러냅니다.
+            uint32_t index = EMPTY; // vertices 안의 인덱스
+        };
+
+        void grow(const std::vector<VertexT>& vertices)
+        {
+            std::vector<Slot> oldSlots(slots.size() * 2, Slot{});
+            oldSlots.swap(slots);
+            mask = slots.size() - 1;
+
+            for (const Slot& entry : oldSlots)
+            {
+                if (entry.index == EMPTY)
+                {
+                    continue;
+                }
+                size_t slot = static_cast<size_t>(hashVertex(vertices[entry.index])) & mask;
+                while (slots[slot].index != EMPTY)
+                {
+                    slot = (slot + 1) & mask;
+                }
+                slots[slot] = entry;
+            }
+        }
+
+        std::vector<Slot> slots;
+        size_t mask = 0;
+        size_t count = 0;
+    };
+
+    // [0, count) 를 threadCount 개의 연속 구간으로 나누어 fn(threadIndex, begin, end) 를 스레드마다 호출합니다. 마지막 구간은 호출한 스레드에서 직접 처리합니다.
+    template<typename Function>
+    void parallelRanges(size_t count, uint32_t threadCount, Function fn)
+    {
+        threadCount = static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(threadCount, count)));
+        size_t chunkSize = (count + threadCount - 1) / threadCount;
+
+        std::vector<std::thread> workers;
+        workers.reserve(threadCount - 1);
+        for (uint32_t t = 0; t + 1 < threadCount; t++)
+        {
+            size_t begin = std::min(count, t * chunkSize);
+            size_t end = std::min(count, begin + chunkSize);
+            workers.emplace_back(fn, t, begin, end);
+        }
+        fn(threadCount - 1, std::min(count, (threadCount - 1) * chunkSize), count);
+
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    // cornerCount 개의 모서리에 대해 makeVertex(cornerIndex) 로 버텍스를 만들고 중복을 제거합니다.
+    // makeVertex 는 여러 스레드에서 동시에 호출되므로 읽기만 해야 합니다. VertexT 는 hashVertex 를 사용할 수 있는 형식이어야 하고 operator== 가 있어야 합니다.
+    // 고유 버텍스 수를 알고 있다면 expectedUniqueCount 로 넘겨 테이블을 다시 만드는 일을 없앨 수 있습니다. 0 이면 OBJ 메쉬의 일반적인 비율(모서리 6 개당 버텍스 1 개)로 어림합니다.
+    template<typename VertexT, typename MakeVertex>
+    void deduplicate(size_t cornerCount, uint32_t threadCount, MakeVertex makeVertex, std::vector<VertexT>& vertices, std::vector<uint32_t>& indices, size_t expectedUniqueCount = 0)
+    {
+        vertices.clear();
+        indices.resize(cornerCount);
+        if (cornerCount == 0)
+        {
+            return;
+        }
+
+        threadCount = static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(resolveThreadCount(threadCount), cornerCount)));
+        if (expectedUniqueCount == 0)
+        {
+            expectedUniqueCount = cornerCount / 6 + 1;
+        }
+
+        // 1. 구간별 중복 제거. indices 에는 우선 구간 안에서의 지역 인덱스를 기록합니다.
+        std::vector<std::vector<VertexT>> localVertices(threadCount);
+        parallelRanges(cornerCount, threadCount, [&](uint32_t t, size_t begin, size_t end)
+        {
+            size_t expectedLocal = static_cast<size_t>(static_cast<double>(expectedUniqueCount) * (end - begin) / cornerCount) + 1;
+            VertexTable<VertexT> uniqueVertices(expectedLocal);
+            std::vector<VertexT>& local = localVertices[t];
+            local.reserve(expectedLocal);
+            for (size_t i = begin; i < end; i++)
+            {
+                indices[i] = uniqueVertices.insert(makeVertex(i), local);
+            }
+        });
+
+        // 2. 구간 순서대로 전역 테이블에 합치며 지역 인덱스 -> 전역 인덱스 변환표를 만듭니다. 고유 버텍스 수만큼만 순회하므로 전체 모서리 수보다 훨씬 적습니다.
+        std::vector<std::vector<uint32_t>> remaps(threadCount);
+        VertexTable<VertexT> globalVertices(expectedUniqueCount);
+        vertices.reserve(expectedUniqueCount);
+        for (uint32_t t = 0; t < threadCount; t++)
+        {
+            remaps[t].resize(localVertices[t].size());
+            for (size_t i = 0; i < localVertices[t].size(); i++)
+            {
+                remaps[t][i] = globalVertices.insert(localVertices[t][i], vertices);
+            }
+            std::vector<VertexT>().swap(localVertices[t]);
+        }
+
+        // 3. 지역 인덱스를 전역 인덱스로 바꿉니다. 첫 구간의 변환표는 항등 변환이므로 건너뜁니다.
+        parallelRanges(cornerCount, threadCount, [&](uint32_t t, size_t begin, size_t end)
+        {
+            if (t == 0)
+            {
+                return;
+            }
+            const std::vector<uint32_t>& remap = remaps[t];
+            for (size_t i = begin; i < end; i++)
+            {
+                indices[i] = remap[indices[i]];
+            }
+        });
+    }
+}
@@ -0,0 +1,760 @@
+#pragma once
+
+// zstd 압축 해제
+// KTX2 의 zstd 초압축(supercompressionScheme = 2) 레벨을 풀기 위한 작은 디코더입니다. RFC 8878 의 프레임 중 사전(dictionary)을 쓰지 않는 프레임을 모두 풉니다.
+// 풀린 크기를 미리 알고(KTX2 의 uncompressedByteLength) 출력 배열 전체가 창(window)이 되므로, 별도의 창 버퍼 없이 출력에서 바로 일치 구간을 복사합니다.
+// 비트 스트림은 두 가지입니다. FSE 표 설명은 앞에서부터 LSB 순서로, 허프만 / FSE 로 인코딩된 본문은 끝에서부터 MSB 순서로 읽습니다. (BackwardBitReader)
+// 체크섬(XXH64)은 검사하지 않습니다. 잘못된 입력은 출력 범위를 벗어나지 않도록 검사하여 std::runtime_error 를 던집니다.
+
+#include <vector>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace Zstd
+{
+    inline void require(bool condition)
+    {
+        if (!condition)
+        {
+            throw std::runtime_error("Corrupt zstd data!");
+        }
+    }
+
+    inline uint32_t highestBit(uint32_t value)
+    {
+        uint32_t bit = 0;
+        while (value >>= 1)
+        {
+            bit++;
+        }
+        return bit;
+    }
+
+    inline uint32_t readLE(const uint8_t* data, uint32_t byteCount)
+    {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < byteCount; i++)
+        {
+            value |= uint32_t(data[i]) << (i * 8);
+        }
+        return value;
+    }
+
+    // 앞에서부터 LSB 순서로 읽는 비트 스트림 (FSE 표 설명). 끝을 넘은 비트는 0 으로 읽고, 실제로 넘겨 쓴 경우에만 오류입니다.
+    struct ForwardBitReader
+    {
+        const uint8_t* data;
+        size_t size;
+        size_t position = 0;    // 비트 단위
+
+        uint32_t peek(uint32_t count) const
+        {
+            uint32_t value = 0;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                size_t bit = position + i;
+                if ((bit >> 3) < size)
+                {
+                    value |= uint32_t((data[bit >> 3] >> (bit & 7)) & 1) << i;
+                }
+            }
+            return value;
+        }
+
+        void skip(uint32_t count)
+        {
+            position += count;
+            require(position <= size * 8);
+        }
+
+        uint32_t read(uint32_t count)
+        {
+            uint32_t value = peek(count);
+            skip(count);
+            return value;
+        }
+    };
+
+    // 끝에서부터 읽는 비트 스트림. 마지막 바이트의 가장 높은 1 비트가 끝 표시이고, 그 아래 비트부터 MSB 쪽에서 차례로 읽습니다.
+    // 처음을 넘어서 읽으면 0 을 읽은 것으로 보고 position 이 음수가 됩니다. FSE 디코딩은 이 넘침으로 끝을 판단합니다.
+    // 이미 넘친 스트림을 더 읽는 것은 손상된 데이터이므로 예외를 던집니다. 그래서 position 은 -32 아래로 내려가지 않습니다.
+    struct BackwardBitReader
+    {
+        const uint8_t* data;
+        size_t size;
+        int64_t position;       // 아직 읽지 않은 비트 수
+
+        BackwardBitReader(const uint8_t* data, size_t size) : data(data), size(size)
+        {
+            require(size > 0 && data[size - 1] != 0);
+            position = int64_t(size - 1) * 8 + highestBit(data[size - 1]);
+        }
+
+        uint64_t load(size_t byte) const
+        {
+            uint64_t word = 0;
+            if (byte + 8 <= size)
+            {
+                std::memcpy(&word, data + byte, 8);
+                return word;
+            }
+            for (size_t i = byte; i < size; i++)
+            {
+                word |= uint64_t(data[i]) << ((i - byte) * 8);
+            }
+            return word;
+        }
+
+        // count 는 32 이하입니다.
+        uint32_t peek(uint32_t count) const
+        {
+            if (count == 0)
+            {
+                return 0;
+            }
+            int64_t start = position - count;
+            if (start <= -64)
+            {
+                return 0;
+            }
+            uint64_t word = start >= 0 ? load(size_t(start >> 3)) >> (start & 7) : load(0) << (-start);
+            return uint32_t(word & ((uint64_t(1) << count) - 1));
+        }
+
+        void skip(uint32_t count)
+        {
+            require(position >= 0);
+            position -= count;
+        }
+
+        uint32_t read(uint32_t count)
+        {
+            uint32_t value = peek(count);
+            skip(count);
+            return value;
+        }
+
+        bool isOverflowed() const
+        {
+            return position < 0;
+        }
+    };
+
+    struct FseEntry
+    {
+        uint16_t baseline;      // 다음 상태 = baseline + bits 비트
+        uint8_t symbol;
+        uint8_t bits;
+    };
+
+    struct FseTable
+    {
+        std::vector<FseEntry> entries;
+        uint32_t accuracyLog = 0;
+    };
+
+    // 정규화된 확률(-1 은 "1 보다 작음")로 디코딩 표를 만듭니다. (RFC 8878 4.1.1)
+    inline void buildFseTable(const int16_t* probabilities, uint32_t symbolCount, uint32_t accuracyLog, FseTable& table)
+    {
+        const uint32_t tableSize = 1u << accuracyLog;
+        table.accuracyLog = accuracyLog;
+        table.entries.assign(tableSize, FseEntry{});
+
+        uint32_t nextState[256];
+        int32_t highThreshold = int32_t(tableSize) - 1;
+        for (uint32_t s = 0; s < symbolCount; s++)
+        {
+            if (probabilities[s] == -1)
+            {
+                require(highThreshold >= 0);
+                table.entries[highThreshold--].symbol = static_cast<uint8_t>(s);
+                nextState[s] = 1;
+            }
+            else
+            {
+                nextState[s] = probabilities[s] > 0 ? uint32_t(probabilities[s]) : 0;
+            }
+        }
+
+        // 확률이 1 이상인 심볼은 표 전체에 고르게 흩어 놓습니다.
+        const uint32_t step = (tableSize >> 1) + (tableSize >> 3) + 3;
+        const uint32_t mask = tableSize - 1;
+        uint32_t position = 0;
+        for (uint32_t s = 0; s < symbolCount; s++)
+        {
+            for (int32_t i = 0; i < probabilities[s]; i++)
+            {
+                table.entries[position].symbol = static_cast<uint8_t>(s);
+                do
+                {
+                    position = (position + step) & mask;
+                } while (int32_t(position) > highThreshold);
+            }
+        }
+        require(position == 0);
+
+        for (uint32_t u = 0; u < tableSize; u++)
+        {
+            uint32_t state = nextState[table.entries[u].symbol]++;
+            require(state != 0);
+            uint32_t bits = accuracyLog - highestBit(state);
+            table.entries[u].bits = static_cast<uint8_t>(bits);
+            table.entries[u].baseline = static_cast<uint16_t>((state << bits) - tableSize);
+        }
+    }
+
+    // 모든 상태가 같은 심볼인 표 (RLE 모드)
+    inline void buildRleTable(uint8_t symbol, FseTable& table)
+    {
+        table.accuracyLog = 0;
+        table.entries.assign(1, FseEntry{ 0, symbol, 0 });
+    }
+
+    // FSE 표 설명을 읽어 표를 만들고 읽은 바이트 수를 반환합니다.
+    inline size_t readFseTable(const uint8_t* src, size_t size, uint32_t maxSymbol, uint32_t maxAccuracyLog, FseTable& table)
+    {
+        ForwardBitReader reader{ src, size };
+        const uint32_t accuracyLog = reader.read(4) + 5;
+        require(accuracyLog <= maxAccuracyLog);
+
+        int16_t probabilities[256];
+        uint32_t symbolCount = 0;
+        int32_t remaining = (1 << accuracyLog) + 1;
+        int32_t threshold = 1 << accuracyLog;
+        uint32_t bitCount = accuracyLog + 1;
+        while (remaining > 1)
+        {
+            require(symbolCount <= maxSymbol);
+
+            // 남은 확률로 표현할 수 없는 작은 값들은 한 비트 적게 씁니다.
+            const int32_t max = 2 * threshold - 1 - remaining;
+            const int32_t bits = int32_t(reader.peek(bitCount));
+            int32_t count;
+            if ((bits & (threshold - 1)) < max)
+            {
+                count = bits & (threshold - 1);
+                reader.skip(bitCount - 1);
+            }
+            else
+            {
+                count = bits & (2 * threshold - 1);
+                if (count >= threshold)
+                {
+                    count -= max;
+                }
+                reader.skip(bitCount);
+            }
+            count--;
+            remaining -= count < 0 ? -count : count;
+            require(remaining >= 1);
+            probabilities[symbolCount++] = static_cast<int16_t>(count);
+
+            // 확률 0 뒤에는 0 이 몇 번 더 반복되는지 2 비트씩 적혀 있습니다. 3 이면 계속 이어집니다.
+            if (count == 0)
+            {
+                for (;;)
+                {
+                    uint32_t repeat = reader.read(2);
+                    for (uint32_t i = 0; i < repeat; i++)
+                    {
+                        require(symbolCount <= maxSymbol);
+                        probabilities[symbolCount++] = 0;
+                    }
+                    if (repeat != 3)
+                    {
+                        break;
+                    }
+                }
+            }
+
+            while (remaining < threshold)
+            {
+                bitCount--;
+                threshold >>= 1;
+            }
+        }
+        require(remaining == 1);
+
+        buildFseTable(probabilities, symbolCount, accuracyLog, table);
+        return (reader.position + 7) / 8;
+    }
+
+    struct FseState
+    {
+        uint32_t state = 0;
+
+        void init(BackwardBitReader& reader, const FseTable& table)
+        {
+            state = reader.read(table.accuracyLog);
+        }
+
+        uint8_t getSymbol(const FseTable& table) const
+        {
+            return table.entries[state].symbol;
+        }
+
+        void update(BackwardBitReader& reader, const FseTable& table)
+        {
+            const FseEntry& entry = table.entries[state];
+            state = entry.baseline + reader.read(entry.bits);
+        }
+    };
+
+    struct HuffmanEntry
+    {
+        uint8_t symbol;
+        uint8_t bits;
+    };
+
+    struct HuffmanTable
+    {
+        std::vector<HuffmanEntry> entries;  // 다음 maxBits 비트로 찾습니다.
+        uint32_t maxBits = 0;
+    };
+
+    // 허프만 트리 설명(가중치 목록)을 읽어 표를 만들고 읽은 바이트 수를 반환합니다. (RFC 8878 4.2.1)
+    inline size_t readHuffmanTable(const uint8_t* src, size_t size, HuffmanTable& table)
+    {
+        require(size >= 1);
+        const uint32_t header = src[0];
+        uint8_t weights[256];
+        uint32_t weightCount = 0;
+        size_t consumed;
+        if (header >= 128)
+        {
+            // 가중치를 4 비트씩 그대로 적은 경우
+            weightCount = header - 127;
+            consumed = 1 + (weightCount + 1) / 2;
+            require(consumed <= size);
+            for (uint32_t i = 0; i < weightCount; i++)
+            {
+                uint8_t packed = src[1 + i / 2];
+                weights[i] = (i & 1) ? (packed & 15) : (packed >> 4);
+            }
+        }
+        else
+        {
+            // 가중치를 FSE 로 압축한 경우. 두 상태를 번갈아 쓰며 스트림이 넘칠 때까지 읽습니다.
+            consumed = 1 + size_t(header);
+            require(header != 0 && consumed <= size);
+            FseTable weightTable;
+            size_t tableSize = readFseTable(src + 1, header, 255, 6, weightTable);
+            require(tableSize < header);
+            BackwardBitReader reader(src + 1 + tableSize, header - tableSize);
+            FseState state1, state2;
+            state1.init(reader, weightTable);
+            state2.init(reader, weightTable);
+            for (;;)
+            {
+                require(weightCount < 254);
+                weights[weightCount++] = state1.getSymbol(weightTable);
+                state1.update(reader, weightTable);
+                if (reader.isOverflowed())
+                {
+                    weights[weightCount++] = state2.getSymbol(weightTable);
+                    break;
+                }
+                weights[weightCount++] = state2.getSymbol(weightTable);
+                state2.update(reader, weightTable);
+                if (reader.isOverflowed())
+                {
+                    weights[weightCount++] = state1.getSymbol(weightTable);
+                    break;
+                }
+            }
+        }
+
+        // 마지막 심볼의 가중치는 적혀 있지 않고, 가중치 합을 2 의 거듭제곱으로 채우는 값입니다.
+        require(weightCount < 256);
+        uint32_t total = 0;
+        for (uint32_t i = 0; i < weightCount; i++)
+        {
+            require(weights[i] <= 11);
+            total += weights[i] ? (1u << (weights[i] - 1)) : 0;
+        }
+        require(total != 0);
+        const uint32_t maxBits = highestBit(total) + 1;
+        const uint32_t leftover = (1u << maxBits) - total;
+        require(maxBits <= 11 && (leftover & (leftover - 1)) == 0);
+        weights[weightCount++] = static_cast<uint8_t>(highestBit(leftover) + 1);
+
+        // 가중치가 낮은(코드가 긴) 심볼부터, 같은 가중치는 심볼 순서대로 코드를 나누어 줍니다.
+        table.maxBits = maxBits;
+        table.entries.resize(size_t(1) << maxBits);
+        size_t position = 0;
+        for (uint32_t weight = 1; weight <= maxBits; weight++)
+        {
+            for (uint32_t s = 0; s < weightCount; s++)
+            {
+                if (weights[s] == weight)
+                {
+                    const size_t length = size_t(1) << (weight - 1);
+                    require(position + length <= table.entries.size());
+                    for (size_t i = 0; i < length; i++)
+                    {
+                        table.entries[position + i] = HuffmanEntry{ static_cast<uint8_t>(s), static_cast<uint8_t>(maxBits + 1 - weight) };
+                    }
+                    position += length;
+                }
+            }
+        }
+        require(position == table.entries.size());
+        return consumed;
+    }
+
+    inline void decodeHuffmanStream(const HuffmanTable& table, const uint8_t* src, size_t size, uint8_t* dst, size_t count)
+    {
+        BackwardBitReader reader(src, size);
+        for (size_t i = 0; i < count; i++)
+        {
+            const HuffmanEntry& entry = table.entries[reader.peek(table.maxBits)];
+            dst[i] = entry.symbol;
+            reader.skip(entry.bits);
+        }
+        require(reader.position == 0);
+    }
+
+    // 리터럴 길이 / 일치 길이 / 오프셋 코드의 기본 분포 (RFC 8878 3.1.1.3.2.2)
+    constexpr int16_t LITERAL_LENGTH_DEFAULT[36] = { 4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1, -1, -1, -1, -1 };
+    constexpr int16_t MATCH_LENGTH_DEFAULT[53] = { 1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1, -1, -1 };
+    constexpr int16_t OFFSET_DEFAULT[29] = { 1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1 };
+
+    // 길이 코드마다 기준 값과 뒤따르는 추가 비트 수
+    constexpr uint32_t LITERAL_LENGTH_BASE[36] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536 };
+    constexpr uint8_t LITERAL_LENGTH_BITS[36] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+    constexpr uint32_t MATCH_LENGTH_BASE[53] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027, 2051, 4099, 8195, 16387, 32771, 65539 };
+    constexpr uint8_t MATCH_LENGTH_BITS[53] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+
+    // 한 프레임 안에서 블록 사이에 이어지는 상태. 허프만 표와 FSE 표는 다음 블록에서 "반복" 모드로 다시 쓸 수 있습니다.
+    struct FrameContext
+    {
+        HuffmanTable huffman;
+        FseTable literalLengths;
+        FseTable offsets;
+        FseTable matchLengths;
+        uint32_t repeatOffsets[3] = { 1, 4, 8 };
+        std::vector<uint8_t> literals;
+    };
+
+    // 리터럴 섹션을 풀어 context.literals 에 담고 읽은 바이트 수를 반환합니다.
+    inline size_t decodeLiterals(const uint8_t* src, size_t size, FrameContext& context)
+    {
+        require(size >= 1);
+        const uint32_t blockType = src[0] & 3;
+        const uint32_t sizeFormat = (src[0] >> 2) & 3;
+
+        // 0 : 그대로, 1 : 한 바이트 반복
+        if (blockType <= 1)
+        {
+            uint32_t headerSize = sizeFormat == 1 ? 2 : (sizeFormat == 3 ? 3 : 1);
+            require(size >= headerSize);
+            size_t regeneratedSize = sizeFormat == 1 || sizeFormat == 3 ? readLE(src, headerSize) >> 4 : src[0] >> 3;
+            size_t payloadSize = blockType == 0 ? regeneratedSize : 1;
+            require(size >= headerSize + payloadSize);
+            if (blockType == 0)
+            {
+                context.literals.assign(src + headerSize, src + headerSize + regeneratedSize);
+            }
+            else
+            {
+                context.literals.assign(regeneratedSize, src[headerSize]);
+            }
+            return headerSize + payloadSize;
+        }
+
+        // 2 : 허프만 압축 (표 포함), 3 : 이전 블록의 허프만 표로 압축
+        const uint32_t headerSize = sizeFormat <= 1 ? 3 : sizeFormat + 2;
+        const uint32_t sizeBits = sizeFormat <= 1 ? 10 : (sizeFormat == 2 ? 14 : 18);
+        const uint32_t streamCount = sizeFormat == 0 ? 1 : 4;
+        require(size >= headerSize);
+        uint64_t header = 0;
+        for (uint32_t i = 0; i < headerSize; i++)
+        {
+            header |= uint64_t(src[i]) << (i * 8);
+        }
+        const size_t regeneratedSize = size_t(header >> 4) & ((size_t(1) << sizeBits) - 1);
+        const size_t sectionSize = headerSize + (size_t(header >> (4 + sizeBits)) & ((size_t(1) << sizeBits) - 1));
+        require(size >= sectionSize);
+        size_t compressedSize = sectionSize - headerSize;
+
+        const uint8_t* data = src + headerSize;
+        if (blockType == 2)
+        {
+            size_t tableSize = readHuffmanTable(data, compressedSize, context.huffman);
+            data += tableSize;
+            compressedSize -= tableSize;
+        }
+        require(context.huffman.entries.empty() == false);
+
+        context.literals.resize(regeneratedSize);
+        if (streamCount == 1)
+        {
+            decodeHuffmanStream(context.huffman, data, compressedSize, context.literals.data(), regeneratedSize);
+        }
+        else
+        {
+            // 네 스트림은 앞의 6 바이트 점프 표에 처음 세 스트림의 크기가 적혀 있고, 출력은 (크기 + 3) / 4 씩 나눕니다.
+            require(compressedSize >= 6);
+            size_t streamSizes[4] = { readLE(data, 2), readLE(data + 2, 2), readLE(data + 4, 2), 0 };
+            require(6 + streamSizes[0] + streamSizes[1] + streamSizes[2] <= compressedSize);
+            streamSizes[3] = compressedSize - 6 - streamSizes[0] - streamSizes[1] - streamSizes[2];
+            const size_t segmentSize = (regeneratedSize + 3) / 4;
+            require(segmentSize * 3 <= regeneratedSize);
+            const uint8_t* stream = data + 6;
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                size_t count = i < 3 ? segmentSize : regeneratedSize - segmentSize * 3;
+                decodeHuffmanStream(context.huffman, stream, streamSizes[i], context.literals.data() + segmentSize * i, count);
+                stream += streamSizes[i];
+            }
+        }
+        return sectionSize;
+    }
+
+    // 시퀀스 코드 하나의 표를 모드(0 : 기본 분포, 1 : RLE, 2 : FSE 표 설명, 3 : 이전 블록 표)에 따라 준비하고 읽은 바이트 수를 반환합니다.
+    inline size_t readSequenceTable(uint32_t mode, const uint8_t* src, size_t size, const int16_t* defaultProbabilities, uint32_t defaultSymbolCount, uint32_t defaultAccuracyLog, uint32_t maxSymbol, uint32_t maxAccuracyLog, FseTable& table)
+    {
+        switch (mode)
+        {
+        case 0:
+            buildFseTable(defaultProbabilities, defaultSymbolCount, defaultAccuracyLog, table);
+            return 0;
+        case 1:
+            require(size >= 1 && src[0] <= maxSymbol);
+            buildRleTable(src[0], table);
+            return 1;
+        case 2:
+            return readFseTable(src, size, maxSymbol, maxAccuracyLog, table);
+        default:
+            require(table.entries.empty() == false);
+            return 0;
+        }
+    }
+
+    // 압축된 블록 하나를 dst 의 written 위치부터 풉니다. 일치 구간은 같은 프레임 안(frameStart 이후)만 가리킬 수 있습니다.
+    inline void decodeCompressedBlock(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize, size_t frameStart, size_t& written, FrameContext& context)
+    {
+        size_t position = decodeLiterals(src, size, context);
+
+        require(position < size);
+        uint32_t sequenceCount = src[position++];
+        if (sequenceCount >= 128)
+        {
+            require(position < size);
+            if (sequenceCount < 255)
+            {
+                sequenceCount = ((sequenceCount - 128) << 8) + src[position++];
+            }
+            else
+            {
+                require(position + 2 <= size);
+                sequenceCount = readLE(src + position, 2) + 0x7F00;
+                position += 2;
+            }
+        }
+
+        const std::vector<uint8_t>& literals = context.literals;
+        size_t literalPosition = 0;
+        if (sequenceCount > 0)
+        {
+            require(position < size);
+            const uint32_t modes = src[position++];
+            require((modes & 3) == 0);
+            position += readSequenceTable(modes >> 6, src + position, size - position, LITERAL_LENGTH_DEFAULT, 36, 6, 35, 9, context.literalLengths);
+            require(position <= size);
+            position += readSequenceTable((modes >> 4) & 3, src + position, size - position, OFFSET_DEFAULT, 29, 5, 31, 8, context.offsets);
+            require(position <= size);
+            position += readSequenceTable((modes >> 2) & 3, src + position, size - position, MATCH_LENGTH_DEFAULT, 53, 6, 52, 9, context.matchLengths);
+            require(position < size);
+
+            BackwardBitReader reader(src + position, size - position);
+            FseState literalLengthState, offsetState, matchLengthState;
+            literalLengthState.init(reader, context.literalLengths);
+            offsetState.init(reader, context.offsets);
+            matchLengthState.init(reader, context.matchLengths);
+
+            uint32_t* repeatOffsets = context.repeatOffsets;
+            for (uint32_t i = 0; i < sequenceCount; i++)
+            {
+                // 추가 비트는 오프셋, 일치 길이, 리터럴 길이 순서로 읽습니다.
+                const uint32_t offsetCode = offsetState.getSymbol(context.offsets);
+                const uint32_t matchLengthCode = matchLengthState.getSymbol(context.matchLengths);
+                const uint32_t literalLengthCode = literalLengthState.getSymbol(context.literalLengths);
+                require(offsetCode <= 31 && matchLengthCode <= 52 && literalLengthCode <= 35);
+                const uint32_t offsetValue = (1u << offsetCode) + reader.read(offsetCode);
+                const size_t matchLength = MATCH_LENGTH_BASE[matchLengthCode] + reader.read(MATCH_LENGTH_BITS[matchLengthCode]);
+                const size_t literalLength = LITERAL_LENGTH_BASE[literalLengthCode] + reader.read(LITERAL_LENGTH_BITS[literalLengthCode]);
+
+                // 1 ~ 3 은 최근 오프셋을 다시 쓰는 코드입니다. 리터럴 길이가 0 이면 한 칸씩 밀리고, 마지막은 "가장 최근 오프셋 - 1" 입니다.
+                uint32_t offset;
+                if (offsetValue > 3)
+                {
+                    offset = offsetValue - 3;
+                    repeatOffsets[2] = repeatOffsets[1];
+                    repeatOffsets[1] = repeatOffsets[0];
+                    repeatOffsets[0] = offset;
+                }
+                else
+                {
+                    const uint32_t index = offsetValue - 1 + (literalLength == 0 ? 1 : 0);
+                    if (index == 0)
+                    {
+                        offset = repeatOffsets[0];
+                    }
+                    else
+                    {
+                        offset = index == 3 ? repeatOffsets[0] - 1 : repeatOffsets[index];
+                        if (index > 1)
+                        {
+                            repeatOffsets[2] = repeatOffsets[1];
+                        }
+                        repeatOffsets[1] = repeatOffsets[0];
+                        repeatOffsets[0] = offset;
+                    }
+                }
+
+                if (i + 1 < sequenceCount)
+                {
+                    literalLengthState.update(reader, context.literalLengths);
+                    matchLengthState.update(reader, context.matchLengths);
+                    offsetState.update(reader, context.offsets);
+                }
+
+                require(literalPosition + literalLength <= literals.size() && written + literalLength + matchLength <= dstSize);
+                if (literalLength > 0)
+                {
+                    std::memcpy(dst + written, literals.data() + literalPosition, literalLength);
+                    literalPosition += literalLength;
+                    written += literalLength;
+                }
+
+                require(offset != 0 && offset <= written - frameStart);
+                const uint8_t* match = dst + written - offset;
+                if (offset >= matchLength)
+                {
+                    std::memcpy(dst + written, match, matchLength);
+                }
+                else
+                {
+                    // 겹치는 일치 구간은 방금 쓴 바이트를 다시 읽어야 하므로 한 바이트씩 복사합니다.
+                    for (size_t j = 0; j < matchLength; j++)
+                    {
+                        dst[written + j] = match[j];
+                    }
+                }
+                written += matchLength;
+            }
+            // 마지막 시퀀스 뒤에는 비트가 하나도 남지 않아야 합니다.
+            require(reader.position == 0);
+        }
+
+        const size_t remaining = literals.size() - literalPosition;
+        require(written + remaining <= dstSize);
+        // 리터럴이 비어 있으면 literals.data() 가 널일 수 있으므로 memcpy 를 건너뜁니다.
+        if (remaining > 0)
+        {
+            std::memcpy(dst + written, literals.data() + literalPosition, remaining);
+            written += remaining;
+        }
+    }
+
+    // src 의 zstd 프레임(여러 개가 이어져 있어도 됩니다)을 풀어 dst 를 정확히 채웁니다.
+    inline void decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+    {
+        size_t position = 0;
+        size_t written = 0;
+        while (position < srcSize)
+        {
+            require(srcSize - position >= 4);
+            const uint32_t magic = readLE(src + position, 4);
+            position += 4;
+
+            // 건너뛰는 프레임 (사용자 데이터)
+            if ((magic & 0xFFFFFFF0u) == 0x184D2A50u)
+            {
+                require(srcSize - position >= 4);
+                const size_t skipSize = readLE(src + position, 4);
+                require(srcSize - position - 4 >= skipSize);
+                position += 4 + skipSize;
+                continue;
+            }
+            require(magic == 0xFD2FB528u);
+
+            // 프레임 헤더 : 설명 바이트, 창 크기, 사전 ID, 내용 크기
+            require(position < srcSize);
+            const uint32_t descriptor = src[position++];
+            const uint32_t contentSizeFlag = descriptor >> 6;
+            const bool singleSegment = (descriptor >> 5) & 1;
+            const bool hasChecksum = (descriptor >> 2) & 1;
+            const uint32_t dictionaryIdSize = (descriptor & 3) == 3 ? 4 : (descriptor & 3);
+            const uint32_t contentSizeBytes = contentSizeFlag == 0 ? (singleSegment ? 1 : 0) : (1u << contentSizeFlag);
+            require((descriptor & 8) == 0);
+            const size_t headerSize = (singleSegment ? 0 : 1) + dictionaryIdSize + contentSizeBytes;
+            require(srcSize - position >= headerSize);
+            position += singleSegment ? 0 : 1;
+            if (readLE(src + position, dictionaryIdSize) != 0)
+            {
+                throw std::runtime_error("zstd frames with a dictionary are not supported!");
+            }
+            position += dictionaryIdSize;
+            uint64_t contentSize = 0;
+            for (uint32_t i = 0; i < contentSizeBytes; i++)
+            {
+                contentSize |= uint64_t(src[position + i]) << (i * 8);
+            }
+            contentSize += contentSizeBytes == 2 ? 256 : 0;
+            position += contentSizeBytes;
+
+            const size_t frameStart = written;
+            FrameContext context;
+            for (;;)
+            {
+                require(srcSize - position >= 3);
+                const uint32_t blockHeader = readLE(src + position, 3);
+                position += 3;
+                const bool lastBlock = blockHeader & 1;
+                const uint32_t blockType = (blockHeader >> 1) & 3;
+                const size_t blockSize = blockHeader >> 3;
+                require(blockType != 3);
+
+                // 0 : 그대로, 1 : 한 바이트를 blockSize 번 반복, 2 : 압축
+                const size_t payloadSize = blockType == 1 ? 1 : blockSize;
+                require(srcSize - position >= payloadSize);
+                if (blockType == 2)
+                {
+                    decodeCompressedBlock(src + position, blockSize, dst, dstSize, frameStart, written, context);
+                }
+                else
+                {
+                    require(dstSize - written >= blockSize);
+                    if (blockType == 0)
+                    {
+                        std::memcpy(dst + written, src + position, blockSize);
+                    }
+                    else
+                    {
+                        std::memset(dst + written, src[position], blockSize);
+                    }
+                    written += blockSize;
+                }
+                position += payloadSize;
+
+                if (lastBlock)
+                {
+                    break;
+                }
+            }
+
+            if (hasChecksum)
+            {
+                require(srcSize - position >= 4);
+                position += 4;
+            }
+            require(contentSizeBytes == 0 || written - frameStart == contentSize);
+        }
+        require(written == dstSize);
+    }
+}